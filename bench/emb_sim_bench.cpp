@@ -0,0 +1,307 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Agreement check and benchmark of the embedding similarity kernels of
+/// srcs/embedding_similarity.cpp (make bench). Every instruction set the
+/// machine supports is compared against the scalar kernels, for fp32, fp16
+/// and int8 rows, over dimensions that exercise every vector width and tail,
+/// from misaligned buffers; then emb_sim_score_batch is timed per
+/// instruction set and row type.
+///
+///   ./emb_sim_bench [--rows N] [--dim D] [--iterations N]
+///
+/// Results may differ from the scalar ones by the reordering of the sums
+/// (and FMA), so they are compared relative to the sum of the magnitudes of
+/// the terms. It exits non-zero on a mismatch.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "embedding_similarity.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const EmbSimIsa kIsas[] = {EMB_SIM_ISA_SCALAR, EMB_SIM_ISA_SSE42, EMB_SIM_ISA_AVX2,
+                                  EMB_SIM_ISA_AVX512, EMB_SIM_ISA_NEON};
+static const EmbSimDataType kTypes[] = {EMB_SIM_FP32, EMB_SIM_FP16, EMB_SIM_INT8};
+static const EmbSimMetric kMetrics[] = {EMB_SIM_DOT, EMB_SIM_COSINE, EMB_SIM_L2};
+static const char *const kTypeNames[] = {"fp32", "fp16", "int8"};
+static const char *const kMetricNames[] = {"dot", "cosine", "l2"};
+
+/// Relative tolerance of a sum of n terms against the scalar one
+static const float kTolerance = 1e-5f;
+
+/// splitmix64
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /// Uniform in [-1, 1)
+    float symmetric() { return (float) ((int64_t) (next() >> 40) - (1 << 23)) / (1 << 23); }
+};
+
+/// Reference rows of one type, one row every stride bytes
+struct Matrix {
+    EmbSimDataType type;
+    float scale;
+    size_t stride;
+    std::vector<uint8_t> bytes;
+    /// Dequantized values, for the magnitudes of the terms
+    std::vector<float> values;
+
+    const void *row(unsigned r) const { return bytes.data() + 1 + r * stride; }
+};
+
+static size_t elementSize(EmbSimDataType type)
+{
+    return type == EMB_SIM_FP32 ? sizeof(float) : type == EMB_SIM_FP16 ? sizeof(uint16_t) : sizeof(int8_t);
+}
+
+/// rows x dim values in [-1, 1), with tiny ones (subnormal in fp16) every
+/// fifth element; rows start one byte past an aligned address and are padded by one
+/// element, so no load is aligned
+static Matrix makeMatrix(EmbSimDataType type, unsigned rows, unsigned dim, bool tiny, Random &rng)
+{
+    Matrix m;
+    m.type = type;
+    m.scale = 1.0f / 127;
+    m.stride = elementSize(type) * (dim + 1);
+    m.bytes.assign(1 + m.stride * rows, 0);
+    m.values.resize((size_t) rows * dim);
+    for (unsigned r = 0; r < rows; r++) {
+        uint8_t *row = m.bytes.data() + 1 + r * m.stride;
+        for (unsigned i = 0; i < dim; i++) {
+            float v = rng.symmetric();
+            if (tiny && i % 5 == 4)
+                v *= 1e-5f;
+            if (type == EMB_SIM_FP32) {
+                memcpy(row + i * sizeof(float), &v, sizeof(v));
+            } else if (type == EMB_SIM_FP16) {
+                uint16_t h = emb_sim_f32_to_f16(v);
+                memcpy(row + i * sizeof(h), &h, sizeof(h));
+                v = emb_sim_f16_to_f32(h);
+            } else {
+                int8_t q = (int8_t) std::lround(v * 127);
+                row[i] = (uint8_t) q;
+                v = q * m.scale;
+            }
+            m.values[(size_t) r * dim + i] = v;
+        }
+    }
+    return m;
+}
+
+/// Sum of the magnitudes of the terms of the score of row r
+static float magnitude(EmbSimMetric metric, const float *query, const Matrix &m, unsigned r, unsigned dim)
+{
+    float sum = 0.0f;
+    for (unsigned i = 0; i < dim; i++) {
+        float b = m.values[(size_t) r * dim + i];
+        sum += metric == EMB_SIM_L2 ? (query[i] - b) * (query[i] - b) : std::fabs(query[i] * b);
+    }
+    // Cosine scores are divided by the norms
+    return metric == EMB_SIM_COSINE ? 1.0f : sum;
+}
+
+static bool close(float value, float expected, float scale)
+{
+    return std::fabs(value - expected) <= kTolerance * (scale + 1e-3f);
+}
+
+static int checkIsa(EmbSimIsa isa)
+{
+    static const unsigned kDims[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65,
+                                     127, 128, 129, 255, 256, 257, 511, 512, 513, 1023};
+    const unsigned rows = 5;
+    int failures = 0;
+    for (unsigned dim : kDims) {
+        Random rng(dim);
+        // Query one float past an aligned address too
+        std::vector<float> queryBuffer(dim + 1);
+        float *query = queryBuffer.data() + 1;
+        for (unsigned i = 0; i < dim; i++)
+            query[i] = rng.symmetric();
+
+        for (EmbSimDataType type : kTypes) {
+            Matrix m = makeMatrix(type, rows, dim, true, rng);
+            for (EmbSimMetric metric : kMetrics) {
+                std::vector<float> expected(rows), scores(rows), withNorms(rows), norms(rows);
+                for (unsigned r = 0; r < rows; r++)
+                    norms[r] = emb_sim_norm(&m.values[(size_t) r * dim], dim);
+                emb_sim_set_isa(EMB_SIM_ISA_SCALAR);
+                emb_sim_score_batch(metric, query, dim, m.row(0), type, m.scale, rows, m.stride,
+                                    nullptr, expected.data());
+                emb_sim_set_isa(isa);
+                emb_sim_score_batch(metric, query, dim, m.row(0), type, m.scale, rows, m.stride,
+                                    nullptr, scores.data());
+                emb_sim_score_batch(metric, query, dim, m.row(0), type, m.scale, rows, m.stride,
+                                    norms.data(), withNorms.data());
+                for (unsigned r = 0; r < rows; r++) {
+                    float scale = magnitude(metric, query, m, r, dim);
+                    if (!close(scores[r], expected[r], scale) || !close(withNorms[r], expected[r], scale)) {
+                        if (failures++ < 10)
+                            printf("  MISMATCH %s %s dim %u row %u: %.9g / %.9g, scalar %.9g\n",
+                                   kTypeNames[type], kMetricNames[metric], dim, r, scores[r],
+                                   withNorms[r], expected[r]);
+                    }
+                }
+            }
+
+            // One-to-one fp32 kernels
+            if (type != EMB_SIM_FP32)
+                continue;
+            const float *b = (const float *) m.row(0);
+            emb_sim_set_isa(EMB_SIM_ISA_SCALAR);
+            float dot = emb_sim_dot(query, b, dim), l2 = emb_sim_l2sq(query, b, dim);
+            float cosine = emb_sim_cosine(query, b, dim), norm = emb_sim_norm(query, dim);
+            emb_sim_set_isa(isa);
+            if (!close(emb_sim_dot(query, b, dim), dot, magnitude(EMB_SIM_DOT, query, m, 0, dim)) ||
+                !close(emb_sim_l2sq(query, b, dim), l2, magnitude(EMB_SIM_L2, query, m, 0, dim)) ||
+                !close(emb_sim_cosine(query, b, dim), cosine, 1.0f) ||
+                !close(emb_sim_norm(query, dim), norm, norm)) {
+                if (failures++ < 10)
+                    printf("  MISMATCH one-to-one fp32 dim %u\n", dim);
+            }
+        }
+    }
+    return failures;
+}
+
+/// Every half widens to the scalar value in the vector loops: rows of 16
+/// holding one half, scored against a one-hot query
+static int checkHalfRows()
+{
+    const unsigned dim = 16;
+    std::vector<uint16_t> rows((size_t) 0x10000 * dim, 0);
+    for (uint32_t h = 0; h < 0x10000; h++)
+        rows[(size_t) h * dim + h % dim] = (uint16_t) h;
+    std::vector<float> scores(0x10000);
+    int failures = 0;
+    for (unsigned lane = 0; lane < dim; lane++) {
+        float query[dim] = {};
+        query[lane] = 1.0f;
+        emb_sim_score_batch(EMB_SIM_DOT, query, dim, rows.data(), EMB_SIM_FP16, 1.0f, 0x10000, 0,
+                            nullptr, scores.data());
+        for (uint32_t h = lane; h < 0x10000; h += dim) {
+            float f = emb_sim_f16_to_f32((uint16_t) h);
+            if (std::isnan(f) ? !std::isnan(scores[h]) : scores[h] != f) {
+                if (failures++ < 5)
+                    printf("  MISMATCH half 0x%04x: %.9g, scalar %.9g\n", h, scores[h], f);
+            }
+        }
+    }
+    return failures;
+}
+
+/// Every half converts to float and back to itself
+static int checkHalf()
+{
+    int failures = 0;
+    for (uint32_t h = 0; h < 0x10000; h++) {
+        bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x3ff);
+        float f = emb_sim_f16_to_f32((uint16_t) h);
+        if (nan ? !std::isnan(f) : emb_sim_f32_to_f16(f) != h)
+            failures++;
+    }
+    if (failures)
+        printf("  %d halves do not round trip\n", failures);
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned rows = 10000, dim = 256, iterations = 20;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--rows") && i + 1 < argc)
+            rows = (unsigned) std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--dim") && i + 1 < argc)
+            dim = (unsigned) std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            iterations = (unsigned) std::atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--rows N] [--dim D] [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+    rows = rows ? rows : 1;
+    dim = dim ? dim : 1;
+    iterations = iterations ? iterations : 1;
+
+    const EmbSimIsa detected = emb_sim_get_isa();
+    int failures = checkHalf();
+    printf("%-8s %-10s\n", "isa", "agreement");
+    for (EmbSimIsa isa : kIsas) {
+        if (!emb_sim_set_isa(isa)) {
+            printf("%-8s %-10s\n", emb_sim_isa_name(isa), "n/a");
+            continue;
+        }
+        int f = checkIsa(isa) + checkHalfRows();
+        printf("%-8s %-10s\n", emb_sim_isa_name(isa), f ? "FAILED" : "ok");
+        failures += f;
+    }
+
+    // emb_sim_score_batch over rows x dim, cosine with precomputed norms
+    printf("\nemb_sim_score_batch, %u rows x %u, cosine\n%-8s %10s %10s %10s\n", rows, dim, "isa",
+           "fp32 ns/row", "fp16 ns/row", "int8 ns/row");
+    Random rng(0xBE7C);
+    std::vector<float> query(dim), scores(rows), norms(rows);
+    for (float &v : query)
+        v = rng.symmetric();
+    std::vector<Matrix> matrices;
+    for (EmbSimDataType type : kTypes)
+        matrices.push_back(makeMatrix(type, rows, dim, false, rng));
+    for (unsigned r = 0; r < rows; r++)
+        norms[r] = emb_sim_norm(&matrices[0].values[(size_t) r * dim], dim);
+    for (EmbSimIsa isa : kIsas) {
+        if (!emb_sim_set_isa(isa))
+            continue;
+        printf("%-8s", emb_sim_isa_name(isa));
+        for (const Matrix &m : matrices) {
+            emb_sim_score_batch(EMB_SIM_COSINE, query.data(), dim, m.row(0), m.type, m.scale, rows,
+                                m.stride, norms.data(), scores.data());
+            Clock::time_point start = Clock::now();
+            for (unsigned k = 0; k < iterations; k++)
+                emb_sim_score_batch(EMB_SIM_COSINE, query.data(), dim, m.row(0), m.type, m.scale, rows,
+                                    m.stride, norms.data(), scores.data());
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            printf(" %10.1f", ns / iterations / rows);
+        }
+        printf("\n");
+    }
+    emb_sim_set_isa(detected);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,601 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Round-trip check of the binary event payloads of srcs/event_codec.cpp,
+/// and size comparison with the JSON messages (make bench).
+///
+/// - Event records, written with event_codec_write_record() and read back
+///   with event_codec_next_record(): empty and absent strings, zero-length
+///   and odd-length embeddings, every prefix of the message (a truncated
+///   message only yields its complete records) and corrupt record sizes.
+/// - Heatmaps: cell counts and occupancy deltas over every varint length,
+///   both zigzag signs, empty grids and windows, and every prefix.
+/// - EventBatcher messages in EVENT_BATCH_BINARY, decoded and compared with
+///   the metas they were built from.
+///
+/// Then one message of N objects per frame is built in EVENT_BATCH_JSON and
+/// EVENT_BATCH_BINARY, for several embedding sizes, and the bytes and time
+/// per object are compared.
+///
+///   ./event_codec_bench [--objects N] [--iterations N]
+///
+/// It exits non-zero on a mismatch.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "event_batcher.h"
+#include "event_codec.h"
+
+using Clock = std::chrono::steady_clock;
+
+/// splitmix64
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t below(uint32_t n) { return (uint32_t) (next() % n); }
+
+    /// Uniform in [-1, 1)
+    float symmetric() { return (float) ((int64_t) (next() >> 40) - (1 << 23)) / (1 << 23); }
+};
+
+/// A copy of the message in a buffer of exactly its size, 8-byte aligned, so
+/// that a read past the end is caught under ASan
+struct Buffer {
+    std::vector<uint8_t> bytes;
+
+    Buffer(const uint8_t *data, size_t size) : bytes(data, data + size) {}
+    const uint8_t *data() const { return bytes.empty() ? nullptr : bytes.data(); }
+    size_t size() const { return bytes.size(); }
+};
+
+/// Record and the storage its pointers refer to
+struct OwnedRecord {
+    EventCodecRecord record;
+    std::vector<float> embedding;
+    std::string label, image, direction, attrs;
+};
+
+static bool sameBytes(const char *a, uint16_t a_len, const char *b, uint16_t b_len)
+{
+    return a_len == b_len && (!a_len || !memcmp(a, b, a_len));
+}
+
+/// Decoded record against what was encoded: absent strings and embeddings
+/// come back empty
+static bool sameRecord(const EventCodecRecord &encoded, const EventCodecRecord &decoded)
+{
+    uint32_t embedding_len = encoded.embedding ? encoded.embedding_len : 0;
+    uint16_t label_len = encoded.label ? encoded.label_len : 0;
+    uint16_t image_len = encoded.image ? encoded.image_len : 0;
+    uint16_t direction_len = encoded.direction ? encoded.direction_len : 0;
+    uint16_t attrs_len = encoded.attrs ? encoded.attrs_len : 0;
+    return encoded.event_type == decoded.event_type && encoded.object_type == decoded.object_type &&
+           encoded.tracking_id == decoded.tracking_id &&
+           encoded.timestamp_us == decoded.timestamp_us && encoded.frame_id == decoded.frame_id &&
+           encoded.class_id == decoded.class_id &&
+           !memcmp(&encoded.confidence, &decoded.confidence, sizeof(float)) &&
+           !memcmp(encoded.bbox, decoded.bbox, sizeof(encoded.bbox)) &&
+           decoded.embedding_len == embedding_len &&
+           (embedding_len ? decoded.embedding &&
+                                !memcmp(encoded.embedding, decoded.embedding, embedding_len * sizeof(float))
+                          : !decoded.embedding) &&
+           sameBytes(encoded.label, label_len, decoded.label, decoded.label_len) &&
+           sameBytes(encoded.image, image_len, decoded.image, decoded.image_len) &&
+           sameBytes(encoded.direction, direction_len, decoded.direction, decoded.direction_len) &&
+           sameBytes(encoded.attrs, attrs_len, decoded.attrs, decoded.attrs_len);
+}
+
+static std::string randomString(Random &rng, size_t len)
+{
+    std::string s(len, '\0');
+    for (char &c : s)
+        c = (char) rng.below(256);  /// any byte, NUL included: lengths are explicit
+    return s;
+}
+
+static std::vector<OwnedRecord> makeRecords(Random &rng)
+{
+    static const uint32_t kEmbeddingLens[] = {0, 1, 3, 7, 128, 255, 256};
+    static const size_t kStringLens[] = {0, 1, 7, 8, 9, 300};
+    std::vector<OwnedRecord> records;
+    for (uint32_t embedding_len : kEmbeddingLens) {
+        for (size_t string_len : kStringLens) {
+            OwnedRecord owned;
+            EventCodecRecord &r = owned.record;
+            r = {};
+            r.event_type = (uint16_t) rng.below(8);
+            r.object_type = (uint16_t) rng.below(0x103);
+            r.tracking_id = rng.next();
+            r.timestamp_us = (int64_t) rng.next();
+            r.frame_id = (int32_t) rng.next();
+            r.class_id = (int32_t) rng.next();
+            r.confidence = rng.symmetric();
+            for (float &v : r.bbox)
+                v = rng.symmetric() * 4096.f;
+            owned.embedding.resize(embedding_len);
+            for (float &v : owned.embedding)
+                v = rng.symmetric();
+            owned.label = randomString(rng, string_len);
+            owned.image = randomString(rng, string_len / 2);
+            owned.direction = randomString(rng, string_len ? 1 : 0);
+            owned.attrs = randomString(rng, string_len * 3);
+            records.push_back(std::move(owned));
+        }
+    }
+    /// Absent strings and embedding, with lengths that must be ignored
+    OwnedRecord absent;
+    absent.record = {};
+    absent.record.embedding_len = 16;
+    absent.record.label_len = 5;
+    absent.record.image_len = 3;
+    absent.record.direction_len = 2;
+    absent.record.attrs_len = 9;
+    records.push_back(absent);
+    /// Longest strings a record holds
+    OwnedRecord longest;
+    longest.record = {};
+    longest.label = randomString(rng, UINT16_MAX);
+    longest.attrs = randomString(rng, UINT16_MAX);
+    records.push_back(std::move(longest));
+
+    for (OwnedRecord &owned : records) {
+        EventCodecRecord &r = owned.record;
+        if (!owned.embedding.empty() || r.embedding_len == 0) {
+            r.embedding = owned.embedding.empty() ? nullptr : owned.embedding.data();
+            r.embedding_len = (uint32_t) owned.embedding.size();
+        }
+        if (!r.label_len) {
+            /// Point at the storage, also for the empty strings: present,
+            /// but zero-length
+            r.label = owned.label.data();
+            r.label_len = (uint16_t) owned.label.size();
+            r.image = owned.image.data();
+            r.image_len = (uint16_t) owned.image.size();
+            r.direction = owned.direction.data();
+            r.direction_len = (uint16_t) owned.direction.size();
+            r.attrs = owned.attrs.data();
+            r.attrs_len = (uint16_t) owned.attrs.size();
+        }
+    }
+    return records;
+}
+
+/// Decode a message of records; fails unless exactly the records entirely
+/// within it come back, unchanged
+static int decodeRecords(const uint8_t *data, size_t size, const std::vector<OwnedRecord> &records,
+                         const std::vector<size_t> &ends, const std::string &sensor)
+{
+    EventCodecMessage message;
+    size_t offset = event_codec_decode_header(data, size, &message);
+    size_t header_size = event_codec_header_size((uint32_t) sensor.size());
+    if (size < header_size)
+        return offset != 0;
+    if (offset != header_size || message.num_records != records.size() || message.sensor_id != -7 ||
+        !sameBytes(message.sensor, (uint16_t) message.sensor_len, sensor.data(),
+                   (uint16_t) sensor.size()))
+        return 1;
+
+    size_t complete = 0;
+    while (complete < ends.size() && ends[complete] <= size)
+        complete++;
+    size_t decoded = 0;
+    EventCodecRecord record;
+    while (event_codec_next_record(data, size, &offset, &record)) {
+        if (decoded >= complete || !sameRecord(records[decoded].record, record) ||
+            offset != ends[decoded])
+            return 1;
+        decoded++;
+    }
+    return decoded != complete;
+}
+
+static int checkRecords()
+{
+    Random rng(0xC0DEC);
+    int failures = 0;
+    std::vector<OwnedRecord> records = makeRecords(rng);
+
+    for (const std::string &sensor : {std::string(), std::string("cam-0"), randomString(rng, 8)}) {
+        size_t size = event_codec_header_size((uint32_t) sensor.size());
+        for (const OwnedRecord &owned : records)
+            size += event_codec_record_size(&owned.record);
+        std::vector<uint64_t> storage((size + 7) / 8);
+        uint8_t *message = (uint8_t *) storage.data();
+
+        size_t offset = event_codec_write_header(message, (uint32_t) records.size(), -7,
+                                                 sensor.empty() ? nullptr : sensor.data(),
+                                                 (uint32_t) sensor.size());
+        std::vector<size_t> ends;
+        for (const OwnedRecord &owned : records) {
+            size_t written = event_codec_write_record(message + offset, &owned.record);
+            if (written != event_codec_record_size(&owned.record) || written % 8) {
+                fprintf(stderr, "record: wrote %zu bytes\n", written);
+                failures++;
+            }
+            offset += written;
+            ends.push_back(offset);
+        }
+        if (offset != size) {
+            fprintf(stderr, "records: %zu bytes written, %zu expected\n", offset, size);
+            return failures + 1;
+        }
+
+        Buffer whole(message, size);
+        if (decodeRecords(whole.data(), whole.size(), records, ends, sensor)) {
+            fprintf(stderr, "records: round trip failed (sensor of %zu bytes)\n", sensor.size());
+            failures++;
+        }
+        /// Every prefix up to the end of the small records, then around
+        /// every record end
+        int truncated = 0;
+        for (size_t len = 0; len < size; len++) {
+            bool near_end = false;
+            for (size_t end : ends)
+                near_end |= len + 16 >= end && len <= end + 16;
+            if (len > ends[ends.size() / 2] && !near_end)
+                continue;
+            Buffer prefix(message, len);
+            truncated += decodeRecords(prefix.data(), prefix.size(), records, ends, sensor);
+        }
+        if (truncated) {
+            fprintf(stderr, "records: %d truncated messages misread\n", truncated);
+            failures++;
+        }
+    }
+
+    /// A record size that does not cover the payload, or runs past the end
+    {
+        const OwnedRecord &owned = records[10];
+        size_t header_size = event_codec_header_size(0);
+        std::vector<uint64_t> storage((header_size + event_codec_record_size(&owned.record)) / 8);
+        uint8_t *message = (uint8_t *) storage.data();
+        event_codec_write_header(message, 1, 0, nullptr, 0);
+        size_t size = header_size + event_codec_write_record(message + header_size, &owned.record);
+        for (uint32_t record_size : {0u, 8u, (uint32_t) EVENT_CODEC_RECORD_HEADER_SIZE,
+                                     (uint32_t) (size - header_size + 8), 0xFFFFFFFFu}) {
+            memcpy(message + header_size, &record_size, sizeof(record_size));
+            size_t offset = header_size;
+            EventCodecRecord record;
+            if (event_codec_next_record(message, size, &offset, &record) || offset != header_size) {
+                fprintf(stderr, "records: record_size %u accepted\n", record_size);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+struct OwnedHeatmap {
+    EventCodecHeatmap heatmap;
+    std::vector<uint32_t> cells;
+    std::vector<uint16_t> occupancy;
+};
+
+static OwnedHeatmap makeHeatmap(uint16_t width, uint16_t height, uint32_t num_frames,
+                                unsigned density, Random &rng)
+{
+    /// Counts and deltas over every varint length
+    static const uint32_t kCounts[] = {1, 127, 128, 16383, 16384, 2097151, 2097152,
+                                       268435455, 268435456, 0xFFFFFFFFu};
+    OwnedHeatmap owned;
+    owned.cells.resize((size_t) width * height);
+    for (uint32_t &c : owned.cells)
+        c = rng.below(100) < density ? kCounts[rng.below(10)] : 0;
+    owned.occupancy.resize(num_frames);
+    uint16_t occupancy = 0;
+    for (uint32_t i = 0; i < num_frames; i++) {
+        switch (rng.below(4)) {
+        case 0: occupancy = (uint16_t) rng.below(65536); break;           /// any jump
+        case 1: occupancy = occupancy ? 0 : UINT16_MAX; break;            /// largest deltas
+        case 2: occupancy = (uint16_t) (occupancy + rng.below(5) - 2); break;
+        default: break;
+        }
+        owned.occupancy[i] = occupancy;
+    }
+    EventCodecHeatmap &h = owned.heatmap;
+    h.sensor_id = (int32_t) rng.next();
+    h.grid_width = width;
+    h.grid_height = height;
+    h.cell_size = (uint16_t) rng.below(65536);
+    h.start_us = (int64_t) rng.next();
+    h.end_us = (int64_t) rng.next();
+    h.num_frames = num_frames;
+    h.cells = owned.cells.data();
+    h.occupancy = owned.occupancy.data();
+    return owned;
+}
+
+static int checkHeatmaps()
+{
+    struct Shape {
+        uint16_t width, height;
+        uint32_t num_frames;
+        unsigned density;  ///< percent of non-zero cells
+    };
+    static const Shape kShapes[] = {
+        {0, 0, 0, 0},   {1, 1, 0, 0},   {1, 1, 1, 100}, {60, 34, 300, 5},
+        {60, 34, 1, 0}, {7, 3, 17, 50}, {40, 23, 9000, 100},
+    };
+    Random rng(0x4EA7);
+    int failures = 0;
+    for (const Shape &shape : kShapes) {
+        OwnedHeatmap owned = makeHeatmap(shape.width, shape.height, shape.num_frames, shape.density, rng);
+        const EventCodecHeatmap &h = owned.heatmap;
+        std::vector<uint8_t> message(event_codec_heatmap_max_size(&h));
+        size_t size = event_codec_write_heatmap(message.data(), &h);
+        if (size > message.size()) {
+            fprintf(stderr, "heatmap %ux%u: %zu bytes, bound %zu\n", shape.width, shape.height, size,
+                    message.size());
+            failures++;
+            continue;
+        }
+
+        Buffer whole(message.data(), size);
+        EventCodecHeatmap header, decoded;
+        std::vector<uint32_t> cells(owned.cells.size() + 1);
+        std::vector<uint16_t> occupancy(owned.occupancy.size() + 1);
+        bool ok = event_codec_decode_heatmap(whole.data(), whole.size(), &header, nullptr, nullptr) &&
+                  event_codec_decode_heatmap(whole.data(), whole.size(), &decoded, cells.data(),
+                                             occupancy.data());
+        ok = ok && header.grid_width == h.grid_width && header.grid_height == h.grid_height &&
+             header.num_frames == h.num_frames && !header.cells && !header.occupancy;
+        ok = ok && decoded.sensor_id == h.sensor_id && decoded.grid_width == h.grid_width &&
+             decoded.grid_height == h.grid_height && decoded.cell_size == h.cell_size &&
+             decoded.start_us == h.start_us && decoded.end_us == h.end_us &&
+             decoded.num_frames == h.num_frames && decoded.cells == cells.data() &&
+             decoded.occupancy == occupancy.data() &&
+             std::equal(owned.cells.begin(), owned.cells.end(), cells.begin()) &&
+             std::equal(owned.occupancy.begin(), owned.occupancy.end(), occupancy.begin());
+        if (!ok) {
+            fprintf(stderr, "heatmap %ux%u, %u frames: round trip failed\n", shape.width,
+                    shape.height, shape.num_frames);
+            failures++;
+        }
+
+        int accepted = 0;
+        for (size_t len = 0; len < size; len++) {
+            Buffer prefix(message.data(), len);
+            accepted += event_codec_decode_heatmap(prefix.data(), prefix.size(), &decoded,
+                                                   cells.data(), occupancy.data());
+        }
+        if (accepted) {
+            fprintf(stderr, "heatmap %ux%u: %d truncated messages accepted\n", shape.width,
+                    shape.height, accepted);
+            failures++;
+        }
+    }
+
+    /// A cell index past the grid
+    {
+        OwnedHeatmap owned = makeHeatmap(4, 4, 2, 0, rng);
+        owned.cells[15] = 3;
+        std::vector<uint8_t> message(event_codec_heatmap_max_size(&owned.heatmap));
+        size_t size = event_codec_write_heatmap(message.data(), &owned.heatmap);
+        message[EVENT_CODEC_HEATMAP_HEADER_SIZE] = 16;  /// skip 16 instead of 15
+        /// One spare cell: an overrun shows as an accepted message
+        std::vector<uint32_t> cells(17);
+        std::vector<uint16_t> occupancy(2);
+        EventCodecHeatmap decoded;
+        if (event_codec_decode_heatmap(message.data(), size, &decoded, cells.data(), occupancy.data())) {
+            fprintf(stderr, "heatmap: cell past the grid accepted\n");
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/// Metas of one frame, and the storage their pointers refer to
+struct Frame {
+    std::vector<NvDsEventMsgMeta> metas;
+    std::vector<NvDsPersonObject> persons;
+    std::vector<NvDsProductObject> products;
+    std::vector<std::vector<float>> embeddings;
+    std::vector<std::string> strings;
+};
+
+static Frame makeFrame(unsigned objects, unsigned dim, int frame_id, Random &rng)
+{
+    static const char *const kTimestamps[] = {"2024-05-01T12:00:00.000Z", "2024-05-01T12:00:00.033Z",
+                                              "2024-12-31T23:59:59.999Z"};
+    Frame frame;
+    frame.metas.resize(objects);
+    frame.persons.resize(objects);
+    frame.products.resize(objects);
+    frame.embeddings.resize(objects);
+    frame.strings.reserve(objects * 4);
+    for (unsigned i = 0; i < objects; i++) {
+        NvDsEventMsgMeta &meta = frame.metas[i];
+        meta = {};
+        meta.type = (NvDsEventType) (i % 2);
+        meta.frameId = frame_id;
+        meta.sensorId = 3;
+        meta.sensorStr = (gchar *) "cam-3";
+        meta.ts = (gchar *) kTimestamps[frame_id % 3];
+        meta.trackingId = rng.next() >> 20;
+        meta.objClassId = (gint) rng.below(4);
+        meta.confidence = (gdouble) (rng.below(1000) / 1000.f);
+        meta.bbox.left = (float) rng.below(1920);
+        meta.bbox.top = (float) rng.below(1080);
+        meta.bbox.width = (float) (rng.below(400) + 1);
+        meta.bbox.height = (float) (rng.below(600) + 1);
+        meta.objectId = (gchar *) "person";
+        frame.strings.push_back("occupancy=" + std::to_string(rng.below(50)) + ";roi=RF;emit=new");
+        meta.otherAttrs = (gchar *) frame.strings.back().c_str();
+        if (i % 5 == 4) {
+            /// Gallery match, no attributes
+            NvDsProductObject &product = frame.products[i];
+            product.brand = (gchar *) "mug";
+            product.type = (gchar *) "person";
+            meta.objType = NVDS_OBJECT_TYPE_PRODUCT;
+            meta.extMsg = &product;
+            meta.otherAttrs = nullptr;
+        } else {
+            NvDsPersonObject &person = frame.persons[i];
+            frame.strings.push_back("/data/crops/cam3/" + std::to_string(meta.trackingId) + ".jpg");
+            person.hair = (gchar *) frame.strings.back().c_str();
+            person.gender = (gchar *) (i % 3 ? "Entry" : "");  /// empty strings too
+            person.cap = (gchar *) "Crossed";
+            person.apparel = (gchar *) "";
+            meta.objType = NVDS_OBJECT_TYPE_PERSON;
+            meta.extMsg = &person;
+        }
+        meta.extMsgSize = 1;
+        /// Every other object without embedding, one with a zero-length one
+        if (dim && i % 2 == 0) {
+            frame.embeddings[i].resize(dim);
+            for (float &v : frame.embeddings[i])
+                v = rng.symmetric();
+            meta.embedding.embedding_vector = frame.embeddings[i].data();
+            meta.embedding.embedding_length = dim;
+        } else if (i == 1) {
+            frame.embeddings[i].resize(1);
+            meta.embedding.embedding_vector = frame.embeddings[i].data();
+            meta.embedding.embedding_length = 0;
+        }
+    }
+    return frame;
+}
+
+static bool sameCString(const char *expected, const char *bytes, uint16_t len)
+{
+    size_t expected_len = expected ? strlen(expected) : 0;
+    return expected_len == len && !memcmp(expected ? expected : "", bytes, len);
+}
+
+/// A meta against the record EventBatcher made of it
+static bool sameEvent(const NvDsEventMsgMeta &meta, const EventCodecRecord &r)
+{
+    const NvDsPersonObject *person =
+        meta.objType == NVDS_OBJECT_TYPE_PERSON ? (const NvDsPersonObject *) meta.extMsg : nullptr;
+    const NvDsProductObject *product =
+        meta.objType == NVDS_OBJECT_TYPE_PRODUCT ? (const NvDsProductObject *) meta.extMsg : nullptr;
+    uint32_t embedding_len = meta.embedding.embedding_vector ? meta.embedding.embedding_length : 0;
+    return r.event_type == meta.type && r.object_type == meta.objType &&
+           r.tracking_id == meta.trackingId &&
+           r.timestamp_us == event_codec_parse_rfc3339(meta.ts) && r.timestamp_us != 0 &&
+           r.frame_id == meta.frameId && r.class_id == meta.objClassId &&
+           r.confidence == (float) meta.confidence && r.bbox[0] == meta.bbox.left &&
+           r.bbox[1] == meta.bbox.top && r.bbox[2] == meta.bbox.width &&
+           r.bbox[3] == meta.bbox.height && r.embedding_len == embedding_len &&
+           (!embedding_len ||
+            !memcmp(r.embedding, meta.embedding.embedding_vector, embedding_len * sizeof(float))) &&
+           sameCString(product ? product->brand : meta.objectId, r.label, r.label_len) &&
+           sameCString(person ? person->hair : nullptr, r.image, r.image_len) &&
+           sameCString(person ? person->gender : nullptr, r.direction, r.direction_len) &&
+           sameCString(meta.otherAttrs, r.attrs, r.attrs_len);
+}
+
+/// EventBatcher binary messages decoded back to their metas
+static int checkBatcher()
+{
+    Random rng(0xBA7C);
+    int failures = 0;
+    for (unsigned dim : {0u, 1u, 3u, 256u}) {
+        Frame frame = makeFrame(23, dim, 7, rng);
+        EventBatcher batcher(0, 0, EVENT_BATCH_BINARY);
+        for (const NvDsEventMsgMeta &meta : frame.metas)
+            batcher.add(3, &meta, 0);
+        std::string payload;
+        if (!batcher.flush(3, 0, true, payload)) {
+            fprintf(stderr, "batcher: no message\n");
+            return failures + 1;
+        }
+        Buffer message((const uint8_t *) payload.data(), payload.size());
+        EventCodecMessage header;
+        size_t offset = event_codec_decode_header(message.data(), message.size(), &header);
+        bool ok = offset && header.num_records == frame.metas.size() && header.sensor_id == 3 &&
+                  sameBytes(header.sensor, (uint16_t) header.sensor_len, "cam-3", 5);
+        size_t decoded = 0;
+        EventCodecRecord record;
+        while (ok && event_codec_next_record(message.data(), message.size(), &offset, &record))
+            ok = decoded < frame.metas.size() && sameEvent(frame.metas[decoded++], record);
+        if (!ok || decoded != frame.metas.size() || offset != message.size()) {
+            fprintf(stderr, "batcher: dim %u, round trip failed\n", dim);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned objects = 20, iterations = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--objects") && i + 1 < argc)
+            objects = (unsigned) std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            iterations = (unsigned) std::atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--objects N] [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+    objects = objects ? objects : 1;
+    iterations = iterations ? iterations : 1;
+
+    int records = checkRecords(), heatmaps = checkHeatmaps(), batcher = checkBatcher();
+    printf("%-10s %s\n%-10s %s\n%-10s %s\n", "records", records ? "FAILED" : "ok", "heatmaps",
+           heatmaps ? "FAILED" : "ok", "batcher", batcher ? "FAILED" : "ok");
+
+    // One message per frame of objects events, half of them with an embedding
+    printf("\nEventBatcher, %u objects per message, half with an embedding\n%-6s %12s %12s %12s %12s\n",
+           objects, "dim", "json B/obj", "binary B/obj", "json ns/obj", "binary ns/obj");
+    Random rng(0x512E);
+    for (unsigned dim : {0u, 128u, 256u, 512u}) {
+        Frame frame = makeFrame(objects, dim, 30, rng);
+        printf("%-6u", dim);
+        double bytes[2], ns[2];
+        for (EventBatchFormat format : {EVENT_BATCH_JSON, EVENT_BATCH_BINARY}) {
+            EventBatcher batcher(0, 0, format);
+            std::string payload;
+            Clock::time_point start = Clock::now();
+            for (unsigned k = 0; k < iterations; k++) {
+                for (const NvDsEventMsgMeta &meta : frame.metas)
+                    batcher.add(3, &meta, k);
+                batcher.flush(3, k, false, payload);
+            }
+            ns[format] = std::chrono::duration<double, std::nano>(Clock::now() - start).count() /
+                         iterations / objects;
+            bytes[format] = (double) payload.size() / objects;
+        }
+        printf(" %12.1f %12.1f %12.1f %12.1f\n", bytes[EVENT_BATCH_JSON], bytes[EVENT_BATCH_BINARY],
+               ns[EVENT_BATCH_JSON], ns[EVENT_BATCH_BINARY]);
+    }
+    return records + heatmaps + batcher ? 1 : 0;
+}
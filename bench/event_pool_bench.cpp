@@ -0,0 +1,380 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Allocation count and benchmark of the pooled event metas of
+/// srcs/event_meta_pool.cpp (make bench). A line crossing person event, as
+/// generate_event_msg_meta() fills it, is built, copied (meta_copy_func)
+/// and released (meta_free_func) twice: with the heap metas the app used
+/// before the pool, and with the pool. malloc() is counted around both.
+///
+///   ./event_pool_bench [--events N]
+///
+/// The embedding is left out: it is one buffer per event either way. It
+/// exits non-zero when the pool still allocates after warm-up, when a copy
+/// does not match its source, or when appended attributes are cut short.
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+
+#include "event_meta_pool.h"
+#include "nvdsmeta.h"
+
+using Clock = std::chrono::steady_clock;
+
+#define MAX_TIME_STAMP_LEN (64)
+
+/// Allocation counter: the libc allocator, counted
+static uint64_t g_mallocs = 0;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    g_mallocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    g_mallocs++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    g_mallocs++;
+    return __libc_realloc(ptr, size);
+}
+}
+
+/// What the analytics and the image meta give one event
+struct EventInput {
+    int frame_num;
+    unsigned long object_id;
+    const char *label;
+    const char *image_path;
+    const char *direction;
+    const char *roi;
+    unsigned occupancy, entries, exits;
+};
+
+static void writeTs(gchar *buf, size_t size, int frame_num)
+{
+    snprintf(buf, size, "2024-05-01T12:00:%02d.%03dZ", frame_num / 1000 % 60, frame_num % 1000);
+}
+
+/// Heap metas, as before the pool: every string and object is its own
+/// allocation
+namespace heap {
+
+static void appendOtherAttr(NvDsEventMsgMeta *meta, const gchar *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    gchar *attr = g_strdup_vprintf(format, args);
+    va_end(args);
+    if (meta->otherAttrs) {
+        size_t len = strlen(meta->otherAttrs);
+        gchar *joined = (gchar *) g_malloc(len + 1 + strlen(attr) + 1);
+        memcpy(joined, meta->otherAttrs, len);
+        joined[len] = ';';
+        strcpy(joined + len + 1, attr);
+        g_free(meta->otherAttrs);
+        g_free(attr);
+        meta->otherAttrs = joined;
+    } else {
+        meta->otherAttrs = attr;
+    }
+}
+
+/// Replace a string; the app leaked the old one, it is freed here so that
+/// the bench does not grow
+static void setStr(gchar **field, const gchar *value)
+{
+    g_free(*field);
+    *field = g_strdup(value);
+}
+
+static NvDsEventMsgMeta *generate(const EventInput &in)
+{
+    NvDsEventMsgMeta *meta = (NvDsEventMsgMeta *) g_malloc0(sizeof(NvDsEventMsgMeta));
+    meta->frameId = in.frame_num;
+    meta->ts = (gchar *) g_malloc0(MAX_TIME_STAMP_LEN + 1);
+    meta->objectId = (gchar *) g_malloc0(MAX_LABEL_SIZE);
+    strncpy(meta->objectId, in.label, MAX_LABEL_SIZE - 1);
+    writeTs(meta->ts, MAX_TIME_STAMP_LEN, in.frame_num);
+    meta->trackingId = in.object_id;
+
+    meta->objType = NVDS_OBJECT_TYPE_PERSON;
+    NvDsPersonObject *obj = (NvDsPersonObject *) g_malloc0(sizeof(NvDsPersonObject));
+    obj->cap = g_strdup("");
+    obj->hair = g_strdup("");
+    obj->gender = g_strdup("");
+    obj->apparel = g_strdup("");
+    meta->extMsg = obj;
+    meta->extMsgSize = sizeof(NvDsPersonObject);
+
+    setStr(&obj->hair, in.image_path);
+    /// The AnalyticsUserMeta was heap allocated (and leaked)
+    g_free(g_malloc0(48));
+    setStr(&obj->gender, in.direction);
+    setStr(&obj->cap, "Crossed");
+    appendOtherAttr(meta, "occupancy=%u;lccum_cnt_entry=%u;lccum_cnt_exit=%u", in.occupancy,
+                    in.entries, in.exits);
+    appendOtherAttr(meta, "roi=%s", in.roi);
+    return meta;
+}
+
+static NvDsEventMsgMeta *copy(const NvDsEventMsgMeta *src)
+{
+    NvDsEventMsgMeta *dst = (NvDsEventMsgMeta *) g_memdup(src, sizeof(NvDsEventMsgMeta));
+    dst->ts = g_strdup(src->ts);
+    dst->objectId = g_strdup(src->objectId);
+    dst->sensorStr = g_strdup(src->sensorStr);
+    dst->otherAttrs = g_strdup(src->otherAttrs);
+    const NvDsPersonObject *src_obj = (const NvDsPersonObject *) src->extMsg;
+    NvDsPersonObject *obj = (NvDsPersonObject *) g_malloc0(sizeof(NvDsPersonObject));
+    obj->age = src_obj->age;
+    obj->gender = g_strdup(src_obj->gender);
+    obj->cap = g_strdup(src_obj->cap);
+    obj->hair = g_strdup(src_obj->hair);
+    obj->apparel = g_strdup(src_obj->apparel);
+    dst->extMsg = obj;
+    return dst;
+}
+
+static void release(NvDsEventMsgMeta *meta)
+{
+    g_free(meta->ts);
+    g_free(meta->objectId);
+    g_free(meta->sensorStr);
+    g_free(meta->otherAttrs);
+    NvDsPersonObject *obj = (NvDsPersonObject *) meta->extMsg;
+    g_free(obj->gender);
+    g_free(obj->cap);
+    g_free(obj->hair);
+    g_free(obj->apparel);
+    g_free(obj);
+    g_free(meta);
+}
+
+}  // namespace heap
+
+/// Pooled metas, as the app builds them now
+namespace pool {
+
+static void appendOtherAttr(NvDsEventMsgMeta *meta, const gchar *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    event_meta_pool_append_vprintf(meta, &meta->otherAttrs, ";", format, args);
+    va_end(args);
+}
+
+static NvDsEventMsgMeta *generate(const EventInput &in)
+{
+    NvDsEventMsgMeta *meta = event_meta_pool_acquire();
+    meta->frameId = in.frame_num;
+    strncpy(meta->objectId, in.label, MAX_LABEL_SIZE - 1);
+    writeTs(meta->ts, MAX_TIME_STAMP_LEN, in.frame_num);
+    meta->trackingId = in.object_id;
+
+    NvDsPersonObject *obj = event_meta_pool_person(meta);
+    event_meta_pool_set_str(meta, &obj->cap, "");
+    event_meta_pool_set_str(meta, &obj->hair, "");
+    event_meta_pool_set_str(meta, &obj->gender, "");
+    event_meta_pool_set_str(meta, &obj->apparel, "");
+
+    event_meta_pool_set_str(meta, &obj->hair, in.image_path);
+    event_meta_pool_set_str(meta, &obj->gender, in.direction);
+    event_meta_pool_set_str(meta, &obj->cap, "Crossed");
+    appendOtherAttr(meta, "occupancy=%u;lccum_cnt_entry=%u;lccum_cnt_exit=%u", in.occupancy,
+                    in.entries, in.exits);
+    appendOtherAttr(meta, "roi=%s", in.roi);
+    return meta;
+}
+
+}  // namespace pool
+
+static void appendf(NvDsEventMsgMeta *meta, const gchar *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    event_meta_pool_append_vprintf(meta, &meta->otherAttrs, ";", format, args);
+    va_end(args);
+}
+
+/// Appended attributes are never cut short: in the arena while they fit,
+/// on the heap after that, and intact in a copy
+static int checkAppend()
+{
+    std::string roi(300, 'r'), expected;
+    int failures = 0;
+    for (size_t label_len : {0, 1, 45, 100, 300}) {
+        NvDsEventMsgMeta *meta = event_meta_pool_acquire();
+        expected.clear();
+        for (int i = 0; i < 4; i++) {
+            appendf(meta, "emit=dwell;roi=%.*s;enter=%s;dwell_ms=%d;end=%s", (int) label_len,
+                    roi.c_str(), "2024-05-01T12:00:00.000Z", 1234567 + i, "terminated");
+            char attr[512];
+            snprintf(attr, sizeof(attr), "emit=dwell;roi=%.*s;enter=%s;dwell_ms=%d;end=%s",
+                     (int) label_len, roi.c_str(), "2024-05-01T12:00:00.000Z", 1234567 + i,
+                     "terminated");
+            expected += (i ? ";" : "") + std::string(attr);
+            NvDsEventMsgMeta *copied = event_meta_pool_copy(meta);
+            if (!meta->otherAttrs || expected != meta->otherAttrs || !copied->otherAttrs ||
+                expected != copied->otherAttrs) {
+                fprintf(stderr, "roi label of %zu bytes, %d attributes: \"%s\"\n", label_len, i + 1,
+                        meta->otherAttrs ? meta->otherAttrs : "(null)");
+                failures++;
+            }
+            event_meta_pool_release(copied);
+        }
+        event_meta_pool_release(meta);
+    }
+    return failures;
+}
+
+static bool sameStr(const gchar *a, const gchar *b)
+{
+    return (!a && !b) || (a && b && !strcmp(a, b));
+}
+
+static bool sameEvent(const NvDsEventMsgMeta *a, const NvDsEventMsgMeta *b)
+{
+    const NvDsPersonObject *pa = (const NvDsPersonObject *) a->extMsg;
+    const NvDsPersonObject *pb = (const NvDsPersonObject *) b->extMsg;
+    return a->frameId == b->frameId && a->trackingId == b->trackingId && sameStr(a->ts, b->ts) &&
+           sameStr(a->objectId, b->objectId) && sameStr(a->otherAttrs, b->otherAttrs) &&
+           a->objType == b->objType && pa && pb && sameStr(pa->gender, pb->gender) &&
+           sameStr(pa->hair, pb->hair) && sameStr(pa->cap, pb->cap) &&
+           sameStr(pa->apparel, pb->apparel);
+}
+
+static EventInput makeInput(int i)
+{
+    static const char *const kDirections[] = {"Entry", "Exit"};
+    return {i,
+            (unsigned long) (i % 37),
+            "person",
+            "/opt/nvidia/deepstream/deepstream/sources/apps/sample_apps/fewshot/images/"
+            "cam0/frame_000123_obj_42.jpg",
+            kDirections[i & 1],
+            "RF",
+            (unsigned) (i % 11),
+            (unsigned) i,
+            (unsigned) (i / 2)};
+}
+
+struct Result {
+    double generate_mallocs;  ///< per event
+    double copy_mallocs;
+    double total_mallocs;
+    double ns_per_event;
+    int mismatches;
+};
+
+/// generate + copy + release of both, events times, after a warm-up round
+template <typename Generate, typename Copy, typename Release>
+static Result run(int events, Generate generate, Copy copy, Release release)
+{
+    Result result = {0, 0, 0, 0, 0};
+    for (int round = 0; round < 2; round++) {
+        uint64_t mallocs = g_mallocs, generate_mallocs = 0, copy_mallocs = 0;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < events; i++) {
+            uint64_t before = g_mallocs;
+            NvDsEventMsgMeta *meta = generate(makeInput(i));
+            uint64_t generated = g_mallocs;
+            NvDsEventMsgMeta *copied = copy(meta);
+            generate_mallocs += generated - before;
+            copy_mallocs += g_mallocs - generated;
+            if (!sameEvent(meta, copied))
+                result.mismatches++;
+            release(meta);
+            release(copied);
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        result.generate_mallocs = (double) generate_mallocs / events;
+        result.copy_mallocs = (double) copy_mallocs / events;
+        result.total_mallocs = (double) (g_mallocs - mallocs) / events;
+        result.ns_per_event = ns / events;
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int events = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--events") && i + 1 < argc)
+            events = std::atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--events N]\n", argv[0]);
+            return 2;
+        }
+    }
+    events = events > 0 ? events : 1;
+
+    int failures = checkAppend();
+    printf("append: %s\n", failures ? "FAILED" : "ok");
+
+    Result before = run(events, heap::generate, heap::copy, heap::release);
+    Result after = run(events, pool::generate, event_meta_pool_copy, event_meta_pool_release);
+
+    printf("event metas, %d events: generate + copy + release\n", events);
+    printf("%-6s %16s %16s %16s %10s\n", "metas", "generate mallocs", "copy mallocs",
+           "mallocs/event", "ns/event");
+    for (const Result *r : {&before, &after})
+        printf("%-6s %16.2f %16.2f %16.2f %10.1f\n", r == &before ? "heap" : "pool",
+               r->generate_mallocs, r->copy_mallocs, r->total_mallocs, r->ns_per_event);
+
+    EventMetaPoolStats stats;
+    event_meta_pool_get_stats(&stats);
+    printf("pool: %llu acquires, %llu heap blocks, %llu heap strings, capacity %llu\n",
+           (unsigned long long) stats.pool_acquires, (unsigned long long) stats.heap_blocks,
+           (unsigned long long) stats.heap_strings, (unsigned long long) stats.capacity);
+
+    if (before.mismatches + after.mismatches) {
+        fprintf(stderr, "%d copies differ from their source\n", before.mismatches + after.mismatches);
+        failures++;
+    }
+    if (after.total_mallocs != 0) {
+        fprintf(stderr, "the pool allocates after warm-up\n");
+        failures++;
+    }
+    if (stats.in_use != 0) {
+        fprintf(stderr, "%llu metas were not released\n", (unsigned long long) stats.in_use);
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Agreement check and benchmark of write_ts_rfc3339() of
+/// srcs/rfc3339_timestamp.c (make bench) against the strftime formatting
+/// the app used before, with its per-thread prefix cache:
+///
+/// - every millisecond of the seconds around minute, day, leap day, year
+///   and epoch boundaries, forwards, backwards and jumping between seconds
+///   so that the cache is both hit and refreshed
+/// - random instants from 1000 to 9999, and years outside it (strftime
+///   fallback)
+/// - short buffers, which must hold a truncated copy
+/// - threads formatting different seconds at the same time
+///
+/// Then both are timed for a stream of events (several per frame at 30 fps)
+/// and with a new second on every call.
+///
+///   ./rfc3339_bench [--events N] [--per-frame N]
+///
+/// It exits non-zero on a mismatch.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "rfc3339_timestamp.h"
+
+using Clock = std::chrono::steady_clock;
+
+/// Keeps the timed calls from being optimized out
+static volatile unsigned g_sink;
+
+/// splitmix64
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+/// The app's formatting before the cache
+static void referenceTs(char *buf, int buf_size, time_t second, int ms)
+{
+    struct tm tm_log;
+    char strmsec[6];  //.nnnZ\0
+    gmtime_r(&second, &tm_log);
+    strftime(buf, buf_size, "%Y-%m-%dT%H:%M:%S", &tm_log);
+    snprintf(strmsec, sizeof(strmsec), ".%.3dZ", ms);
+    strncat(buf, strmsec, buf_size - strlen(buf) - 1);  /// bounded here, it was buf_size
+}
+
+#define TS_SIZE 65
+
+static int check(time_t second, int ms)
+{
+    char expected[TS_SIZE], actual[TS_SIZE];
+    referenceTs(expected, sizeof(expected), second, ms);
+    memset(actual, 'x', sizeof(actual));
+    write_ts_rfc3339(actual, sizeof(actual), second, ms);
+    if (!strcmp(expected, actual))
+        return 0;
+    fprintf(stderr, "%lld.%03d: \"%s\", expected \"%s\"\n", (long long) second, ms, actual, expected);
+    return 1;
+}
+
+/// UTC seconds of a date
+static time_t utc(int year, int month, int day, int hour, int minute, int second)
+{
+    struct tm tm = {};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    return timegm(&tm);
+}
+
+static int checkBoundaries()
+{
+    const time_t kBoundaries[] = {
+        0,
+        utc(1999, 12, 31, 23, 59, 59),
+        utc(2024, 2, 28, 23, 59, 59),
+        utc(2024, 2, 29, 23, 59, 59),
+        utc(2024, 5, 1, 12, 0, 59),
+        utc(2024, 5, 1, 12, 59, 59),
+        utc(2038, 1, 19, 3, 14, 7),
+        utc(2100, 2, 28, 23, 59, 59),
+        utc(9999, 12, 31, 23, 59, 58),
+    };
+    int failures = 0;
+    for (time_t boundary : kBoundaries) {
+        /// Every millisecond of the seconds around it, in order...
+        for (time_t s = boundary - 2; s <= boundary + 2; s++)
+            for (int ms = 0; ms < 1000; ms++)
+                failures += check(s, ms);
+        /// ...backwards...
+        for (time_t s = boundary + 2; s >= boundary - 2; s--)
+            for (int ms = 999; ms >= 0; ms--)
+                failures += check(s, ms);
+        /// ...and alternating between two seconds on every call
+        for (int ms = 0; ms < 1000; ms++) {
+            failures += check(boundary, ms);
+            failures += check(boundary + 1, 999 - ms);
+        }
+    }
+    return failures;
+}
+
+static int checkRandom()
+{
+    Random rng(0x3339);
+    const time_t first = utc(1000, 1, 1, 0, 0, 0), last = utc(9999, 12, 31, 23, 59, 59);
+    int failures = 0;
+    for (int i = 0; i < 500000 && failures < 10; i++) {
+        time_t second = first + (time_t) (rng.next() % (uint64_t) (last - first + 1));
+        int ms = (int) (rng.next() % 1000);
+        failures += check(second, ms);
+        /// Same second again, from the cache
+        failures += check(second, 999 - ms);
+    }
+    /// Years with fewer or more than 4 digits
+    for (time_t second : {utc(999, 12, 31, 23, 59, 59), utc(1, 1, 1, 0, 0, 0),
+                          utc(10000, 1, 1, 0, 0, 0), utc(99999, 6, 15, 12, 30, 30)})
+        for (int ms : {0, 1, 999})
+            failures += check(second, ms) + check(second + 1, ms);
+    return failures;
+}
+
+/// A short buffer holds the start of the timestamp
+static int checkTruncation()
+{
+    const time_t second = utc(2024, 5, 1, 12, 34, 56);
+    char full[TS_SIZE];
+    referenceTs(full, sizeof(full), second, 789);
+    int failures = 0;
+    for (int size = 1; size <= (int) strlen(full) + 1; size++) {
+        char buf[TS_SIZE + 1];
+        memset(buf, 'x', sizeof(buf));
+        write_ts_rfc3339(buf, size, second, 789);
+        if (strlen(buf) != (size_t) size - 1 || strncmp(buf, full, size - 1) || buf[size] != 'x') {
+            fprintf(stderr, "buffer of %d bytes: \"%s\"\n", size, buf);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/// Threads on different seconds: each must see its own prefix
+static int checkThreads()
+{
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([t, &failures]() {
+            const time_t base = utc(2024, 5, 1, 12, 0, 0) + t * 86401;
+            int f = 0;
+            for (int i = 0; i < 20000; i++)
+                f += check(base + i / 100, i % 1000);
+            failures += f;
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    return failures;
+}
+
+template <typename Format>
+static double timeStream(Format format, int events, int per_frame, bool new_second)
+{
+    char buf[TS_SIZE];
+    const time_t start_second = utc(2024, 5, 1, 12, 0, 0);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < events; i++) {
+        time_t second;
+        int ms;
+        if (new_second) {
+            second = start_second + i;
+            ms = i % 1000;
+        } else {
+            /// 30 fps: frame f at f * 33.3 ms
+            int64_t frame_ms = (int64_t) (i / per_frame) * 1000 / 30;
+            second = start_second + (time_t) (frame_ms / 1000);
+            ms = (int) (frame_ms % 1000);
+        }
+        format(buf, sizeof(buf), second, ms);
+        g_sink = (unsigned char) buf[22];
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return ns / events;
+}
+
+int main(int argc, char **argv)
+{
+    int events = 2000000, per_frame = 20;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--events") && i + 1 < argc)
+            events = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--per-frame") && i + 1 < argc)
+            per_frame = std::atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--events N] [--per-frame N]\n", argv[0]);
+            return 2;
+        }
+    }
+    events = events > 0 ? events : 1;
+    per_frame = per_frame > 0 ? per_frame : 1;
+
+    int boundaries = checkBoundaries(), random = checkRandom(), truncation = checkTruncation(),
+        threads = checkThreads();
+    printf("%-12s %s\n%-12s %s\n%-12s %s\n%-12s %s\n", "boundaries", boundaries ? "FAILED" : "ok",
+           "random", random ? "FAILED" : "ok", "truncation", truncation ? "FAILED" : "ok", "threads",
+           threads ? "FAILED" : "ok");
+
+    printf("\n%d timestamps\n%-10s %22s %22s\n", events, "format", "ns/call, 30 fps stream",
+           "ns/call, new second");
+    printf("%-10s %22.1f %22.1f\n", "strftime", timeStream(referenceTs, events, per_frame, false),
+           timeStream(referenceTs, events, per_frame, true));
+    printf("%-10s %22.1f %22.1f\n", "cached", timeStream(write_ts_rfc3339, events, per_frame, false),
+           timeStream(write_ts_rfc3339, events, per_frame, true));
+    printf("(%d events per frame)\n", per_frame);
+    return boundaries + random + truncation + threads ? 1 : 0;
+}
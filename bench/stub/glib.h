@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Stand-in for glib.h with only the types and functions the event code
+ * under ../srcs uses, each mapped onto libc. It lets the benches build that
+ * code on a machine without GLib; the app itself is always built against it.
+ */
+
+#ifndef __G_LIB_H__
+#define __G_LIB_H__
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef char gchar;
+typedef int gint;
+typedef unsigned int guint;
+typedef gint gboolean;
+typedef uint32_t guint32;
+typedef int64_t gint64;
+typedef uint64_t guint64;
+typedef unsigned long gulong;
+typedef size_t gsize;
+typedef float gfloat;
+typedef double gdouble;
+typedef void *gpointer;
+typedef const void *gconstpointer;
+
+#define TRUE 1
+#define FALSE 0
+#define G_MAXUINT32 UINT32_MAX
+#define G_GNUC_PRINTF(format_idx, arg_idx) \
+    __attribute__((__format__(__printf__, format_idx, arg_idx)))
+
+static inline gpointer g_malloc(gsize n) { return n ? malloc(n) : NULL; }
+
+static inline gpointer g_malloc0(gsize n) { return n ? calloc(1, n) : NULL; }
+
+static inline void g_free(gpointer mem) { free(mem); }
+
+static inline gpointer g_memdup(gconstpointer mem, guint n) {
+    if (!mem || !n)
+        return NULL;
+    gpointer copy = malloc(n);
+    memcpy(copy, mem, n);
+    return copy;
+}
+
+static inline gchar *g_strdup(const gchar *str) {
+    return str ? strdup(str) : NULL;
+}
+
+static inline gsize g_strlcpy(gchar *dest, const gchar *src, gsize dest_size) {
+    gsize len = strlen(src);
+    if (dest_size) {
+        gsize n = len < dest_size - 1 ? len : dest_size - 1;
+        memcpy(dest, src, n);
+        dest[n] = '\0';
+    }
+    return len;
+}
+
+static inline gint g_vsnprintf(gchar *str, gulong n, const gchar *format, va_list args) {
+    return vsnprintf(str, n, format, args);
+}
+
+static inline gchar *g_strdup_vprintf(const gchar *format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if (len < 0)
+        return NULL;
+    gchar *str = (gchar *) malloc((size_t) len + 1);
+    vsnprintf(str, (size_t) len + 1, format, args);
+    return str;
+}
+
+static inline gchar *g_strdup_printf(const gchar *format, ...) G_GNUC_PRINTF(1, 2);
+static inline gchar *g_strdup_printf(const gchar *format, ...) {
+    va_list args;
+    va_start(args, format);
+    gchar *str = g_strdup_vprintf(format, args);
+    va_end(args);
+    return str;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< __G_LIB_H__ */
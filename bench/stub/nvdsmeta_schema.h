@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Stand-in for the DeepStream 7.x nvdsmeta_schema.h, with only the types
+ * and NvDsEventMsgMeta fields the event code under ../srcs uses, laid out
+ * as in the SDK. It lets the benches build that code on a machine without
+ * DeepStream; the app itself is always built against the SDK header.
+ */
+
+#ifndef NVDSMETA_H_
+#define NVDSMETA_H_
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum NvDsEventType {
+  NVDS_EVENT_ENTRY,
+  NVDS_EVENT_EXIT,
+  NVDS_EVENT_MOVING,
+  NVDS_EVENT_STOPPED,
+  NVDS_EVENT_EMPTY,
+  NVDS_EVENT_PARKED,
+  NVDS_EVENT_RESET,
+  NVDS_EVENT_RESERVED = 0x100,
+  NVDS_EVENT_CUSTOM = 0x101,
+  NVDS_EVENT_FORCE32 = 0x7FFFFFFF
+} NvDsEventType;
+
+typedef enum NvDsObjectType {
+  NVDS_OBJECT_TYPE_VEHICLE,
+  NVDS_OBJECT_TYPE_PERSON,
+  NVDS_OBJECT_TYPE_FACE,
+  NVDS_OBJECT_TYPE_BAG,
+  NVDS_OBJECT_TYPE_BICYCLE,
+  NVDS_OBJECT_TYPE_ROADSIGN,
+  NVDS_OBJECT_TYPE_VEHICLE_EXT,
+  NVDS_OBJECT_TYPE_PERSON_EXT,
+  NVDS_OBJECT_TYPE_FACE_EXT,
+  NVDS_OBJECT_TYPE_PRODUCT,
+  NVDS_OBJECT_TYPE_PRODUCT_EXT,
+  NVDS_OBJECT_TYPE_RESERVED = 0x100,
+  NVDS_OBJECT_TYPE_CUSTOM = 0x101,
+  NVDS_OBJECT_TYPE_UNKNOWN = 0x102,
+  NVDS_OBEJCT_TYPE_FORCE32 = 0x7FFFFFFF
+} NvDsObjectType;
+
+typedef struct NvDsRect {
+  float top;
+  float left;
+  float width;
+  float height;
+} NvDsRect;
+
+typedef struct NvDsGeoLocation {
+  gdouble lat;
+  gdouble lon;
+  gdouble alt;
+} NvDsGeoLocation;
+
+typedef struct NvDsCoordinate {
+  gdouble x;
+  gdouble y;
+  gdouble z;
+} NvDsCoordinate;
+
+typedef struct NvDsObjectSignature {
+  gdouble *signature;
+  guint size;
+} NvDsObjectSignature;
+
+typedef struct NvDsPersonObject {
+  gchar *gender;
+  gchar *hair;
+  gchar *cap;
+  gchar *apparel;
+  guint age;
+} NvDsPersonObject;
+
+typedef struct NvDsProductObject {
+  gchar *brand;
+  gchar *type;
+  gchar *shape;
+} NvDsProductObject;
+
+typedef struct NvDsEmbedding {
+  float *embedding_vector;
+  guint embedding_length;
+} NvDsEmbedding;
+
+typedef struct NvDsConvexHull {
+  gint *points;
+  guint numFilled;
+} NvDsConvexHull;
+
+typedef struct NvDsSingleView3DTracking {
+  gfloat visibility;
+  gfloat ptWorldFeet[2];
+  gfloat ptImgFeet[2];
+  NvDsConvexHull convexHull;
+} NvDsSingleView3DTracking;
+
+typedef struct NvDsEventMsgMeta {
+  NvDsEventType type;
+  NvDsObjectType objType;
+  NvDsRect bbox;
+  NvDsGeoLocation location;
+  NvDsCoordinate coordinate;
+  NvDsObjectSignature objSignature;
+  gint objClassId;
+  gint sensorId;
+  gint moduleId;
+  gint placeId;
+  gint componentId;
+  gint frameId;
+  gdouble confidence;
+  guint64 trackingId;
+  gchar *ts;
+  gchar *objectId;
+  gchar *sensorStr;
+  gchar *otherAttrs;
+  gchar *videoPath;
+  gpointer extMsg;
+  guint extMsgSize;
+  NvDsEmbedding embedding;
+  gboolean has3DTracking;
+  NvDsSingleView3DTracking singleView3DTracking;
+} NvDsEventMsgMeta;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< NVDSMETA_H_ */
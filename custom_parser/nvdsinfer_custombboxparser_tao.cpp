@@ -21,13 +21,28 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstdint>
 #include <cstring>
+#include <cstdlib>
 #include <iostream>
 #include "nvdsinfer_custom_impl.h"
 #include <cassert>
 #include <cmath>
 #include <algorithm>
-#include <map>
+#include <limits>
+#include <string>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#if !defined(__F16C__)
+#define HAVE_F16C_DISPATCH 1
+#endif
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
@@ -37,6 +52,581 @@
 struct MrcnnRawDetection {
     float y1, x1, y2, x2, class_id, score;
 };
+
+/* DDETR query above its class threshold, ranked by logit */
+struct DDETRCandidate {
+    float logit;
+    unsigned int query;
+    int classId;
+};
+
+/* Largest of the n > 0 values of row */
+static inline float rowMax(const float *row, unsigned int n)
+{
+    unsigned int i = 0;
+    float m = row[0];
+#if defined(__SSE2__)
+    if (n >= 8) {
+        __m128 m0 = _mm_loadu_ps(row);
+        __m128 m1 = _mm_loadu_ps(row + 4);
+        for (i = 8; i + 8 <= n; i += 8) {
+            m0 = _mm_max_ps(m0, _mm_loadu_ps(row + i));
+            m1 = _mm_max_ps(m1, _mm_loadu_ps(row + i + 4));
+        }
+        m0 = _mm_max_ps(m0, m1);
+        m0 = _mm_max_ps(m0, _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(2, 3, 0, 1)));
+        m0 = _mm_max_ps(m0, _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_cvtss_f32(m0);
+    }
+#elif defined(__ARM_NEON)
+    if (n >= 8) {
+        float32x4_t m0 = vld1q_f32(row);
+        float32x4_t m1 = vld1q_f32(row + 4);
+        for (i = 8; i + 8 <= n; i += 8) {
+            m0 = vmaxq_f32(m0, vld1q_f32(row + i));
+            m1 = vmaxq_f32(m1, vld1q_f32(row + i + 4));
+        }
+        m0 = vmaxq_f32(m0, m1);
+        float32x2_t h = vpmax_f32(vget_low_f32(m0), vget_high_f32(m0));
+        m = vget_lane_f32(vpmax_f32(h, h), 0);
+    }
+#endif
+    for (; i < n; i++)
+        m = row[i] > m ? row[i] : m;
+    return m;
+}
+
+/* x = 1 / (1 + exp(-x)) over n values; exp is the Cephes polynomial, within
+ * 2 ulp of expf */
+static void sigmoidInPlace(float *x, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(x + i));
+        v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-87.3f)), _mm_set1_ps(88.3f));
+        __m128 fx = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+        __m128i k = _mm_cvttps_epi32(fx);
+        __m128 fk = _mm_cvtepi32_ps(k);
+        // Truncation rounds towards zero, floor it
+        __m128 adjust = _mm_and_ps(_mm_cmpgt_ps(fk, fx), one);
+        fk = _mm_sub_ps(fk, adjust);
+        k = _mm_cvtps_epi32(fk);
+        v = _mm_sub_ps(v, _mm_mul_ps(fk, _mm_set1_ps(0.693359375f)));
+        v = _mm_sub_ps(v, _mm_mul_ps(fk, _mm_set1_ps(-2.12194440e-4f)));
+        __m128 y = _mm_set1_ps(1.9875691500e-4f);
+        y = _mm_add_ps(_mm_mul_ps(y, v), _mm_set1_ps(1.3981999507e-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, v), _mm_set1_ps(8.3334519073e-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, v), _mm_set1_ps(4.1665795894e-2f));
+        y = _mm_add_ps(_mm_mul_ps(y, v), _mm_set1_ps(1.6666665459e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, v), _mm_set1_ps(5.0000001201e-1f));
+        y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, v), v), _mm_add_ps(v, one));
+        __m128 pow2k = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(k, _mm_set1_epi32(127)), 23));
+        y = _mm_mul_ps(y, pow2k);
+        _mm_storeu_ps(x + i, _mm_div_ps(one, _mm_add_ps(one, y)));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vnegq_f32(vld1q_f32(x + i));
+        v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-87.3f)), vdupq_n_f32(88.3f));
+        float32x4_t fx = vmlaq_n_f32(vdupq_n_f32(0.5f), v, 1.44269504088896341f);
+        float32x4_t fk = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+        // Truncation rounds towards zero, floor it
+        uint32x4_t greater = vcgtq_f32(fk, fx);
+        fk = vsubq_f32(fk, vreinterpretq_f32_u32(vandq_u32(greater, vreinterpretq_u32_f32(one))));
+        int32x4_t k = vcvtq_s32_f32(fk);
+        v = vmlsq_n_f32(v, fk, 0.693359375f);
+        v = vmlsq_n_f32(v, fk, -2.12194440e-4f);
+        float32x4_t y = vdupq_n_f32(1.9875691500e-4f);
+        y = vmlaq_f32(vdupq_n_f32(1.3981999507e-3f), y, v);
+        y = vmlaq_f32(vdupq_n_f32(8.3334519073e-3f), y, v);
+        y = vmlaq_f32(vdupq_n_f32(4.1665795894e-2f), y, v);
+        y = vmlaq_f32(vdupq_n_f32(1.6666665459e-1f), y, v);
+        y = vmlaq_f32(vdupq_n_f32(5.0000001201e-1f), y, v);
+        y = vmlaq_f32(vaddq_f32(v, one), vmulq_f32(y, v), v);
+        float32x4_t pow2k = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(k, vdupq_n_s32(127)), 23));
+        y = vmulq_f32(y, pow2k);
+        float32x4_t d = vaddq_f32(one, y);
+        float32x4_t r = vrecpeq_f32(d);
+        r = vmulq_f32(r, vrecpsq_f32(d, r));
+        r = vmulq_f32(r, vrecpsq_f32(d, r));
+        vst1q_f32(x + i, r);
+    }
+#endif
+    for (; i < n; i++)
+        x[i] = 1.0f / (1.0f + std::exp(-x[i]));
+}
+
+static inline bool sigmoidAbove(float x, float t)
+{
+    return (float) (1.0 / (1.0 + std::exp(-(double) x))) >= t;
+}
+
+/* Smallest float logit whose confidence is at least t, 0 < t < 1 */
+static float smallestLogitAbove(float t)
+{
+    // Bisect around the exact inverse, which float rounding may be off by
+    // a few ulps
+    float hi = (float) std::log((double) t / (1.0 - t));
+    float step = MAX(std::fabs(hi), 1.0f);
+    while (!sigmoidAbove(hi, t))
+        hi += step;
+    float lo = hi - step;
+    while (sigmoidAbove(lo, t))
+        lo -= step;
+    for (;;) {
+        float mid = lo + (hi - lo) / 2;
+        if (mid == lo || mid == hi)
+            return hi;
+        if (sigmoidAbove(mid, t))
+            hi = mid;
+        else
+            lo = mid;
+    }
+}
+
+/* perClassPreclusterThreshold mapped to logits: sigmoid(x) >= t <=> x >= log(t / (1 - t)).
+ * The thresholds do not change between frames, so the logs are only taken again
+ * when they do */
+static const std::vector<float> &logitThresholds(const std::vector<float> &thresholds)
+{
+    static thread_local std::vector<float> probabilities;
+    static thread_local std::vector<float> logits;
+    if (probabilities != thresholds) {
+        probabilities = thresholds;
+        logits.resize(thresholds.size());
+        for (size_t i = 0; i < thresholds.size(); i++) {
+            double t = thresholds[i];
+            if (t <= 0.0)
+                logits[i] = -std::numeric_limits<float>::infinity();
+            else if (t >= 1.0)
+                logits[i] = std::numeric_limits<float>::infinity();
+            else
+                logits[i] = smallestLogitAbove(thresholds[i]);
+        }
+    }
+    return logits;
+}
+/* CPU NMS settings, read once from the environment:
+ * CPU_NMS_IOU     IoU above which a box is suppressed (default 0.5)
+ * CPU_NMS_SOFT    0: hard NMS (default), 1: linear soft-NMS, 2: gaussian soft-NMS
+ * CPU_NMS_SIGMA   gaussian soft-NMS sigma (default 0.5)
+ * CPU_NMS_TOP_K   candidates per class before NMS (default 1000) */
+struct CpuNmsSettings {
+    float iou;
+    int soft;
+    float sigma;
+    unsigned int top_k;
+};
+
+static float envFloat(const char *name, float value)
+{
+    const char *env = std::getenv(name);
+    return env ? (float) std::atof(env) : value;
+}
+
+static const CpuNmsSettings &cpuNmsSettings()
+{
+    static const CpuNmsSettings settings = {
+        envFloat("CPU_NMS_IOU", 0.5f),
+        (int) envFloat("CPU_NMS_SOFT", 0),
+        envFloat("CPU_NMS_SIGMA", 0.5f),
+        (unsigned int) envFloat("CPU_NMS_TOP_K", 1000)};
+    return settings;
+}
+
+struct NmsCandidate {
+    float score;
+    unsigned int box;
+    int classId;
+};
+
+/* Boxes of one class, sorted by score, as arrays for the IoU kernel */
+struct NmsScratch {
+    std::vector<NmsCandidate> candidates;
+    std::vector<NmsCandidate> byClass;
+    std::vector<size_t> classStart;
+    std::vector<NmsCandidate> kept;
+    std::vector<float> x1, y1, x2, y2, area, score;
+    std::vector<unsigned int> box;
+    std::vector<float> iou;
+
+    void load(const NmsCandidate *begin, size_t n, const float *boxes)
+    {
+        // Padded to a multiple of 4 so the kernel needs no tail
+        size_t padded = (n + 3) & ~(size_t) 3;
+        for (std::vector<float> *v : {&x1, &y1, &x2, &y2, &area, &score, &iou})
+            v->assign(padded, 0.0f);
+        box.resize(padded);
+        for (size_t i = 0; i < n; i++) {
+            const float *b = boxes + begin[i].box * 4;
+            x1[i] = b[0];
+            y1[i] = b[1];
+            x2[i] = b[2];
+            y2[i] = b[3];
+            area[i] = MAX(b[2] - b[0], 0.0f) * MAX(b[3] - b[1], 0.0f);
+            score[i] = begin[i].score;
+            box[i] = begin[i].box;
+        }
+    }
+};
+
+/* Scores of box at or above the threshold of their class */
+static void collectCandidates(const float *row, const float *thresholds, unsigned int n,
+                              unsigned int box, std::vector<NmsCandidate> &candidates)
+{
+    unsigned int c = 0;
+#if defined(__SSE2__)
+    for (; c + 4 <= n; c += 4) {
+        int mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + c), _mm_loadu_ps(thresholds + c)));
+        for (; mask; mask &= mask - 1) {
+            unsigned int k = c + __builtin_ctz(mask);
+            NmsCandidate candidate = {row[k], box, (int) k};
+            candidates.push_back(candidate);
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; c + 4 <= n; c += 4) {
+        uint32x4_t above = vcgeq_f32(vld1q_f32(row + c), vld1q_f32(thresholds + c));
+        if (vmaxvq_u32(above) == 0)
+            continue;
+        for (unsigned int k = c; k < c + 4; k++) {
+            if (row[k] >= thresholds[k]) {
+                NmsCandidate candidate = {row[k], box, (int) k};
+                candidates.push_back(candidate);
+            }
+        }
+    }
+#endif
+    for (; c < n; c++) {
+        if (row[c] >= thresholds[c]) {
+            NmsCandidate candidate = {row[c], box, (int) c};
+            candidates.push_back(candidate);
+        }
+    }
+}
+
+/* IoU of box i with boxes [begin, end) into scratch.iou; begin is a multiple of 4 */
+static void iouRow(NmsScratch &s, size_t i, size_t begin, size_t end)
+{
+    size_t j = begin;
+#if defined(__SSE2__)
+    const __m128 ix1 = _mm_set1_ps(s.x1[i]), iy1 = _mm_set1_ps(s.y1[i]);
+    const __m128 ix2 = _mm_set1_ps(s.x2[i]), iy2 = _mm_set1_ps(s.y2[i]);
+    const __m128 iarea = _mm_set1_ps(s.area[i]), zero = _mm_setzero_ps();
+    for (; j < end; j += 4) {
+        __m128 w = _mm_sub_ps(_mm_min_ps(ix2, _mm_loadu_ps(&s.x2[j])), _mm_max_ps(ix1, _mm_loadu_ps(&s.x1[j])));
+        __m128 h = _mm_sub_ps(_mm_min_ps(iy2, _mm_loadu_ps(&s.y2[j])), _mm_max_ps(iy1, _mm_loadu_ps(&s.y1[j])));
+        __m128 inter = _mm_mul_ps(_mm_max_ps(w, zero), _mm_max_ps(h, zero));
+        __m128 uni = _mm_sub_ps(_mm_add_ps(iarea, _mm_loadu_ps(&s.area[j])), inter);
+        // Degenerate pairs (union 0) have no overlap
+        __m128 valid = _mm_cmpgt_ps(uni, zero);
+        _mm_storeu_ps(&s.iou[j], _mm_and_ps(valid, _mm_div_ps(inter, _mm_max_ps(uni, _mm_set1_ps(1e-12f)))));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t ix1 = vdupq_n_f32(s.x1[i]), iy1 = vdupq_n_f32(s.y1[i]);
+    const float32x4_t ix2 = vdupq_n_f32(s.x2[i]), iy2 = vdupq_n_f32(s.y2[i]);
+    const float32x4_t iarea = vdupq_n_f32(s.area[i]), zero = vdupq_n_f32(0.0f);
+    for (; j < end; j += 4) {
+        float32x4_t w = vsubq_f32(vminq_f32(ix2, vld1q_f32(&s.x2[j])), vmaxq_f32(ix1, vld1q_f32(&s.x1[j])));
+        float32x4_t h = vsubq_f32(vminq_f32(iy2, vld1q_f32(&s.y2[j])), vmaxq_f32(iy1, vld1q_f32(&s.y1[j])));
+        float32x4_t inter = vmulq_f32(vmaxq_f32(w, zero), vmaxq_f32(h, zero));
+        float32x4_t uni = vsubq_f32(vaddq_f32(iarea, vld1q_f32(&s.area[j])), inter);
+        uint32x4_t valid = vcgtq_f32(uni, zero);
+        float32x4_t d = vmaxq_f32(uni, vdupq_n_f32(1e-12f));
+        float32x4_t r = vrecpeq_f32(d);
+        r = vmulq_f32(r, vrecpsq_f32(d, r));
+        r = vmulq_f32(r, vrecpsq_f32(d, r));
+        float32x4_t iou = vmulq_f32(inter, r);
+        vst1q_f32(&s.iou[j], vreinterpretq_f32_u32(vandq_u32(valid, vreinterpretq_u32_f32(iou))));
+    }
+#endif
+    for (; j < end; j++) {
+        float w = MIN(s.x2[i], s.x2[j]) - MAX(s.x1[i], s.x1[j]);
+        float h = MIN(s.y2[i], s.y2[j]) - MAX(s.y1[i], s.y1[j]);
+        float inter = MAX(w, 0.0f) * MAX(h, 0.0f);
+        float uni = s.area[i] + s.area[j] - inter;
+        s.iou[j] = uni > 0.0f ? inter / uni : 0.0f;
+    }
+}
+
+/* NMS of the n boxes loaded in s, sorted by score; kept boxes are appended to
+ * s.kept. Suppressed boxes get a score of -1 */
+static void nmsClass(NmsScratch &s, size_t n, int classId, float threshold,
+                     const CpuNmsSettings &settings)
+{
+    if (!settings.soft) {
+        for (size_t i = 0; i < n; i++) {
+            if (s.score[i] < 0.0f)
+                continue;
+            NmsCandidate kept = {s.score[i], s.box[i], classId};
+            s.kept.push_back(kept);
+            size_t begin = (i + 1) & ~(size_t) 3;
+            iouRow(s, i, begin, (n + 3) & ~(size_t) 3);
+            for (size_t j = i + 1; j < n; j++)
+                if (s.iou[j] > settings.iou)
+                    s.score[j] = -1.0f;
+        }
+        return;
+    }
+
+    // Soft-NMS: the scores change, so the best remaining box is searched
+    // for on every step
+    for (size_t i = 0; i < n; i++) {
+        size_t best = i;
+        for (size_t j = i + 1; j < n; j++)
+            if (s.score[j] > s.score[best])
+                best = j;
+        if (s.score[best] < threshold)
+            break;
+        if (best != i) {
+            std::swap(s.x1[i], s.x1[best]);
+            std::swap(s.y1[i], s.y1[best]);
+            std::swap(s.x2[i], s.x2[best]);
+            std::swap(s.y2[i], s.y2[best]);
+            std::swap(s.area[i], s.area[best]);
+            std::swap(s.score[i], s.score[best]);
+            std::swap(s.box[i], s.box[best]);
+        }
+        NmsCandidate kept = {s.score[i], s.box[i], classId};
+        s.kept.push_back(kept);
+        size_t begin = (i + 1) & ~(size_t) 3;
+        iouRow(s, i, begin, (n + 3) & ~(size_t) 3);
+        for (size_t j = i + 1; j < n; j++) {
+            float iou = s.iou[j];
+            if (settings.soft == 1) {
+                if (iou > settings.iou)
+                    s.score[j] *= 1.0f - iou;
+            } else {
+                s.score[j] *= std::exp(-(iou * iou) / settings.sigma);
+            }
+        }
+    }
+}
+
+/* Mask R-CNN masks, read once from the environment:
+ * MRCNN_MASK_RLE        1: binary run-length encoded masks instead of float maps
+ * MRCNN_MASK_THRESHOLD  probability from which a pixel is in the mask (default 0.5)
+ *
+ * An RLE mask holds uint16_t run lengths over the mask_width x mask_height
+ * pixels in row-major order, alternating pixels out of and in the mask and
+ * starting with pixels out of it. mask_size is the size of the runs in bytes.
+ * Runs longer than 65535 are split by an empty run */
+struct MrcnnMaskSettings {
+    bool rle;
+    float threshold;
+};
+
+static const MrcnnMaskSettings &mrcnnMaskSettings()
+{
+    static const MrcnnMaskSettings settings = {
+        envFloat("MRCNN_MASK_RLE", 0) != 0,
+        envFloat("MRCNN_MASK_THRESHOLD", 0.5f)};
+    return settings;
+}
+
+static inline void appendRun(std::vector<uint16_t> &runs, uint32_t run)
+{
+    for (; run > 0xFFFF; run -= 0xFFFF) {
+        runs.push_back(0xFFFF);
+        runs.push_back(0);
+    }
+    runs.push_back((uint16_t) run);
+}
+
+/* Runs of the n pixels of mask thresholded at threshold */
+static void encodeMaskRle(const float *mask, unsigned int n, float threshold,
+                          std::vector<uint16_t> &runs)
+{
+    runs.clear();
+    bool inside = false;
+    uint32_t run = 0;
+    unsigned int i = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    // 16 pixels at a time as a bit mask; runs only end where it differs from
+    // the side of the current run
+#if defined(__SSE2__)
+    const __m128 t = _mm_set1_ps(threshold);
+#define MASK_BITS4(p) ((uint32_t) _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(p), t)))
+#else
+    const float32x4_t t = vdupq_n_f32(threshold);
+    const uint32x4_t weights = {1, 2, 4, 8};
+#define MASK_BITS4(p) vaddvq_u32(vandq_u32(vcgeq_f32(vld1q_f32(p), t), weights))
+#endif
+    for (; i + 16 <= n; i += 16) {
+        uint32_t bits = MASK_BITS4(mask + i) | (MASK_BITS4(mask + i + 4) << 4) |
+                        (MASK_BITS4(mask + i + 8) << 8) | (MASK_BITS4(mask + i + 12) << 12);
+        uint32_t side = inside ? 0xFFFF : 0;
+        uint32_t diff = bits ^ side;
+        unsigned int pos = 0;
+        while (diff) {
+            unsigned int k = __builtin_ctz(diff);
+            appendRun(runs, run + k - pos);
+            run = 0;
+            pos = k;
+            inside = !inside;
+            side ^= 0xFFFF;
+            diff = (bits ^ side) & (0xFFFFu << k) & 0xFFFF;
+        }
+        run += 16 - pos;
+    }
+#undef MASK_BITS4
+#endif
+    for (; i < n; i++) {
+        bool set = mask[i] >= threshold;
+        if (set != inside) {
+            appendRun(runs, run);
+            run = 0;
+            inside = set;
+        }
+        run++;
+    }
+    appendRun(runs, run);
+}
+
+/* IEEE half to float */
+static inline float halfToFloat(uint16_t h)
+{
+    uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        // Infinity, or NaN made quiet as F16C and NEON do
+        bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+        // Zero or subnormal: mantissa * 2^-24, exact in float
+        float f = (float) mantissa * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+#if defined(HAVE_F16C_DISPATCH)
+__attribute__((target("avx,f16c")))
+static size_t halfToFloatsF16C(const uint16_t *in, size_t n, float *out)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (in + i))));
+    return i;
+}
+#endif
+
+/* n halves to floats; F16C when the CPU has it, else NEON or scalar */
+static void halfToFloats(const uint16_t *in, size_t n, float *out)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (in + i))));
+#elif defined(HAVE_F16C_DISPATCH)
+    static const bool f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    if (f16c)
+        i = halfToFloatsF16C(in, n, out);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 8 <= n; i += 8) {
+        float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(in + i));
+        vst1q_f32(out + i, vcvt_f32_f16(vget_low_f16(h)));
+        vst1q_f32(out + i + 4, vcvt_high_f32_f16(h));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = halfToFloat(in[i]);
+}
+
+/* n INT8 values times scale to floats */
+static void int8ToFloats(const int8_t *in, size_t n, float scale, float *out)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 s = _mm_set1_ps(scale);
+    for (; i + 16 <= n; i += 16) {
+        // Sign extend by unpacking each byte with itself and shifting back
+        __m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+        __m128i lo = _mm_unpacklo_epi8(v, v), hi = _mm_unpackhi_epi8(v, v);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 24)), s));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 24)), s));
+        _mm_storeu_ps(out + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 24)), s));
+        _mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 24)), s));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vmovl_s8(vld1_s8(in + i));
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = in[i] * scale;
+}
+
+/* Dequantization scales of INT8 output layers, read once from the
+ * environment as PARSER_INT8_SCALES=<layer name>=<scale>[;...]; nvinfer does
+ * not pass them to the parser. 0 if the layer has none */
+static float int8Scale(const char *layerName)
+{
+    static const std::vector<std::pair<std::string, float>> scales = [] {
+        std::vector<std::pair<std::string, float>> parsed;
+        const char *env = std::getenv("PARSER_INT8_SCALES");
+        std::string entries = env ? env : "";
+        size_t begin = 0;
+        while (begin < entries.size()) {
+            size_t end = entries.find(';', begin);
+            if (end == std::string::npos)
+                end = entries.size();
+            std::string entry = entries.substr(begin, end - begin);
+            size_t equal = entry.rfind('=');
+            if (equal != std::string::npos && equal > 0)
+                parsed.push_back(std::make_pair(entry.substr(0, equal),
+                                                (float) std::atof(entry.c_str() + equal + 1)));
+            begin = end + 1;
+        }
+        return parsed;
+    }();
+    for (size_t i = 0; layerName && i < scales.size(); i++)
+        if (scales[i].first == layerName)
+            return scales[i].second;
+    return 0.0f;
+}
+
+/* count values of layer from offset on, as floats. INT8 values are
+ * multiplied by scale and need one */
+static bool layerToFloats(const NvDsInferLayerInfo &layer, float scale, size_t offset,
+                          size_t count, float *out)
+{
+    switch (layer.dataType) {
+    case FLOAT:
+        memcpy(out, (const float *) layer.buffer + offset, count * sizeof(float));
+        return true;
+    case HALF:
+        halfToFloats((const uint16_t *) layer.buffer + offset, count, out);
+        return true;
+    case INT8:
+        if (scale == 0.0f) {
+            std::cerr << "ERROR: no scale for INT8 output layer "
+                      << (layer.layerName ? layer.layerName : "") << " in PARSER_INT8_SCALES" << std::endl;
+            return false;
+        }
+        int8ToFloats((const int8_t *) layer.buffer + offset, count, scale, out);
+        return true;
+    case INT32:
+        for (size_t i = 0; i < count; i++)
+            out[i] = (float) ((const int32_t *) layer.buffer)[offset + i];
+        return true;
+    default:
+        std::cerr << "ERROR: unsupported data type " << (int) layer.dataType << " of output layer "
+                  << (layer.layerName ? layer.layerName : "") << std::endl;
+        return false;
+    }
+}
+
 /* This is a sample bounding box parsing function for the sample FasterRCNN
  *
  * detector model provided with the SDK. */
@@ -69,106 +659,332 @@ bool NvDsInferParseCustomEfficientDetTAO (
          NvDsInferParseDetectionParams const &detectionParams,
          std::vector<NvDsInferObjectDetectionInfo> &objectList);
 
-
 extern "C"
-bool NvDsInferParseCustomNMSTLT (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-                                   NvDsInferNetworkInfo  const &networkInfo,
-                                   NvDsInferParseDetectionParams const &detectionParams,
-                                   std::vector<NvDsInferObjectDetectionInfo> &objectList) {
-    if(outputLayersInfo.size() != 2)
+bool NvDsInferParseCustomCpuNMSTLT (
+         std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+         NvDsInferNetworkInfo  const &networkInfo,
+         NvDsInferParseDetectionParams const &detectionParams,
+         std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+
+/* Semantic roles of the output layers of a network */
+enum LayerRole {
+    ROLE_BOXES,
+    ROLE_SCORES,
+    ROLE_CLASSES,
+    ROLE_KEEP_COUNT,
+    ROLE_MASKS,
+    NUM_LAYER_ROLES
+};
+
+/* Where a layout finds the layer of a role: by name, when the network has
+ * layers of all the names of the layout, else at its position (-1: by name
+ * only) */
+struct LayerRoleSpec {
+    LayerRole role;
+    const char *name;
+    int position;
+};
+
+/* Index in outputLayersInfo of the layer of each role, -1 if unused, and
+ * the scale of the INT8 ones */
+struct LayerBindings {
+    int index[NUM_LAYER_ROLES];
+    float scale[NUM_LAYER_ROLES];
+};
+
+template <typename Layout>
+static bool resolveBindings(std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+                            LayerBindings &bindings)
+{
+    std::fill(bindings.index, bindings.index + NUM_LAYER_ROLES, -1);
+    std::fill(bindings.scale, bindings.scale + NUM_LAYER_ROLES, 0.0f);
+    bool byName = true;
+    for (const LayerRoleSpec &spec : Layout::roles) {
+        for (size_t i = 0; spec.name && i < outputLayersInfo.size(); i++) {
+            const NvDsInferLayerInfo &layer = outputLayersInfo[i];
+            if (layer.layerName && !strcmp(spec.name, layer.layerName)) {
+                bindings.index[spec.role] = (int) i;
+                break;
+            }
+        }
+        byName = byName && bindings.index[spec.role] >= 0;
+    }
+    if (!byName) {
+        if (Layout::NUM_LAYERS != 0 && outputLayersInfo.size() != Layout::NUM_LAYERS) {
+            std::cerr << "Mismatch in the number of output buffers."
+                      << "Expected " << Layout::NUM_LAYERS << " output buffers, detected in the network :"
+                      << outputLayersInfo.size() << std::endl;
+            return false;
+        }
+        for (const LayerRoleSpec &spec : Layout::roles) {
+            if (spec.position < 0) {
+                std::cerr << "ERROR: some layers missing or unsupported data types "
+                          << "in output tensors" << std::endl;
+                return false;
+            }
+            bindings.index[spec.role] = spec.position;
+        }
+    }
+    for (const LayerRoleSpec &spec : Layout::roles)
+        bindings.scale[spec.role] = int8Scale(outputLayersInfo[bindings.index[spec.role]].layerName);
+    return true;
+}
+
+/* Bindings of the last networks a layout was used with. nvinfer passes the
+ * same layer names, owned by the engine, on every frame, so the name pointers
+ * and sizes of the layers identify a network without comparing strings */
+struct LayerBindingCache {
+    static const size_t SIZE = 4;
+    struct Entry {
+        std::vector<std::pair<const char *, unsigned int>> layers;
+        LayerBindings bindings;
+    };
+    std::vector<Entry> entries;
+    size_t next = 0;
+
+    static bool matches(const Entry &entry, std::vector<NvDsInferLayerInfo> const &outputLayersInfo)
     {
-        std::cerr << "Mismatch in the number of output buffers."
-                  << "Expected 2 output buffers, detected in the network :"
-                  << outputLayersInfo.size() << std::endl;
-        return false;
+        if (entry.layers.size() != outputLayersInfo.size())
+            return false;
+        for (size_t i = 0; i < entry.layers.size(); i++) {
+            if (entry.layers[i].first != outputLayersInfo[i].layerName ||
+                entry.layers[i].second != outputLayersInfo[i].inferDims.numElements)
+                return false;
+        }
+        return true;
     }
 
-    // Host memory for "nms" which has 2 output bindings:
-    // the order is bboxes and keep_count
-    float* out_nms = (float *) outputLayersInfo[0].buffer;
-    int * p_keep_count = (int *) outputLayersInfo[1].buffer;
-    const int out_class_size = detectionParams.numClassesConfigured;
-    const float threshold = detectionParams.perClassThreshold[0];
+    const LayerBindings *find(std::vector<NvDsInferLayerInfo> const &outputLayersInfo) const
+    {
+        for (const Entry &entry : entries)
+            if (matches(entry, outputLayersInfo))
+                return &entry.bindings;
+        return nullptr;
+    }
 
-    float* det;
+    const LayerBindings *insert(std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+                                const LayerBindings &bindings)
+    {
+        Entry entry;
+        for (const NvDsInferLayerInfo &layer : outputLayersInfo)
+            entry.layers.push_back(std::make_pair(layer.layerName, layer.inferDims.numElements));
+        entry.bindings = bindings;
+        if (entries.size() < SIZE) {
+            entries.push_back(entry);
+            return &entries.back().bindings;
+        }
+        // Oldest first; the vector never grows past SIZE, so pointers stay valid
+        Entry &slot = entries[next];
+        next = (next + 1) % SIZE;
+        slot = entry;
+        return &slot.bindings;
+    }
+};
 
-    for (int i = 0; i < p_keep_count[0]; i++) {
-        det = out_nms + i * 7;
+/* Layer bindings of Layout for this network, resolved on its first frame */
+template <typename Layout>
+static const LayerBindings *bindLayers(std::vector<NvDsInferLayerInfo> const &outputLayersInfo)
+{
+    static thread_local LayerBindingCache cache;
+    const LayerBindings *bindings = cache.find(outputLayersInfo);
+    if (bindings)
+        return bindings;
+    LayerBindings resolved;
+    if (!resolveBindings<Layout>(outputLayersInfo, resolved))
+        return nullptr;
+    if (cache.entries.empty())
+        cache.entries.reserve(LayerBindingCache::SIZE);
+    return cache.insert(outputLayersInfo, resolved);
+}
 
-        // Output format for each detection is stored in the below order
-        // [image_id, label, confidence, xmin, ymin, xmax, ymax]
-        if ( det[2] < threshold) continue;
-        assert((int) det[1] < out_class_size);
+/* Output layers of a frame, by role. load() converts the HALF, INT8 and
+ * INT32 layers to floats in per-thread buffers; FLOAT layers are read in
+ * place. The keep count stays INT32, and masks are converted per instance
+ * by the parser with floatsAt() */
+struct DetectionTensors {
+    const NvDsInferLayerInfo *layers[NUM_LAYER_ROLES];
+    const float *values[NUM_LAYER_ROLES];
+    const LayerBindings &bindings;
+
+    DetectionTensors(std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+                     const LayerBindings &layerBindings)
+        : bindings(layerBindings)
+    {
+        for (int role = 0; role < NUM_LAYER_ROLES; role++) {
+            layers[role] = bindings.index[role] >= 0 ? &outputLayersInfo[bindings.index[role]] : nullptr;
+            values[role] = nullptr;
+        }
+    }
 
-#if 0
-        std::cout << "id/label/conf/ x/y x/y -- "
-                  << det[0] << " " << det[1] << " " << det[2] << " "
-                  << det[3] << " " << det[4] << " " << det[5] << " " << det[6] << std::endl;
-#endif
-        NvDsInferObjectDetectionInfo object;
-            object.classId = (int) det[1];
-            object.detectionConfidence = det[2];
+    bool load()
+    {
+        static thread_local std::vector<float> converted[NUM_LAYER_ROLES];
+        for (int role = 0; role < NUM_LAYER_ROLES; role++) {
+            const NvDsInferLayerInfo *layer = layers[role];
+            if (!layer || role == ROLE_KEEP_COUNT || role == ROLE_MASKS)
+                continue;
+            if (layer->dataType == FLOAT) {
+                values[role] = (const float *) layer->buffer;
+                continue;
+            }
+            converted[role].resize(layer->inferDims.numElements);
+            if (!layerToFloats(*layer, bindings.scale[role], 0, converted[role].size(),
+                               converted[role].data()))
+                return false;
+            values[role] = converted[role].data();
+        }
+        return true;
+    }
 
-            /* Clip object box co-ordinates to network resolution */
-            object.left = CLIP(det[3] * networkInfo.width, 0, networkInfo.width - 1);
-            object.top = CLIP(det[4] * networkInfo.height, 0, networkInfo.height - 1);
-            object.width = CLIP((det[5] - det[3]) * networkInfo.width, 0, networkInfo.width - 1);
-            object.height = CLIP((det[6] - det[4]) * networkInfo.height, 0, networkInfo.height - 1);
+    const NvDsInferLayerInfo &layer(LayerRole role) const { return *layers[role]; }
+    const float *floats(LayerRole role) const { return values[role]; }
+    const int *ints(LayerRole role) const { return (const int *) layers[role]->buffer; }
 
-            objectList.push_back(object);
+    bool floatsAt(LayerRole role, size_t offset, size_t count, float *out) const
+    {
+        return layerToFloats(*layers[role], bindings.scale[role], offset, count, out);
     }
+};
+
+/* Decode core of the detection parsers. The Layout policy lists the roles of
+ * its output layers and, for the tensors of a frame, prepares the detections
+ * and decodes them one by one; decode() returns false to skip one */
+template <typename Layout>
+static bool parseDetections(std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+                            NvDsInferNetworkInfo const &networkInfo,
+                            NvDsInferParseDetectionParams const &detectionParams,
+                            std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+    const LayerBindings *bindings = bindLayers<Layout>(outputLayersInfo);
+    if (!bindings)
+        return false;
+    DetectionTensors tensors(outputLayersInfo, *bindings);
+    if (!tensors.load())
+        return false;
+
+    Layout layout;
+    if (!layout.prepare(tensors, networkInfo, detectionParams))
+        return false;
 
+    unsigned int count = layout.count();
+    if (Layout::KEEP_TOP_K != 0)
+        count = MIN(count, (unsigned int) Layout::KEEP_TOP_K);
+    objectList.reserve(objectList.size() + count);
+    for (unsigned int i = 0; i < layout.count() && count > 0; i++) {
+        NvDsInferObjectDetectionInfo object;
+        if (!layout.decode(i, object))
+            continue;
+        objectList.push_back(object);
+        count--;
+    }
     return true;
 }
 
-extern "C"
-bool NvDsInferParseCustomBatchedNMSTLT (
-         std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-         NvDsInferNetworkInfo  const &networkInfo,
-         NvDsInferParseDetectionParams const &detectionParams,
-         std::vector<NvDsInferObjectDetectionInfo> &objectList) {
+/* NMS plugin: [image_id, label, confidence, xmin, ymin, xmax, ymax] per
+ * detection, normalized, then keep_count */
+struct NmsLayout {
+    enum { NUM_LAYERS = 2, KEEP_TOP_K = 0 };
+    static const LayerRoleSpec roles[2];
 
-	 if(outputLayersInfo.size() != 4)
+    const float *out_nms;
+    int keep_count;
+    int out_class_size;
+    float threshold;
+    NvDsInferNetworkInfo networkInfo;
+
+    bool prepare(const DetectionTensors &tensors, NvDsInferNetworkInfo const &network,
+                 NvDsInferParseDetectionParams const &detectionParams)
     {
-        std::cerr << "Mismatch in the number of output buffers."
-                  << "Expected 4 output buffers, detected in the network :"
-                  << outputLayersInfo.size() << std::endl;
-        return false;
+        out_nms = tensors.floats(ROLE_BOXES);
+        keep_count = tensors.ints(ROLE_KEEP_COUNT)[0];
+        out_class_size = detectionParams.numClassesConfigured;
+        threshold = detectionParams.perClassThreshold[0];
+        networkInfo = network;
+        return true;
     }
 
-    /* Host memory for "BatchedNMS"
-       BatchedNMS has 4 output bindings, the order is:
-       keepCount, bboxes, scores, classes
-    */
-    int* p_keep_count = (int *) outputLayersInfo[0].buffer;
-    float* p_bboxes = (float *) outputLayersInfo[1].buffer;
-    float* p_scores = (float *) outputLayersInfo[2].buffer;
-    float* p_classes = (float *) outputLayersInfo[3].buffer;
+    unsigned int count() const { return MAX(keep_count, 0); }
+
+    bool decode(unsigned int i, NvDsInferObjectDetectionInfo &object) const
+    {
+        const float *det = out_nms + i * 7;
 
-    const float threshold = detectionParams.perClassThreshold[0];
+        // Output format for each detection is stored in the below order
+        // [image_id, label, confidence, xmin, ymin, xmax, ymax]
+        if ( det[2] < threshold) return false;
+        assert((int) det[1] < out_class_size);
 
-    const int keep_top_k = 200;
-    const char* log_enable = std::getenv("ENABLE_DEBUG");
+#if 0
+        std::cout << "id/label/conf/ x/y x/y -- "
+                  << det[0] << " " << det[1] << " " << det[2] << " "
+                  << det[3] << " " << det[4] << " " << det[5] << " " << det[6] << std::endl;
+#endif
+        object.classId = (int) det[1];
+        object.detectionConfidence = det[2];
 
-    if(log_enable != NULL && std::stoi(log_enable)) {
-        std::cout <<"keep cout"
-              <<p_keep_count[0] << std::endl;
+        /* Clip object box co-ordinates to network resolution */
+        object.left = CLIP(det[3] * networkInfo.width, 0, networkInfo.width - 1);
+        object.top = CLIP(det[4] * networkInfo.height, 0, networkInfo.height - 1);
+        object.width = CLIP((det[5] - det[3]) * networkInfo.width, 0, networkInfo.width - 1);
+        object.height = CLIP((det[6] - det[4]) * networkInfo.height, 0, networkInfo.height - 1);
+        return true;
+    }
+};
+const LayerRoleSpec NmsLayout::roles[2] = {
+    {ROLE_BOXES, "NMS", 0},
+    {ROLE_KEEP_COUNT, "NMS_1", 1}};
+
+/* BatchedNMS plugin: keepCount, bboxes (normalized x1 y1 x2 y2), scores,
+ * classes */
+struct BatchedNmsLayout {
+    enum { NUM_LAYERS = 4, KEEP_TOP_K = 200 };
+    static const LayerRoleSpec roles[4];
+
+    const float *p_bboxes;
+    const float *p_scores;
+    const float *p_classes;
+    int keep_count;
+    unsigned int numClassesConfigured;
+    float threshold;
+    bool log_enable;
+    NvDsInferNetworkInfo networkInfo;
+
+    bool prepare(const DetectionTensors &tensors, NvDsInferNetworkInfo const &network,
+                 NvDsInferParseDetectionParams const &detectionParams)
+    {
+        keep_count = tensors.ints(ROLE_KEEP_COUNT)[0];
+        p_bboxes = tensors.floats(ROLE_BOXES);
+        p_scores = tensors.floats(ROLE_SCORES);
+        p_classes = tensors.floats(ROLE_CLASSES);
+        numClassesConfigured = detectionParams.numClassesConfigured;
+        threshold = detectionParams.perClassThreshold[0];
+        networkInfo = network;
+
+        const char* debug = std::getenv("ENABLE_DEBUG");
+        log_enable = debug != NULL && std::atoi(debug);
+        if(log_enable) {
+            std::cout <<"keep cout"
+                  <<keep_count << std::endl;
+        }
+        return true;
     }
 
-    for (int i = 0; i < p_keep_count[0] && objectList.size() <= keep_top_k; i++) {
+    unsigned int count() const { return MAX(keep_count, 0); }
 
-        if ( p_scores[i] < threshold) continue;
+    bool decode(unsigned int i, NvDsInferObjectDetectionInfo &object) const
+    {
+        if ( p_scores[i] < threshold) return false;
 
-        if(log_enable != NULL && std::stoi(log_enable)) {
+        if(log_enable) {
             std::cout << "label/conf/ x/y x/y -- "
                       << p_classes[i] << " " << p_scores[i] << " "
                       << p_bboxes[4*i] << " " << p_bboxes[4*i+1] << " " << p_bboxes[4*i+2] << " "<< p_bboxes[4*i+3] << " " << std::endl;
         }
 
-        if((unsigned int) p_classes[i] >= detectionParams.numClassesConfigured) continue;
-        if(p_bboxes[4*i+2] < p_bboxes[4*i] || p_bboxes[4*i+3] < p_bboxes[4*i+1]) continue;
+        if((unsigned int) p_classes[i] >= numClassesConfigured) return false;
+        if(p_bboxes[4*i+2] < p_bboxes[4*i] || p_bboxes[4*i+3] < p_bboxes[4*i+1]) return false;
 
-        NvDsInferObjectDetectionInfo object;
         object.classId = (int) p_classes[i];
         object.detectionConfidence = p_scores[i];
 
@@ -178,11 +994,325 @@ bool NvDsInferParseCustomBatchedNMSTLT (
         object.width = CLIP(p_bboxes[4*i+2] * networkInfo.width, 0, networkInfo.width - 1) - object.left;
         object.height = CLIP(p_bboxes[4*i+3] * networkInfo.height, 0, networkInfo.height - 1) - object.top;
 
-        if(object.height < 0 || object.width < 0)
-            continue;
-        objectList.push_back(object);
+        return object.height >= 0 && object.width >= 0;
     }
-    return true;
+};
+const LayerRoleSpec BatchedNmsLayout::roles[4] = {
+    {ROLE_KEEP_COUNT, "BatchedNMS", 0},
+    {ROLE_BOXES, "BatchedNMS_1", 1},
+    {ROLE_SCORES, "BatchedNMS_2", 2},
+    {ROLE_CLASSES, "BatchedNMS_3", 3}};
+
+/* EfficientNMS plugin: num_detections, detection_boxes (absolute y1 x1 y2
+ * x2), detection_scores, detection_classes */
+struct EfficientDetLayout {
+    enum { NUM_LAYERS = 4, KEEP_TOP_K = 0 };
+    static const LayerRoleSpec roles[4];
+
+    const float *p_bboxes;
+    const float *p_scores;
+    const float *p_classes;
+    int keep_count;
+    int out_class_size;
+    float threshold;
+    NvDsInferNetworkInfo networkInfo;
+
+    bool prepare(const DetectionTensors &tensors, NvDsInferNetworkInfo const &network,
+                 NvDsInferParseDetectionParams const &detectionParams)
+    {
+        keep_count = tensors.ints(ROLE_KEEP_COUNT)[0];
+        p_bboxes = tensors.floats(ROLE_BOXES);
+        p_scores = tensors.floats(ROLE_SCORES);
+        p_classes = tensors.floats(ROLE_CLASSES);
+        out_class_size = detectionParams.numClassesConfigured;
+        threshold = detectionParams.perClassThreshold[0];
+        networkInfo = network;
+
+        if (keep_count > 0) {
+            int numElements_p_bboxes = tensors.layer(ROLE_BOXES).inferDims.numElements;
+            float max_bbox=0;
+            for (int i=0; i < numElements_p_bboxes; i++)
+            {
+                if ( max_bbox < p_bboxes[i] )
+                    max_bbox=p_bboxes[i];
+            }
+            int normalized = (max_bbox < 2.0);
+            assert (normalized == 0);
+            (void) normalized;
+        }
+        return true;
+    }
+
+    unsigned int count() const { return MAX(keep_count, 0); }
+
+    bool decode(unsigned int i, NvDsInferObjectDetectionInfo &object) const
+    {
+        if ( p_scores[i] < threshold) return false;
+        assert((int) p_classes[i] < out_class_size);
+
+        // std::cout << "label/conf/ x/y x/y -- "
+                  // << (int)p_classes[i] << " " << p_scores[i] << " "
+                  // << p_bboxes[4*i] << " " << p_bboxes[4*i+1] << " " << p_bboxes[4*i+2] << " "<< p_bboxes[4*i+3] << " " << std::endl;
+
+        if(p_bboxes[4*i+2] < p_bboxes[4*i] || p_bboxes[4*i+3] < p_bboxes[4*i+1])
+            return false;
+
+        object.classId = (int) p_classes[i];
+        object.detectionConfidence = p_scores[i];
+
+        object.left=p_bboxes[4*i+1];
+        object.top=p_bboxes[4*i];
+        object.width=( p_bboxes[4*i+3] - object.left);
+        object.height= ( p_bboxes[4*i+2] - object.top);
+
+        object.left=CLIP(object.left, 0, networkInfo.width - 1);
+        object.top=CLIP(object.top, 0, networkInfo.height - 1);
+        object.width=CLIP(object.width, 0, networkInfo.width - 1);
+        object.height=CLIP(object.height, 0, networkInfo.height - 1);
+        return true;
+    }
+};
+const LayerRoleSpec EfficientDetLayout::roles[4] = {
+    {ROLE_KEEP_COUNT, "num_detections", 0},
+    {ROLE_BOXES, "detection_boxes", 1},
+    {ROLE_SCORES, "detection_scores", 2},
+    {ROLE_CLASSES, "detection_classes", 3}};
+
+/* Deformable DETR: pred_boxes (num_queries x 4, normalized cx cy w h) and
+ * pred_logits (num_queries x num_classes, class 0 is background) */
+struct DDETRLayout {
+    enum { NUM_LAYERS = 0, KEEP_TOP_K = 200 };
+    static const LayerRoleSpec roles[2];
+
+    const float *boxes;
+    const std::vector<DDETRCandidate> *candidates;
+    const float *scores;
+    NvDsInferNetworkInfo networkInfo;
+
+    bool prepare(const DetectionTensors &tensors, NvDsInferNetworkInfo const &network,
+                 NvDsInferParseDetectionParams const &detectionParams)
+    {
+        static thread_local std::vector<DDETRCandidate> ranked;
+        static thread_local std::vector<float> confidences;
+        ranked.clear();
+        confidences.clear();
+        candidates = &ranked;
+        scores = confidences.data();
+        boxes = tensors.floats(ROLE_BOXES);
+        networkInfo = network;
+
+        const NvDsInferLayerInfo &classLayer = tensors.layer(ROLE_SCORES);
+        unsigned int numDetections = classLayer.inferDims.d[0];
+        unsigned int numClasses = classLayer.inferDims.d[1];
+        const float *logits = tensors.floats(ROLE_SCORES);
+        if (numClasses == 0)
+            return true;
+
+        // The model has no sigmoid layer: compare logits against the thresholds
+        // mapped through the inverse sigmoid, and only compute the confidence of
+        // the detections that are kept
+        const std::vector<float> &thresholds = logitThresholds(detectionParams.perClassPreclusterThreshold);
+        const unsigned int numThresholds = MIN(numClasses, (unsigned int) thresholds.size());
+        float minThreshold = std::numeric_limits<float>::infinity();
+        for (unsigned int c = 1; c < numThresholds; c++)
+            minThreshold = MIN(minThreshold, thresholds[c]);
+
+        for (unsigned int idx = 0; idx < numDetections; idx += 1) {
+            const float *row = logits + idx * numClasses;
+            float best = rowMax(row, numClasses);
+            if (!(best >= minThreshold))
+                continue;
+            // First class with the max logit, as std::max_element; 0 is background
+            unsigned int classId = 0;
+            while (classId < numClasses && row[classId] != best)
+                classId++;
+            if (classId == 0 || classId >= numThresholds || best < thresholds[classId])
+                continue;
+            DDETRCandidate candidate = {best, idx, (int) classId};
+            ranked.push_back(candidate);
+        }
+
+        // Highest confidence first; equal confidences are all kept, in query order
+        auto higher = [](const DDETRCandidate &a, const DDETRCandidate &b) {
+            return a.logit > b.logit || (a.logit == b.logit && a.query < b.query);
+        };
+        if (ranked.size() > KEEP_TOP_K) {
+            std::nth_element(ranked.begin(), ranked.begin() + KEEP_TOP_K, ranked.end(), higher);
+            ranked.resize(KEEP_TOP_K);
+        }
+        std::sort(ranked.begin(), ranked.end(), higher);
+
+        confidences.resize(ranked.size());
+        for (size_t i = 0; i < ranked.size(); i++)
+            confidences[i] = ranked[i].logit;
+        sigmoidInPlace(confidences.data(), confidences.size());
+        scores = confidences.data();
+        return true;
+    }
+
+    unsigned int count() const { return candidates->size(); }
+
+    bool decode(unsigned int i, NvDsInferObjectDetectionInfo &res) const
+    {
+        const DDETRCandidate &candidate = (*candidates)[i];
+        res.classId = candidate.classId;
+        res.detectionConfidence = scores[i];
+
+        enum {cx, cy, w, h};
+        float rectX1f, rectY1f, rectX2f, rectY2f;
+
+        const float *box = boxes + candidate.query * 4;
+
+        rectX1f = (box[cx] - (box[w]/2)) * networkInfo.width;
+        rectY1f = (box[cy] - (box[h]/2)) * networkInfo.height;
+        rectX2f = rectX1f + box[w] * networkInfo.width;
+        rectY2f = rectY1f + box[h] * networkInfo.height;
+
+        rectX1f = CLIP(rectX1f, 0.0f, networkInfo.width - 1);
+        rectX2f = CLIP(rectX2f, 0.0f, networkInfo.width - 1);
+        rectY1f = CLIP(rectY1f, 0.0f, networkInfo.height - 1);
+        rectY2f = CLIP(rectY2f, 0.0f, networkInfo.height - 1);
+
+        res.left = rectX1f;
+        res.top = rectY1f;
+        res.width = rectX2f - rectX1f;
+        res.height = rectY2f - rectY1f;
+        return true;
+    }
+};
+const LayerRoleSpec DDETRLayout::roles[2] = {
+    {ROLE_BOXES, "pred_boxes", -1},     // 1 x num_queries x 4
+    {ROLE_SCORES, "pred_logits", -1}};  // 1 x num_queries x num_classes
+
+/* Raw detector outputs, for models exported without the NMS plugins: boxes
+ * (num_boxes x 4, normalized x1 y1 x2 y2, the BatchedNMS input) and scores
+ * (num_boxes x num_classes), with class-aware NMS run on the CPU, see
+ * CpuNmsSettings */
+struct CpuNmsLayout {
+    enum { NUM_LAYERS = 2, KEEP_TOP_K = 200 };
+    static const LayerRoleSpec roles[2];
+
+    const float *p_bboxes;
+    const std::vector<NmsCandidate> *kept;
+    NvDsInferNetworkInfo networkInfo;
+
+    bool prepare(const DetectionTensors &tensors, NvDsInferNetworkInfo const &network,
+                 NvDsInferParseDetectionParams const &detectionParams)
+    {
+        static thread_local NmsScratch scratch;
+        scratch.candidates.clear();
+        scratch.kept.clear();
+        kept = &scratch.kept;
+        networkInfo = network;
+
+        p_bboxes = tensors.floats(ROLE_BOXES);
+        const float* p_scores = tensors.floats(ROLE_SCORES);
+        const unsigned int numBoxes = tensors.layer(ROLE_BOXES).inferDims.numElements / 4;
+        const unsigned int numScores = tensors.layer(ROLE_SCORES).inferDims.numElements;
+        const unsigned int numClasses = numBoxes ? numScores / numBoxes : 0;
+        if (numBoxes == 0 || numClasses == 0 || numScores != numBoxes * numClasses) {
+            std::cerr << "ERROR: expected boxes num_boxes x 4 and scores num_boxes x "
+                      << "num_classes, got " << tensors.layer(ROLE_BOXES).inferDims.numElements
+                      << " and " << numScores << " values" << std::endl;
+            return false;
+        }
+
+        const CpuNmsSettings &settings = cpuNmsSettings();
+        const std::vector<float> &thresholds = detectionParams.perClassPreclusterThreshold;
+        const unsigned int numThresholds = MIN(numClasses, (unsigned int) thresholds.size());
+
+        std::vector<NmsCandidate> &candidates = scratch.candidates;
+        for (unsigned int i = 0; i < numBoxes; i++)
+            collectCandidates(p_scores + (size_t) i * numClasses, thresholds.data(),
+                              numThresholds, i, candidates);
+
+        // Bucket by class, then the top_k highest scores of each class first
+        std::vector<size_t> &classStart = scratch.classStart;
+        classStart.assign(numThresholds + 1, 0);
+        for (const NmsCandidate &candidate : candidates)
+            classStart[candidate.classId + 1]++;
+        for (unsigned int c = 0; c < numThresholds; c++)
+            classStart[c + 1] += classStart[c];
+        scratch.byClass.resize(candidates.size());
+        for (const NmsCandidate &candidate : candidates)
+            scratch.byClass[classStart[candidate.classId]++] = candidate;
+
+        auto higher = [](const NmsCandidate &a, const NmsCandidate &b) {
+            return a.score > b.score || (a.score == b.score && a.box < b.box);
+        };
+        size_t begin = 0;
+        for (unsigned int c = 0; c < numThresholds; c++) {
+            // classStart[c] is now the end of class c
+            size_t end = classStart[c];
+            if (begin == end)
+                continue;
+            auto first = scratch.byClass.begin() + begin, last = scratch.byClass.begin() + end;
+            size_t n = MIN(end - begin, (size_t) settings.top_k);
+            if (n < end - begin)
+                std::nth_element(first, first + n, last, higher);
+            std::sort(first, first + n, higher);
+            scratch.load(&scratch.byClass[begin], n, p_bboxes);
+            nmsClass(scratch, n, c, thresholds[c], settings);
+            begin = end;
+        }
+
+        std::vector<NmsCandidate> &result = scratch.kept;
+        if (result.size() > KEEP_TOP_K) {
+            std::nth_element(result.begin(), result.begin() + KEEP_TOP_K, result.end(), higher);
+            result.resize(KEEP_TOP_K);
+        }
+        std::sort(result.begin(), result.end(), higher);
+        return true;
+    }
+
+    unsigned int count() const { return kept->size(); }
+
+    bool decode(unsigned int i, NvDsInferObjectDetectionInfo &object) const
+    {
+        const NmsCandidate &candidate = (*kept)[i];
+        const float *b = p_bboxes + candidate.box * 4;
+        if (b[2] < b[0] || b[3] < b[1]) return false;
+
+        object.classId = candidate.classId;
+        object.detectionConfidence = candidate.score;
+
+        /* Clip object box co-ordinates to network resolution */
+        object.left = CLIP(b[0] * networkInfo.width, 0, networkInfo.width - 1);
+        object.top = CLIP(b[1] * networkInfo.height, 0, networkInfo.height - 1);
+        object.width = CLIP(b[2] * networkInfo.width, 0, networkInfo.width - 1) - object.left;
+        object.height = CLIP(b[3] * networkInfo.height, 0, networkInfo.height - 1) - object.top;
+        return true;
+    }
+};
+const LayerRoleSpec CpuNmsLayout::roles[2] = {
+    {ROLE_BOXES, nullptr, 0},
+    {ROLE_SCORES, nullptr, 1}};
+
+/* Mask R-CNN: generate_detections (MrcnnRawDetection per instance) and
+ * mask_fcn_logits (instances x classes x mask height x mask width) */
+struct MrcnnLayout {
+    enum { NUM_LAYERS = 0 };
+    static const LayerRoleSpec roles[2];
+};
+const LayerRoleSpec MrcnnLayout::roles[2] = {
+    {ROLE_BOXES, "generate_detections", -1},
+    {ROLE_MASKS, "mask_fcn_logits/BiasAdd", -1}};
+
+extern "C"
+bool NvDsInferParseCustomNMSTLT (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+                                   NvDsInferNetworkInfo  const &networkInfo,
+                                   NvDsInferParseDetectionParams const &detectionParams,
+                                   std::vector<NvDsInferObjectDetectionInfo> &objectList) {
+    return parseDetections<NmsLayout>(outputLayersInfo, networkInfo, detectionParams, objectList);
+}
+
+extern "C"
+bool NvDsInferParseCustomBatchedNMSTLT (
+         std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+         NvDsInferNetworkInfo  const &networkInfo,
+         NvDsInferParseDetectionParams const &detectionParams,
+         std::vector<NvDsInferObjectDetectionInfo> &objectList) {
+    return parseDetections<BatchedNmsLayout>(outputLayersInfo, networkInfo, detectionParams, objectList);
 }
 
 extern "C"
@@ -190,26 +1320,13 @@ bool NvDsInferParseCustomMrcnnTLTV2 (std::vector<NvDsInferLayerInfo> const &outp
                                    NvDsInferNetworkInfo  const &networkInfo,
                                    NvDsInferParseDetectionParams const &detectionParams,
                                    std::vector<NvDsInferInstanceMaskInfo> &objectList) {
-    auto layerFinder = [&outputLayersInfo](const std::string &name)
-        -> const NvDsInferLayerInfo *{
-        for (auto &layer : outputLayersInfo) {
-            if (layer.dataType == FLOAT &&
-              (layer.layerName && name == layer.layerName)) {
-                return &layer;
-            }
-        }
-        return nullptr;
-    };
-
-    const NvDsInferLayerInfo *detectionLayer = layerFinder("generate_detections");
-    const NvDsInferLayerInfo *maskLayer = layerFinder("mask_fcn_logits/BiasAdd");
-
-    if (!detectionLayer || !maskLayer) {
-        std::cerr << "ERROR: some layers missing or unsupported data types "
-                  << "in output tensors" << std::endl;
+    const LayerBindings *bindings = bindLayers<MrcnnLayout>(outputLayersInfo);
+    if (!bindings)
         return false;
-    }
-
+    DetectionTensors tensors(outputLayersInfo, *bindings);
+    if (!tensors.load())
+        return false;
+    const NvDsInferLayerInfo *maskLayer = &tensors.layer(ROLE_MASKS);
     if(maskLayer->inferDims.numDims != 4U) {
         std::cerr << "Network output number of dims is : " <<
             maskLayer->inferDims.numDims << " expect is 4"<< std::endl;
@@ -226,12 +1343,16 @@ bool NvDsInferParseCustomMrcnnTLTV2 (std::vector<NvDsInferLayerInfo> const &outp
     const unsigned int mask_instance_height= maskLayer->inferDims.d[2];
     const unsigned int mask_instance_width = maskLayer->inferDims.d[3];
 
-    auto out_det = reinterpret_cast<MrcnnRawDetection*>( detectionLayer->buffer);
-    auto out_mask = reinterpret_cast<float(*)[mask_instance_width *
-        mask_instance_height]>(maskLayer->buffer);
+    auto out_det = reinterpret_cast<const MrcnnRawDetection*>(tensors.floats(ROLE_BOXES));
+    const unsigned int mask_area = mask_instance_width * mask_instance_height;
+    const bool floatMasks = maskLayer->dataType == FLOAT;
+
+    const MrcnnMaskSettings &maskSettings = mrcnnMaskSettings();
+    static thread_local std::vector<uint16_t> runs;
+    static thread_local std::vector<float> converted;
 
     for(auto i = 0U; i < det_max_instances; i++) {
-        MrcnnRawDetection &rawDec = out_det[i];
+        const MrcnnRawDetection &rawDec = out_det[i];
 
         if(rawDec.score < detectionParams.perClassPreclusterThreshold[0])
             continue;
@@ -246,20 +1367,40 @@ bool NvDsInferParseCustomMrcnnTLTV2 (std::vector<NvDsInferLayerInfo> const &outp
         obj.classId = static_cast<int>(rawDec.class_id);
         obj.detectionConfidence = rawDec.score;
 
-        obj.mask_size = sizeof(float)*mask_instance_width*mask_instance_height;
-        obj.mask = new float[mask_instance_width*mask_instance_height];
         obj.mask_width = mask_instance_width;
         obj.mask_height = mask_instance_height;
 
-        float *rawMask = reinterpret_cast<float *>(out_mask + i
-                         * detectionParams.numClassesConfigured + obj.classId);
-        memcpy (obj.mask, rawMask, sizeof(float)*mask_instance_width*mask_instance_height);
+        size_t maskOffset = ((size_t) i * detectionParams.numClassesConfigured + obj.classId) * mask_area;
+
+        // nvinfer owns the masks and frees them with delete[], so each one is
+        // allocated on its own; RLE masks are encoded in a per-thread buffer
+        // and only their runs are allocated. Masks of other types than FLOAT
+        // are only converted for the instances that are kept
+        if (maskSettings.rle) {
+            const float *rawMask = (const float *) maskLayer->buffer + maskOffset;
+            if (!floatMasks) {
+                converted.resize(mask_area);
+                if (!tensors.floatsAt(ROLE_MASKS, maskOffset, mask_area, converted.data()))
+                    return false;
+                rawMask = converted.data();
+            }
+            encodeMaskRle(rawMask, mask_area, maskSettings.threshold, runs);
+            obj.mask_size = runs.size() * sizeof(uint16_t);
+            obj.mask = new float[DIVIDE_AND_ROUND_UP(obj.mask_size, sizeof(float))];
+            memcpy (obj.mask, runs.data(), obj.mask_size);
+        } else {
+            obj.mask_size = sizeof(float) * mask_area;
+            obj.mask = new float[mask_area];
+            if (!tensors.floatsAt(ROLE_MASKS, maskOffset, mask_area, obj.mask)) {
+                delete[] obj.mask;
+                return false;
+            }
+        }
 
         objectList.push_back(obj);
     }
 
     return true;
-
 }
 
 extern "C"
@@ -267,156 +1408,28 @@ bool NvDsInferParseCustomDDETRTAO (std::vector<NvDsInferLayerInfo> const &output
                                 NvDsInferNetworkInfo const &networkInfo,
                                 NvDsInferParseDetectionParams const &detectionParams,
                                 std::vector<NvDsInferObjectDetectionInfo> &objectList) {
-
-    // Code from NvDsInferParseCustomTfSSD for layer finding
-    auto layerFinder = [&outputLayersInfo](const std::string &name)
-        -> const NvDsInferLayerInfo *{
-        for (auto &layer : outputLayersInfo) {
-            if (layer.dataType == FLOAT &&
-              (layer.layerName && name == layer.layerName)) {
-                return &layer;
-            }
-        }
-        return nullptr;
-    };
-
-    const NvDsInferLayerInfo *boxLayer = layerFinder("pred_boxes"); // 1 x num_queries x 4
-    const NvDsInferLayerInfo *classLayer = layerFinder("pred_logits");  // 1 x num_queries x num_classes
-
-    if (!boxLayer || !classLayer) {
-        std::cerr << "ERROR: some layers missing or unsupported data types "
-                  << "in output tensors" << std::endl;
-        return false;
-    }
-
-    const int keep_top_k = 200;
-    unsigned int numDetections = classLayer->inferDims.d[0];
-    unsigned int numClasses = classLayer->inferDims.d[1];
-    std::map<float, NvDsInferObjectDetectionInfo> ordered_objects;
-
-    for (unsigned int idx = 0; idx < numDetections; idx += 1) {
-        NvDsInferObjectDetectionInfo res;
-
-        unsigned int class_layer_idx = idx * numClasses;
-
-        res.classId = std::max_element(((float*)classLayer->buffer+class_layer_idx), ((float*)classLayer->buffer+class_layer_idx+numClasses)) - ((float*)classLayer->buffer+class_layer_idx);
-        res.detectionConfidence = ((float*)classLayer->buffer)[class_layer_idx+res.classId];
-
-        // If model does not have sigmoid layer, perform sigmoid calculation here
-        res.detectionConfidence = 1.0/(1.0 + exp(-res.detectionConfidence));
-
-        if(res.classId == 0 || res.detectionConfidence < detectionParams.perClassPreclusterThreshold[res.classId]) {
-            continue;
-        }
-        enum {cx, cy, w, h};
-        float rectX1f, rectY1f, rectX2f, rectY2f;
-
-        unsigned int box_layer_idx = idx * 4;
-
-        rectX1f = (((float*)boxLayer->buffer)[box_layer_idx + cx] - (((float*)boxLayer->buffer)[box_layer_idx + w]/2)) * networkInfo.width;
-        rectY1f = (((float*)boxLayer->buffer)[box_layer_idx + cy] - (((float*)boxLayer->buffer)[box_layer_idx + h]/2)) * networkInfo.height;
-        rectX2f = rectX1f + ((float*)boxLayer->buffer)[box_layer_idx + w] * networkInfo.width;
-        rectY2f = rectY1f + ((float*)boxLayer->buffer)[box_layer_idx + h] * networkInfo.height;
-
-        rectX1f = CLIP(rectX1f, 0.0f, networkInfo.width - 1);
-        rectX2f = CLIP(rectX2f, 0.0f, networkInfo.width - 1);
-        rectY1f = CLIP(rectY1f, 0.0f, networkInfo.height - 1);
-        rectY2f = CLIP(rectY2f, 0.0f, networkInfo.height - 1);
-
-        res.left = rectX1f;
-        res.top = rectY1f;
-        res.width = rectX2f - rectX1f;
-        res.height = rectY2f - rectY1f;
-
-        ordered_objects[res.detectionConfidence] = res;
-    }
-
-    int jdx = 0;
-    for (auto iter=ordered_objects.rbegin(); iter!=ordered_objects.rend() && jdx<keep_top_k; iter++, jdx++) {
-        if (iter->second.classId != 0){
-        objectList.emplace_back(iter->second);}
-    }
-    return true;
+    return parseDetections<DDETRLayout>(outputLayersInfo, networkInfo, detectionParams, objectList);
 }
 
-
 extern "C"
 bool NvDsInferParseCustomEfficientDetTAO (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
                                    NvDsInferNetworkInfo  const &networkInfo,
                                    NvDsInferParseDetectionParams const &detectionParams,
                                    std::vector<NvDsInferObjectDetectionInfo> &objectList) {
-    if(outputLayersInfo.size() != 4)
-    {
-        std::cerr << "Mismatch in the number of output buffers."
-                  << "Expected 4 output buffers, detected in the network :"
-                  << outputLayersInfo.size() << std::endl;
-        return false;
-    }
-
-    int* p_keep_count = (int *) outputLayersInfo[0].buffer;
-
-    float* p_bboxes = (float *) outputLayersInfo[1].buffer;
-    NvDsInferDims inferDims_p_bboxes = outputLayersInfo[1].inferDims;
-    int numElements_p_bboxes=inferDims_p_bboxes.numElements;
-
-    float* p_scores = (float *) outputLayersInfo[2].buffer;
-    float* p_classes = (float *) outputLayersInfo[3].buffer;
-
-    const int out_class_size = detectionParams.numClassesConfigured;
-    const float threshold = detectionParams.perClassThreshold[0];
-
-    float max_bbox=0;
-    for (int i=0; i < numElements_p_bboxes; i++)
-    {
-        // std::cout <<"p_bboxes: "
-              // <<p_bboxes[i] << std::endl;
-        if ( max_bbox < p_bboxes[i] )
-            max_bbox=p_bboxes[i];
-    }
-    int normalized = (max_bbox < 2.0);
-
-
-    if (p_keep_count[0] > 0)
-    {
-        assert (normalized == 0);
-        for (int i = 0; i < p_keep_count[0]; i++) {
-
-
-            if ( p_scores[i] < threshold) continue;
-            assert((int) p_classes[i] < out_class_size);
-
-
-            // std::cout << "label/conf/ x/y x/y -- "
-                      // << (int)p_classes[i] << " " << p_scores[i] << " "
-                      // << p_bboxes[4*i] << " " << p_bboxes[4*i+1] << " " << p_bboxes[4*i+2] << " "<< p_bboxes[4*i+3] << " " << std::endl;
-
-            if(p_bboxes[4*i+2] < p_bboxes[4*i] || p_bboxes[4*i+3] < p_bboxes[4*i+1])
-                continue;
-
-            NvDsInferObjectDetectionInfo object;
-            object.classId = (int) p_classes[i];
-            object.detectionConfidence = p_scores[i];
-
-
-            object.left=p_bboxes[4*i+1];
-            object.top=p_bboxes[4*i];
-            object.width=( p_bboxes[4*i+3] - object.left);
-            object.height= ( p_bboxes[4*i+2] - object.top);
-
-            object.left=CLIP(object.left, 0, networkInfo.width - 1);
-            object.top=CLIP(object.top, 0, networkInfo.height - 1);
-            object.width=CLIP(object.width, 0, networkInfo.width - 1);
-            object.height=CLIP(object.height, 0, networkInfo.height - 1);
-
-            objectList.push_back(object);
-        }
-    }
-    return true;
+    return parseDetections<EfficientDetLayout>(outputLayersInfo, networkInfo, detectionParams, objectList);
 }
 
+extern "C"
+bool NvDsInferParseCustomCpuNMSTLT (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+                                   NvDsInferNetworkInfo  const &networkInfo,
+                                   NvDsInferParseDetectionParams const &detectionParams,
+                                   std::vector<NvDsInferObjectDetectionInfo> &objectList) {
+    return parseDetections<CpuNmsLayout>(outputLayersInfo, networkInfo, detectionParams, objectList);
+}
 
 /* Check that the custom function has been defined correctly */
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomNMSTLT);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomBatchedNMSTLT);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomDDETRTAO);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomEfficientDetTAO);
+CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomCpuNMSTLT);
@@ -0,0 +1,601 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// CPU benchmark and golden check of the parsers of
+/// nvdsinfer_custombboxparser_tao.cpp, built against the stub nvdsinfer types
+/// of stub/ (make bench). Each case feeds synthetic output tensors of a
+/// realistic size to one parser and reports the time and the heap
+/// allocations per frame; the objects it parses are compared against the
+/// golden file.
+///
+///   ./parser_bench [--frames N] [--case NAME] [--golden FILE] [--write-golden FILE]
+///
+/// The tensors only hold values that are exact in float, so they are the
+/// same on every platform. Mask R-CNN runs as the mrcnn case, or mrcnn_rle
+/// with MRCNN_MASK_RLE=1. The _fp16 cases feed the same values as HALF
+/// tensors, which hold them exactly, and are checked against the golden
+/// objects of their float case; ddetr_int8 quantizes the logits to INT8 with
+/// the scale it sets in PARSER_INT8_SCALES.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nvdsinfer_custom_impl.h"
+
+extern "C" {
+bool NvDsInferParseCustomNMSTLT(std::vector<NvDsInferLayerInfo> const &, NvDsInferNetworkInfo const &,
+                                NvDsInferParseDetectionParams const &, std::vector<NvDsInferObjectDetectionInfo> &);
+bool NvDsInferParseCustomBatchedNMSTLT(std::vector<NvDsInferLayerInfo> const &, NvDsInferNetworkInfo const &,
+                                       NvDsInferParseDetectionParams const &, std::vector<NvDsInferObjectDetectionInfo> &);
+bool NvDsInferParseCustomDDETRTAO(std::vector<NvDsInferLayerInfo> const &, NvDsInferNetworkInfo const &,
+                                  NvDsInferParseDetectionParams const &, std::vector<NvDsInferObjectDetectionInfo> &);
+bool NvDsInferParseCustomEfficientDetTAO(std::vector<NvDsInferLayerInfo> const &, NvDsInferNetworkInfo const &,
+                                         NvDsInferParseDetectionParams const &, std::vector<NvDsInferObjectDetectionInfo> &);
+bool NvDsInferParseCustomCpuNMSTLT(std::vector<NvDsInferLayerInfo> const &, NvDsInferNetworkInfo const &,
+                                   NvDsInferParseDetectionParams const &, std::vector<NvDsInferObjectDetectionInfo> &);
+bool NvDsInferParseCustomMrcnnTLTV2(std::vector<NvDsInferLayerInfo> const &, NvDsInferNetworkInfo const &,
+                                    NvDsInferParseDetectionParams const &, std::vector<NvDsInferInstanceMaskInfo> &);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Heap allocations of the process, counted by the replaced operator new
+static uint64_t g_allocations = 0;
+
+void *operator new(size_t size)
+{
+    g_allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+/// splitmix64; values are made from integers so they are exact in float
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    unsigned int below(unsigned int n) { return (unsigned int) (next() % n); }
+
+    /// Multiple of 1/steps in [lo, hi)
+    float uniform(int lo, int hi, int steps = 1024)
+    {
+        int range = (hi - lo) * steps;
+        return (float) (lo * steps + (int) below(range)) / steps;
+    }
+};
+
+/// Objects parsed from a frame, as written to the golden file
+struct ParsedObject {
+    unsigned int classId;
+    float left, top, width, height, confidence;
+    unsigned int maskSize;
+    uint64_t maskHash;
+};
+
+static uint64_t fnv1a(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+static NvDsInferLayerInfo makeLayer(const char *name, void *buffer, NvDsInferDataType type,
+                                    std::initializer_list<unsigned int> dims)
+{
+    NvDsInferLayerInfo layer;
+    memset(&layer, 0, sizeof(layer));
+    layer.dataType = type;
+    layer.layerName = name;
+    layer.buffer = buffer;
+    layer.inferDims.numElements = 1;
+    for (unsigned int d : dims) {
+        layer.inferDims.d[layer.inferDims.numDims++] = d;
+        layer.inferDims.numElements *= d;
+    }
+    return layer;
+}
+
+/// Half of a float that is exact in half
+static uint16_t exactHalf(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int) ((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if ((bits & 0x7FFFFFFF) == 0)
+        return sign;
+    if (exponent <= 0)
+        return sign | (uint16_t) ((mantissa | 0x800000) >> (14 - exponent));
+    return sign | (uint16_t) (exponent << 10) | (uint16_t) (mantissa >> 13);
+}
+
+/// Output tensors of one synthetic frame and the parser they are for
+struct BenchCase {
+    std::string name;
+    std::string golden;
+    std::vector<std::vector<float>> tensors;
+    std::vector<std::vector<uint16_t>> halves;
+    std::vector<std::vector<int8_t>> quantized;
+    std::vector<int> keepCount;
+    std::vector<NvDsInferLayerInfo> layers;
+    NvDsInferParseDetectionParams params;
+    NvDsInferParseCustomFunc parse = nullptr;
+    bool masks = false;
+
+    std::vector<float> &tensor(size_t size)
+    {
+        tensors.emplace_back(size);
+        return tensors.back();
+    }
+
+    /// Feeds layer i as HALF
+    void toHalf(size_t i)
+    {
+        NvDsInferLayerInfo &layer = layers[i];
+        const float *values = (const float *) layer.buffer;
+        halves.emplace_back(layer.inferDims.numElements);
+        for (size_t k = 0; k < halves.back().size(); k++)
+            halves.back()[k] = exactHalf(values[k]);
+        layer.buffer = halves.back().data();
+        layer.dataType = HALF;
+    }
+
+    /// Feeds layer i as INT8 of the given scale, rounded and saturated
+    void toInt8(size_t i, float scale)
+    {
+        NvDsInferLayerInfo &layer = layers[i];
+        const float *values = (const float *) layer.buffer;
+        quantized.emplace_back(layer.inferDims.numElements);
+        for (size_t k = 0; k < quantized.back().size(); k++) {
+            float q = std::nearbyint(values[k] / scale);
+            quantized.back()[k] = (int8_t) (q < -128 ? -128 : q > 127 ? 127 : q);
+        }
+        layer.buffer = quantized.back().data();
+        layer.dataType = INT8;
+    }
+
+    void setThresholds(unsigned int numClasses, float threshold)
+    {
+        params.numClassesConfigured = numClasses;
+        params.perClassPreclusterThreshold.assign(numClasses, threshold);
+        params.perClassPostclusterThreshold.assign(numClasses, threshold);
+    }
+};
+
+static const NvDsInferNetworkInfo kNetwork = {960, 544, 3};
+
+/// NMS plugin: 200 x 7 detections, 150 kept
+static void makeNms(BenchCase &c, Random &rng)
+{
+    c.name = "nms";
+    c.parse = NvDsInferParseCustomNMSTLT;
+    c.tensors.reserve(1);
+    std::vector<float> &nms = c.tensor(200 * 7);
+    for (int i = 0; i < 200; i++) {
+        float *det = &nms[i * 7];
+        det[0] = 0;
+        det[1] = (float) rng.below(4);
+        det[2] = rng.uniform(0, 1);
+        det[3] = rng.uniform(0, 1) / 2;
+        det[4] = rng.uniform(0, 1) / 2;
+        det[5] = det[3] + rng.uniform(0, 1) / 2;
+        det[6] = det[4] + rng.uniform(0, 1) / 2;
+    }
+    c.keepCount.assign(1, 150);
+    c.layers = {makeLayer("NMS", nms.data(), FLOAT, {1, 200, 7}),
+                makeLayer("NMS_1", c.keepCount.data(), INT32, {1})};
+    c.setThresholds(4, 0.3f);
+}
+
+/// BatchedNMS plugin: 300 detections, 250 kept, 1 in 5 of an unknown class
+static void makeBatchedNms(BenchCase &c, Random &rng)
+{
+    c.name = "batched_nms";
+    c.parse = NvDsInferParseCustomBatchedNMSTLT;
+    c.tensors.reserve(3);
+    std::vector<float> &boxes = c.tensor(300 * 4);
+    std::vector<float> &scores = c.tensor(300);
+    std::vector<float> &classes = c.tensor(300);
+    for (int i = 0; i < 300; i++) {
+        boxes[i * 4] = rng.uniform(0, 1) * 0.75f;
+        boxes[i * 4 + 1] = rng.uniform(0, 1) * 0.75f;
+        boxes[i * 4 + 2] = boxes[i * 4] + rng.uniform(0, 1) / 4;
+        boxes[i * 4 + 3] = boxes[i * 4 + 1] + rng.uniform(0, 1) / 4;
+        scores[i] = rng.uniform(0, 1);
+        classes[i] = (float) rng.below(5);
+    }
+    c.keepCount.assign(1, 250);
+    c.layers = {makeLayer("BatchedNMS", c.keepCount.data(), INT32, {1}),
+                makeLayer("BatchedNMS_1", boxes.data(), FLOAT, {300, 4}),
+                makeLayer("BatchedNMS_2", scores.data(), FLOAT, {300}),
+                makeLayer("BatchedNMS_3", classes.data(), FLOAT, {300})};
+    c.setThresholds(4, 0.3f);
+}
+
+/// EfficientNMS plugin: 100 detections in pixels (y1 x1 y2 x2), 80 kept
+static void makeEfficientDet(BenchCase &c, Random &rng)
+{
+    c.name = "efficientdet";
+    c.parse = NvDsInferParseCustomEfficientDetTAO;
+    c.tensors.reserve(3);
+    std::vector<float> &boxes = c.tensor(100 * 4);
+    std::vector<float> &scores = c.tensor(100);
+    std::vector<float> &classes = c.tensor(100);
+    for (int i = 0; i < 100; i++) {
+        boxes[i * 4] = rng.uniform(0, 400, 4);
+        boxes[i * 4 + 1] = rng.uniform(0, 800, 4);
+        boxes[i * 4 + 2] = boxes[i * 4] + rng.uniform(-4, 200, 4);
+        boxes[i * 4 + 3] = boxes[i * 4 + 1] + rng.uniform(-4, 200, 4);
+        scores[i] = rng.uniform(0, 1);
+        classes[i] = (float) rng.below(4);
+    }
+    c.keepCount.assign(1, 80);
+    c.layers = {makeLayer("num_detections", c.keepCount.data(), INT32, {1}),
+                makeLayer("detection_boxes", boxes.data(), FLOAT, {100, 4}),
+                makeLayer("detection_scores", scores.data(), FLOAT, {100}),
+                makeLayer("detection_classes", classes.data(), FLOAT, {100})};
+    c.setThresholds(4, 0.3f);
+}
+
+/// Deformable DETR: 300 queries x 91 classes, about 60 above threshold
+static void makeDDETR(BenchCase &c, Random &rng)
+{
+    c.name = "ddetr";
+    c.parse = NvDsInferParseCustomDDETRTAO;
+    c.tensors.reserve(2);
+    std::vector<float> &boxes = c.tensor(300 * 4);
+    std::vector<float> &logits = c.tensor(300 * 91);
+    for (float &logit : logits)
+        logit = rng.uniform(-10, -2, 64);
+    for (int k = 0; k < 80; k++)
+        logits[rng.below(300) * 91 + rng.below(91)] = rng.uniform(-3, 6, 64);
+    for (int i = 0; i < 300; i++) {
+        boxes[i * 4] = rng.uniform(0, 1);
+        boxes[i * 4 + 1] = rng.uniform(0, 1);
+        boxes[i * 4 + 2] = rng.uniform(0, 1) / 2;
+        boxes[i * 4 + 3] = rng.uniform(0, 1) / 2;
+    }
+    c.layers = {makeLayer("pred_boxes", boxes.data(), FLOAT, {300, 4}),
+                makeLayer("pred_logits", logits.data(), FLOAT, {300, 91})};
+    c.setThresholds(91, 0.3f);
+}
+
+/// Raw YOLO-like output for the CPU NMS: 10647 boxes x 3 classes around 40
+/// objects
+static void makeCpuNms(BenchCase &c, Random &rng)
+{
+    c.name = "cpu_nms";
+    c.parse = NvDsInferParseCustomCpuNMSTLT;
+    c.tensors.reserve(2);
+    const unsigned int numBoxes = 10647, numClasses = 3;
+    std::vector<float> &boxes = c.tensor(numBoxes * 4);
+    std::vector<float> &scores = c.tensor(numBoxes * numClasses);
+    for (unsigned int i = 0; i < numBoxes; i++) {
+        unsigned int object = rng.below(40);
+        float cx = (float) (object * 37 % 100) / 128 + 0.1f + rng.uniform(-1, 1) / 64;
+        float cy = (float) (object * 61 % 100) / 128 + 0.1f + rng.uniform(-1, 1) / 64;
+        float half = (float) (4 + object % 8) / 128;
+        boxes[i * 4] = cx - half;
+        boxes[i * 4 + 1] = cy - half;
+        boxes[i * 4 + 2] = cx + half;
+        boxes[i * 4 + 3] = cy + half;
+        for (unsigned int k = 0; k < numClasses; k++)
+            scores[i * numClasses + k] = rng.below(50) ? rng.uniform(0, 1) / 16 : rng.uniform(0, 1);
+    }
+    c.layers = {makeLayer("boxes", boxes.data(), FLOAT, {numBoxes, 1, 4}),
+                makeLayer("scores", scores.data(), FLOAT, {numBoxes, numClasses})};
+    c.setThresholds(numClasses, 0.3f);
+}
+
+/// Mask R-CNN: 100 instances, 91 classes of 28 x 28 round masks
+static void makeMrcnn(BenchCase &c, Random &rng)
+{
+    const char *rle = std::getenv("MRCNN_MASK_RLE");
+    c.name = rle && std::atoi(rle) ? "mrcnn_rle" : "mrcnn";
+    c.masks = true;
+    c.tensors.reserve(2);
+    const unsigned int instances = 100, classes = 91, side = 28;
+    std::vector<float> &detections = c.tensor(instances * 6);
+    std::vector<float> &masks = c.tensor((size_t) instances * classes * side * side);
+    for (unsigned int i = 0; i < instances; i++) {
+        // y1, x1, y2, x2, class_id, score
+        float *det = &detections[i * 6];
+        det[0] = rng.uniform(0, 500, 4);
+        det[1] = rng.uniform(0, 900, 4);
+        det[2] = det[0] + rng.uniform(1, 200, 4);
+        det[3] = det[1] + rng.uniform(1, 200, 4);
+        det[4] = (float) rng.below(classes);
+        det[5] = rng.uniform(0, 1);
+    }
+    for (size_t m = 0; m < (size_t) instances * classes; m++) {
+        int cx = 8 + rng.below(12), cy = 8 + rng.below(12), r = 5 + rng.below(8);
+        float *mask = &masks[m * side * side];
+        for (int y = 0; y < (int) side; y++) {
+            for (int x = 0; x < (int) side; x++) {
+                int d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+                int v = 256 - d2 * 256 / (r * r) + (int) rng.below(32) - 16;
+                mask[y * side + x] = (float) (v < 0 ? 0 : v > 256 ? 256 : v) / 256;
+            }
+        }
+    }
+    c.layers = {makeLayer("generate_detections", detections.data(), FLOAT, {instances, 1, 1, 6}),
+                makeLayer("mask_fcn_logits/BiasAdd", masks.data(), FLOAT, {instances, classes, side, side})};
+    c.setThresholds(classes, 0.5f);
+}
+
+/// DDETR with HALF boxes and logits
+static void makeDDETRHalf(BenchCase &c, Random &rng)
+{
+    makeDDETR(c, rng);
+    c.name = "ddetr_fp16";
+    c.golden = "ddetr";
+    c.toHalf(0);
+    c.toHalf(1);
+}
+
+/// DDETR with INT8 logits of scale 1/8, see main()
+static void makeDDETRInt8(BenchCase &c, Random &rng)
+{
+    makeDDETR(c, rng);
+    c.name = "ddetr_int8";
+    c.toInt8(1, 0.125f);
+}
+
+/// Mask R-CNN with HALF masks
+static void makeMrcnnHalf(BenchCase &c, Random &rng)
+{
+    makeMrcnn(c, rng);
+    c.golden = c.name;
+    c.name += "_fp16";
+    c.toHalf(1);
+}
+
+static bool runParser(BenchCase &c, std::vector<NvDsInferObjectDetectionInfo> &objects,
+                      std::vector<NvDsInferInstanceMaskInfo> &instances)
+{
+    objects.clear();
+    for (NvDsInferInstanceMaskInfo &instance : instances)
+        delete[] instance.mask;
+    instances.clear();
+    if (c.masks)
+        return NvDsInferParseCustomMrcnnTLTV2(c.layers, kNetwork, c.params, instances);
+    return c.parse(c.layers, kNetwork, c.params, objects);
+}
+
+static std::vector<ParsedObject> collect(const std::vector<NvDsInferObjectDetectionInfo> &objects,
+                                         const std::vector<NvDsInferInstanceMaskInfo> &instances)
+{
+    std::vector<ParsedObject> parsed;
+    for (const NvDsInferObjectDetectionInfo &o : objects) {
+        ParsedObject p = {o.classId, o.left, o.top, o.width, o.height, o.detectionConfidence, 0, 0};
+        parsed.push_back(p);
+    }
+    for (const NvDsInferInstanceMaskInfo &o : instances) {
+        ParsedObject p = {o.classId, o.left, o.top, o.width, o.height, o.detectionConfidence,
+                          o.mask_size, fnv1a(o.mask, o.mask_size)};
+        parsed.push_back(p);
+    }
+    return parsed;
+}
+
+typedef std::map<std::string, std::vector<ParsedObject>> Golden;
+
+static bool readGolden(const char *path, Golden &golden)
+{
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string name;
+        ParsedObject p = {};
+        fields >> name >> p.classId >> p.left >> p.top >> p.width >> p.height >> p.confidence;
+        if (fields >> p.maskSize)
+            fields >> std::hex >> p.maskHash;
+        golden[name].push_back(p);
+    }
+    return true;
+}
+
+static void writeGolden(FILE *out, const std::string &name, const std::vector<ParsedObject> &parsed)
+{
+    for (const ParsedObject &p : parsed) {
+        fprintf(out, "%s %u %.9g %.9g %.9g %.9g %.9g", name.c_str(), p.classId, p.left, p.top,
+                p.width, p.height, p.confidence);
+        if (p.maskSize)
+            fprintf(out, " %u %016llx", p.maskSize, (unsigned long long) p.maskHash);
+        fprintf(out, "\n");
+    }
+}
+
+/// Confidences may differ in the last bits between the SIMD and scalar
+/// builds, and boxes with FMA contraction
+static bool sameObjects(const std::vector<ParsedObject> &a, const std::vector<ParsedObject> &b,
+                        std::string &why)
+{
+    if (a.size() != b.size()) {
+        why = std::to_string(a.size()) + " objects, golden " + std::to_string(b.size());
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        bool same = a[i].classId == b[i].classId && a[i].maskSize == b[i].maskSize &&
+                    a[i].maskHash == b[i].maskHash &&
+                    std::fabs(a[i].left - b[i].left) <= 1e-3f &&
+                    std::fabs(a[i].top - b[i].top) <= 1e-3f &&
+                    std::fabs(a[i].width - b[i].width) <= 1e-3f &&
+                    std::fabs(a[i].height - b[i].height) <= 1e-3f &&
+                    std::fabs(a[i].confidence - b[i].confidence) <= 1e-5f * std::fabs(b[i].confidence);
+        if (!same) {
+            why = "object " + std::to_string(i) + " differs";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int frames = 1000;
+    const char *only = nullptr;
+    const char *goldenPath = nullptr;
+    const char *writePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = (unsigned int) std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--case") && i + 1 < argc)
+            only = argv[++i];
+        else if (!strcmp(argv[i], "--golden") && i + 1 < argc)
+            goldenPath = argv[++i];
+        else if (!strcmp(argv[i], "--write-golden") && i + 1 < argc)
+            writePath = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--case NAME] [--golden FILE] [--write-golden FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    frames = frames ? frames : 1;
+
+    Golden golden;
+    if (goldenPath && !readGolden(goldenPath, golden))
+        return 2;
+    FILE *goldenOut = nullptr;
+    if (writePath) {
+        goldenOut = fopen(writePath, "w");
+        if (!goldenOut) {
+            fprintf(stderr, "cannot write %s\n", writePath);
+            return 2;
+        }
+        fprintf(goldenOut, "# parser_bench golden objects: case classId left top width height confidence [mask_size mask_fnv1a]\n");
+    }
+
+    // Read once by the parsers, so set before the first frame
+    setenv("PARSER_INT8_SCALES", "pred_logits=0.125", 1);
+
+    void (*makers[])(BenchCase &, Random &) = {makeNms, makeBatchedNms, makeEfficientDet,
+                                               makeDDETR, makeDDETRHalf, makeDDETRInt8,
+                                               makeCpuNms, makeMrcnn, makeMrcnnHalf};
+    int failures = 0;
+    printf("%-15s %8s %12s %14s  %s\n", "case", "objects", "ns/frame", "allocs/frame", "golden");
+    for (auto make : makers) {
+        BenchCase c;
+        Random rng(0x5EED);
+        make(c, rng);
+        if (c.golden.empty())
+            c.golden = c.name;
+        if (only && c.name.find(only) != 0)
+            continue;
+
+        std::vector<NvDsInferObjectDetectionInfo> objects;
+        std::vector<NvDsInferInstanceMaskInfo> instances;
+        // The first frame binds the layers and sizes the scratch buffers
+        if (!runParser(c, objects, instances)) {
+            printf("%-15s parser failed\n", c.name.c_str());
+            failures++;
+            continue;
+        }
+        std::vector<ParsedObject> parsed = collect(objects, instances);
+
+        uint64_t allocations = g_allocations;
+        Clock::time_point start = Clock::now();
+        for (unsigned int f = 0; f < frames; f++)
+            runParser(c, objects, instances);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / frames;
+        double allocs = (double) (g_allocations - allocations) / frames;
+        runParser(c, objects, instances);
+        for (NvDsInferInstanceMaskInfo &instance : instances)
+            delete[] instance.mask;
+
+        std::string result = "-";
+        if (goldenPath) {
+            Golden::const_iterator expected = golden.find(c.golden);
+            if (expected == golden.end()) {
+                result = "missing";
+                failures++;
+            } else if (!sameObjects(parsed, expected->second, result)) {
+                failures++;
+            } else {
+                result = "ok";
+            }
+        }
+        if (goldenOut && c.golden == c.name)
+            writeGolden(goldenOut, c.name, parsed);
+        printf("%-15s %8zu %12.0f %14.1f  %s\n", c.name.c_str(), parsed.size(), ns, allocs, result.c_str());
+    }
+    if (goldenOut)
+        fclose(goldenOut);
+    return failures ? 1 : 0;
+}
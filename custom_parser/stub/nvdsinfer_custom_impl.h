@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Stand-in for the DeepStream nvdsinfer_custom_impl.h, with only the types
+ * the bbox parsers use, laid out as in DeepStream 6.x/7.x. It lets
+ * parser_bench build the parsers on a machine without DeepStream, CUDA or
+ * TensorRT; the parser library itself is always built against the SDK.
+ */
+
+#ifndef __NVDSINFER_CUSTOM_IMPL_H__
+#define __NVDSINFER_CUSTOM_IMPL_H__
+
+#include <type_traits>
+#include <vector>
+
+#define NVDSINFER_MAX_DIMS 8
+
+typedef enum
+{
+    FLOAT = 0,
+    HALF = 1,
+    INT8 = 2,
+    INT32 = 3
+} NvDsInferDataType;
+
+typedef struct
+{
+    unsigned int numDims;
+    unsigned int d[NVDSINFER_MAX_DIMS];
+    unsigned int numElements;
+} NvDsInferDims;
+
+typedef struct
+{
+    NvDsInferDataType dataType;
+    union {
+        NvDsInferDims inferDims;
+        NvDsInferDims dims;
+    };
+    int bindingIndex;
+    const char* layerName;
+    void *buffer;
+    int isInput;
+} NvDsInferLayerInfo;
+
+typedef struct
+{
+    unsigned int width;
+    unsigned int height;
+    unsigned int channels;
+} NvDsInferNetworkInfo;
+
+typedef struct
+{
+    unsigned int classId;
+    float left;
+    float top;
+    float width;
+    float height;
+    float detectionConfidence;
+} NvDsInferObjectDetectionInfo;
+
+typedef struct
+{
+    unsigned int classId;
+    float left;
+    float top;
+    float width;
+    float height;
+    float detectionConfidence;
+    float *mask;
+    unsigned int mask_width;
+    unsigned int mask_height;
+    unsigned int mask_size;
+} NvDsInferInstanceMaskInfo;
+
+typedef struct _NvDsInferParseDetectionParams
+{
+    unsigned int numClassesConfigured;
+    union {
+        std::vector<float> perClassThreshold;
+        std::vector<float> perClassPreclusterThreshold;
+    };
+    std::vector<float> perClassPostclusterThreshold;
+
+    _NvDsInferParseDetectionParams() : perClassThreshold() {}
+    ~_NvDsInferParseDetectionParams() { perClassThreshold.~vector(); }
+} NvDsInferParseDetectionParams;
+
+typedef bool (* NvDsInferParseCustomFunc) (
+        std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+#define CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(customParseFunc) \
+    static_assert(std::is_same<decltype(&customParseFunc), NvDsInferParseCustomFunc>::value, \
+                  #customParseFunc " does not match NvDsInferParseCustomFunc")
+
+#endif
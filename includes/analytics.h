@@ -7,11 +7,15 @@
 typedef struct 
 {
 
-    guint32 lcc_cnt_exit;
-    guint32 lccum_cnt;
-    guint32 lcc_cnt_entry;
+    guint32 lcc_cnt_exit;     /* exit crossings of the object on this frame */
+    guint32 lccum_cnt;        /* cumulative crossings of the line it crossed */
+    guint32 lcc_cnt_entry;    /* entry crossings of the object on this frame */
     guint32 source_id;
     const char* direction;
+    guint32 lccum_cnt_entry;  /* cumulative entries of the stream */
+    guint32 lccum_cnt_exit;   /* cumulative exits of the stream */
+    guint32 occupancy;        /* entries - exits */
+    guint32 roi_mask;         /* ROIs of the in-app engine the object is in */
 
 } AnalyticsUserMeta;
 
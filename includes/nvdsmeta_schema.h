@@ -228,6 +228,7 @@ typedef struct NvDsEventMsgMeta {
   guint extMsgSize;
   
   /*My data*/
+#define NVDS_EVENT_MSG_META_ANALYTICS_EXT 1
   guint occupancy;
   guint source_id;
   guint lccum_cnt_entry;
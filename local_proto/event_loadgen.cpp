@@ -0,0 +1,272 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Synthetic load for the event path: builds pooled NvDsEventMsgMeta the
+/// way the app does (embedding, person object, attributes), batches and
+/// encodes them with EventBatcher and sends the messages through any
+/// nvds_msgapi protocol library, at a fixed objects/s rate.
+///
+///   ./event_loadgen --rate 20000 --format binary --conn-str "unix;/tmp/events.sock"
+///
+/// Reports the achieved rate, the CPU time spent generating and encoding
+/// per object, the message sizes and the queue-to-callback latency.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dlfcn.h>
+#include <getopt.h>
+
+#include "event_batcher.h"
+#include "event_meta_pool.h"
+#include "nvds_msgapi.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct MsgApi {
+    decltype(&nvds_msgapi_connect) connect;
+    decltype(&nvds_msgapi_send_async) send_async;
+    decltype(&nvds_msgapi_do_work) do_work;
+    decltype(&nvds_msgapi_disconnect) disconnect;
+};
+
+struct PendingSend {
+    Clock::time_point queued;
+    std::vector<double> *latencies_us;
+    bool *failed;
+};
+
+static void send_done(void *user_ptr, NvDsMsgApiErrorType flag) {
+    PendingSend *send = (PendingSend *) user_ptr;
+    send->latencies_us->push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - send->queued).count());
+    if (flag != NVDS_MSGAPI_OK)
+        *send->failed = true;
+    delete send;
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s [options]\n"
+           "  --rate N          objects per second, 0 = as fast as possible (default 10000)\n"
+           "  --objects N       objects per frame and stream (default 32)\n"
+           "  --streams N       streams (default 1)\n"
+           "  --dim N           embedding elements, 0 = none (default 256)\n"
+           "  --duration S      seconds (default 10)\n"
+           "  --format F        json or binary (default json)\n"
+           "  --interval MS     batch window in ms of stream time, 0 = per frame (default 0)\n"
+           "  --fps N           frames per second of every stream (default 30)\n"
+           "  --proto-lib PATH  nvds_msgapi library (default ./libnvds_local_proto.so)\n"
+           "  --conn-str STR    connection string (default file;/tmp/fsl_events.bin)\n"
+           "  --topic STR       topic (default mdx-raw)\n"
+           "  --config PATH     protocol library config file (msg-broker-config)\n",
+           name);
+}
+
+static double percentile(std::vector<double> &values, double p) {
+    if (values.empty())
+        return 0;
+    size_t index = std::min(values.size() - 1, (size_t) (p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int main(int argc, char *argv[]) {
+    double rate = 10000;
+    int objects = 32, streams = 1, dim = 256, fps = 30;
+    double duration = 10;
+    unsigned interval_ms = 0;
+    bool binary = false;
+    std::string proto_lib = "./libnvds_local_proto.so";
+    std::string conn_str = "file;/tmp/fsl_events.bin";
+    std::string topic = "mdx-raw";
+    std::string config;
+
+    static struct option options[] = {
+        {"rate", required_argument, 0, 'r'},     {"objects", required_argument, 0, 'o'},
+        {"streams", required_argument, 0, 's'},  {"dim", required_argument, 0, 'd'},
+        {"duration", required_argument, 0, 't'}, {"format", required_argument, 0, 'f'},
+        {"interval", required_argument, 0, 'i'}, {"fps", required_argument, 0, 'p'},
+        {"proto-lib", required_argument, 0, 'l'}, {"conn-str", required_argument, 0, 'c'},
+        {"topic", required_argument, 0, 'T'},    {"config", required_argument, 0, 'C'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", options, nullptr)) != -1) {
+        switch (opt) {
+        case 'r': rate = atof(optarg); break;
+        case 'o': objects = atoi(optarg); break;
+        case 's': streams = atoi(optarg); break;
+        case 'd': dim = atoi(optarg); break;
+        case 't': duration = atof(optarg); break;
+        case 'f': binary = !strcmp(optarg, "binary"); break;
+        case 'i': interval_ms = atoi(optarg); break;
+        case 'p': fps = atoi(optarg); break;
+        case 'l': proto_lib = optarg; break;
+        case 'c': conn_str = optarg; break;
+        case 'T': topic = optarg; break;
+        case 'C': config = optarg; break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (objects <= 0 || streams <= 0 || fps <= 0 || dim < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    void *lib = dlopen(proto_lib.c_str(), RTLD_NOW);
+    if (!lib) {
+        fprintf(stderr, "Cannot load %s: %s\n", proto_lib.c_str(), dlerror());
+        return 1;
+    }
+    MsgApi api;
+    api.connect = (decltype(api.connect)) dlsym(lib, "nvds_msgapi_connect");
+    api.send_async = (decltype(api.send_async)) dlsym(lib, "nvds_msgapi_send_async");
+    api.do_work = (decltype(api.do_work)) dlsym(lib, "nvds_msgapi_do_work");
+    api.disconnect = (decltype(api.disconnect)) dlsym(lib, "nvds_msgapi_disconnect");
+    if (!api.connect || !api.send_async || !api.do_work || !api.disconnect) {
+        fprintf(stderr, "%s is not an nvds_msgapi library\n", proto_lib.c_str());
+        return 1;
+    }
+    NvDsMsgApiHandle handle = api.connect((char *) conn_str.c_str(), nullptr,
+                                         config.empty() ? nullptr : (char *) config.c_str());
+    if (!handle) {
+        fprintf(stderr, "Cannot connect to %s\n", conn_str.c_str());
+        return 1;
+    }
+
+    /// A bank of embeddings, copied into every event like the app does
+    std::mt19937 rng(42);
+    std::normal_distribution<float> normal(0.f, 0.06f);
+    std::vector<float> bank((size_t) objects * dim);
+    for (float &x : bank)
+        x = normal(rng);
+
+    EventBatcher batcher((uint64_t) interval_ms * 1000000ull, 0,
+                         binary ? EVENT_BATCH_BINARY : EVENT_BATCH_JSON);
+    std::string payload;
+    std::vector<double> latencies_us;
+    bool failed = false;
+    uint64_t sent_objects = 0, messages = 0, bytes = 0;
+    double generate_s = 0;
+    char ts[EVENT_META_TS_SIZE];
+
+    Clock::time_point start = Clock::now();
+    uint64_t frame_ns = 1000000000ull / fps;
+    for (uint64_t frame = 0;; frame++) {
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (elapsed >= duration)
+            break;
+        if (rate > 0) {
+            double due = sent_objects / rate;
+            if (due > elapsed)
+                std::this_thread::sleep_for(std::chrono::duration<double>(due - elapsed));
+        }
+
+        time_t now = time(nullptr);
+        struct tm tm_utc;
+        gmtime_r(&now, &tm_utc);
+        size_t len = strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tm_utc);
+        snprintf(ts + len, sizeof(ts) - len, ".%03dZ", (int) (frame % 1000));
+
+        Clock::time_point generate_start = Clock::now();
+        for (int stream = 0; stream < streams; stream++) {
+            for (int i = 0; i < objects; i++) {
+                NvDsEventMsgMeta *meta = event_meta_pool_acquire();
+                meta->objType = NVDS_OBJECT_TYPE_UNKNOWN;
+                meta->sensorId = stream;
+                meta->frameId = frame;
+                meta->trackingId = (uint64_t) stream << 32 | i;
+                meta->confidence = 0.9;
+                meta->bbox.left = 10 * i;
+                meta->bbox.top = 20;
+                meta->bbox.width = 48;
+                meta->bbox.height = 128;
+                strcpy(meta->ts, ts);
+                strcpy(meta->objectId, "person");
+                if (dim > 0) {
+                    meta->embedding.embedding_vector = event_meta_pool_embedding_new(dim);
+                    memcpy(meta->embedding.embedding_vector, &bank[(size_t) i * dim],
+                           dim * sizeof(float));
+                    meta->embedding.embedding_length = dim;
+                }
+                NvDsPersonObject *person = event_meta_pool_person(meta);
+                event_meta_pool_printf(meta, &person->hair, "/tmp/crops/%d_%lu_%d.jpg", stream,
+                                       (unsigned long) frame, i);
+                event_meta_pool_set_str(meta, &person->gender, "entry");
+                event_meta_pool_set_str(meta, &person->cap, "Crossed");
+                event_meta_pool_set_str(meta, &meta->otherAttrs, "emit=motion");
+                batcher.add(stream, meta, frame * frame_ns);
+                event_meta_pool_release(meta);
+            }
+            if (batcher.flush(stream, frame * frame_ns, false, payload)) {
+                PendingSend *send = new PendingSend{Clock::now(), &latencies_us, &failed};
+                api.send_async(handle, (char *) topic.c_str(), (const uint8_t *) payload.data(),
+                               payload.size(), send_done, send);
+                messages++;
+                bytes += payload.size();
+            }
+        }
+        generate_s += std::chrono::duration<double>(Clock::now() - generate_start).count();
+        sent_objects += (uint64_t) objects * streams;
+        api.do_work(handle);
+    }
+    for (int stream = 0; stream < streams; stream++) {
+        if (batcher.flush(stream, 0, true, payload)) {
+            PendingSend *send = new PendingSend{Clock::now(), &latencies_us, &failed};
+            api.send_async(handle, (char *) topic.c_str(), (const uint8_t *) payload.data(),
+                           payload.size(), send_done, send);
+            messages++;
+            bytes += payload.size();
+        }
+    }
+    api.do_work(handle);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    api.disconnect(handle);
+
+    EventMetaPoolStats stats;
+    event_meta_pool_get_stats(&stats);
+    printf("objects: %lu in %.2f s, %.0f objects/s\n", (unsigned long) sent_objects, elapsed,
+           sent_objects / elapsed);
+    printf("messages: %lu, %.0f bytes/message, %.1f bytes/object, %.2f MB/s\n",
+           (unsigned long) messages, messages ? (double) bytes / messages : 0.,
+           sent_objects ? (double) bytes / sent_objects : 0., bytes / elapsed / (1 << 20));
+    printf("generate + encode: %.2f us/object\n",
+           sent_objects ? generate_s * 1e6 / sent_objects : 0.);
+    printf("send latency: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           percentile(latencies_us, 0.5), percentile(latencies_us, 0.99),
+           percentile(latencies_us, 1.0));
+    printf("event meta pool: %lu acquires, %lu heap blocks, %lu heap strings\n",
+           (unsigned long) stats.pool_acquires, (unsigned long) stats.heap_blocks,
+           (unsigned long) stats.heap_strings);
+    if (failed)
+        fprintf(stderr, "Some messages could not be sent\n");
+    dlclose(lib);
+    return failed ? 1 : 0;
+}
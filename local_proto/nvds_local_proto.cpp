@@ -0,0 +1,470 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// nvds_msgapi protocol adaptor that keeps event payloads on the local
+/// machine, so the metadata path can be measured without a broker.
+///
+/// Connection string, in msg-broker-conn-str:
+///   file;<path>[;<max size MB>[;<max files>]]   rotating file, 64 MB x 4
+///   unix;<socket path>                          SOCK_STREAM client
+///
+/// Every message is framed as
+///   uint32  payload size      little-endian
+///   uint32  topic size
+///   uint64  send time         CLOCK_REALTIME ns at nvds_msgapi_send*()
+///   topic bytes, payload bytes
+/// so binary payloads pass through unchanged and a reader can compute the
+/// sink latency. Rotated files are renamed <path>.1 ... <path>.<n - 1>.
+///
+/// nvds_msgapi_send_async() only queues the message; nvds_msgapi_do_work()
+/// writes the queue with one writev() per batch and runs the callbacks.
+///
+/// The optional msg-broker-config file (key=value lines) compresses the
+/// framed stream with StreamCompressor, in seekable frames:
+///   compression=lz4|zstd          the file gets the .lz4 / .zst suffix
+///   compression-level=<level>
+///   compression-frame-kb=<KB>     uncompressed bytes per frame, 1024
+///   compression-dictionary=<path> zstd dictionary, trained if missing
+/// Rotation then applies to the compressed size; every rotated file ends
+/// with its seek table. On a socket a frame is closed after every batch.
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "nvds_msgapi.h"
+#include "stream_compressor.h"
+
+#define LOCAL_PROTO_VERSION "1.0"
+#define LOCAL_PROTO_NAME "LOCAL"
+#define DEFAULT_MAX_SIZE_MB 64
+#define DEFAULT_MAX_FILES 4
+/// Frames per writev() call, below IOV_MAX
+#define WRITE_BATCH 256
+/// Seconds between two reconnection attempts of the socket
+#define RECONNECT_INTERVAL 1
+
+struct FrameHeader {
+    uint32_t payload_size;
+    uint32_t topic_size;
+    uint64_t send_time_ns;
+};
+
+struct PendingMessage {
+    FrameHeader header;
+    std::string topic;
+    std::vector<uint8_t> payload;
+    nvds_msgapi_send_cb_t callback;
+    void *user_ptr;
+};
+
+struct LocalSink {
+    bool use_socket = false;
+    std::string path;
+    uint64_t max_size = (uint64_t) DEFAULT_MAX_SIZE_MB << 20;
+    int max_files = DEFAULT_MAX_FILES;
+    nvds_msgapi_connect_cb_t connect_cb = nullptr;
+
+    int fd = -1;
+    uint64_t written = 0;
+    time_t last_connect_attempt = 0;
+
+    std::mutex queue_mutex;
+    std::deque<PendingMessage> queue;
+    /// Serializes writers: send() from the app thread and do_work()
+    std::mutex write_mutex;
+
+    StreamCompressor compressor;
+    std::vector<uint8_t> frame;
+    bool sink_failed = false;
+};
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static std::vector<std::string> split(const std::string &str, char sep) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t end = str.find(sep, start);
+        fields.push_back(str.substr(start, end - start));
+        if (end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+    return fields;
+}
+
+/// Write all iovecs, resuming after short writes. A socket whose reader
+/// went away fails with EPIPE instead of raising SIGPIPE.
+static bool write_all(int fd, bool is_socket, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n;
+        if (is_socket) {
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        } else {
+            n = writev(fd, iov, count);
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        while (count > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (uint8_t *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+static std::string trim(const std::string &str) {
+    size_t start = str.find_first_not_of(" \t\r\n");
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return start == std::string::npos ? "" : str.substr(start, end - start + 1);
+}
+
+/// Compression settings from the key=value config file; sections and
+/// comments are ignored
+static bool setup_compression(LocalSink *sink, const char *config_path) {
+    StreamCompressor::Codec codec = StreamCompressor::NONE;
+    int level = 0;
+    size_t frame_size = 0;
+    std::string dictionary;
+    if (config_path && *config_path) {
+        FILE *file = fopen(config_path, "r");
+        if (!file) {
+            std::cerr << "local_proto: cannot read " << config_path << "\n";
+            return false;
+        }
+        char line[1024];
+        while (fgets(line, sizeof(line), file)) {
+            std::string entry = trim(line);
+            size_t eq = entry.find('=');
+            if (entry.empty() || entry[0] == '#' || entry[0] == '[' || eq == std::string::npos)
+                continue;
+            std::string key = trim(entry.substr(0, eq));
+            std::string value = trim(entry.substr(eq + 1));
+            if (key == "compression" && !StreamCompressor::parse_codec(value, codec))
+                std::cerr << "local_proto: unknown compression " << value << "\n";
+            else if (key == "compression-level")
+                level = atoi(value.c_str());
+            else if (key == "compression-frame-kb")
+                frame_size = (size_t) atoi(value.c_str()) << 10;
+            else if (key == "compression-dictionary")
+                dictionary = value;
+        }
+        fclose(file);
+    }
+    return sink->compressor.init(codec, level, frame_size,
+                                 [sink](const void *data, size_t size) {
+                                     struct iovec iov = {(void *) data, size};
+                                     if (sink->fd < 0 || !write_all(sink->fd, sink->use_socket, &iov, 1)) {
+                                         sink->sink_failed = true;
+                                         return false;
+                                     }
+                                     sink->written += size;
+                                     return true;
+                                 },
+                                 dictionary);
+}
+
+static void print_compression_stats(LocalSink *sink) {
+    if (sink->compressor.codec() == StreamCompressor::NONE)
+        return;
+    const StreamCompressor::Stats &stats = sink->compressor.stats();
+    std::cout << "local_proto: " << sink->path << ": " << stats.bytes_in << " -> "
+              << stats.bytes_out << " bytes with " << StreamCompressor::codec_name(sink->compressor.codec())
+              << " (ratio " << stats.ratio() << ", " << stats.cpu_seconds << " s CPU, "
+              << stats.frames << " frames)\n";
+}
+
+/// Shift <path>.i to <path>.i+1, dropping the oldest, so that <path> is free
+static void shift_files(LocalSink *sink) {
+    std::string file_path = sink->path + StreamCompressor::extension(sink->compressor.codec());
+    for (int i = sink->max_files - 1; i > 0; i--) {
+        std::string from = i == 1 ? file_path : file_path + "." + std::to_string(i - 1);
+        std::string to = file_path + "." + std::to_string(i);
+        rename(from.c_str(), to.c_str());
+    }
+    if (sink->max_files <= 1)
+        unlink(file_path.c_str());
+}
+
+static bool open_sink(LocalSink *sink) {
+    if (sink->use_socket) {
+        sink->last_connect_attempt = time(nullptr);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return false;
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, sink->path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return false;
+        }
+        sink->fd = fd;
+        return true;
+    }
+    std::string file_path = sink->path + StreamCompressor::extension(sink->compressor.codec());
+    sink->fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (sink->fd < 0)
+        return false;
+    struct stat st;
+    sink->written = fstat(sink->fd, &st) == 0 ? st.st_size : 0;
+    if (sink->written > 0 && sink->compressor.codec() != StreamCompressor::NONE) {
+        /// A compressed file ends with its one seek table: leave the previous
+        /// run's file whole and start a new one
+        close(sink->fd);
+        shift_files(sink);
+        sink->fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (sink->fd < 0)
+            return false;
+        sink->written = 0;
+    }
+    return true;
+}
+
+static void close_sink(LocalSink *sink) {
+    if (sink->fd >= 0) {
+        sink->compressor.finish();
+        close(sink->fd);
+    }
+    sink->fd = -1;
+}
+
+/// Close the file, shift the older ones and start a new file
+static bool rotate(LocalSink *sink) {
+    close_sink(sink);
+    shift_files(sink);
+    return open_sink(sink);
+}
+
+/// Write frames; called with write_mutex held
+static bool write_frames(LocalSink *sink, const FrameHeader *headers, const char *const *topics,
+                         const uint8_t *const *payloads, int count) {
+    if (sink->fd < 0) {
+        if (!sink->use_socket || time(nullptr) - sink->last_connect_attempt < RECONNECT_INTERVAL ||
+            !open_sink(sink))
+            return false;
+        if (sink->connect_cb)
+            sink->connect_cb(sink, NVDS_MSGAPI_EVT_SUCCESS);
+    }
+
+    struct iovec iov[WRITE_BATCH * 3];
+    uint64_t size = 0;
+    for (int i = 0; i < count; i++) {
+        iov[3 * i] = {(void *) &headers[i], sizeof(FrameHeader)};
+        iov[3 * i + 1] = {(void *) topics[i], headers[i].topic_size};
+        iov[3 * i + 2] = {(void *) payloads[i], headers[i].payload_size};
+        size += sizeof(FrameHeader) + headers[i].topic_size + headers[i].payload_size;
+    }
+    bool compressed = sink->compressor.codec() != StreamCompressor::NONE;
+    /// Compressed output only knows its size once written: rotate past the limit
+    uint64_t next_size = sink->written + (compressed ? 0 : size);
+    if (!sink->use_socket && sink->written > 0 && next_size >= sink->max_size && !rotate(sink))
+        return false;
+
+    bool ok = true;
+    if (compressed) {
+        /// One compressor write per message, so every message is a
+        /// dictionary training sample
+        sink->sink_failed = false;
+        for (int i = 0; ok && i < count; i++) {
+            sink->frame.clear();
+            for (int j = 0; j < 3; j++) {
+                const uint8_t *base = (const uint8_t *) iov[3 * i + j].iov_base;
+                sink->frame.insert(sink->frame.end(), base, base + iov[3 * i + j].iov_len);
+            }
+            ok = sink->compressor.write(sink->frame.data(), sink->frame.size());
+        }
+        if (ok && sink->use_socket)
+            ok = sink->compressor.flush();
+        ok = ok && !sink->sink_failed;
+    } else {
+        ok = write_all(sink->fd, sink->use_socket, iov, count * 3);
+    }
+    if (!ok) {
+        std::cerr << "local_proto: write to " << sink->path << " failed: " << strerror(errno) << "\n";
+        close_sink(sink);
+        if (sink->connect_cb)
+            sink->connect_cb(sink, NVDS_MSGAPI_EVT_DISCONNECT);
+        return false;
+    }
+    if (!compressed)
+        sink->written += size;
+    return true;
+}
+
+NvDsMsgApiHandle nvds_msgapi_connect(char *connection_str, nvds_msgapi_connect_cb_t connect_cb,
+                                     char *config_path) {
+    if (!connection_str)
+        return nullptr;
+    std::vector<std::string> fields = split(connection_str, ';');
+    if (fields.size() < 2 || fields[1].empty() || (fields[0] != "file" && fields[0] != "unix")) {
+        std::cerr << "local_proto: expected file;<path>[;<max MB>[;<max files>]] or "
+                     "unix;<socket path>, got " << connection_str << "\n";
+        return nullptr;
+    }
+
+    LocalSink *sink = new LocalSink();
+    sink->use_socket = fields[0] == "unix";
+    sink->path = fields[1];
+    sink->connect_cb = connect_cb;
+    if (fields.size() > 2 && atoi(fields[2].c_str()) > 0)
+        sink->max_size = (uint64_t) atoi(fields[2].c_str()) << 20;
+    if (fields.size() > 3 && atoi(fields[3].c_str()) > 0)
+        sink->max_files = atoi(fields[3].c_str());
+
+    if (!setup_compression(sink, config_path) || !open_sink(sink)) {
+        std::cerr << "local_proto: cannot open " << sink->path << ": " << strerror(errno) << "\n";
+        delete sink;
+        return nullptr;
+    }
+    return sink;
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload,
+                                     size_t nbuf) {
+    LocalSink *sink = (LocalSink *) h_ptr;
+    if (!sink || !payload)
+        return NVDS_MSGAPI_ERR;
+    const char *topic_str = topic ? topic : "";
+    FrameHeader header = {(uint32_t) nbuf, (uint32_t) strlen(topic_str), now_ns()};
+    std::lock_guard<std::mutex> lock(sink->write_mutex);
+    return write_frames(sink, &header, &topic_str, &payload, 1) ? NVDS_MSGAPI_OK : NVDS_MSGAPI_ERR;
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_async(NvDsMsgApiHandle h_ptr, char *topic,
+                                           const uint8_t *payload, size_t nbuf,
+                                           nvds_msgapi_send_cb_t send_callback, void *user_ptr) {
+    LocalSink *sink = (LocalSink *) h_ptr;
+    if (!sink || !payload)
+        return NVDS_MSGAPI_ERR;
+    PendingMessage message;
+    message.topic = topic ? topic : "";
+    message.header = {(uint32_t) nbuf, (uint32_t) message.topic.size(), now_ns()};
+    message.payload.assign(payload, payload + nbuf);
+    message.callback = send_callback;
+    message.user_ptr = user_ptr;
+    std::lock_guard<std::mutex> lock(sink->queue_mutex);
+    sink->queue.push_back(std::move(message));
+    return NVDS_MSGAPI_OK;
+}
+
+NvDsMsgApiErrorType nvds_msgapi_subscribe(NvDsMsgApiHandle h_ptr, char **topics, int num_topics,
+                                          nvds_msgapi_subscribe_request_cb_t cb, void *user_ctx) {
+    (void) h_ptr; (void) topics; (void) num_topics; (void) cb; (void) user_ctx;
+    std::cerr << "local_proto: subscribe is not supported\n";
+    return NVDS_MSGAPI_ERR;
+}
+
+void nvds_msgapi_do_work(NvDsMsgApiHandle h_ptr) {
+    LocalSink *sink = (LocalSink *) h_ptr;
+    if (!sink)
+        return;
+    std::deque<PendingMessage> batch;
+    {
+        std::lock_guard<std::mutex> lock(sink->queue_mutex);
+        batch.swap(sink->queue);
+    }
+    while (!batch.empty()) {
+        int count = batch.size() < WRITE_BATCH ? (int) batch.size() : WRITE_BATCH;
+        FrameHeader headers[WRITE_BATCH];
+        const char *topics[WRITE_BATCH];
+        const uint8_t *payloads[WRITE_BATCH];
+        for (int i = 0; i < count; i++) {
+            headers[i] = batch[i].header;
+            topics[i] = batch[i].topic.data();
+            payloads[i] = batch[i].payload.data();
+        }
+        bool ok;
+        {
+            std::lock_guard<std::mutex> lock(sink->write_mutex);
+            ok = write_frames(sink, headers, topics, payloads, count);
+        }
+        for (int i = 0; i < count; i++) {
+            if (batch.front().callback)
+                batch.front().callback(batch.front().user_ptr, ok ? NVDS_MSGAPI_OK : NVDS_MSGAPI_ERR);
+            batch.pop_front();
+        }
+    }
+}
+
+NvDsMsgApiErrorType nvds_msgapi_disconnect(NvDsMsgApiHandle h_ptr) {
+    LocalSink *sink = (LocalSink *) h_ptr;
+    if (!sink)
+        return NVDS_MSGAPI_ERR;
+    nvds_msgapi_do_work(h_ptr);
+    close_sink(sink);
+    print_compression_stats(sink);
+    delete sink;
+    return NVDS_MSGAPI_OK;
+}
+
+char *nvds_msgapi_getversion(void) {
+    return (char *) LOCAL_PROTO_VERSION;
+}
+
+char *nvds_msgapi_get_protocol_name(void) {
+    return (char *) LOCAL_PROTO_NAME;
+}
+
+/// One connection per sink path
+NvDsMsgApiErrorType nvds_msgapi_connection_signature(char *broker_str, char *cfg, char *output_str,
+                                                     int max_len) {
+    (void) cfg;
+    if (!broker_str || !output_str || max_len <= 0)
+        return NVDS_MSGAPI_ERR;
+    std::vector<std::string> fields = split(broker_str, ';');
+    std::string signature = fields.size() > 1 ? fields[0] + ":" + fields[1] : broker_str;
+    snprintf(output_str, max_len, "%s", signature.c_str());
+    return NVDS_MSGAPI_OK;
+}
@@ -0,0 +1,301 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// nvds_msgapi protocol adaptor that puts an EventOutbox in front of
+/// another protocol library, so a slow or unreachable broker fills a disk
+/// spool instead of the memory of the pipeline. Messages reach the broker
+/// in order, at least once, including the ones spooled by a previous run.
+///
+/// msg-broker-conn-str is passed to the wrapped library as is. The
+/// msg-broker-config file (key=value lines) configures the outbox; the
+/// other keys are left to the wrapped library, which gets its own file:
+///   outbox-proto-lib=<path>       wrapped library, required
+///   outbox-proto-config=<path>    msg-broker-config of the wrapped library
+///   outbox-dir=<path>             spool directory, required
+///   outbox-memory-kb=<KB>         queued in memory before spilling, 8192
+///   outbox-segment-mb=<MB>        spool segment size, 16
+///   outbox-max-spool-mb=<MB>      spool limit, 1024
+///   outbox-drop-policy=oldest|newest   what goes past the limit, oldest
+///   outbox-max-in-flight=<n>      messages handed to the library, 256
+///   outbox-retry-ms=<ms>          retry interval while it fails, 1000
+///   outbox-drain-ms=<ms>          delivery time left at disconnect, 2000
+///
+/// nvds_msgapi_send_async() completes once the message is queued (or
+/// dropped), from the next nvds_msgapi_do_work(); do_work() also sends
+/// the queue to the wrapped library and drives it.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include "event_outbox.h"
+#include "nvds_msgapi.h"
+
+#define OUTBOX_PROTO_VERSION "1.0"
+#define OUTBOX_PROTO_NAME "OUTBOX"
+#define DEFAULT_DRAIN_MS 2000
+
+struct Completion {
+    nvds_msgapi_send_cb_t callback;
+    void *user_ptr;
+    NvDsMsgApiErrorType flag;
+};
+
+struct OutboxProto {
+    void *lib = nullptr;
+    decltype(&nvds_msgapi_connect) connect = nullptr;
+    decltype(&nvds_msgapi_send_async) send_async = nullptr;
+    decltype(&nvds_msgapi_do_work) do_work = nullptr;
+    decltype(&nvds_msgapi_disconnect) disconnect = nullptr;
+    NvDsMsgApiHandle inner = nullptr;
+    std::string conn_str;
+    std::string inner_config;
+    unsigned drain_ms = DEFAULT_DRAIN_MS;
+
+    EventOutbox outbox;
+    std::mutex completions_mutex;
+    std::vector<Completion> completions;
+};
+
+/// user_ptr of the wrapped library's callback
+struct SendTag {
+    OutboxProto *proto;
+    uint64_t id;
+};
+
+static std::string trim(const std::string &str) {
+    size_t start = str.find_first_not_of(" \t\r\n");
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return start == std::string::npos ? "" : str.substr(start, end - start + 1);
+}
+
+static bool parse_config(OutboxProto *proto, const char *config_path, std::string &proto_lib,
+                         OutboxConfig &config) {
+    FILE *file = config_path && *config_path ? fopen(config_path, "r") : nullptr;
+    if (!file) {
+        std::cerr << "outbox_proto: msg-broker-config with outbox-proto-lib and outbox-dir "
+                     "is required\n";
+        return false;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        std::string entry = trim(line);
+        size_t eq = entry.find('=');
+        if (entry.empty() || entry[0] == '#' || entry[0] == '[' || eq == std::string::npos)
+            continue;
+        std::string key = trim(entry.substr(0, eq));
+        std::string value = trim(entry.substr(eq + 1));
+        if (key == "outbox-proto-lib")
+            proto_lib = value;
+        else if (key == "outbox-proto-config")
+            proto->inner_config = value;
+        else if (key == "outbox-dir")
+            config.spool_dir = value;
+        else if (key == "outbox-memory-kb")
+            config.memory_bytes = (size_t) atoll(value.c_str()) << 10;
+        else if (key == "outbox-segment-mb")
+            config.segment_bytes = (uint64_t) atoll(value.c_str()) << 20;
+        else if (key == "outbox-max-spool-mb")
+            config.max_spool_bytes = (uint64_t) atoll(value.c_str()) << 20;
+        else if (key == "outbox-drop-policy" && (value == "oldest" || value == "newest"))
+            config.drop_policy = value == "oldest" ? OUTBOX_DROP_OLDEST : OUTBOX_DROP_NEWEST;
+        else if (key == "outbox-drop-policy")
+            std::cerr << "outbox_proto: unknown drop policy " << value << "\n";
+        else if (key == "outbox-max-in-flight")
+            config.max_in_flight = (unsigned) atoi(value.c_str());
+        else if (key == "outbox-retry-ms")
+            config.retry_ms = (unsigned) atoi(value.c_str());
+        else if (key == "outbox-drain-ms")
+            proto->drain_ms = (unsigned) atoi(value.c_str());
+    }
+    fclose(file);
+    if (proto_lib.empty() || config.spool_dir.empty()) {
+        std::cerr << "outbox_proto: outbox-proto-lib and outbox-dir are required\n";
+        return false;
+    }
+    return true;
+}
+
+static void inner_send_done(void *user_ptr, NvDsMsgApiErrorType flag) {
+    SendTag *tag = (SendTag *) user_ptr;
+    tag->proto->outbox.complete(tag->id, flag == NVDS_MSGAPI_OK);
+    delete tag;
+}
+
+/// Connects on demand, so a broker down at startup is retried like a
+/// broker lost later
+static bool inner_send(OutboxProto *proto, uint64_t id, const std::string &topic,
+                       const std::string &payload) {
+    if (!proto->inner) {
+        proto->inner = proto->connect((char *) proto->conn_str.c_str(), nullptr,
+                                      proto->inner_config.empty()
+                                          ? nullptr
+                                          : (char *) proto->inner_config.c_str());
+        if (!proto->inner)
+            return false;
+    }
+    SendTag *tag = new SendTag{proto, id};
+    if (proto->send_async(proto->inner, (char *) topic.c_str(), (const uint8_t *) payload.data(),
+                          payload.size(), inner_send_done, tag) != NVDS_MSGAPI_OK) {
+        delete tag;
+        return false;
+    }
+    return true;
+}
+
+NvDsMsgApiHandle nvds_msgapi_connect(char *connection_str, nvds_msgapi_connect_cb_t connect_cb,
+                                     char *config_path) {
+    (void) connect_cb;
+    if (!connection_str)
+        return nullptr;
+    OutboxProto *proto = new OutboxProto();
+    proto->conn_str = connection_str;
+    std::string proto_lib;
+    OutboxConfig config;
+    if (!parse_config(proto, config_path, proto_lib, config)) {
+        delete proto;
+        return nullptr;
+    }
+
+    proto->lib = dlopen(proto_lib.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!proto->lib) {
+        std::cerr << "outbox_proto: cannot load " << proto_lib << ": " << dlerror() << "\n";
+        delete proto;
+        return nullptr;
+    }
+    proto->connect = (decltype(proto->connect)) dlsym(proto->lib, "nvds_msgapi_connect");
+    proto->send_async = (decltype(proto->send_async)) dlsym(proto->lib, "nvds_msgapi_send_async");
+    proto->do_work = (decltype(proto->do_work)) dlsym(proto->lib, "nvds_msgapi_do_work");
+    proto->disconnect = (decltype(proto->disconnect)) dlsym(proto->lib, "nvds_msgapi_disconnect");
+    if (!proto->connect || !proto->send_async || !proto->do_work || !proto->disconnect ||
+        !proto->outbox.init(config, [proto](uint64_t id, const std::string &topic,
+                                            const std::string &payload) {
+            return inner_send(proto, id, topic, payload);
+        })) {
+        std::cerr << "outbox_proto: cannot wrap " << proto_lib << "\n";
+        dlclose(proto->lib);
+        delete proto;
+        return nullptr;
+    }
+    return proto;
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload,
+                                     size_t nbuf) {
+    OutboxProto *proto = (OutboxProto *) h_ptr;
+    if (!proto || !payload)
+        return NVDS_MSGAPI_ERR;
+    return proto->outbox.push(topic ? topic : "", payload, nbuf) ? NVDS_MSGAPI_OK
+                                                                 : NVDS_MSGAPI_ERR;
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_async(NvDsMsgApiHandle h_ptr, char *topic,
+                                           const uint8_t *payload, size_t nbuf,
+                                           nvds_msgapi_send_cb_t send_callback, void *user_ptr) {
+    NvDsMsgApiErrorType flag = nvds_msgapi_send(h_ptr, topic, payload, nbuf);
+    if (h_ptr && send_callback) {
+        OutboxProto *proto = (OutboxProto *) h_ptr;
+        std::lock_guard<std::mutex> lock(proto->completions_mutex);
+        proto->completions.push_back({send_callback, user_ptr, flag});
+    }
+    return NVDS_MSGAPI_OK;
+}
+
+NvDsMsgApiErrorType nvds_msgapi_subscribe(NvDsMsgApiHandle h_ptr, char **topics, int num_topics,
+                                          nvds_msgapi_subscribe_request_cb_t cb, void *user_ctx) {
+    (void) h_ptr; (void) topics; (void) num_topics; (void) cb; (void) user_ctx;
+    std::cerr << "outbox_proto: subscribe is not supported\n";
+    return NVDS_MSGAPI_ERR;
+}
+
+void nvds_msgapi_do_work(NvDsMsgApiHandle h_ptr) {
+    OutboxProto *proto = (OutboxProto *) h_ptr;
+    if (!proto)
+        return;
+    proto->outbox.pump();
+    if (proto->inner)
+        proto->do_work(proto->inner);
+
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(proto->completions_mutex);
+        completions.swap(proto->completions);
+    }
+    for (const Completion &completion : completions)
+        completion.callback(completion.user_ptr, completion.flag);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_disconnect(NvDsMsgApiHandle h_ptr) {
+    OutboxProto *proto = (OutboxProto *) h_ptr;
+    if (!proto)
+        return NVDS_MSGAPI_ERR;
+    /// Give the broker a chance to take the queue; the rest is spooled
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(proto->drain_ms);
+    nvds_msgapi_do_work(h_ptr);
+    while (!proto->outbox.idle() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        nvds_msgapi_do_work(h_ptr);
+    }
+    proto->outbox.close();
+    if (proto->inner)
+        proto->disconnect(proto->inner);
+    proto->inner = nullptr;
+    /// Completions of the last sends
+    nvds_msgapi_do_work(h_ptr);
+
+    EventOutbox::Stats stats = proto->outbox.stats();
+    std::cout << "outbox_proto: " << stats.pushed << " pushed, " << stats.delivered
+              << " delivered, " << stats.failed << " failed attempts, " << stats.spilled
+              << " spooled, " << stats.replayed << " replayed, " << stats.dropped
+              << " dropped\n";
+    dlclose(proto->lib);
+    delete proto;
+    return NVDS_MSGAPI_OK;
+}
+
+char *nvds_msgapi_getversion(void) {
+    return (char *) OUTBOX_PROTO_VERSION;
+}
+
+char *nvds_msgapi_get_protocol_name(void) {
+    return (char *) OUTBOX_PROTO_NAME;
+}
+
+/// One connection per wrapped connection string
+NvDsMsgApiErrorType nvds_msgapi_connection_signature(char *broker_str, char *cfg, char *output_str,
+                                                     int max_len) {
+    (void) cfg;
+    if (!broker_str || !output_str || max_len <= 0)
+        return NVDS_MSGAPI_ERR;
+    snprintf(output_str, max_len, "outbox:%s", broker_str);
+    return NVDS_MSGAPI_OK;
+}
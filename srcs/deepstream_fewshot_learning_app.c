@@ -27,6 +27,7 @@
 #include <X11/Xutil.h>
 #include <cuda_runtime_api.h>
 #include <errno.h>
+#include <stdarg.h>
 #include <glib.h>
 #include <gst/gst.h>
 #include <stdbool.h>
@@ -53,6 +54,17 @@
 #include "nvds_tracker_meta.h"
 #include "nvds_version.h"
 #include "nvdsmeta_schema.h"
+#include "prototype_gallery_wrapper.h"
+#include "embedding_cold_store_wrapper.h"
+#include "embedding_change_filter_wrapper.h"
+#include "event_meta_pool.h"
+#include "emission_policy_wrapper.h"
+#include "event_batcher_wrapper.h"
+#include "event_worker_pool_wrapper.h"
+#include "line_cross_engine_wrapper.h"
+#include "occupancy_heatmap_wrapper.h"
+#include "dwell_tracker_wrapper.h"
+#include "rfc3339_timestamp.h"
 // #include "image_meta_producer_wrapper.h"
 
 /**
@@ -181,6 +193,57 @@ static AppConfigAnalyticsModel model_used = APP_CONFIG_ANALYTICS_MODELS_UNKNOWN;
 static gint log_level = 0;
 static gint message_rate = 30;
 static ImageMetaConsumerWrapper *g_img_meta_consumer;
+static gchar *gallery_file = NULL;
+static gdouble gallery_threshold = 0.5;
+static gboolean gallery_watch = FALSE;
+static gchar *gallery_save_file = NULL;
+static gboolean gallery_save_fp16 = FALSE;
+static PrototypeGalleryWrapper *g_prototype_gallery = NULL;
+static gchar *reid_cold_store_dir = NULL;
+static guint reid_cold_store_age = 0;
+static guint reid_cold_store_size = 256;
+static EmbeddingColdStoreWrapper *g_reid_cold_store = NULL;
+static gdouble embedding_change_threshold = 0;
+static gint embedding_resend_age = 300;
+static EmbeddingChangeFilterWrapper *g_embedding_filter = NULL;
+static gint emission_policy = 0;
+static gdouble emit_motion_threshold = 0.5;
+static gint emit_frame_budget = 0;
+static EmissionPolicyWrapper *g_emission_policy = NULL;
+static gboolean event_batch = FALSE;
+static guint event_batch_interval = 0;
+static guint event_batch_max_objects = 0;
+static gint payload_format = 0;
+static gchar *meta_compression = NULL;
+static gint meta_compression_level = 0;
+static gchar *meta_compression_dict_dir = NULL;
+static EventBatcherWrapper *g_event_batcher = NULL;
+static guint analytics_summary_interval = 10;
+static guint async_events = 0;
+static guint async_events_queue = 64;
+static EventWorkerPoolWrapper *g_event_worker_pool = NULL;
+static gchar *line_cross_config = NULL;
+static LineCrossEngineWrapper *g_line_cross_engine = NULL;
+/** Objects of the current frame, as handed to the line crossing engine,
+ * and their results */
+static LineCrossObject *line_cross_objects = NULL;
+static LineCrossResult *line_cross_results = NULL;
+static guint line_cross_objects_len = 0;
+static guint line_cross_num_objects = 0;
+static gint dwell_events = 0;
+static guint dwell_max_visits = 4096;
+static guint dwell_expiry = 3000;
+static DwellTrackerWrapper *g_dwell_tracker = NULL;
+static guint heatmap_interval = 0;
+static guint heatmap_cell = 32;
+static OccupancyHeatmapWrapper *g_occupancy_heatmap = NULL;
+/** Boxes of the current frame, as handed to the heatmap */
+static float *heatmap_boxes = NULL;
+static guint heatmap_boxes_len = 0;
+/** Staging buffer for device embeddings (an event_meta_pool embedding),
+ * handed over to the event meta when the embedding is sent */
+static float *embedding_scratch = NULL;
+static gint embedding_scratch_len = 0;
 static struct timeval ota_request_time;
 static struct timeval ota_completion_time;
 
@@ -221,13 +284,130 @@ GOptionEntry entries[] = {
     {"log-level", 'l', 0, G_OPTION_ARG_INT, &log_level,
      "Log level for prints, default=0", NULL},
     {"message-rate", 'r', 0, G_OPTION_ARG_INT, &message_rate,
-     "Message rate for broker", NULL},
+     "Message rate for broker; with the adaptive emission policy, the "
+     "maximum frames between two events of a track",
+     NULL},
+    {"emission-policy", 0, 0, G_OPTION_ARG_INT, &emission_policy,
+     "Event emission; {0: every object on frames multiple of message-rate "
+     "[DEFAULT]}, {1: per track on new track, line crossing, termination, "
+     "motion or staleness; needs the tracker, untracked objects fall back "
+     "to 0}",
+     NULL},
+    {"emit-motion-threshold", 0, 0, G_OPTION_ARG_DOUBLE, &emit_motion_threshold,
+     "Box center displacement, relative to the box size, that triggers an "
+     "event; default=0.5, 0 disables motion events",
+     NULL},
+    {"emit-frame-budget", 0, 0, G_OPTION_ARG_INT, &emit_frame_budget,
+     "Maximum motion/staleness events per stream and frame, default=0 "
+     "(unlimited)",
+     NULL},
+    {"event-batch", 0, 0, G_OPTION_ARG_INT, &event_batch,
+     "Send the events of a stream as one JSON payload per frame or window "
+     "instead of one message per object, default=0",
+     NULL},
+    {"event-batch-interval", 0, 0, G_OPTION_ARG_INT, &event_batch_interval,
+     "Window of a batched event message in ms of stream time, default=0 "
+     "(one message per frame)",
+     NULL},
+    {"event-batch-max-objects", 0, 0, G_OPTION_ARG_INT,
+     &event_batch_max_objects,
+     "Objects after which a batched window is sent early, default=0 "
+     "(unlimited)",
+     NULL},
+    {"payload-format", 0, 0, G_OPTION_ARG_INT, &payload_format,
+     "Event payload; {0: JSON [DEFAULT]}, {1: binary with raw embeddings, "
+     "see event_codec.h; implies --event-batch 1}",
+     NULL},
+    {"analytics-summary-interval", 0, 0, G_OPTION_ARG_INT,
+     &analytics_summary_interval,
+     "Seconds between two summaries of the cumulative line crossings and "
+     "occupancy of every stream, default=10 (0 to disable)",
+     NULL},
+    {"line-cross-config", 0, 0, G_OPTION_ARG_FILENAME, &line_cross_config,
+     "nvdsanalytics config file whose line-crossing and roi-filtering "
+     "groups are evaluated in the app on the tracker output, in place of "
+     "the nvdsanalytics element ([nvds-analytics] can then be disabled)",
+     NULL},
+    {"dwell-events", 0, 0, G_OPTION_ARG_INT, &dwell_events,
+     "Send one event per visit of an object to an ROI of "
+     "--line-cross-config, with its entry time and dwell time, when it "
+     "leaves the ROI, its track ends or it is lost; default=0",
+     NULL},
+    {"dwell-max-visits", 0, 0, G_OPTION_ARG_INT, &dwell_max_visits,
+     "Open ROI visits tracked at once, over all streams; default=4096",
+     NULL},
+    {"dwell-expiry", 0, 0, G_OPTION_ARG_INT, &dwell_expiry,
+     "Milliseconds after which the visits of an object that is not seen "
+     "anymore end; default=3000",
+     NULL},
+    {"heatmap-interval", 0, 0, G_OPTION_ARG_INT, &heatmap_interval,
+     "Seconds between two occupancy heatmap messages of a stream (foot "
+     "point counts per cell and objects per frame, see event_codec.h), "
+     "sent through the type=6 [sink]; default=0 (disabled)",
+     NULL},
+    {"heatmap-cell", 0, 0, G_OPTION_ARG_INT, &heatmap_cell,
+     "Cell size of the occupancy heatmap in streammux pixels, default=32",
+     NULL},
+    {"async-events", 0, 0, G_OPTION_ARG_INT, &async_events,
+     "Number of worker threads building and sending the events, default=0 "
+     "(built on the streaming thread and sent by the msgconv/msgbroker "
+     "sink); workers send through the proto-lib/conn-str/topic of the "
+     "type=6 [sink], which should be left disabled",
+     NULL},
+    {"async-events-queue", 0, 0, G_OPTION_ARG_INT, &async_events_queue,
+     "Frame batches a worker may fall behind before events are dropped, "
+     "default=64",
+     NULL},
+    {"meta-compression", 0, 0, G_OPTION_ARG_STRING, &meta_compression,
+     "Compression of the [img-save] metadata.json/csv files: none, lz4 or "
+     "zstd (needs a build with ENABLE_COMPRESSION=1), default=none",
+     NULL},
+    {"meta-compression-level", 0, 0, G_OPTION_ARG_INT, &meta_compression_level,
+     "Codec level of --meta-compression, default=0 (codec default)", NULL},
+    {"meta-compression-dict-dir", 0, 0, G_OPTION_ARG_FILENAME,
+     &meta_compression_dict_dir,
+     "Directory of the zstd dictionaries of the metadata files; missing ones "
+     "are trained on the first run and saved there",
+     NULL},
     {"target-class", 't', 0, G_OPTION_ARG_INT, &target_class,
      "Target class for MTMC", NULL},
     {"tracker-reid", 0, 0, G_OPTION_ARG_NONE, &use_tracker_reid,
      "Use tracker re-identification as embedding", NULL},
     {"reid-store-age", 0, 0, G_OPTION_ARG_INT, &tracker_reid_store_age,
      "Tracker reid store age", NULL},
+    {"reid-cold-store-dir", 0, 0, G_OPTION_ARG_FILENAME, &reid_cold_store_dir,
+     "Spill embeddings older than reid-store-age to memory-mapped segments "
+     "in this directory",
+     NULL},
+    {"reid-cold-store-age", 0, 0, G_OPTION_ARG_INT, &reid_cold_store_age,
+     "Frames to look back in the cold store, default=0 (as long as the "
+     "segments hold)",
+     NULL},
+    {"reid-cold-store-size", 0, 0, G_OPTION_ARG_INT, &reid_cold_store_size,
+     "Disk budget of the cold store in MB, default=256", NULL},
+    {"embedding-change-threshold", 0, 0, G_OPTION_ARG_DOUBLE,
+     &embedding_change_threshold,
+     "Send a track's embedding only when its cosine distance to the last "
+     "one sent reaches this value, default=0 (always send); needs the "
+     "tracker, untracked objects always send theirs",
+     NULL},
+    {"embedding-resend-age", 0, 0, G_OPTION_ARG_INT, &embedding_resend_age,
+     "Frames after which an unchanged embedding is sent anyway, default=300 "
+     "(0 = never)",
+     NULL},
+    {"gallery", 0, 0, G_OPTION_ARG_FILENAME, &gallery_file,
+     "Prototype gallery (binary or JSON) used to classify object embeddings "
+     "in-app; events then carry a product object with the matched label",
+     NULL},
+    {"gallery-watch", 0, 0, G_OPTION_ARG_NONE, &gallery_watch,
+     "Reload the gallery whenever a new file is renamed onto it; write it "
+     "to a temporary file and rename() it, never rewrite it in place", NULL},
+    {"gallery-save", 0, 0, G_OPTION_ARG_FILENAME, &gallery_save_file,
+     "Write the loaded gallery in the binary (mmap) format to this file", NULL},
+    {"gallery-save-fp16", 0, 0, G_OPTION_ARG_NONE, &gallery_save_fp16,
+     "Store the gallery written with --gallery-save as fp16", NULL},
+    {"gallery-threshold", 0, 0, G_OPTION_ARG_DOUBLE, &gallery_threshold,
+     "Minimum cosine similarity for a gallery match, default=0.5", NULL},
     {NULL},
 };
 
@@ -272,80 +452,58 @@ void apply_ota(AppCtx *ota_appCtx);
 gpointer ota_handler_thread(gpointer data);
 
 static void generate_ts_rfc3339(char *buf, int buf_size) {
-  time_t tloc;
-  struct tm tm_log;
   struct timespec ts;
-  char strmsec[6]; //.nnnZ\0
 
   clock_gettime(CLOCK_REALTIME, &ts);
-  memcpy(&tloc, (void *)(&ts.tv_sec), sizeof(time_t));
-  gmtime_r(&tloc, &tm_log);
-  strftime(buf, buf_size, "%Y-%m-%dT%H:%M:%S", &tm_log);
-  int ms = ts.tv_nsec / 1000000;
-  g_snprintf(strmsec, sizeof(strmsec), ".%.3dZ", ms);
-  strncat(buf, strmsec, buf_size);
+  write_ts_rfc3339(buf, buf_size, ts.tv_sec, ts.tv_nsec / 1000000);
+}
+
+/**
+ * UTC time of a buffer of a stream: for playback (and file sources) the
+ * time encoded in the URI of the first frame plus the elapsed stream time,
+ * else @a ts, which already is UTC. Updates the first-frame state of the
+ * stream, so it runs on the streaming thread.
+ */
+static GstClockTime compute_utc_from_ts(GstClockTime ts, gchar *src_uri,
+                                        gint stream_id) {
+  if (!playback_utc && (appCtx[0]->config.multi_source_config[stream_id].type ==
+                        NV_DS_SOURCE_RTSP)) {
+    /** ts itself is UTC Time in ns */
+    return ts;
+  }
+  StreamSourceInfo *stream = &testAppCtx->streams[stream_id];
+  if (stream->meta_number != 0) {
+    return GST_TIMESPEC_TO_TIME(stream->timespec_first_frame) +
+           (ts - stream->gst_ts_first_frame);
+  }
+  stream->timespec_first_frame = extract_utc_from_uri(src_uri);
+  stream->gst_ts_first_frame = ts;
+  GstClockTime ts_generated = GST_TIMESPEC_TO_TIME(stream->timespec_first_frame);
+  if (ts_generated == 0) {
+    if (log_level >= LOG_LVL_WARN) {
+      g_print(
+          "WARNING; playback mode used with URI [%s] not conforming to "
+          "timestamp format;"
+          " check README; using system-time\n",
+          src_uri);
+    }
+    clock_gettime(CLOCK_REALTIME, &stream->timespec_first_frame);
+    ts_generated = GST_TIMESPEC_TO_TIME(stream->timespec_first_frame);
+  }
+  return ts_generated;
+}
+
+/** RFC3339 with milliseconds of a UTC time in ns; thread safe */
+static void format_ts_rfc3339(char *buf, int buf_size, GstClockTime utc) {
+  write_ts_rfc3339(buf, buf_size, (time_t)(utc / GST_SECOND),
+                   (int)((utc % GST_SECOND) / GST_MSECOND));
 }
 
 GstClockTime generate_ts_rfc3339_from_ts(char *buf, int buf_size,
                                          GstClockTime ts, gchar *src_uri,
                                          gint stream_id) {
-  time_t tloc;
-  struct tm tm_log;
-  char strmsec[6]; //.nnnZ\0
-  int ms;
-
-  GstClockTime ts_generated;
-
-  if (playback_utc || (appCtx[0]->config.multi_source_config[stream_id].type !=
-                       NV_DS_SOURCE_RTSP)) {
-    if (testAppCtx->streams[stream_id].meta_number == 0) {
-      testAppCtx->streams[stream_id].timespec_first_frame =
-          extract_utc_from_uri(src_uri);
-      memcpy(
-          &tloc,
-          (void *)(&testAppCtx->streams[stream_id].timespec_first_frame.tv_sec),
-          sizeof(time_t));
-      ms =
-          testAppCtx->streams[stream_id].timespec_first_frame.tv_nsec / 1000000;
-      testAppCtx->streams[stream_id].gst_ts_first_frame = ts;
-      ts_generated = GST_TIMESPEC_TO_TIME(
-          testAppCtx->streams[stream_id].timespec_first_frame);
-      if (ts_generated == 0) {
-        if (log_level >= LOG_LVL_WARN) {
-          g_print(
-              "WARNING; playback mode used with URI [%s] not conforming to "
-              "timestamp format;"
-              " check README; using system-time\n",
-              src_uri);
-        }
-        clock_gettime(CLOCK_REALTIME,
-                      &testAppCtx->streams[stream_id].timespec_first_frame);
-        ts_generated = GST_TIMESPEC_TO_TIME(
-            testAppCtx->streams[stream_id].timespec_first_frame);
-      }
-    } else {
-      GstClockTime ts_current =
-          GST_TIMESPEC_TO_TIME(
-              testAppCtx->streams[stream_id].timespec_first_frame) +
-          (ts - testAppCtx->streams[stream_id].gst_ts_first_frame);
-      struct timespec timespec_current;
-      GST_TIME_TO_TIMESPEC(ts_current, timespec_current);
-      memcpy(&tloc, (void *)(&timespec_current.tv_sec), sizeof(time_t));
-      ms = timespec_current.tv_nsec / 1000000;
-      ts_generated = ts_current;
-    }
-  } else {
-    /** ts itself is UTC Time in ns */
-    struct timespec timespec_current;
-    GST_TIME_TO_TIMESPEC(ts, timespec_current);
-    memcpy(&tloc, (void *)(&timespec_current.tv_sec), sizeof(time_t));
-    ms = timespec_current.tv_nsec / 1000000;
-    ts_generated = ts;
-  }
-  gmtime_r(&tloc, &tm_log);
-  strftime(buf, buf_size, "%Y-%m-%dT%H:%M:%S", &tm_log);
-  g_snprintf(strmsec, sizeof(strmsec), ".%.3dZ", ms);
-  strncat(buf, strmsec, buf_size);
+  GstClockTime ts_generated = compute_utc_from_ts(ts, src_uri, stream_id);
+  format_ts_rfc3339(buf, buf_size, ts_generated);
   if (log_level >= LOG_LVL_DEBUG) {
     LOGD("ts=%s\n", buf);
   }
@@ -353,95 +511,16 @@ GstClockTime generate_ts_rfc3339_from_ts(char *buf, int buf_size,
   return ts_generated;
 }
 
+/**
+ * Event metas come from event_meta_pool: copying one is a block memcpy
+ * that shares its refcounted embedding (one more reference, no copy),
+ * releasing one drops that reference and recycles the block.
+ */
 static gpointer meta_copy_func(gpointer data, gpointer user_data) {
   NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
   NvDsEventMsgMeta *srcMeta = (NvDsEventMsgMeta *)user_meta->user_meta_data;
-  NvDsEventMsgMeta *dstMeta = NULL;
-
-  dstMeta = (NvDsEventMsgMeta *)g_memdup(srcMeta, sizeof(NvDsEventMsgMeta));
-
-  if (srcMeta->ts) dstMeta->ts = g_strdup(srcMeta->ts);
-
-  if (srcMeta->objSignature.size > 0) {
-    dstMeta->objSignature.signature = (gdouble *)g_memdup(
-        srcMeta->objSignature.signature, srcMeta->objSignature.size);
-    dstMeta->objSignature.size = srcMeta->objSignature.size;
-  }
-
-  if (srcMeta->objectId) {
-    dstMeta->objectId = g_strdup(srcMeta->objectId);
-  }
-
-  if (srcMeta->sensorStr) {
-    dstMeta->sensorStr = g_strdup(srcMeta->sensorStr);
-  }
-
-  if (srcMeta->extMsgSize > 0) {
-    if (srcMeta->objType == NVDS_OBJECT_TYPE_VEHICLE) {
-      NvDsVehicleObject *srcObj = (NvDsVehicleObject *)srcMeta->extMsg;
-      NvDsVehicleObject *obj =
-          (NvDsVehicleObject *)g_malloc0(sizeof(NvDsVehicleObject));
-      if (srcObj->type) obj->type = g_strdup(srcObj->type);
-      if (srcObj->make) obj->make = g_strdup(srcObj->make);
-      if (srcObj->model) obj->model = g_strdup(srcObj->model);
-      if (srcObj->color) obj->color = g_strdup(srcObj->color);
-      if (srcObj->license) obj->license = g_strdup(srcObj->license);
-      if (srcObj->region) obj->region = g_strdup(srcObj->region);
-
-      dstMeta->extMsg = obj;
-      dstMeta->extMsgSize = sizeof(NvDsVehicleObject);
-    } else if (srcMeta->objType == NVDS_OBJECT_TYPE_PERSON) {
-      NvDsPersonObject *srcObj = (NvDsPersonObject *)srcMeta->extMsg;
-      NvDsPersonObject *obj =
-          (NvDsPersonObject *)g_malloc0(sizeof(NvDsPersonObject));
-
-      obj->age = srcObj->age;
-
-      if (srcObj->gender) obj->gender = g_strdup(srcObj->gender);
-      if (srcObj->cap) obj->cap = g_strdup(srcObj->cap);
-      if (srcObj->hair) obj->hair = g_strdup(srcObj->hair);
-      if (srcObj->apparel) obj->apparel = g_strdup(srcObj->apparel);
-
-      dstMeta->extMsg = obj;
-      dstMeta->extMsgSize = sizeof(NvDsPersonObject);
-    }
-    //! Extensions for Fewshot Learning
-    else if (srcMeta->objType == NVDS_OBJECT_TYPE_PRODUCT) {
-      NvDsProductObject *srcObj = (NvDsProductObject *)srcMeta->extMsg;
-      NvDsProductObject *obj =
-          (NvDsProductObject *)g_malloc0(sizeof(NvDsProductObject));
-      if (srcObj->brand) obj->brand = g_strdup(srcObj->brand);
-      if (srcObj->type) obj->type = g_strdup(srcObj->type);
-      if (srcObj->shape) obj->shape = g_strdup(srcObj->shape);
-
-      dstMeta->extMsg = obj;
-      dstMeta->extMsgSize = sizeof(NvDsProductObject);
-    }
-  }
-
-  if (srcMeta->embedding.embedding_length > 0) {
-    dstMeta->embedding.embedding_length = srcMeta->embedding.embedding_length;
-    dstMeta->embedding.embedding_vector =
-        g_memdup(srcMeta->embedding.embedding_vector,
-                 srcMeta->embedding.embedding_length * sizeof(float));
-  }
-
-  if (srcMeta->has3DTracking) {
-    dstMeta->has3DTracking = true;
-    dstMeta->singleView3DTracking.visibility = srcMeta->singleView3DTracking.visibility;
-    dstMeta->singleView3DTracking.ptWorldFeet[0] = srcMeta->singleView3DTracking.ptWorldFeet[0];
-    dstMeta->singleView3DTracking.ptWorldFeet[1] = srcMeta->singleView3DTracking.ptWorldFeet[1];
-    dstMeta->singleView3DTracking.ptImgFeet[0] = srcMeta->singleView3DTracking.ptImgFeet[0];
-    dstMeta->singleView3DTracking.ptImgFeet[1] = srcMeta->singleView3DTracking.ptImgFeet[1];
-    dstMeta->singleView3DTracking.convexHull.numFilled = srcMeta->singleView3DTracking.convexHull.numFilled;
-    dstMeta->singleView3DTracking.convexHull.points =
-        g_memdup(srcMeta->singleView3DTracking.convexHull.points,
-                    srcMeta->singleView3DTracking.convexHull.numFilled * 2 * sizeof(gint));
 
-  } else {
-    dstMeta->has3DTracking = false;
-  }
-  return dstMeta;
+  return event_meta_pool_copy(srcMeta);
 }
 
 static void meta_free_func(gpointer data, gpointer user_data) {
@@ -449,65 +528,7 @@ static void meta_free_func(gpointer data, gpointer user_data) {
   NvDsEventMsgMeta *srcMeta = (NvDsEventMsgMeta *)user_meta->user_meta_data;
   user_meta->user_meta_data = NULL;
 
-  if (srcMeta->ts) {
-    g_free(srcMeta->ts);
-  }
-
-  if (srcMeta->objSignature.size > 0) {
-    g_free(srcMeta->objSignature.signature);
-    srcMeta->objSignature.size = 0;
-  }
-
-  if (srcMeta->objectId) {
-    g_free(srcMeta->objectId);
-  }
-
-  if (srcMeta->sensorStr) {
-    g_free(srcMeta->sensorStr);
-  }
-
-  if (srcMeta->extMsgSize > 0) {
-    if (srcMeta->objType == NVDS_OBJECT_TYPE_VEHICLE) {
-      NvDsVehicleObject *obj = (NvDsVehicleObject *)srcMeta->extMsg;
-      if (obj->type) g_free(obj->type);
-      if (obj->color) g_free(obj->color);
-      if (obj->make) g_free(obj->make);
-      if (obj->model) g_free(obj->model);
-      if (obj->license) g_free(obj->license);
-      if (obj->region) g_free(obj->region);
-    } else if (srcMeta->objType == NVDS_OBJECT_TYPE_PERSON) {
-      NvDsPersonObject *obj = (NvDsPersonObject *)srcMeta->extMsg;
-
-      if (obj->gender) g_free(obj->gender);
-      if (obj->cap) g_free(obj->cap);
-      if (obj->hair) g_free(obj->hair);
-      if (obj->apparel) g_free(obj->apparel);
-    }
-    //! Extensions for Fewshot Learning
-    else if (srcMeta->objType == NVDS_OBJECT_TYPE_PRODUCT) {
-      NvDsProductObject *obj = (NvDsProductObject *)srcMeta->extMsg;
-
-      if (obj->brand) g_free(obj->brand);
-      if (obj->type) g_free(obj->type);
-      if (obj->shape) g_free(obj->shape);
-    }
-
-    g_free(srcMeta->extMsg);
-    srcMeta->extMsg = NULL;
-    srcMeta->extMsgSize = 0;
-  }
-
-  if (srcMeta->embedding.embedding_vector) {
-    g_free(srcMeta->embedding.embedding_vector);
-  }
-  srcMeta->embedding.embedding_length = 0;
-
-  if (srcMeta->has3DTracking && srcMeta->singleView3DTracking.convexHull.points) {
-    g_free(srcMeta->singleView3DTracking.convexHull.points);
-    srcMeta->singleView3DTracking.convexHull.numFilled = 0;
-  }
-
-  g_free(srcMeta);
+  event_meta_pool_release(srcMeta);
 }
 
 #ifdef GENERATE_DUMMY_META_EXT
@@ -522,13 +543,13 @@ static void generate_vehicle_meta(gpointer data) {
   obj->region = g_strdup("CA");
 }
 
-static void generate_person_meta(gpointer data) {
-  NvDsPersonObject *obj = (NvDsPersonObject *)data;
+static void generate_person_meta(NvDsEventMsgMeta *meta) {
+  NvDsPersonObject *obj = event_meta_pool_person(meta);
   obj->age = 0;
-  obj->cap = g_strdup("");
-  obj->hair = g_strdup("");
-  obj->gender = g_strdup("");
-  obj->apparel = g_strdup("");
+  event_meta_pool_set_str(meta, &obj->cap, "");
+  event_meta_pool_set_str(meta, &obj->hair, "");
+  event_meta_pool_set_str(meta, &obj->gender, "");
+  event_meta_pool_set_str(meta, &obj->apparel, "");
 }
 //! Extensions for Fewshot Learning
 // Create product meta object
@@ -571,6 +592,13 @@ static void pop_embedding_queue(gint stream_id, gint frame_num) {
           frame_embedding = (FrameEmbedding *) g_queue_pop_tail(prev_frames_embedding);
           for (GList *l = frame_embedding->obj_embeddings; l; l = l->next) {
             ObjEmbedding *obj_emb = (ObjEmbedding *) l->data;
+            /** Keep it in the cold tier for long occlusions */
+            if (g_reid_cold_store) {
+              embedding_cold_store_spill(g_reid_cold_store, stream_id,
+                                         frame_embedding->frame_num,
+                                         obj_emb->object_id, obj_emb->embedding,
+                                         obj_emb->num_elements);
+            }
             g_free(obj_emb->embedding);
             g_free(obj_emb);
           }
@@ -588,12 +616,9 @@ float *retrieve_embedding_queue(gint stream_id, gint frame_num, guint64 target_o
   float* embedding_data = NULL;
   GQueue *prev_frames_embedding = testAppCtx->streams[stream_id].frame_embedding_queue;
 
-  if (prev_frames_embedding == NULL || g_queue_is_empty(prev_frames_embedding))
-    return embedding_data;
-
   /** Find history embedding*/
   /**When queue tail is not reached and embedding not found */
-  for (guint i=0; i < g_queue_get_length(prev_frames_embedding) && embedding_data == NULL; i++) {
+  for (guint i=0; prev_frames_embedding && i < g_queue_get_length(prev_frames_embedding) && embedding_data == NULL; i++) {
 
     FrameEmbedding *frame_embedding = (FrameEmbedding *) g_queue_peek_nth(prev_frames_embedding, i);
     /** Out of history range */
@@ -609,6 +634,19 @@ float *retrieve_embedding_queue(gint stream_id, gint frame_num, guint64 target_o
       }
     }
   }
+
+  /** Not in the in-memory window: look further back in the cold tier */
+  if (embedding_data == NULL && g_reid_cold_store) {
+    guint num_elements = 0;
+    gint min_frame_num = reid_cold_store_age > 0
+                             ? frame_num - (gint)(tracker_reid_store_age +
+                                                  reid_cold_store_age)
+                             : G_MININT;
+    embedding_data = (float *)embedding_cold_store_lookup(
+        g_reid_cold_store, stream_id, target_obj_id, min_frame_num,
+        &num_elements);
+    if (embedding_data) *p_num_elements = num_elements;
+  }
   return embedding_data;
 }
 
@@ -618,7 +656,132 @@ static void push_to_embedding_queue(gint stream_id, FrameEmbedding *frame_embedd
   }
   g_queue_push_head (testAppCtx->streams[stream_id].frame_embedding_queue, frame_embedding);
 }
-void analytics_custom_parse_direction_obj_data (NvDsObjectMeta *obj_meta, AnalyticsUserMeta *data);
+void analytics_custom_parse_direction_obj_data (NvDsObjectMeta *obj_meta, guint source_id, AnalyticsUserMeta *data);
+gboolean analytics_obj_line_crossed (NvDsObjectMeta *obj_meta);
+void analytics_count_frame (NvDsFrameMeta *frame_meta);
+void analytics_print_summary (void);
+
+/** Add a key=value attribute to NvDsEventMsgMeta::otherAttrs, ';' separated */
+static void append_other_attr(NvDsEventMsgMeta *meta, const gchar *format,
+                              ...) {
+  va_list args;
+  va_start(args, format);
+  event_meta_pool_append_vprintf(meta, &meta->otherAttrs, ";", format, args);
+  va_end(args);
+}
+
+/**
+ * Cumulative line-crossing counts of the stream: in the NvDsEventMsgMeta
+ * extension fields when the schema has them (includes/nvdsmeta_schema.h),
+ * else as attributes
+ */
+static void set_analytics_counts(NvDsEventMsgMeta *meta, guint source_id,
+                                 guint occupancy, guint entries,
+                                 guint exits) {
+#ifdef NVDS_EVENT_MSG_META_ANALYTICS_EXT
+  meta->source_id = source_id;
+  meta->occupancy = occupancy;
+  meta->lccum_cnt_entry = entries;
+  meta->lccum_cnt_exit = exits;
+#else
+  (void)source_id;
+  append_other_attr(meta, "occupancy=%u;lccum_cnt_entry=%u;lccum_cnt_exit=%u",
+                    occupancy, entries, exits);
+#endif
+}
+
+/** ROI of the line crossing engine the object is in, as an attribute */
+static void set_analytics_roi(NvDsEventMsgMeta *meta, guint source_id,
+                              guint32 roi_mask) {
+  const char *roi =
+      line_cross_engine_roi_label(g_line_cross_engine, source_id, roi_mask);
+  if (roi) {
+    append_other_attr(meta, "roi=%s", roi);
+  }
+}
+
+/**
+ * Line crossings of the objects of a frame with the in-app engine; the
+ * results are read back per object by get_object_analytics()
+ */
+static void line_cross_process_frame(NvDsFrameMeta *frame_meta) {
+  if (frame_meta->num_obj_meta > line_cross_objects_len) {
+    line_cross_objects_len = frame_meta->num_obj_meta * 2;
+    g_free(line_cross_objects);
+    g_free(line_cross_results);
+    line_cross_objects = g_new(LineCrossObject, line_cross_objects_len);
+    line_cross_results = g_new(LineCrossResult, line_cross_objects_len);
+  }
+  guint num_objects = 0;
+  for (NvDsMetaList *l_obj = frame_meta->obj_meta_list;
+       l_obj != NULL && num_objects < line_cross_objects_len;
+       l_obj = l_obj->next) {
+    NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)l_obj->data;
+    LineCrossObject *object = &line_cross_objects[num_objects++];
+    object->object_id = obj_meta->object_id;
+    object->class_id = obj_meta->class_id;
+    object->bbox[0] = obj_meta->rect_params.left;
+    object->bbox[1] = obj_meta->rect_params.top;
+    object->bbox[2] = obj_meta->rect_params.width;
+    object->bbox[3] = obj_meta->rect_params.height;
+  }
+  line_cross_engine_process(g_line_cross_engine, frame_meta->source_id,
+                            frame_meta->frame_num, line_cross_objects,
+                            num_objects, line_cross_results);
+  line_cross_num_objects = num_objects;
+}
+
+/**
+ * Line crossing direction and counts of an object, from the in-app engine
+ * when --line-cross-config is set, else from the nvdsanalytics meta.
+ * Returns FALSE when neither is enabled.
+ */
+static gboolean get_object_analytics(AppCtx *appCtx, NvDsFrameMeta *frame_meta,
+                                     NvDsObjectMeta *obj_meta, guint stream_id,
+                                     AnalyticsUserMeta *data) {
+  if (g_line_cross_engine) {
+    LineCrossResult result;
+    memset(data, 0, sizeof(*data));
+    data->source_id = stream_id;
+    if (line_cross_engine_object(g_line_cross_engine, stream_id,
+                                 obj_meta->object_id, frame_meta->frame_num,
+                                 &result)) {
+      data->direction = result.line;
+      data->lcc_cnt_entry = result.entries;
+      data->lcc_cnt_exit = result.exits;
+      data->lccum_cnt = result.line_count;
+      data->roi_mask = result.roi_mask;
+    }
+    line_cross_engine_stream_counts(g_line_cross_engine, stream_id,
+                                    &data->lccum_cnt_entry,
+                                    &data->lccum_cnt_exit, &data->occupancy);
+    return TRUE;
+  }
+  if (appCtx->config.dsanalytics_config.enable) {
+    analytics_custom_parse_direction_obj_data(obj_meta, stream_id, data);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/**
+ * Host view of an embedding: device tensors are staged in the scratch
+ * buffer, host ones are read in place
+ */
+static const float *stage_host_embedding(float *embedding_data,
+                                         int numElements,
+                                         gboolean embedding_on_device) {
+  if (!embedding_data || numElements <= 0) return NULL;
+  if (!embedding_on_device) return embedding_data;
+  if (embedding_scratch_len < numElements) {
+    event_meta_pool_embedding_unref(embedding_scratch);
+    embedding_scratch = event_meta_pool_embedding_new(numElements);
+    embedding_scratch_len = numElements;
+  }
+  cudaMemcpy(embedding_scratch, embedding_data, numElements * sizeof(float),
+             cudaMemcpyDeviceToHost);
+  return embedding_scratch;
+}
 
 static void generate_event_msg_meta(AppCtx *appCtx, gpointer data,
                                     gint class_id, gboolean useTs,
@@ -638,23 +801,33 @@ static void generate_event_msg_meta(AppCtx *appCtx, gpointer data,
   meta->placeId = sensor_id;
   meta->moduleId = sensor_id;
   meta->frameId = frame_meta->frame_num;
-  meta->ts = (gchar *)g_malloc0(MAX_TIME_STAMP_LEN + 1);
-  meta->objectId = (gchar *)g_malloc0(MAX_LABEL_SIZE);
   // embedding_data
-  if (embedding_data) {
-    // printf("Malloc embedding: %d\n", numElements*4);
-    meta->embedding.embedding_vector =
-        (float *)g_malloc0(numElements * sizeof(float));
-    if (embedding_on_device) {
-      cudaMemcpy(meta->embedding.embedding_vector, embedding_data,
-                 numElements * sizeof(float), cudaMemcpyDeviceToHost);
+  const float *host_embedding =
+      stage_host_embedding(embedding_data, numElements, embedding_on_device);
+  meta->embedding.embedding_length = 0;
+  if (host_embedding) {
+    gint ref_frame_num = 0;
+    if (!g_embedding_filter ||
+        embedding_change_filter_check(
+            g_embedding_filter, stream_id, obj_params->object_id,
+            frame_meta->frame_num, host_embedding, numElements,
+            &ref_frame_num)) {
+      if (host_embedding == embedding_scratch) {
+        /** Hand the staged copy over instead of duplicating it */
+        meta->embedding.embedding_vector = embedding_scratch;
+        embedding_scratch = NULL;
+        embedding_scratch_len = 0;
+      } else {
+        meta->embedding.embedding_vector =
+            event_meta_pool_embedding_new(numElements);
+        memcpy(meta->embedding.embedding_vector, host_embedding,
+               numElements * sizeof(float));
+      }
+      meta->embedding.embedding_length = numElements;
     } else {
-      cudaMemcpy(meta->embedding.embedding_vector, embedding_data,
-                 numElements * sizeof(float), cudaMemcpyHostToHost);
+      /** Unchanged since the last event of this track: reference that one */
+      append_other_attr(meta, "embedding_ref_frame=%d", ref_frame_num);
     }
-    meta->embedding.embedding_length = numElements;
-  } else {
-    meta->embedding.embedding_length = 0;
   }
 
   meta->has3DTracking = false;
@@ -733,24 +906,41 @@ static void generate_event_msg_meta(AppCtx *appCtx, gpointer data,
     // g_print(
     //     "this stream [%d:%s] was added using REST API; we have Sensor
     //     Info\n", sensorInfo->source_id, sensorInfo->sensor_id);
-    meta->sensorStr = g_strdup(sensorInfo->sensor_name);
+    event_meta_pool_set_str(meta, &meta->sensorStr, sensorInfo->sensor_name);
   }
   //g_print("sensorId:%d sensorStr:%s \n",meta->sensorId, meta->sensorStr);
   (void)ts_generated;
 
+  /** Few-shot classification against the prototype gallery: the event
+   * carries the matched label instead of the person attributes */
+  if (g_prototype_gallery && host_embedding) {
+    gchar label[MAX_LABEL_SIZE];
+    gfloat score = 0.f;
+    gint class_index = prototype_gallery_classify(
+        g_prototype_gallery, host_embedding, numElements, label,
+        sizeof(label), &score);
+
+    meta->objClassId = class_index;
+    NvDsProductObject *product = event_meta_pool_product(meta);
+    event_meta_pool_set_str(meta, &product->brand, label);
+    event_meta_pool_set_str(meta, &product->type, obj_params->obj_label);
+    append_other_attr(meta, "gallery_score=%.4f", score);
+
+    if (log_level >= LOG_LVL_DEBUG) {
+      g_print("Gallery: stream %d track %lu -> %s (%.4f)\n", stream_id,
+              obj_params->object_id, label, score);
+    }
+    return;
+  }
+
   /*
    * This demonstrates how to attach custom objects.
    * Any custom object as per requirement can be generated and attached
    * like NvDsVehicleObject / NvDsPersonObject. Then that object should
    * be handled in gst-nvmsgconv component accordingly.
    */
-  meta->objType = NVDS_OBJECT_TYPE_PERSON;
-  NvDsPersonObject *obj =
-      (NvDsPersonObject *)g_malloc0(sizeof(NvDsPersonObject));
-  generate_person_meta(obj);
-
-  meta->extMsg = obj;
-  meta->extMsgSize = sizeof(NvDsPersonObject);
+  generate_person_meta(meta);
+  NvDsPersonObject *obj = (NvDsPersonObject *)meta->extMsg;
 
     gchar *image_path = NULL;
   for (NvDsUserMetaList *l_user = obj_params->obj_user_meta_list; l_user != NULL; l_user = l_user->next) {
@@ -762,22 +952,24 @@ static void generate_event_msg_meta(AppCtx *appCtx, gpointer data,
           break; 
         }
       }
-  if (image_path) obj->hair = g_strdup(image_path);
+  if (image_path) event_meta_pool_set_str(meta, &obj->hair, image_path);
 
-  if (!appCtx->config.dsanalytics_config.enable) {
+  AnalyticsUserMeta user_data = {0};
+  if (!get_object_analytics(appCtx, frame_meta, obj_params, stream_id,
+                            &user_data)) {
     g_print("Unable to get nvdsanalytics src pad\n");
     return;
   }
-  AnalyticsUserMeta *user_data =
-      (AnalyticsUserMeta *)g_malloc0(sizeof(AnalyticsUserMeta));
-  analytics_custom_parse_direction_obj_data(obj_params, user_data);
-  if (user_data->direction != NULL) {
+  if (user_data.direction != NULL) {
 
-  obj->gender = g_strdup(user_data->direction);
-  obj->cap = g_strdup("Crossed");
+  event_meta_pool_set_str(meta, &obj->gender, user_data.direction);
+  event_meta_pool_set_str(meta, &obj->cap, "Crossed");
 
     // meta->extMsgSize = sizeof(AnalyticsUserMeta);
   } 
+  set_analytics_counts(meta, stream_id, user_data.occupancy,
+                       user_data.lccum_cnt_entry, user_data.lccum_cnt_exit);
+  set_analytics_roi(meta, stream_id, user_data.roi_mask);
   // if (terminated_id) {
 
   //   meta->type = NVDS_EVENT_STOPPED;
@@ -790,6 +982,502 @@ static void generate_event_msg_meta(AppCtx *appCtx, gpointer data,
   //   meta->extMsgSize = sizeof(NvDsPersonObject);
   // } 
 }
+
+/**
+ * STOPPED event for a track the tracker terminated, located at the last
+ * box reported for it
+ */
+static void generate_terminated_event_msg_meta(AppCtx *appCtx,
+                                               NvDsEventMsgMeta *meta,
+                                               gint stream_id,
+                                               NvDsFrameMeta *frame_meta,
+                                               guint64 object_id,
+                                               const float *bbox,
+                                               GstClockTime ts) {
+  meta->type = NVDS_EVENT_STOPPED;
+  meta->objType = NVDS_OBJECT_TYPE_UNKNOWN;
+  meta->sensorId = stream_id;
+  meta->placeId = stream_id;
+  meta->moduleId = stream_id;
+  meta->frameId = frame_meta->frame_num;
+  meta->trackingId = object_id;
+
+  float scaleW = 1, scaleH = 1;
+  if (appCtx->config.streammux_config.pipeline_width &&
+      appCtx->config.streammux_config.pipeline_height) {
+    scaleW = (float)frame_meta->source_frame_width /
+             appCtx->config.streammux_config.pipeline_width;
+    scaleH = (float)frame_meta->source_frame_height /
+             appCtx->config.streammux_config.pipeline_height;
+  }
+  meta->bbox.left = bbox[0] * scaleW;
+  meta->bbox.top = bbox[1] * scaleH;
+  meta->bbox.width = bbox[2] * scaleW;
+  meta->bbox.height = bbox[3] * scaleH;
+
+  generate_ts_rfc3339_from_ts(meta->ts, MAX_TIME_STAMP_LEN, ts,
+                              appCtx->config.multi_source_config[stream_id].uri,
+                              stream_id);
+
+  NvDsSensorInfo *sensorInfo = get_sensor_info(appCtx, stream_id);
+  if (sensorInfo) {
+    event_meta_pool_set_str(meta, &meta->sensorStr, sensorInfo->sensor_name);
+  }
+
+  generate_person_meta(meta);
+  NvDsPersonObject *obj = (NvDsPersonObject *)meta->extMsg;
+  event_meta_pool_set_str(meta, &obj->cap, "Terminated");
+  append_other_attr(meta, "emit=terminated");
+}
+
+static const char *dwell_end_name(guint8 end) {
+  switch (end) {
+  case DWELL_END_EXIT:
+    return "exit";
+  case DWELL_END_TERMINATED:
+    return "terminated";
+  default:
+    return "expired";
+  }
+}
+
+/** ROI, entry time, dwell time and how a visit ended, as attributes */
+static void set_dwell_attrs(NvDsEventMsgMeta *meta, const DwellVisit *visit) {
+  char enter[MAX_TIME_STAMP_LEN];
+  format_ts_rfc3339(enter, sizeof(enter), visit->enter_ns);
+  const char *roi = line_cross_engine_roi_label(
+      g_line_cross_engine, visit->stream_id, 1u << visit->roi);
+  append_other_attr(meta,
+                    "emit=dwell;roi=%s;enter=%s;dwell_ms=%" G_GUINT64_FORMAT
+                    ";end=%s",
+                    roi ? roi : "", enter,
+                    (guint64)((visit->exit_ns - visit->enter_ns) / GST_MSECOND),
+                    dwell_end_name(visit->end));
+}
+
+/**
+ * One EXIT event per finished ROI visit (--dwell-events), timestamped with
+ * the end of the visit; times of @a visit are UTC
+ */
+static void generate_dwell_event_msg_meta(AppCtx *appCtx,
+                                          NvDsEventMsgMeta *meta,
+                                          NvDsFrameMeta *frame_meta,
+                                          const DwellVisit *visit) {
+  meta->type = NVDS_EVENT_EXIT;
+  meta->objType = NVDS_OBJECT_TYPE_UNKNOWN;
+  meta->sensorId = visit->stream_id;
+  meta->placeId = visit->stream_id;
+  meta->moduleId = visit->stream_id;
+  meta->frameId = frame_meta->frame_num;
+  meta->trackingId = visit->object_id;
+  format_ts_rfc3339(meta->ts, MAX_TIME_STAMP_LEN, visit->exit_ns);
+
+  NvDsSensorInfo *sensorInfo = get_sensor_info(appCtx, visit->stream_id);
+  if (sensorInfo) {
+    event_meta_pool_set_str(meta, &meta->sensorStr, sensorInfo->sensor_name);
+  }
+
+  generate_person_meta(meta);
+  NvDsPersonObject *obj = (NvDsPersonObject *)meta->extMsg;
+  event_meta_pool_set_str(meta, &obj->cap, "Dwell");
+  set_dwell_attrs(meta, visit);
+}
+
+/**
+ * --async-events: build on a worker thread the event of a snapshot taken by
+ * queue_event_snapshot(), with the same fields and attributes as
+ * generate_event_msg_meta() / generate_terminated_event_msg_meta()
+ */
+static void fill_event_msg_meta_from_snapshot(NvDsEventMsgMeta *meta,
+                                              const EventSnapshotView *view,
+                                              void *user_data) {
+  const EventSnapshot *snapshot = view->snapshot;
+  (void)user_data;
+
+  meta->type = (NvDsEventType)snapshot->event_type;
+  meta->objType = NVDS_OBJECT_TYPE_UNKNOWN;
+  meta->sensorId = snapshot->stream_id;
+  meta->placeId = snapshot->stream_id;
+  meta->moduleId = snapshot->stream_id;
+  meta->frameId = snapshot->frame_num;
+  meta->trackingId = snapshot->object_id;
+  meta->confidence = snapshot->confidence;
+  meta->bbox.left = snapshot->bbox[0];
+  meta->bbox.top = snapshot->bbox[1];
+  meta->bbox.width = snapshot->bbox[2];
+  meta->bbox.height = snapshot->bbox[3];
+  format_ts_rfc3339(meta->ts, MAX_TIME_STAMP_LEN, snapshot->utc_ns);
+  if (view->sensor) {
+    event_meta_pool_set_str(meta, &meta->sensorStr, view->sensor);
+  }
+
+  if (snapshot->event_type == NVDS_EVENT_STOPPED) {
+    generate_person_meta(meta);
+    NvDsPersonObject *obj = (NvDsPersonObject *)meta->extMsg;
+    event_meta_pool_set_str(meta, &obj->cap, "Terminated");
+    append_other_attr(meta, "emit=terminated");
+    return;
+  }
+  if (snapshot->event_type == NVDS_EVENT_EXIT) {
+    DwellVisit visit = {0};
+    visit.object_id = snapshot->object_id;
+    visit.enter_ns = snapshot->dwell_enter_ns;
+    visit.exit_ns = snapshot->utc_ns;
+    visit.stream_id = snapshot->stream_id;
+    visit.roi = snapshot->roi_mask ? __builtin_ctz(snapshot->roi_mask) : 0;
+    visit.end = snapshot->dwell_end;
+    generate_person_meta(meta);
+    NvDsPersonObject *obj = (NvDsPersonObject *)meta->extMsg;
+    event_meta_pool_set_str(meta, &obj->cap, "Dwell");
+    set_dwell_attrs(meta, &visit);
+    return;
+  }
+
+  if (view->label) {
+    strncpy(meta->objectId, view->label, MAX_LABEL_SIZE);
+  }
+  if (view->embedding && snapshot->embedding_ref_frame < 0) {
+    meta->embedding.embedding_vector =
+        event_meta_pool_embedding_new(view->num_elements);
+    memcpy(meta->embedding.embedding_vector, view->embedding,
+           view->num_elements * sizeof(float));
+    meta->embedding.embedding_length = view->num_elements;
+  } else if (snapshot->embedding_ref_frame >= 0) {
+    append_other_attr(meta, "embedding_ref_frame=%d",
+                      snapshot->embedding_ref_frame);
+  }
+
+  if (g_prototype_gallery && view->embedding) {
+    gchar label[MAX_LABEL_SIZE];
+    gfloat score = 0.f;
+    meta->objClassId = prototype_gallery_classify(
+        g_prototype_gallery, view->embedding, view->num_elements, label,
+        sizeof(label), &score);
+    NvDsProductObject *product = event_meta_pool_product(meta);
+    event_meta_pool_set_str(meta, &product->brand, label);
+    event_meta_pool_set_str(meta, &product->type,
+                            view->label ? view->label : "");
+    append_other_attr(meta, "gallery_score=%.4f", score);
+  } else {
+    generate_person_meta(meta);
+    NvDsPersonObject *obj = (NvDsPersonObject *)meta->extMsg;
+    if (view->image_path) {
+      event_meta_pool_set_str(meta, &obj->hair, view->image_path);
+    }
+    if (view->direction) {
+      event_meta_pool_set_str(meta, &obj->gender, view->direction);
+      event_meta_pool_set_str(meta, &obj->cap, "Crossed");
+    }
+    if (snapshot->has_line_counts) {
+      set_analytics_counts(meta, snapshot->stream_id, snapshot->occupancy,
+                           snapshot->lccum_entry, snapshot->lccum_exit);
+      set_analytics_roi(meta, snapshot->stream_id, snapshot->roi_mask);
+    }
+  }
+  if (snapshot->emit_reason && g_emission_policy) {
+    append_other_attr(meta, "emit=%s",
+                      emission_policy_reason_name(snapshot->emit_reason));
+  }
+}
+
+/**
+ * --async-events: copy what the event of an object needs into the worker
+ * pool instead of building it here. The embedding change filter still runs
+ * on this thread, since it tracks per-track state in frame order.
+ */
+static void queue_event_snapshot(AppCtx *appCtx, NvDsFrameMeta *frame_meta,
+                                 NvDsObjectMeta *obj_params, GstClockTime ts,
+                                 float scaleW, float scaleH,
+                                 float *embedding_data, int numElements,
+                                 gboolean embedding_on_device,
+                                 gint emit_reason) {
+  gint stream_id = frame_meta->source_id;
+  EventSnapshot snapshot = {0};
+  snapshot.object_id = obj_params->object_id;
+  snapshot.utc_ns = compute_utc_from_ts(
+      ts, appCtx->config.multi_source_config[stream_id].uri, stream_id);
+  snapshot.frame_pts = frame_meta->buf_pts;
+  snapshot.frame_num = frame_meta->frame_num;
+  snapshot.class_id = obj_params->class_id;
+  snapshot.embedding_ref_frame = -1;
+  snapshot.stream_id = stream_id;
+  snapshot.event_type = NVDS_EVENT_ENTRY;
+  snapshot.emit_reason = emit_reason;
+  snapshot.confidence = obj_params->confidence;
+  snapshot.bbox[0] = obj_params->rect_params.left * scaleW;
+  snapshot.bbox[1] = obj_params->rect_params.top * scaleH;
+  snapshot.bbox[2] = obj_params->rect_params.width * scaleW;
+  snapshot.bbox[3] = obj_params->rect_params.height * scaleH;
+
+  const float *host_embedding =
+      stage_host_embedding(embedding_data, numElements, embedding_on_device);
+  if (host_embedding && g_embedding_filter) {
+    gint ref_frame_num = 0;
+    if (!embedding_change_filter_check(
+            g_embedding_filter, stream_id, obj_params->object_id,
+            frame_meta->frame_num, host_embedding, numElements,
+            &ref_frame_num)) {
+      snapshot.embedding_ref_frame = ref_frame_num;
+      /** Still needed by the gallery, else not worth copying */
+      if (!g_prototype_gallery) host_embedding = NULL;
+    }
+  }
+
+  gchar *image_path = NULL;
+  for (NvDsUserMetaList *l_user = obj_params->obj_user_meta_list;
+       l_user != NULL; l_user = l_user->next) {
+    NvDsUserMeta *user_meta = (NvDsUserMeta *)l_user->data;
+    if (user_meta->base_meta.meta_type == NVDS_CUSTOM_IMAGE_PATH_META) {
+      image_path = ((NvDsImagePathMeta *)user_meta->user_meta_data)->image_path;
+      break;
+    }
+  }
+  AnalyticsUserMeta user_data = {0};
+  if (get_object_analytics(appCtx, frame_meta, obj_params, stream_id,
+                           &user_data)) {
+    snapshot.has_line_counts = 1;
+    snapshot.occupancy = user_data.occupancy;
+    snapshot.lccum_entry = user_data.lccum_cnt_entry;
+    snapshot.lccum_exit = user_data.lccum_cnt_exit;
+    snapshot.roi_mask = user_data.roi_mask;
+  }
+  NvDsSensorInfo *sensorInfo = get_sensor_info(appCtx, stream_id);
+
+  event_worker_pool_add(g_event_worker_pool, &snapshot, host_embedding,
+                        host_embedding ? numElements : 0,
+                        obj_params->obj_label, image_path, user_data.direction,
+                        sensorInfo ? sensorInfo->sensor_name : NULL);
+}
+
+/** --async-events counterpart of generate_terminated_event_msg_meta() */
+static void queue_terminated_event_snapshot(AppCtx *appCtx,
+                                            NvDsFrameMeta *frame_meta,
+                                            guint64 object_id,
+                                            const float *bbox,
+                                            GstClockTime ts) {
+  gint stream_id = frame_meta->source_id;
+  EventSnapshot snapshot = {0};
+  snapshot.object_id = object_id;
+  snapshot.utc_ns = compute_utc_from_ts(
+      ts, appCtx->config.multi_source_config[stream_id].uri, stream_id);
+  snapshot.frame_pts = frame_meta->buf_pts;
+  snapshot.frame_num = frame_meta->frame_num;
+  snapshot.class_id = -1;
+  snapshot.embedding_ref_frame = -1;
+  snapshot.stream_id = stream_id;
+  snapshot.event_type = NVDS_EVENT_STOPPED;
+
+  float scaleW = 1, scaleH = 1;
+  if (appCtx->config.streammux_config.pipeline_width &&
+      appCtx->config.streammux_config.pipeline_height) {
+    scaleW = (float)frame_meta->source_frame_width /
+             appCtx->config.streammux_config.pipeline_width;
+    scaleH = (float)frame_meta->source_frame_height /
+             appCtx->config.streammux_config.pipeline_height;
+  }
+  snapshot.bbox[0] = bbox[0] * scaleW;
+  snapshot.bbox[1] = bbox[1] * scaleH;
+  snapshot.bbox[2] = bbox[2] * scaleW;
+  snapshot.bbox[3] = bbox[3] * scaleH;
+
+  NvDsSensorInfo *sensorInfo = get_sensor_info(appCtx, stream_id);
+  event_worker_pool_add(g_event_worker_pool, &snapshot, NULL, 0, NULL, NULL,
+                        NULL, sensorInfo ? sensorInfo->sensor_name : NULL);
+}
+
+/** --async-events counterpart of generate_dwell_event_msg_meta() */
+static void queue_dwell_event_snapshot(AppCtx *appCtx,
+                                       NvDsFrameMeta *frame_meta,
+                                       const DwellVisit *visit) {
+  EventSnapshot snapshot = {0};
+  snapshot.object_id = visit->object_id;
+  snapshot.utc_ns = visit->exit_ns;
+  snapshot.frame_pts = frame_meta->buf_pts;
+  snapshot.frame_num = frame_meta->frame_num;
+  snapshot.class_id = -1;
+  snapshot.embedding_ref_frame = -1;
+  snapshot.stream_id = visit->stream_id;
+  snapshot.event_type = NVDS_EVENT_EXIT;
+  snapshot.roi_mask = 1u << visit->roi;
+  snapshot.dwell_enter_ns = visit->enter_ns;
+  snapshot.dwell_end = visit->end;
+
+  NvDsSensorInfo *sensorInfo = get_sensor_info(appCtx, visit->stream_id);
+  event_worker_pool_add(g_event_worker_pool, &snapshot, NULL, 0, NULL, NULL,
+                        NULL, sensorInfo ? sensorInfo->sensor_name : NULL);
+}
+
+static gpointer payload_meta_copy_func(gpointer data, gpointer user_data) {
+  NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
+  NvDsPayload *src = (NvDsPayload *)user_meta->user_meta_data;
+  NvDsPayload *dst = (NvDsPayload *)g_malloc0(sizeof(NvDsPayload));
+  *dst = *src;
+  dst->payload = malloc(src->payloadSize);
+  memcpy(dst->payload, src->payload, src->payloadSize);
+  return dst;
+}
+
+static void payload_meta_free_func(gpointer data, gpointer user_data) {
+  NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
+  NvDsPayload *payload = (NvDsPayload *)user_meta->user_meta_data;
+  free(payload->payload);
+  g_free(payload);
+  user_meta->user_meta_data = NULL;
+}
+
+/**
+ * Attach a ready message to the frame as NVDS_PAYLOAD_META, which
+ * nvmsgbroker sends as is. Takes ownership of the malloc'ed @a data.
+ */
+static void attach_payload_meta(NvDsBatchMeta *batch_meta,
+                                NvDsFrameMeta *frame_meta, gchar *data,
+                                gsize size) {
+  NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool(batch_meta);
+  if (!user_meta) {
+    if (log_level >= LOG_LVL_ERROR) {
+      g_print("Error in attaching payload meta to buffer\n");
+    }
+    free(data);
+    return;
+  }
+  NvDsPayload *payload = (NvDsPayload *)g_malloc0(sizeof(NvDsPayload));
+  payload->payload = data;
+  payload->payloadSize = size;
+  user_meta->user_meta_data = payload;
+  user_meta->base_meta.batch_meta = batch_meta;
+  user_meta->base_meta.meta_type = NVDS_PAYLOAD_META;
+  user_meta->base_meta.copy_func = (NvDsMetaCopyFunc)payload_meta_copy_func;
+  user_meta->base_meta.release_func =
+      (NvDsMetaReleaseFunc)payload_meta_free_func;
+  nvds_add_user_meta_to_frame(frame_meta, user_meta);
+}
+
+static void emit_event_msg_meta(NvDsBatchMeta *batch_meta,
+                                NvDsFrameMeta *frame_meta,
+                                NvDsEventMsgMeta *msg_meta);
+
+/** Send the events of finished ROI visits */
+static void emit_dwell_visits(AppCtx *appCtx, NvDsBatchMeta *batch_meta,
+                              NvDsFrameMeta *frame_meta,
+                              const DwellVisit *visits, guint num_visits) {
+  for (guint i = 0; i < num_visits; i++) {
+    if (g_event_worker_pool) {
+      queue_dwell_event_snapshot(appCtx, frame_meta, &visits[i]);
+      continue;
+    }
+    NvDsEventMsgMeta *msg_meta = event_meta_pool_acquire();
+    generate_dwell_event_msg_meta(appCtx, msg_meta, frame_meta, &visits[i]);
+    emit_event_msg_meta(batch_meta, frame_meta, msg_meta);
+  }
+}
+
+/**
+ * ROI visits of the objects processed by line_cross_process_frame(): the
+ * visits they ended on this frame, and those of objects lost for
+ * --dwell-expiry
+ */
+static void dwell_process_frame(AppCtx *appCtx, NvDsBatchMeta *batch_meta,
+                                NvDsFrameMeta *frame_meta, GstClockTime ts) {
+  guint stream_id = frame_meta->source_id;
+  guint num_rois = line_cross_engine_num_rois(g_line_cross_engine, stream_id);
+  if (num_rois == 0) {
+    return;
+  }
+  GstClockTime utc = compute_utc_from_ts(
+      ts, appCtx->config.multi_source_config[stream_id].uri, stream_id);
+  DwellVisit visits[DWELL_MAX_ROIS];
+  for (guint i = 0; i < line_cross_num_objects; i++) {
+    guint num_visits = dwell_tracker_update(
+        g_dwell_tracker, stream_id, line_cross_objects[i].object_id,
+        line_cross_results[i].roi_mask, num_rois, utc, visits);
+    emit_dwell_visits(appCtx, batch_meta, frame_meta, visits, num_visits);
+  }
+  guint num_visits;
+  do {
+    num_visits = dwell_tracker_expire(g_dwell_tracker, stream_id, utc, visits,
+                                      DWELL_MAX_ROIS);
+    emit_dwell_visits(appCtx, batch_meta, frame_meta, visits, num_visits);
+  } while (num_visits == DWELL_MAX_ROIS);
+}
+
+/**
+ * Bin the objects of a frame into the occupancy heatmap of its stream, and
+ * attach the heatmap message when the stream's window is due
+ */
+static void heatmap_process_frame(NvDsBatchMeta *batch_meta,
+                                  NvDsFrameMeta *frame_meta,
+                                  GstClockTime ts) {
+  if (frame_meta->num_obj_meta * 4 > heatmap_boxes_len) {
+    heatmap_boxes_len = frame_meta->num_obj_meta * 8;
+    g_free(heatmap_boxes);
+    heatmap_boxes = g_new(float, heatmap_boxes_len);
+  }
+  guint num_boxes = 0;
+  for (NvDsMetaList *l_obj = frame_meta->obj_meta_list;
+       l_obj != NULL && (num_boxes + 1) * 4 <= heatmap_boxes_len;
+       l_obj = l_obj->next) {
+    NvDsObjectMeta *obj_meta = (NvDsObjectMeta *)l_obj->data;
+    if (model_used == APP_CONFIG_ANALYTICS_MTMC &&
+        obj_meta->class_id != target_class) {
+      continue;
+    }
+    float *box = &heatmap_boxes[4 * num_boxes++];
+    box[0] = obj_meta->rect_params.left;
+    box[1] = obj_meta->rect_params.top;
+    box[2] = obj_meta->rect_params.width;
+    box[3] = obj_meta->rect_params.height;
+  }
+  guint stream_id = frame_meta->source_id;
+  occupancy_heatmap_add_frame(g_occupancy_heatmap, stream_id,
+                              frame_meta->buf_pts, heatmap_boxes, num_boxes);
+  gchar *payload = NULL;
+  gsize payload_size = 0;
+  GstClockTime utc = compute_utc_from_ts(
+      ts, appCtx[0]->config.multi_source_config[stream_id].uri, stream_id);
+  if (occupancy_heatmap_flush(g_occupancy_heatmap, stream_id, stream_id,
+                              frame_meta->buf_pts, utc, FALSE, &payload,
+                              &payload_size)) {
+    attach_payload_meta(batch_meta, frame_meta, payload, payload_size);
+  }
+}
+
+/**
+ * Hand an event over: serialized into the batch of its stream when batching
+ * is enabled, else attached to the frame. The meta is released if it cannot
+ * be attached.
+ */
+static void emit_event_msg_meta(NvDsBatchMeta *batch_meta,
+                                NvDsFrameMeta *frame_meta,
+                                NvDsEventMsgMeta *msg_meta) {
+  if (g_event_batcher) {
+    event_batcher_add(g_event_batcher, frame_meta->source_id, msg_meta,
+                      frame_meta->buf_pts);
+    event_meta_pool_release(msg_meta);
+    return;
+  }
+  NvDsUserMeta *user_event_meta = nvds_acquire_user_meta_from_pool(batch_meta);
+  if (user_event_meta) {
+    /*
+     * Since generated event metadata has custom objects for
+     * Vehicle / Person which are allocated dynamically, we are
+     * setting copy and free function to handle those fields when
+     * metadata copy happens between two components.
+     */
+    user_event_meta->user_meta_data = (void *)msg_meta;
+    user_event_meta->base_meta.batch_meta = batch_meta;
+    user_event_meta->base_meta.meta_type = NVDS_EVENT_MSG_META;
+    user_event_meta->base_meta.copy_func = (NvDsMetaCopyFunc)meta_copy_func;
+    user_event_meta->base_meta.release_func =
+        (NvDsMetaReleaseFunc)meta_free_func;
+    nvds_add_user_meta_to_frame(frame_meta, user_event_meta);
+  } else {
+    if (log_level >= LOG_LVL_ERROR) {
+      g_print("Error in attaching event meta to buffer\n");
+    }
+    event_meta_pool_release(msg_meta);
+  }
+}
+
 void after_pgie_image_meta_save(AppCtx *appCtx, GstBuffer *buf,
                                 NvDsBatchMeta *batch_meta, guint index,
                                 ImageMetaConsumerWrapper *consumer);
@@ -817,11 +1505,11 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
   // NvDsReidTensorBatch *pReidTensor = NULL;
   NvDsObjReid *pReidObj = NULL;
   NvDsTargetMiscDataBatch *pTrackerObj = NULL;
-  if (use_tracker_reid) {
+  {
     for (NvDsUserMetaList *l_batch_user = batch_meta->batch_user_meta_list;
          l_batch_user != NULL; l_batch_user = l_batch_user->next) {
       NvDsUserMeta *user_meta = (NvDsUserMeta *)l_batch_user->data;
-      if (user_meta &&
+      if (use_tracker_reid && user_meta &&
           user_meta->base_meta.meta_type == NVDS_TRACKER_BATCH_REID_META) {
         // pReidTensor = (NvDsReidTensorBatch *) (user_meta->user_meta_data);
         pReidObj = (NvDsObjReid *)(user_meta->user_meta_data);
@@ -835,7 +1523,10 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
             
             for (uint32_t j = 0; j < stream->numFilled; ++j) {
               NvDsTargetMiscDataObject *obj = &stream->list[j];
-              g_print("StreamID %u: Terminated Unique ID: %lu\n", stream->streamID, obj->uniqueId);
+              if (log_level >= LOG_LVL_INFO) {
+                g_print("StreamID %u: Terminated Unique ID: %lu\n", stream->streamID, obj->uniqueId);
+              }
+              embedding_change_filter_forget(g_embedding_filter, stream->streamID, obj->uniqueId);
             }
             }
           }
@@ -883,6 +1574,12 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
       src_stream->last_ntp_time = buf_ntp_time;
     }
 
+    if (g_line_cross_engine) {
+      line_cross_process_frame(frame_meta);
+    } else if (appCtx->config.dsanalytics_config.enable) {
+      analytics_count_frame(frame_meta);
+    }
+
     FrameEmbedding *frame_embedding = NULL;
     if (use_tracker_reid && tracker_reid_store_age > 0) {
       pop_embedding_queue(stream_id, frame_meta->frame_num);
@@ -899,7 +1596,30 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
           obj_meta->class_id != target_class) {
         continue;
       }
-      if (!(frame_meta->frame_num % message_rate)) {
+      gint emit_reason = 0;
+      if (g_emission_policy) {
+        float bbox[4] = {obj_meta->rect_params.left, obj_meta->rect_params.top,
+                         obj_meta->rect_params.width,
+                         obj_meta->rect_params.height};
+        gboolean line_crossed = FALSE;
+        if (g_line_cross_engine) {
+          LineCrossResult result;
+          line_crossed = line_cross_engine_object(g_line_cross_engine,
+                                                  stream_id, obj_meta->object_id,
+                                                  frame_meta->frame_num,
+                                                  &result) &&
+                         result.line != NULL;
+        } else if (appCtx->config.dsanalytics_config.enable) {
+          line_crossed = analytics_obj_line_crossed(obj_meta);
+        }
+        emit_reason = emission_policy_check(g_emission_policy, stream_id,
+                                            frame_meta->frame_num,
+                                            obj_meta->object_id, bbox,
+                                            line_crossed);
+      } else {
+        emit_reason = !(frame_meta->frame_num % message_rate);
+      }
+      if (emit_reason) {
         /**
          * Enable only if this callback is after tiler
          * NOTE: Scaling back code-commented
@@ -1008,8 +1728,16 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
             obj_meta->object_id, &numElements);
         }
 
+        if (g_event_worker_pool) {
+          queue_event_snapshot(appCtx, frame_meta, obj_meta, buffer_pts,
+                               scaleW, scaleH, embedding_data, numElements,
+                               embedding_on_device, emit_reason);
+          testAppCtx->streams[stream_id].meta_number++;
+          continue;
+        }
+
         /** Generate NvDsEventMsgMeta for every object */
-        NvDsEventMsgMeta *msg_meta = (NvDsEventMsgMeta *) g_malloc0(sizeof(NvDsEventMsgMeta));
+        NvDsEventMsgMeta *msg_meta = event_meta_pool_acquire();
         generate_event_msg_meta(
             appCtx, msg_meta, obj_meta->class_id, TRUE,
             /**< useTs NOTE: Pass FALSE for files without base-timestamp in URI
@@ -1017,6 +1745,10 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
             buffer_pts, appCtx->config.multi_source_config[stream_id].uri,
             stream_id, stream_id, obj_meta, scaleW, scaleH, frame_meta,
             embedding_data, numElements, embedding_on_device);
+        if (g_emission_policy) {
+          append_other_attr(msg_meta, "emit=%s",
+                            emission_policy_reason_name(emit_reason));
+        }
         if (log_level == 99 || log_level == 100) {
           g_print("[DEBUG]: Timestamp after msg meta creation: %s\n",
                   msg_meta->ts);
@@ -1031,31 +1763,69 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
         }
 
         testAppCtx->streams[stream_id].meta_number++;
-        NvDsUserMeta *user_event_meta =
-            nvds_acquire_user_meta_from_pool(batch_meta);
-        if (user_event_meta) {
-          /*
-           * Since generated event metadata has custom objects for
-           * Vehicle / Person which are allocated dynamically, we are
-           * setting copy and free function to handle those fields when
-           * metadata copy happens between two components.
-           */
-          user_event_meta->user_meta_data = (void *)msg_meta;
-          user_event_meta->base_meta.batch_meta = batch_meta;
-          user_event_meta->base_meta.meta_type = NVDS_EVENT_MSG_META;
-          user_event_meta->base_meta.copy_func =
-              (NvDsMetaCopyFunc)meta_copy_func;
-          user_event_meta->base_meta.release_func =
-              (NvDsMetaReleaseFunc)meta_free_func;
-          nvds_add_user_meta_to_frame(frame_meta, user_event_meta);
-        } else {
-          if (log_level >= LOG_LVL_ERROR) {
-            g_print("Error in attaching event meta to buffer\n");
+        emit_event_msg_meta(batch_meta, frame_meta, msg_meta);
+      }
+    }
+
+    if (g_dwell_tracker) {
+      dwell_process_frame(appCtx, batch_meta, frame_meta,
+                          playback_utc ? frame_meta->buf_pts : buf_ntp_time);
+    }
+
+    /** Tracks of this stream the tracker ended: one STOPPED event each, and
+     * the end of their ROI visits */
+    if ((g_emission_policy || g_dwell_tracker) && pTrackerObj) {
+      GstClockTime ts = playback_utc ? frame_meta->buf_pts : buf_ntp_time;
+      guint num_rois =
+          line_cross_engine_num_rois(g_line_cross_engine, stream_id);
+      for (uint32_t i = 0; i < pTrackerObj->numFilled; ++i) {
+        NvDsTargetMiscDataStream *stream = &pTrackerObj->list[i];
+        if (stream->streamID != stream_id) continue;
+        for (uint32_t j = 0; j < stream->numFilled; ++j) {
+          float bbox[4];
+          if (g_dwell_tracker) {
+            DwellVisit visits[DWELL_MAX_ROIS];
+            guint num_visits = dwell_tracker_terminate(
+                g_dwell_tracker, stream_id, stream->list[j].uniqueId,
+                num_rois, visits);
+            emit_dwell_visits(appCtx, batch_meta, frame_meta, visits,
+                              num_visits);
+          }
+          if (!g_emission_policy ||
+              !emission_policy_terminate(g_emission_policy, stream_id,
+                                         stream->list[j].uniqueId, bbox)) {
+            continue;
           }
+          if (g_event_worker_pool) {
+            queue_terminated_event_snapshot(appCtx, frame_meta,
+                                            stream->list[j].uniqueId, bbox,
+                                            ts);
+            continue;
+          }
+          NvDsEventMsgMeta *msg_meta = event_meta_pool_acquire();
+          generate_terminated_event_msg_meta(appCtx, msg_meta, stream_id,
+                                             frame_meta,
+                                             stream->list[j].uniqueId, bbox,
+                                             ts);
+          emit_event_msg_meta(batch_meta, frame_meta, msg_meta);
         }
       }
     }
 
+    if (g_occupancy_heatmap) {
+      heatmap_process_frame(batch_meta, frame_meta,
+                            playback_utc ? frame_meta->buf_pts : buf_ntp_time);
+    }
+
+    if (g_event_batcher) {
+      gchar *payload = NULL;
+      gsize payload_size = 0;
+      if (event_batcher_flush(g_event_batcher, stream_id, frame_meta->buf_pts,
+                              FALSE, &payload, &payload_size)) {
+        attach_payload_meta(batch_meta, frame_meta, payload, payload_size);
+      }
+    }
+
     if (use_tracker_reid && tracker_reid_store_age > 0 && frame_embedding) {
       push_to_embedding_queue(stream_id, frame_embedding);
     }
@@ -1098,6 +1868,11 @@ static void bbox_generated_probe_after_analytics(AppCtx *appCtx, GstBuffer *buf,
 
     testAppCtx->streams[stream_id].frameCount++;
   }
+
+  /** One batch per probe call: the workers take it from here */
+  if (g_event_worker_pool) {
+    event_worker_pool_submit(g_event_worker_pool);
+  }
 }
 
 /** TransferLearning */
@@ -1227,6 +2002,21 @@ static gboolean check_for_interrupt(gpointer data) {
   return TRUE;
 }
 
+/**
+ * Periodic summary of the line crossings, in place of a log line per object
+ */
+static gboolean analytics_summary_cb(gpointer data) {
+  if (quit) {
+    return FALSE;
+  }
+  if (g_line_cross_engine) {
+    line_cross_engine_print_summary(g_line_cross_engine);
+  } else {
+    analytics_print_summary();
+  }
+  return TRUE;
+}
+
 /*
  * Function to install custom handler for program interrupt signal.
  */
@@ -1933,6 +2723,117 @@ int main(int argc, char *argv[]) {
                  "buffer-pool-size", STREAMMUX_BUFFER_POOL_SIZE, NULL);
   }
   g_img_meta_consumer = create_image_meta_consumer();
+  if (gallery_file) {
+    g_prototype_gallery = create_prototype_gallery();
+    if (!prototype_gallery_load(g_prototype_gallery, gallery_file,
+                                gallery_threshold)) {
+      fprintf(stderr, "Could not load gallery %s => exiting...\n\n",
+              gallery_file);
+      return_value = -1;
+      goto done;
+    }
+    if (gallery_save_file &&
+        !prototype_gallery_save(g_prototype_gallery, gallery_save_file,
+                                gallery_save_fp16)) {
+      fprintf(stderr, "Could not save gallery to %s\n", gallery_save_file);
+    }
+    if (gallery_watch &&
+        !prototype_gallery_watch(g_prototype_gallery, gallery_file)) {
+      fprintf(stderr, "Could not watch gallery %s for updates\n",
+              gallery_file);
+    }
+  }
+  if (async_events > 0) {
+    /** The workers send through the broker settings of the msgconv/msgbroker
+     * sink, which is expected to be disabled */
+    NvDsSinkMsgConvBrokerConfig *broker = NULL;
+    for (i = 0; i < appCtx[0]->config.num_sink_sub_bins; i++) {
+      if (appCtx[0]->config.sink_bin_sub_bin_config[i].type ==
+          NV_DS_SINK_MSG_CONV_BROKER) {
+        broker =
+            &appCtx[0]->config.sink_bin_sub_bin_config[i].msg_conv_broker_config;
+        break;
+      }
+    }
+    if (!broker || !broker->proto_lib || !broker->conn_str || !broker->topic) {
+      fprintf(stderr, "--async-events needs a [sink] of type=6 with "
+                      "msg-broker-proto-lib, msg-broker-conn-str and topic "
+                      "=> exiting...\n\n");
+      return_value = -1;
+      goto done;
+    }
+    EventWorkerPoolConfig pool_config = {0};
+    pool_config.num_workers = async_events;
+    pool_config.max_pending_batches = async_events_queue;
+    pool_config.batch_interval_ms = event_batch_interval;
+    pool_config.batch_max_objects = event_batch_max_objects;
+    pool_config.binary = payload_format == 1;
+    pool_config.proto_lib = broker->proto_lib;
+    pool_config.conn_str = broker->conn_str;
+    pool_config.proto_config = broker->config_file_path;
+    pool_config.topic = broker->topic;
+    pool_config.fill = fill_event_msg_meta_from_snapshot;
+    g_event_worker_pool = create_event_worker_pool(&pool_config);
+    if (!g_event_worker_pool) {
+      fprintf(stderr, "Could not start the event workers => exiting...\n\n");
+      return_value = -1;
+      goto done;
+    }
+  } else if (event_batch || payload_format == 1) {
+    g_event_batcher = create_event_batcher(
+        event_batch_interval, event_batch_max_objects, payload_format == 1);
+  }
+  if (line_cross_config) {
+    g_line_cross_engine = create_line_cross_engine(
+        line_cross_config, appCtx[0]->config.streammux_config.pipeline_width,
+        appCtx[0]->config.streammux_config.pipeline_height);
+    if (!g_line_cross_engine) {
+      fprintf(stderr, "Could not load --line-cross-config %s => exiting...\n\n",
+              line_cross_config);
+      return_value = -1;
+      goto done;
+    }
+  }
+  if (dwell_events) {
+    if (!g_line_cross_engine) {
+      fprintf(stderr, "--dwell-events needs the ROIs of --line-cross-config "
+                      "=> exiting...\n\n");
+      return_value = -1;
+      goto done;
+    }
+    g_dwell_tracker = create_dwell_tracker(dwell_max_visits, dwell_expiry);
+  }
+  if (heatmap_interval > 0) {
+    g_occupancy_heatmap = create_occupancy_heatmap(
+        appCtx[0]->config.streammux_config.pipeline_width,
+        appCtx[0]->config.streammux_config.pipeline_height, heatmap_cell,
+        heatmap_interval * 1000);
+    if (!g_occupancy_heatmap) {
+      fprintf(stderr, "Invalid --heatmap-cell %u => exiting...\n\n",
+              heatmap_cell);
+      return_value = -1;
+      goto done;
+    }
+  }
+  if (emission_policy == 1) {
+    g_emission_policy = create_emission_policy(
+        message_rate, emit_motion_threshold, emit_frame_budget);
+  }
+  if (embedding_change_threshold > 0) {
+    g_embedding_filter = create_embedding_change_filter(
+        embedding_change_threshold, embedding_resend_age);
+  }
+  if (reid_cold_store_dir && use_tracker_reid && tracker_reid_store_age > 0) {
+    g_reid_cold_store = create_embedding_cold_store();
+    if (!embedding_cold_store_init(g_reid_cold_store, reid_cold_store_dir,
+                                   (size_t)reid_cold_store_size << 20)) {
+      fprintf(stderr, "Could not create the reid cold store in %s => "
+                      "exiting...\n\n",
+              reid_cold_store_dir);
+      return_value = -1;
+      goto done;
+    }
+  }
   NvDsImageSave nvds_imgsave = appCtx[0]->config.image_save_config;
   if (nvds_imgsave.enable) {
     bool can_start = true;
@@ -1952,6 +2853,14 @@ int main(int argc, char *argv[]) {
              "integer. Setting to Default.\n");
       nvds_imgsave.second_to_skip_interval = 600;
     }
+    if (can_start && meta_compression &&
+        !image_meta_consumer_set_compression(g_img_meta_consumer,
+                                             meta_compression,
+                                             meta_compression_level,
+                                             meta_compression_dict_dir)) {
+      fprintf(stderr, "Invalid --meta-compression %s\n", meta_compression);
+      can_start = false;
+    }
     if (can_start) {
       /* Initiating the encode process for images. Each init function creates a
        * context on the specified gpu and can then be used to encode images.
@@ -1997,6 +2906,11 @@ int main(int argc, char *argv[]) {
 
   _intr_setup();
   g_timeout_add(400, check_for_interrupt, NULL);
+  if ((g_line_cross_engine || appCtx[0]->config.dsanalytics_config.enable) &&
+      analytics_summary_interval > 0) {
+    g_timeout_add_seconds(analytics_summary_interval, analytics_summary_cb,
+                          NULL);
+  }
 
   g_mutex_init(&disp_lock);
   display = XOpenDisplay(NULL);
@@ -2170,6 +3084,29 @@ done:
   if (tracker_reid_store_age > 0) {
     destroy_embedding_queue();
   }
+  destroy_embedding_cold_store(g_reid_cold_store);
+  destroy_embedding_change_filter(g_embedding_filter);
+  /** Sends what the workers still hold, so before what they use */
+  destroy_event_worker_pool(g_event_worker_pool);
+  destroy_emission_policy(g_emission_policy);
+  destroy_dwell_tracker(g_dwell_tracker);
+  destroy_line_cross_engine(g_line_cross_engine);
+  g_free(line_cross_objects);
+  g_free(line_cross_results);
+  destroy_occupancy_heatmap(g_occupancy_heatmap);
+  g_free(heatmap_boxes);
+  destroy_event_batcher(g_event_batcher);
+  if (log_level >= LOG_LVL_INFO) {
+    EventMetaPoolStats pool_stats;
+    event_meta_pool_get_stats(&pool_stats);
+    g_print("Event meta pool: %" G_GUINT64_FORMAT " pooled, %" G_GUINT64_FORMAT
+            " heap blocks, %" G_GUINT64_FORMAT " heap strings, capacity %"
+            G_GUINT64_FORMAT "\n",
+            pool_stats.pool_acquires, pool_stats.heap_blocks,
+            pool_stats.heap_strings, pool_stats.capacity);
+  }
+  event_meta_pool_embedding_unref(embedding_scratch);
+  destroy_prototype_gallery(g_prototype_gallery);
   g_free(testAppCtx);
 
   return return_value;
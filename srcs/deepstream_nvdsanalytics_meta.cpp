@@ -22,39 +22,187 @@
 
 #include <gst/gst.h>
 #include <glib.h>
-#include <iostream>
-#include <vector>
-#include <unordered_map>
-#include <sstream>
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <strings.h>
 #include "gstnvdsmeta.h"
 #include "nvds_analytics_meta.h"
 #include "analytics.h"
+
+#define ANALYTICS_MAX_STREAMS 1024
+#define ANALYTICS_MAX_LINES 16
+#define ANALYTICS_LINE_NAME_LEN 48
+
+/* Cumulative crossings of one line of a stream. Lines are only added by
+ * the streaming thread; the summary reads them concurrently. */
+struct LineCounter {
+    char name[ANALYTICS_LINE_NAME_LEN];
+    bool exit;
+    std::atomic<guint64> crossings{0};
+};
+
+struct StreamCounters {
+    std::atomic<guint> num_lines{0};
+    LineCounter lines[ANALYTICS_MAX_LINES];
+    std::atomic<guint64> entries{0};
+    std::atomic<guint64> exits{0};
+};
+
+static std::atomic<StreamCounters *> g_streams[ANALYTICS_MAX_STREAMS];
+
+/* Lines are directional in nvdsanalytics: one whose label contains "exit"
+ * (line-crossing-Exit=...) counts objects leaving, any other one objects
+ * entering */
+static bool is_exit_line(const char *name)
+{
+    for (const char *p = name; *p; p++)
+        if (strncasecmp(p, "exit", 4) == 0)
+            return true;
+    return false;
+}
+
+static StreamCounters *get_stream(guint source_id, bool create)
+{
+    if (source_id >= ANALYTICS_MAX_STREAMS)
+        return nullptr;
+    StreamCounters *stream = g_streams[source_id].load(std::memory_order_acquire);
+    if (!stream && create) {
+        stream = new StreamCounters();
+        g_streams[source_id].store(stream, std::memory_order_release);
+    }
+    return stream;
+}
+
+static LineCounter *find_line(StreamCounters *stream, const std::string &name, bool create)
+{
+    guint num_lines = stream->num_lines.load(std::memory_order_acquire);
+    for (guint i = 0; i < num_lines; i++)
+        if (name.compare(stream->lines[i].name) == 0)
+            return &stream->lines[i];
+    if (!create || num_lines == ANALYTICS_MAX_LINES)
+        return nullptr;
+    LineCounter *line = &stream->lines[num_lines];
+    g_strlcpy(line->name, name.c_str(), sizeof(line->name));
+    line->exit = is_exit_line(line->name);
+    stream->num_lines.store(num_lines + 1, std::memory_order_release);
+    return line;
+}
+
+static NvDsAnalyticsObjInfo *get_obj_info(NvDsObjectMeta *obj_meta)
+{
+    for (NvDsMetaList *l_user_meta = obj_meta->obj_user_meta_list; l_user_meta != NULL;
+            l_user_meta = l_user_meta->next) {
+        NvDsUserMeta *user_meta = (NvDsUserMeta *) (l_user_meta->data);
+        if (user_meta->base_meta.meta_type == NVDS_USER_OBJ_META_NVDSANALYTICS)
+            return (NvDsAnalyticsObjInfo *) user_meta->user_meta_data;
+    }
+    return nullptr;
+}
+
+/* Count the line crossings of every object of a frame; once per frame,
+ * from the streaming thread */
+extern "C" void
+analytics_count_frame (NvDsFrameMeta *frame_meta)
+{
+    StreamCounters *stream = nullptr;
+    for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL; l_obj = l_obj->next) {
+        NvDsAnalyticsObjInfo *info = get_obj_info((NvDsObjectMeta *) l_obj->data);
+        if (!info || info->lcStatus.empty())
+            continue;
+        if (!stream && !(stream = get_stream(frame_meta->source_id, true)))
+            return;
+        for (const std::string &status : info->lcStatus) {
+            LineCounter *line = find_line(stream, status, true);
+            if (!line)
+                continue;
+            line->crossings.fetch_add(1, std::memory_order_relaxed);
+            (line->exit ? stream->exits : stream->entries).fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/* Cumulative entries, exits and occupancy of a stream; FALSE before its
+ * first crossing */
+extern "C" gboolean
+analytics_get_stream_counts (guint source_id, guint32 *entries, guint32 *exits,
+                             guint32 *occupancy)
+{
+    StreamCounters *stream = get_stream(source_id, false);
+    guint64 in = stream ? stream->entries.load(std::memory_order_relaxed) : 0;
+    guint64 out = stream ? stream->exits.load(std::memory_order_relaxed) : 0;
+    *entries = (guint32) in;
+    *exits = (guint32) out;
+    *occupancy = in > out ? (guint32) (in - out) : 0;
+    return stream != nullptr;
+}
+
+/* Direction and counts of an object: the crossings of this frame, the
+ * cumulative count of the line it crossed and those of its stream.
+ * direction points into the object meta. */
 extern "C" void
-analytics_custom_parse_direction_obj_data (NvDsObjectMeta *obj_meta, AnalyticsUserMeta *data)
-{           std::stringstream out_string;
-            data->lcc_cnt_entry = 0;
-	        data->lcc_cnt_exit = 0;
-	        data->lccum_cnt = 0;
-            for (NvDsMetaList *l_user_meta = obj_meta->obj_user_meta_list; l_user_meta != NULL;
-                    l_user_meta = l_user_meta->next) {
-                NvDsUserMeta *user_meta = (NvDsUserMeta *) (l_user_meta->data);
-                 if(user_meta->base_meta.meta_type == NVDS_USER_OBJ_META_NVDSANALYTICS)
-                {
-                    NvDsAnalyticsObjInfo * user_meta_data =
-                        (NvDsAnalyticsObjInfo *)user_meta->user_meta_data;
-                    if (!user_meta_data->lcStatus.empty()){
-                       data->direction = user_meta_data->lcStatus[0].c_str();
-                        out_string << " object " << obj_meta->object_id <<
-                            " is moving in " <<  user_meta_data->lcStatus[0];
-                            
-                    }
-                }
-            }
-            //out_string << " object ";
-            if (out_string.str().size()){
-            g_print ("%s", out_string.str().c_str());}
-			
-        
-               
-
-}
\ No newline at end of file
+analytics_custom_parse_direction_obj_data (NvDsObjectMeta *obj_meta, guint source_id,
+                                           AnalyticsUserMeta *data)
+{
+    data->lcc_cnt_entry = 0;
+    data->lcc_cnt_exit = 0;
+    data->lccum_cnt = 0;
+    data->source_id = source_id;
+    data->direction = NULL;
+    StreamCounters *stream = get_stream(source_id, false);
+    NvDsAnalyticsObjInfo *info = get_obj_info(obj_meta);
+    if (info && !info->lcStatus.empty()) {
+        data->direction = info->lcStatus[0].c_str();
+        for (const std::string &status : info->lcStatus) {
+            LineCounter *line = stream ? find_line(stream, status, false) : nullptr;
+            bool exit = line ? line->exit : is_exit_line(status.c_str());
+            (exit ? data->lcc_cnt_exit : data->lcc_cnt_entry)++;
+        }
+        LineCounter *line = stream ? find_line(stream, info->lcStatus[0], false) : nullptr;
+        if (line)
+            data->lccum_cnt = line->crossings.load(std::memory_order_relaxed);
+    }
+    analytics_get_stream_counts(source_id, &data->lccum_cnt_entry, &data->lccum_cnt_exit,
+                                &data->occupancy);
+}
+
+/* One line per stream with crossings: cumulative count of every line and
+ * the occupancy */
+extern "C" void
+analytics_print_summary (void)
+{
+    for (guint source_id = 0; source_id < ANALYTICS_MAX_STREAMS; source_id++) {
+        StreamCounters *stream = get_stream(source_id, false);
+        if (!stream)
+            continue;
+        GString *summary = g_string_new(NULL);
+        g_string_append_printf(summary, "Analytics stream %u:", source_id);
+        guint num_lines = stream->num_lines.load(std::memory_order_acquire);
+        for (guint i = 0; i < num_lines; i++)
+            g_string_append_printf(summary, " %s=%" G_GUINT64_FORMAT, stream->lines[i].name,
+                                   stream->lines[i].crossings.load(std::memory_order_relaxed));
+        guint32 entries, exits, occupancy;
+        analytics_get_stream_counts(source_id, &entries, &exits, &occupancy);
+        g_print("%s entries=%u exits=%u occupancy=%u\n", summary->str, entries, exits,
+                occupancy);
+        g_string_free(summary, TRUE);
+    }
+}
+
+/* Whether the object crossed a line on this frame, without building the
+ * direction string */
+extern "C" gboolean
+analytics_obj_line_crossed (NvDsObjectMeta *obj_meta)
+{
+    for (NvDsMetaList *l_user_meta = obj_meta->obj_user_meta_list; l_user_meta != NULL;
+            l_user_meta = l_user_meta->next) {
+        NvDsUserMeta *user_meta = (NvDsUserMeta *) (l_user_meta->data);
+        if (user_meta->base_meta.meta_type == NVDS_USER_OBJ_META_NVDSANALYTICS) {
+            NvDsAnalyticsObjInfo *user_meta_data =
+                (NvDsAnalyticsObjInfo *) user_meta->user_meta_data;
+            if (!user_meta_data->lcStatus.empty())
+                return TRUE;
+        }
+    }
+    return FALSE;
+}
@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "dwell_tracker.h"
+
+#include <algorithm>
+#include <iostream>
+
+/// Calls to expire() of a stream between two sweeps of the table
+#define EXPIRE_INTERVAL 32
+
+DwellTracker::~DwellTracker() {
+    if (opened_) {
+        std::cout << "Dwell tracker: " << opened_ << " visits, " << closed_[DWELL_END_EXIT]
+                  << " exited, " << closed_[DWELL_END_TERMINATED] << " terminated, "
+                  << closed_[DWELL_END_EXPIRED] << " expired, " << size_ << " open, "
+                  << dropped_ << " dropped (table full)" << std::endl;
+    }
+}
+
+void DwellTracker::init(size_t max_visits, uint64_t expiry_ns) {
+    max_visits_ = std::max<size_t>(max_visits, 1);
+    size_t capacity = 16;
+    while (capacity < 2 * max_visits_)
+        capacity *= 2;
+    slots_.assign(capacity, Slot());
+    mask_ = capacity - 1;
+    size_ = 0;
+    expiry_ns_ = expiry_ns;
+    expire_calls_.clear();
+}
+
+size_t DwellTracker::home(unsigned stream_id, uint64_t object_id, unsigned roi) const {
+    uint64_t key = object_id ^ ((uint64_t) stream_id << 40) ^ ((uint64_t) roi << 58);
+    key *= 0x9E3779B97F4A7C15ull;
+    return (size_t) (key ^ (key >> 29)) & mask_;
+}
+
+DwellTracker::Slot *DwellTracker::find(unsigned stream_id, uint64_t object_id, unsigned roi) {
+    for (size_t i = home(stream_id, object_id, roi);; i = (i + 1) & mask_) {
+        Slot &slot = slots_[i];
+        if (!slot.used)
+            return nullptr;
+        if (slot.object_id == object_id && slot.stream_id == stream_id && slot.roi == roi)
+            return &slot;
+    }
+}
+
+DwellTracker::Slot *DwellTracker::insert(unsigned stream_id, uint64_t object_id, unsigned roi) {
+    if (size_ >= max_visits_) {
+        dropped_++;
+        return nullptr;
+    }
+    size_t i = home(stream_id, object_id, roi);
+    while (slots_[i].used)
+        i = (i + 1) & mask_;
+    Slot &slot = slots_[i];
+    slot.object_id = object_id;
+    slot.stream_id = stream_id;
+    slot.roi = (uint8_t) roi;
+    slot.used = 1;
+    size_++;
+    opened_++;
+    return &slot;
+}
+
+void DwellTracker::erase(size_t index) {
+    /// Backward shift: pull up the following slots of the cluster that
+    /// would not be reachable anymore through the freed one
+    size_t hole = index;
+    for (size_t i = (index + 1) & mask_; slots_[i].used; i = (i + 1) & mask_) {
+        size_t h = home(slots_[i].stream_id, slots_[i].object_id, slots_[i].roi);
+        /// Movable unless its home lies cyclically in (hole, i]
+        bool stays = hole <= i ? (hole < h && h <= i) : (hole < h || h <= i);
+        if (stays)
+            continue;
+        slots_[hole] = slots_[i];
+        hole = i;
+    }
+    slots_[hole].used = 0;
+    size_--;
+}
+
+DwellVisit DwellTracker::finish(const Slot &slot, uint64_t exit_ns, DwellEnd end) {
+    DwellVisit visit;
+    visit.object_id = slot.object_id;
+    visit.enter_ns = slot.enter_ns;
+    visit.exit_ns = std::max(exit_ns, slot.enter_ns);
+    visit.stream_id = slot.stream_id;
+    visit.roi = slot.roi;
+    visit.end = (uint8_t) end;
+    return visit;
+}
+
+unsigned DwellTracker::update(unsigned stream_id, uint64_t object_id, uint32_t roi_mask,
+                              unsigned num_rois, uint64_t ts_ns, DwellVisit *visits) {
+    unsigned count = 0;
+    num_rois = std::min<unsigned>(num_rois, DWELL_MAX_ROIS);
+    for (unsigned roi = 0; roi < num_rois; roi++) {
+        Slot *slot = find(stream_id, object_id, roi);
+        if (roi_mask & (1u << roi)) {
+            if (!slot && (slot = insert(stream_id, object_id, roi)))
+                slot->enter_ns = ts_ns;
+            if (slot)
+                slot->last_ns = ts_ns;
+        } else if (slot) {
+            visits[count++] = finish(*slot, ts_ns, DWELL_END_EXIT);
+            closed_[DWELL_END_EXIT]++;
+            erase(slot - slots_.data());
+        }
+    }
+    return count;
+}
+
+unsigned DwellTracker::terminate(unsigned stream_id, uint64_t object_id, unsigned num_rois,
+                                 DwellVisit *visits) {
+    unsigned count = 0;
+    num_rois = std::min<unsigned>(num_rois, DWELL_MAX_ROIS);
+    for (unsigned roi = 0; roi < num_rois; roi++) {
+        Slot *slot = find(stream_id, object_id, roi);
+        if (!slot)
+            continue;
+        visits[count++] = finish(*slot, slot->last_ns, DWELL_END_TERMINATED);
+        closed_[DWELL_END_TERMINATED]++;
+        erase(slot - slots_.data());
+    }
+    return count;
+}
+
+unsigned DwellTracker::expire(unsigned stream_id, uint64_t ts_ns, DwellVisit *visits,
+                              unsigned max_visits) {
+    if (stream_id >= expire_calls_.size())
+        expire_calls_.resize(stream_id + 1, 0);
+    if (++expire_calls_[stream_id] < EXPIRE_INTERVAL || size_ == 0)
+        return 0;
+
+    unsigned count = 0;
+    for (size_t i = 0; i < slots_.size() && count < max_visits;) {
+        const Slot &slot = slots_[i];
+        /// A stream restarting (time going backwards) ends its visits too
+        if (slot.used && slot.stream_id == stream_id &&
+            (ts_ns < slot.last_ns || ts_ns - slot.last_ns > expiry_ns_)) {
+            visits[count++] = finish(slot, slot.last_ns, DWELL_END_EXPIRED);
+            closed_[DWELL_END_EXPIRED]++;
+            /// The shift may have pulled another slot here, look again
+            erase(i);
+            continue;
+        }
+        i++;
+    }
+    /// Not done if the output filled up: sweep again on the next call
+    if (count < max_visits)
+        expire_calls_[stream_id] = 0;
+    return count;
+}
@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "dwell_tracker_wrapper.h"
+
+/// Residency of tracked objects in the ROIs of their stream.
+///
+/// An open visit is one slot of an open-addressing table (linear probing,
+/// backward-shift deletion, no tombstones) keyed by stream, object and ROI:
+/// 32 bytes holding the entry time and the time the object was last seen
+/// inside. A visit ends when the object is outside the ROI, when the
+/// tracker terminates it, or when it has not been seen for the expiry time;
+/// it is then returned once, as a DwellVisit, and its slot is freed.
+///
+/// The table is allocated once for max_visits open visits at half load, so
+/// memory does not grow with the number of tracks; visits that would exceed
+/// it are not opened and counted as dropped.
+class DwellTracker {
+public:
+    ~DwellTracker();
+
+    void init(size_t max_visits, uint64_t expiry_ns);
+
+    unsigned update(unsigned stream_id, uint64_t object_id, uint32_t roi_mask,
+                    unsigned num_rois, uint64_t ts_ns, DwellVisit *visits);
+
+    unsigned terminate(unsigned stream_id, uint64_t object_id, unsigned num_rois,
+                       DwellVisit *visits);
+
+    unsigned expire(unsigned stream_id, uint64_t ts_ns, DwellVisit *visits, unsigned max_visits);
+
+    size_t open_visits() const { return size_; }
+
+private:
+    struct Slot {
+        uint64_t object_id;
+        uint64_t enter_ns;
+        uint64_t last_ns;
+        uint32_t stream_id;
+        uint8_t roi;
+        uint8_t used;
+    };
+
+    size_t home(unsigned stream_id, uint64_t object_id, unsigned roi) const;
+    Slot *find(unsigned stream_id, uint64_t object_id, unsigned roi);
+    Slot *insert(unsigned stream_id, uint64_t object_id, unsigned roi);
+    void erase(size_t index);
+    static DwellVisit finish(const Slot &slot, uint64_t exit_ns, DwellEnd end);
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    size_t max_visits_ = 0;
+    uint64_t expiry_ns_ = 0;
+    /// Per stream: calls to expire() since its last sweep
+    std::vector<unsigned> expire_calls_;
+    uint64_t opened_ = 0;
+    uint64_t closed_[4] = {0, 0, 0, 0};
+    uint64_t dropped_ = 0;
+};
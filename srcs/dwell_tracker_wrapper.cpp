@@ -0,0 +1,47 @@
+#include "dwell_tracker_wrapper.h"
+#include "dwell_tracker.h"
+
+// Wrapper struct to hold the actual C++ object
+struct DwellTrackerWrapper {
+    DwellTracker* tracker;
+};
+
+// Create and destroy
+DwellTrackerWrapper* create_dwell_tracker(unsigned max_visits, unsigned expiry_ms) {
+    DwellTrackerWrapper* wrapper = new DwellTrackerWrapper();
+    wrapper->tracker = new DwellTracker();
+    wrapper->tracker->init(max_visits, (uint64_t) expiry_ms * 1000000);
+    return wrapper;
+}
+
+void destroy_dwell_tracker(DwellTrackerWrapper* wrapper) {
+    if (wrapper) {
+        delete wrapper->tracker;
+        delete wrapper;
+    }
+}
+
+// Update
+unsigned dwell_tracker_update(DwellTrackerWrapper* wrapper, unsigned stream_id,
+                              uint64_t object_id, uint32_t roi_mask, unsigned num_rois,
+                              uint64_t ts_ns, DwellVisit* visits) {
+    if (!wrapper || !wrapper->tracker)
+        return 0;
+    return wrapper->tracker->update(stream_id, object_id, roi_mask, num_rois, ts_ns, visits);
+}
+
+// Terminate
+unsigned dwell_tracker_terminate(DwellTrackerWrapper* wrapper, unsigned stream_id,
+                                 uint64_t object_id, unsigned num_rois, DwellVisit* visits) {
+    if (!wrapper || !wrapper->tracker)
+        return 0;
+    return wrapper->tracker->terminate(stream_id, object_id, num_rois, visits);
+}
+
+// Expire
+unsigned dwell_tracker_expire(DwellTrackerWrapper* wrapper, unsigned stream_id, uint64_t ts_ns,
+                              DwellVisit* visits, unsigned max_visits) {
+    if (!wrapper || !wrapper->tracker)
+        return 0;
+    return wrapper->tracker->expire(stream_id, ts_ns, visits, max_visits);
+}
@@ -0,0 +1,56 @@
+#ifndef DWELL_TRACKER_WRAPPER_H
+#define DWELL_TRACKER_WRAPPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct DwellTrackerWrapper DwellTrackerWrapper;
+
+// How a visit ended
+typedef enum {
+    DWELL_END_EXIT = 1,        // the object left the ROI
+    DWELL_END_TERMINATED = 2,  // the tracker ended the track
+    DWELL_END_EXPIRED = 3,     // the object was not seen for the expiry time
+} DwellEnd;
+
+// A finished visit of an object to an ROI of its stream; times in ns
+typedef struct {
+    uint64_t object_id;
+    uint64_t enter_ns;
+    uint64_t exit_ns;
+    uint32_t stream_id;
+    uint8_t roi;               // index of the ROI in the stream
+    uint8_t end;               // DwellEnd
+} DwellVisit;
+
+// Visits update() and terminate() may finish at once
+#define DWELL_MAX_ROIS 32
+
+// Create and destroy a DwellTracker object holding up to max_visits open
+// visits; objects not seen for expiry_ms end their visits
+DwellTrackerWrapper* create_dwell_tracker(unsigned max_visits, unsigned expiry_ms);
+void destroy_dwell_tracker(DwellTrackerWrapper* tracker);
+
+// Record that the object is in the ROIs of roi_mask (bits below num_rois)
+// at ts_ns; returns the visits that ended, at most DWELL_MAX_ROIS
+unsigned dwell_tracker_update(DwellTrackerWrapper* tracker, unsigned stream_id,
+                              uint64_t object_id, uint32_t roi_mask, unsigned num_rois,
+                              uint64_t ts_ns, DwellVisit* visits);
+
+// End the open visits of a terminated track, at most DWELL_MAX_ROIS
+unsigned dwell_tracker_terminate(DwellTrackerWrapper* tracker, unsigned stream_id,
+                                 uint64_t object_id, unsigned num_rois, DwellVisit* visits);
+
+// End the visits of the stream's objects not seen since ts_ns - expiry;
+// cheap to call every frame, the table is only swept from time to time
+unsigned dwell_tracker_expire(DwellTrackerWrapper* tracker, unsigned stream_id, uint64_t ts_ns,
+                              DwellVisit* visits, unsigned max_visits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DWELL_TRACKER_WRAPPER_H
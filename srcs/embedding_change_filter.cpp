@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedding_change_filter.h"
+
+#include "embedding_similarity.h"
+#include "emission_policy.h"  /// kUntrackedObjectId
+
+/// Checks between two sweeps for tracks the tracker never reported as ended
+#define EVICT_INTERVAL 1024
+
+void EmbeddingChangeFilter::init(float threshold, int resend_age, int evict_age) {
+    threshold_ = threshold;
+    resend_age_ = resend_age;
+    evict_age_ = evict_age;
+    tracks_.clear();
+}
+
+bool EmbeddingChangeFilter::check(int stream_id, uint64_t object_id, int frame_num,
+                                  const float *embedding, unsigned num_elements, int *ref_frame_num) {
+    if (++checks_since_evict_ >= EVICT_INTERVAL) {
+        checks_since_evict_ = 0;
+        evict(stream_id, frame_num);
+    }
+
+    /// Without a tracker every object has the same id: no track to compare with
+    if (object_id == kUntrackedObjectId) {
+        sent_++;
+        return true;
+    }
+
+    Entry &entry = tracks_[Key{object_id, stream_id}];
+    entry.seen_frame_num = frame_num;
+    const float norm = emb_sim_norm(embedding, num_elements);
+
+    if (entry.embedding.size() == num_elements && norm > 0.f &&
+        (resend_age_ <= 0 || frame_num - entry.sent_frame_num < resend_age_)) {
+        /// Cached vector is unit length, one dot product gives the cosine
+        float cosine = emb_sim_dot(entry.embedding.data(), embedding, num_elements) / norm;
+        if (1.f - cosine < threshold_) {
+            if (ref_frame_num)
+                *ref_frame_num = entry.sent_frame_num;
+            suppressed_++;
+            return false;
+        }
+    }
+
+    entry.embedding.resize(num_elements);
+    const float inv_norm = norm > 0.f ? 1.f / norm : 0.f;
+    for (unsigned i = 0; i < num_elements; i++)
+        entry.embedding[i] = embedding[i] * inv_norm;
+    entry.sent_frame_num = frame_num;
+    sent_++;
+    return true;
+}
+
+void EmbeddingChangeFilter::forget(int stream_id, uint64_t object_id) {
+    tracks_.erase(Key{object_id, stream_id});
+}
+
+void EmbeddingChangeFilter::evict(int stream_id, int frame_num) {
+    /// Frame numbers are per stream, only compare tracks of the same stream
+    for (auto it = tracks_.begin(); it != tracks_.end();) {
+        if (it->first.stream_id == stream_id && frame_num - it->second.seen_frame_num > evict_age_)
+            it = tracks_.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// Per-track cache of the last embedding sent to the broker.
+///
+/// An embedding is only worth sending again once it has moved away from
+/// the last sent one by at least the cosine distance threshold, or once
+/// the last sent one is older than the resend age (so late consumers still
+/// get a fresh vector).
+///
+/// Tracks need a tracker: untracked objects all share kUntrackedObjectId,
+/// so their embeddings are always sent and never cached.
+class EmbeddingChangeFilter {
+public:
+    /// @param [in] threshold Minimum cosine distance (1 - cosine) to resend
+    /// @param [in] resend_age Frames after which the embedding is sent
+    ///             anyway; 0 never forces a resend
+    /// @param [in] evict_age Frames without any check after which a track
+    ///             is dropped from the cache
+    void init(float threshold, int resend_age, int evict_age);
+
+    /// @param [out] ref_frame_num Frame of the last sent embedding when the
+    ///              embedding is suppressed
+    /// @return true if the embedding has to be sent
+    bool check(int stream_id, uint64_t object_id, int frame_num,
+               const float *embedding, unsigned num_elements, int *ref_frame_num);
+
+    /// Drop a track, e.g. when the tracker terminates it
+    void forget(int stream_id, uint64_t object_id);
+
+    uint64_t num_sent() const { return sent_; }
+    uint64_t num_suppressed() const { return suppressed_; }
+
+private:
+    struct Key {
+        uint64_t object_id;
+        int stream_id;
+        bool operator==(const Key &other) const {
+            return object_id == other.object_id && stream_id == other.stream_id;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<uint64_t>()(key.object_id * 0x9E3779B97F4A7C15ull + key.stream_id);
+        }
+    };
+    struct Entry {
+        std::vector<float> embedding;  ///< last sent, L2 normalized
+        int sent_frame_num = 0;
+        int seen_frame_num = 0;
+    };
+
+    void evict(int stream_id, int frame_num);
+
+    float threshold_ = 0.f;
+    int resend_age_ = 0;
+    int evict_age_ = 0;
+    unsigned checks_since_evict_ = 0;
+    uint64_t sent_ = 0;
+    uint64_t suppressed_ = 0;
+    std::unordered_map<Key, Entry, KeyHash> tracks_;
+};
@@ -0,0 +1,48 @@
+#include "embedding_change_filter_wrapper.h"
+#include "embedding_change_filter.h"
+
+#include <algorithm>
+#include <iostream>
+
+/// Tracks unseen for this long are dropped even without a terminated event
+#define MIN_EVICT_AGE 300
+
+// Wrapper struct to hold the actual C++ object
+struct EmbeddingChangeFilterWrapper {
+    EmbeddingChangeFilter* filter;
+};
+
+// Create and destroy
+EmbeddingChangeFilterWrapper* create_embedding_change_filter(float threshold, int resend_age) {
+    EmbeddingChangeFilterWrapper* wrapper = new EmbeddingChangeFilterWrapper();
+    wrapper->filter = new EmbeddingChangeFilter();
+    wrapper->filter->init(threshold, resend_age, std::max(4 * resend_age, MIN_EVICT_AGE));
+    return wrapper;
+}
+
+void destroy_embedding_change_filter(EmbeddingChangeFilterWrapper* wrapper) {
+    if (wrapper) {
+        std::cout << "Embeddings sent: " << wrapper->filter->num_sent()
+                  << ", suppressed: " << wrapper->filter->num_suppressed() << "\n";
+        delete wrapper->filter;
+        delete wrapper;
+    }
+}
+
+// Check
+int embedding_change_filter_check(EmbeddingChangeFilterWrapper* wrapper, int stream_id,
+                                  uint64_t object_id, int frame_num,
+                                  const float* embedding, unsigned num_elements,
+                                  int* ref_frame_num) {
+    if (!wrapper || !wrapper->filter || !embedding)
+        return 1;
+    return wrapper->filter->check(stream_id, object_id, frame_num, embedding, num_elements,
+                                  ref_frame_num) ? 1 : 0;
+}
+
+// Forget
+void embedding_change_filter_forget(EmbeddingChangeFilterWrapper* wrapper, int stream_id,
+                                    uint64_t object_id) {
+    if (wrapper && wrapper->filter)
+        wrapper->filter->forget(stream_id, object_id);
+}
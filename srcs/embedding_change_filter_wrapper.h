@@ -0,0 +1,33 @@
+#ifndef EMBEDDING_CHANGE_FILTER_WRAPPER_H
+#define EMBEDDING_CHANGE_FILTER_WRAPPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct EmbeddingChangeFilterWrapper EmbeddingChangeFilterWrapper;
+
+// Create and destroy an EmbeddingChangeFilter object. threshold is the
+// minimum cosine distance to resend, resend_age the frames after which the
+// embedding is sent anyway (0 = never).
+EmbeddingChangeFilterWrapper* create_embedding_change_filter(float threshold, int resend_age);
+void destroy_embedding_change_filter(EmbeddingChangeFilterWrapper* filter);
+
+// Returns 1 if the embedding has to be sent, 0 if it is close enough to the
+// last one sent for the track; ref_frame_num then holds that frame.
+int embedding_change_filter_check(EmbeddingChangeFilterWrapper* filter, int stream_id,
+                                  uint64_t object_id, int frame_num,
+                                  const float* embedding, unsigned num_elements,
+                                  int* ref_frame_num);
+
+// Drop a terminated track
+void embedding_change_filter_forget(EmbeddingChangeFilterWrapper* filter, int stream_id,
+                                    uint64_t object_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMBEDDING_CHANGE_FILTER_WRAPPER_H
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedding_cold_store.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static size_t record_size(unsigned num_elements) {
+    size_t size = sizeof(EmbeddingColdStore::Record) + num_elements * sizeof(float);
+    return (size + 15) & ~(size_t) 15;
+}
+
+EmbeddingColdStore::~EmbeddingColdStore() {
+    for (Segment &segment : segments_) {
+        if (segment.base)
+            munmap(segment.base, segment_bytes_);
+    }
+}
+
+bool EmbeddingColdStore::init(const std::string &dir, size_t segment_bytes, unsigned num_segments) {
+    if (segment_bytes < record_size(0) || num_segments < 2) {
+        std::cerr << "Embedding cold store needs at least 2 segments\n";
+        return false;
+    }
+    dir_ = dir;
+    segment_bytes_ = segment_bytes;
+    segments_.assign(num_segments, Segment());
+    current_ = 0;
+    /// Map the first segment now so a bad spill directory fails at startup
+    if (!map_segment(segments_[0]))
+        return false;
+    segments_[0].seq = next_seq_++;
+    return true;
+}
+
+bool EmbeddingColdStore::map_segment(Segment &segment) {
+    std::string path_template = dir_ + "/reid_cold_XXXXXX";
+    std::vector<char> path(path_template.begin(), path_template.end());
+    path.push_back('\0');
+    int fd = mkstemp(path.data());
+    if (fd < 0) {
+        std::cerr << "Could not create cold store segment in " << dir_ << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    /// Nothing is meant to outlive the process: keep only the open mapping
+    unlink(path.data());
+    if (ftruncate(fd, segment_bytes_) != 0) {
+        std::cerr << "Could not size cold store segment: " << strerror(errno) << "\n";
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(nullptr, segment_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Could not map cold store segment: " << strerror(errno) << "\n";
+        return false;
+    }
+    segment.base = static_cast<uint8_t *>(addr);
+    segment.used = 0;
+    return true;
+}
+
+void EmbeddingColdStore::advance_segment() {
+#ifdef MADV_PAGEOUT
+    /// The full segment is only read on a lookup miss; let it leave RAM
+    madvise(segments_[current_].base, segments_[current_].used, MADV_PAGEOUT);
+#endif
+    current_ = (current_ + 1) % segments_.size();
+    Segment &segment = segments_[current_];
+    if (segment.base) {
+        /// Ring wrapped: forget the tracks whose latest record is overwritten
+        for (auto it = index_.begin(); it != index_.end();) {
+            if (it->second.slot == current_)
+                it = index_.erase(it);
+            else
+                ++it;
+        }
+    } else if (!map_segment(segment)) {
+        return;
+    }
+    segment.used = 0;
+    segment.seq = next_seq_++;
+}
+
+bool EmbeddingColdStore::spill(int stream_id, int frame_num, uint64_t object_id,
+                               const float *embedding, unsigned num_elements) {
+    const size_t size = record_size(num_elements);
+    if (size > segment_bytes_ || segments_.empty())
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (segments_[current_].used + size > segment_bytes_)
+        advance_segment();
+    Segment &segment = segments_[current_];
+    if (!segment.base || segment.used + size > segment_bytes_)
+        return false;
+
+    Record *record = reinterpret_cast<Record *>(segment.base + segment.used);
+    record->object_id = object_id;
+    record->stream_id = stream_id;
+    record->frame_num = frame_num;
+    record->num_elements = num_elements;
+    record->reserved = 0;
+    memcpy(record + 1, embedding, num_elements * sizeof(float));
+
+    index_[Key{object_id, stream_id}] = Location{current_, segment.seq, segment.used, frame_num};
+    segment.used += size;
+    return true;
+}
+
+const float *EmbeddingColdStore::lookup(int stream_id, uint64_t object_id, int min_frame_num,
+                                        unsigned *num_elements) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(Key{object_id, stream_id});
+    if (it == index_.end())
+        return nullptr;
+    const Location &location = it->second;
+    if (location.frame_num < min_frame_num) {
+        index_.erase(it);
+        return nullptr;
+    }
+    const Segment &segment = segments_[location.slot];
+    if (segment.seq != location.seq)
+        return nullptr;
+    const Record *record = reinterpret_cast<const Record *>(segment.base + location.offset);
+    *num_elements = record->num_elements;
+    return reinterpret_cast<const float *>(record + 1);
+}
+
+size_t EmbeddingColdStore::num_tracks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+}
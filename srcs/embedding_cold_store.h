@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Cold tier of the tracker ReID embedding history.
+///
+/// Embeddings that leave the in-memory window (tracker_reid_store_age frames)
+/// are appended to a ring of fixed-size segments. The segments are unlinked
+/// files in a spill directory, mapped shared, so the kernel can write them
+/// back and evict them instead of growing the process heap. An index keeps
+/// the latest record of every (stream, object_id); when the ring wraps, the
+/// oldest segment is reused and the tracks it held are forgotten.
+class EmbeddingColdStore {
+public:
+    /// Record header in a segment, followed by num_elements floats
+    struct Record {
+        uint64_t object_id;
+        int32_t stream_id;
+        int32_t frame_num;
+        uint32_t num_elements;
+        uint32_t reserved;
+    };
+
+    ~EmbeddingColdStore();
+
+    /// @param [in] dir Directory on the spill device
+    /// @param [in] segment_bytes Size of one segment
+    /// @param [in] num_segments Segments in the ring; total disk budget is
+    ///             segment_bytes * num_segments
+    bool init(const std::string &dir, size_t segment_bytes, unsigned num_segments);
+
+    /// Append an embedding that left the in-memory window.
+    bool spill(int stream_id, int frame_num, uint64_t object_id,
+               const float *embedding, unsigned num_elements);
+
+    /// Latest spilled embedding of a track, if it is not older than
+    /// min_frame_num. The pointer refers to the mapping and stays valid
+    /// until the next spill().
+    const float *lookup(int stream_id, uint64_t object_id, int min_frame_num,
+                        unsigned *num_elements);
+
+    size_t num_tracks() const;
+
+private:
+    struct Key {
+        uint64_t object_id;
+        int stream_id;
+        bool operator==(const Key &other) const {
+            return object_id == other.object_id && stream_id == other.stream_id;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<uint64_t>()(key.object_id * 0x9E3779B97F4A7C15ull + key.stream_id);
+        }
+    };
+    struct Location {
+        unsigned slot;
+        uint64_t seq;
+        size_t offset;
+        int frame_num;
+    };
+    struct Segment {
+        uint8_t *base = nullptr;
+        size_t used = 0;
+        uint64_t seq = 0;
+    };
+
+    bool map_segment(Segment &segment);
+    void advance_segment();
+
+    std::string dir_;
+    size_t segment_bytes_ = 0;
+    std::vector<Segment> segments_;
+    unsigned current_ = 0;
+    uint64_t next_seq_ = 1;
+    std::unordered_map<Key, Location, KeyHash> index_;
+    mutable std::mutex mutex_;
+};
@@ -0,0 +1,59 @@
+#include "embedding_cold_store_wrapper.h"
+#include "embedding_cold_store.h"
+
+#include <iostream>
+
+/// Segments in the ring; the oldest quarter of the budget is recycled at once
+#define COLD_STORE_SEGMENTS 4
+
+// Wrapper struct to hold the actual C++ object
+struct EmbeddingColdStoreWrapper {
+    EmbeddingColdStore* store;
+};
+
+// Create and destroy
+EmbeddingColdStoreWrapper* create_embedding_cold_store() {
+    EmbeddingColdStoreWrapper* wrapper = new EmbeddingColdStoreWrapper();
+    wrapper->store = new EmbeddingColdStore();
+    return wrapper;
+}
+
+void destroy_embedding_cold_store(EmbeddingColdStoreWrapper* wrapper) {
+    if (wrapper) {
+        delete wrapper->store;
+        delete wrapper;
+    }
+}
+
+// Init
+int embedding_cold_store_init(EmbeddingColdStoreWrapper* wrapper, const char* dir,
+                              size_t budget_bytes) {
+    if (!wrapper || !wrapper->store || !dir)
+        return 0;
+    size_t segment_bytes = budget_bytes / COLD_STORE_SEGMENTS;
+    /// Keep segments page aligned for mmap
+    segment_bytes &= ~(size_t) 4095;
+    if (!wrapper->store->init(std::string(dir), segment_bytes, COLD_STORE_SEGMENTS))
+        return 0;
+    std::cout << "ReID cold store in " << dir << ": " << COLD_STORE_SEGMENTS << " segments of "
+              << segment_bytes / (1024 * 1024) << " MB\n";
+    return 1;
+}
+
+// Spill
+int embedding_cold_store_spill(EmbeddingColdStoreWrapper* wrapper, int stream_id,
+                               int frame_num, uint64_t object_id,
+                               const float* embedding, unsigned num_elements) {
+    if (!wrapper || !wrapper->store || !embedding)
+        return 0;
+    return wrapper->store->spill(stream_id, frame_num, object_id, embedding, num_elements) ? 1 : 0;
+}
+
+// Lookup
+const float* embedding_cold_store_lookup(EmbeddingColdStoreWrapper* wrapper,
+                                         int stream_id, uint64_t object_id,
+                                         int min_frame_num, unsigned* num_elements) {
+    if (!wrapper || !wrapper->store || !num_elements)
+        return nullptr;
+    return wrapper->store->lookup(stream_id, object_id, min_frame_num, num_elements);
+}
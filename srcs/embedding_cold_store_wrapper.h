@@ -0,0 +1,37 @@
+#ifndef EMBEDDING_COLD_STORE_WRAPPER_H
+#define EMBEDDING_COLD_STORE_WRAPPER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct EmbeddingColdStoreWrapper EmbeddingColdStoreWrapper;
+
+// Create and destroy an EmbeddingColdStore object
+EmbeddingColdStoreWrapper* create_embedding_cold_store();
+void destroy_embedding_cold_store(EmbeddingColdStoreWrapper* store);
+
+// Map the segment ring in dir, using at most budget_bytes of disk;
+// returns 1 on success
+int embedding_cold_store_init(EmbeddingColdStoreWrapper* store, const char* dir,
+                              size_t budget_bytes);
+
+// Append an embedding that left the in-memory window; returns 1 on success
+int embedding_cold_store_spill(EmbeddingColdStoreWrapper* store, int stream_id,
+                               int frame_num, uint64_t object_id,
+                               const float* embedding, unsigned num_elements);
+
+// Latest spilled embedding of a track not older than min_frame_num, or NULL.
+// Valid until the next spill.
+const float* embedding_cold_store_lookup(EmbeddingColdStoreWrapper* store,
+                                         int stream_id, uint64_t object_id,
+                                         int min_frame_num, unsigned* num_elements);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMBEDDING_COLD_STORE_WRAPPER_H
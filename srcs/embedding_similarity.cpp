@@ -0,0 +1,760 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedding_similarity.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EMB_SIM_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define EMB_SIM_ARM 1
+#include <arm_neon.h>
+#endif
+
+/// One set of kernels per instruction set. Reference rows can be fp32, fp16 or
+/// int8; the query is always fp32. int8 dot products are returned unscaled.
+struct EmbSimKernels {
+    EmbSimIsa isa;
+    float (*dot_f32)(const float *, const float *, unsigned);
+    float (*l2sq_f32)(const float *, const float *, unsigned);
+    float (*dot_f16)(const float *, const uint16_t *, unsigned);
+    float (*l2sq_f16)(const float *, const uint16_t *, unsigned);
+    float (*dot_i8)(const float *, const int8_t *, unsigned);
+    float (*l2sq_i8)(const float *, const int8_t *, float, unsigned);
+};
+
+uint16_t emb_sim_f32_to_f16(float value) {
+    uint32_t x;
+    memcpy(&x, &value, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    int32_t exponent = (int32_t) ((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = x & 0x7fffff;
+
+    if (((x >> 23) & 0xff) == 0xff)   /// inf / nan
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if (exponent >= 0x1f)              /// overflow
+        return sign | 0x7c00;
+    if (exponent <= 0) {               /// subnormal or zero
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rem = mantissa & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1)))
+            half++;
+        return sign | half;
+    }
+    uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+    uint32_t rem = mantissa & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+        half++;   /// may carry into the exponent, which is the correct rounding
+    return half;
+}
+
+float emb_sim_f16_to_f32(uint16_t value) {
+    uint32_t sign = (uint32_t) (value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t x;
+
+    if (exponent == 0x1f) {
+        x = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        x = sign;
+    } else {
+        /// normalize the subnormal
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        x = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+/// @{ Scalar reference kernels, also used for the tails of the SIMD loops
+static float dot_f32_scalar(const float *a, const float *b, unsigned n) {
+    float sum = 0.f;
+    for (unsigned i = 0; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+static float l2sq_f32_scalar(const float *a, const float *b, unsigned n) {
+    float sum = 0.f;
+    for (unsigned i = 0; i < n; i++) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+static float dot_f16_scalar(const float *a, const uint16_t *b, unsigned n) {
+    float sum = 0.f;
+    for (unsigned i = 0; i < n; i++)
+        sum += a[i] * emb_sim_f16_to_f32(b[i]);
+    return sum;
+}
+
+static float l2sq_f16_scalar(const float *a, const uint16_t *b, unsigned n) {
+    float sum = 0.f;
+    for (unsigned i = 0; i < n; i++) {
+        float d = a[i] - emb_sim_f16_to_f32(b[i]);
+        sum += d * d;
+    }
+    return sum;
+}
+
+static float dot_i8_scalar(const float *a, const int8_t *b, unsigned n) {
+    float sum = 0.f;
+    for (unsigned i = 0; i < n; i++)
+        sum += a[i] * (float) b[i];
+    return sum;
+}
+
+static float l2sq_i8_scalar(const float *a, const int8_t *b, float scale, unsigned n) {
+    float sum = 0.f;
+    for (unsigned i = 0; i < n; i++) {
+        float d = a[i] - (float) b[i] * scale;
+        sum += d * d;
+    }
+    return sum;
+}
+/// @}
+
+static const EmbSimKernels kernels_scalar = {
+    EMB_SIM_ISA_SCALAR,
+    dot_f32_scalar, l2sq_f32_scalar,
+    dot_f16_scalar, l2sq_f16_scalar,
+    dot_i8_scalar, l2sq_i8_scalar,
+};
+
+#ifdef EMB_SIM_X86
+
+/// @{ SSE4.2 kernels. There is no FMA and no F16C at this level, so half
+/// rows are widened four at a time with integer SSE.
+#define EMB_SIM_SSE __attribute__((target("sse4.2")))
+
+EMB_SIM_SSE static inline float hsum128(__m128 v) {
+    v = _mm_hadd_ps(v, v);
+    v = _mm_hadd_ps(v, v);
+    return _mm_cvtss_f32(v);
+}
+
+EMB_SIM_SSE static inline __m128 load_i8x4_sse(const int8_t *p) {
+    int32_t packed;
+    memcpy(&packed, p, sizeof(packed));
+    return _mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed)));
+}
+
+/// The exponent and mantissa bits are moved into place and rebiased;
+/// subnormals are made normal by one more exponent step, which a float
+/// subtraction takes off again, so no arithmetic is done on denormals.
+EMB_SIM_SSE static inline __m128 load_f16x4_sse(const uint16_t *p) {
+    __m128i h = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *) p));
+    __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+    __m128i bits = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+    __m128i exponent = _mm_and_si128(bits, _mm_set1_epi32(0x0f800000));
+    /// (127 - 15) << 23, twice for inf / nan to reach an all-ones exponent
+    bits = _mm_add_epi32(bits, _mm_set1_epi32(0x38000000));
+    __m128i infnan = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x0f800000));
+    bits = _mm_add_epi32(bits, _mm_and_si128(infnan, _mm_set1_epi32(0x38000000)));
+    /// subnormal: (1 + m) * 2^-14 - 2^-14
+    __m128i subnormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+    __m128 normalized = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))),
+                                   _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+    __m128 f = _mm_blendv_ps(_mm_castsi128_ps(bits), normalized, _mm_castsi128_ps(subnormal));
+    return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+EMB_SIM_SSE static float dot_f32_sse(const float *a, const float *b, unsigned n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    return hsum128(_mm_add_ps(acc0, acc1)) + dot_f32_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_SSE static float l2sq_f32_sse(const float *a, const float *b, unsigned n) {
+    __m128 acc = _mm_setzero_ps();
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+    }
+    return hsum128(acc) + l2sq_f32_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_SSE static float dot_f16_sse(const float *a, const uint16_t *b, unsigned n) {
+    __m128 acc = _mm_setzero_ps();
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), load_f16x4_sse(b + i)));
+    return hsum128(acc) + dot_f16_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_SSE static float l2sq_f16_sse(const float *a, const uint16_t *b, unsigned n) {
+    __m128 acc = _mm_setzero_ps();
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), load_f16x4_sse(b + i));
+        acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+    }
+    return hsum128(acc) + l2sq_f16_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_SSE static float dot_i8_sse(const float *a, const int8_t *b, unsigned n) {
+    __m128 acc = _mm_setzero_ps();
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), load_i8x4_sse(b + i)));
+    return hsum128(acc) + dot_i8_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_SSE static float l2sq_i8_sse(const float *a, const int8_t *b, float scale, unsigned n) {
+    __m128 acc = _mm_setzero_ps();
+    __m128 vscale = _mm_set1_ps(scale);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_mul_ps(load_i8x4_sse(b + i), vscale));
+        acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+    }
+    return hsum128(acc) + l2sq_i8_scalar(a + i, b + i, scale, n - i);
+}
+/// @}
+
+/// @{ AVX2 + FMA + F16C kernels
+#define EMB_SIM_AVX2 __attribute__((target("avx2,fma,f16c")))
+
+EMB_SIM_AVX2 static inline float hsum256(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    lo = _mm_hadd_ps(lo, lo);
+    lo = _mm_hadd_ps(lo, lo);
+    return _mm_cvtss_f32(lo);
+}
+
+EMB_SIM_AVX2 static inline __m256 load_f16x8_avx2(const uint16_t *p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) p));
+}
+
+EMB_SIM_AVX2 static inline __m256 load_i8x8_avx2(const int8_t *p) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *) p)));
+}
+
+EMB_SIM_AVX2 static float dot_f32_avx2(const float *a, const float *b, unsigned n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8)
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    return hsum256(_mm256_add_ps(acc0, acc1)) + dot_f32_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX2 static float l2sq_f32_avx2(const float *a, const float *b, unsigned n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+    return hsum256(_mm256_add_ps(acc0, acc1)) + l2sq_f32_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX2 static float dot_f16_avx2(const float *a, const uint16_t *b, unsigned n) {
+    __m256 acc = _mm256_setzero_ps();
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), load_f16x8_avx2(b + i), acc);
+    return hsum256(acc) + dot_f16_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX2 static float l2sq_f16_avx2(const float *a, const uint16_t *b, unsigned n) {
+    __m256 acc = _mm256_setzero_ps();
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), load_f16x8_avx2(b + i));
+        acc = _mm256_fmadd_ps(d, d, acc);
+    }
+    return hsum256(acc) + l2sq_f16_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX2 static float dot_i8_avx2(const float *a, const int8_t *b, unsigned n) {
+    __m256 acc = _mm256_setzero_ps();
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), load_i8x8_avx2(b + i), acc);
+    return hsum256(acc) + dot_i8_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX2 static float l2sq_i8_avx2(const float *a, const int8_t *b, float scale, unsigned n) {
+    __m256 acc = _mm256_setzero_ps();
+    __m256 vscale = _mm256_set1_ps(scale);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_mul_ps(load_i8x8_avx2(b + i), vscale));
+        acc = _mm256_fmadd_ps(d, d, acc);
+    }
+    return hsum256(acc) + l2sq_i8_scalar(a + i, b + i, scale, n - i);
+}
+/// @}
+
+/// @{ AVX-512F kernels; fp32 tails use masked loads
+#define EMB_SIM_AVX512 __attribute__((target("avx512f")))
+
+EMB_SIM_AVX512 static float dot_f32_avx512(const float *a, const float *b, unsigned n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    unsigned i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16)
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    if (i < n) {
+        __mmask16 m = (__mmask16) ((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+EMB_SIM_AVX512 static float l2sq_f32_avx512(const float *a, const float *b, unsigned n) {
+    __m512 acc = _mm512_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    if (i < n) {
+        __mmask16 m = (__mmask16) ((1u << (n - i)) - 1);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+EMB_SIM_AVX512 static float dot_f16_avx512(const float *a, const uint16_t *b, unsigned n) {
+    __m512 acc = _mm512_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vb = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *) (b + i)));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), vb, acc);
+    }
+    return _mm512_reduce_add_ps(acc) + dot_f16_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX512 static float l2sq_f16_avx512(const float *a, const uint16_t *b, unsigned n) {
+    __m512 acc = _mm512_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vb = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *) (b + i)));
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), vb);
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    return _mm512_reduce_add_ps(acc) + l2sq_f16_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX512 static float dot_i8_avx512(const float *a, const int8_t *b, unsigned n) {
+    __m512 acc = _mm512_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vb = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *) (b + i))));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), vb, acc);
+    }
+    return _mm512_reduce_add_ps(acc) + dot_i8_scalar(a + i, b + i, n - i);
+}
+
+EMB_SIM_AVX512 static float l2sq_i8_avx512(const float *a, const int8_t *b, float scale, unsigned n) {
+    __m512 acc = _mm512_setzero_ps();
+    __m512 vscale = _mm512_set1_ps(scale);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vb = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *) (b + i))));
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_mul_ps(vb, vscale));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    return _mm512_reduce_add_ps(acc) + l2sq_i8_scalar(a + i, b + i, scale, n - i);
+}
+/// @}
+
+/// fp16 rows are widened with integer SSE, see load_f16x4_sse
+static const EmbSimKernels kernels_sse42 = {
+    EMB_SIM_ISA_SSE42,
+    dot_f32_sse, l2sq_f32_sse,
+    dot_f16_sse, l2sq_f16_sse,
+    dot_i8_sse, l2sq_i8_sse,
+};
+
+static const EmbSimKernels kernels_avx2 = {
+    EMB_SIM_ISA_AVX2,
+    dot_f32_avx2, l2sq_f32_avx2,
+    dot_f16_avx2, l2sq_f16_avx2,
+    dot_i8_avx2, l2sq_i8_avx2,
+};
+
+static const EmbSimKernels kernels_avx512 = {
+    EMB_SIM_ISA_AVX512,
+    dot_f32_avx512, l2sq_f32_avx512,
+    dot_f16_avx512, l2sq_f16_avx512,
+    dot_i8_avx512, l2sq_i8_avx512,
+};
+
+/// Read the extended control register to know which register states the OS saves.
+static uint64_t read_xcr0() {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t) edx << 32) | eax;
+}
+
+static EmbSimIsa detect_isa() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return EMB_SIM_ISA_SCALAR;
+
+    const bool sse42 = ecx & (1u << 20);
+    const bool fma = ecx & (1u << 12);
+    const bool osxsave = ecx & (1u << 27);
+    const bool avx = ecx & (1u << 28);
+    const bool f16c = ecx & (1u << 29);
+    if (!sse42)
+        return EMB_SIM_ISA_SCALAR;
+    if (!osxsave || !avx)
+        return EMB_SIM_ISA_SSE42;
+
+    const uint64_t xcr0 = read_xcr0();
+    /// XMM and YMM state, then opmask / ZMM_Hi256 / Hi16_ZMM state
+    const bool os_avx = (xcr0 & 0x6) == 0x6;
+    const bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+    if (!os_avx)
+        return EMB_SIM_ISA_SSE42;
+
+    bool avx2 = false, avx512f = false;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        avx2 = ebx & (1u << 5);
+        avx512f = ebx & (1u << 16);
+    }
+    if (avx512f && os_avx512 && fma && f16c)
+        return EMB_SIM_ISA_AVX512;
+    if (avx2 && fma && f16c)
+        return EMB_SIM_ISA_AVX2;
+    return EMB_SIM_ISA_SSE42;
+}
+
+#elif defined(EMB_SIM_ARM)
+
+/// @{ NEON kernels (always available on aarch64)
+static float dot_f32_neon(const float *a, const float *b, unsigned n) {
+    float32x4_t acc0 = vdupq_n_f32(0.f), acc1 = vdupq_n_f32(0.f);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    return vaddvq_f32(vaddq_f32(acc0, acc1)) + dot_f32_scalar(a + i, b + i, n - i);
+}
+
+static float l2sq_f32_neon(const float *a, const float *b, unsigned n) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t d = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        acc = vfmaq_f32(acc, d, d);
+    }
+    return vaddvq_f32(acc) + l2sq_f32_scalar(a + i, b + i, n - i);
+}
+
+static inline float32x4_t load_f16x4_neon(const uint16_t *p) {
+    return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)));
+}
+
+static float dot_f16_neon(const float *a, const uint16_t *b, unsigned n) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = vfmaq_f32(acc, vld1q_f32(a + i), load_f16x4_neon(b + i));
+    return vaddvq_f32(acc) + dot_f16_scalar(a + i, b + i, n - i);
+}
+
+static float l2sq_f16_neon(const float *a, const uint16_t *b, unsigned n) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t d = vsubq_f32(vld1q_f32(a + i), load_f16x4_neon(b + i));
+        acc = vfmaq_f32(acc, d, d);
+    }
+    return vaddvq_f32(acc) + l2sq_f16_scalar(a + i, b + i, n - i);
+}
+
+static float dot_i8_neon(const float *a, const int8_t *b, unsigned n) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t w = vmovl_s8(vld1_s8(b + i));
+        acc = vfmaq_f32(acc, vld1q_f32(a + i), vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))));
+        acc = vfmaq_f32(acc, vld1q_f32(a + i + 4), vcvtq_f32_s32(vmovl_s16(vget_high_s16(w))));
+    }
+    return vaddvq_f32(acc) + dot_i8_scalar(a + i, b + i, n - i);
+}
+
+static float l2sq_i8_neon(const float *a, const int8_t *b, float scale, unsigned n) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t w = vmovl_s8(vld1_s8(b + i));
+        float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))), scale);
+        float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(w))), scale);
+        float32x4_t d0 = vsubq_f32(vld1q_f32(a + i), lo);
+        float32x4_t d1 = vsubq_f32(vld1q_f32(a + i + 4), hi);
+        acc = vfmaq_f32(acc, d0, d0);
+        acc = vfmaq_f32(acc, d1, d1);
+    }
+    return vaddvq_f32(acc) + l2sq_i8_scalar(a + i, b + i, scale, n - i);
+}
+/// @}
+
+static const EmbSimKernels kernels_neon = {
+    EMB_SIM_ISA_NEON,
+    dot_f32_neon, l2sq_f32_neon,
+    dot_f16_neon, l2sq_f16_neon,
+    dot_i8_neon, l2sq_i8_neon,
+};
+
+static EmbSimIsa detect_isa() {
+    return EMB_SIM_ISA_NEON;
+}
+
+#else
+
+static EmbSimIsa detect_isa() {
+    return EMB_SIM_ISA_SCALAR;
+}
+
+#endif
+
+static const EmbSimKernels *kernels_for(EmbSimIsa isa) {
+    switch (isa) {
+#ifdef EMB_SIM_X86
+        case EMB_SIM_ISA_AVX512:
+            return &kernels_avx512;
+        case EMB_SIM_ISA_AVX2:
+            return &kernels_avx2;
+        case EMB_SIM_ISA_SSE42:
+            return &kernels_sse42;
+#elif defined(EMB_SIM_ARM)
+        case EMB_SIM_ISA_NEON:
+            return &kernels_neon;
+#endif
+        default:
+            return &kernels_scalar;
+    }
+}
+
+/// Every level below the detected one is usable as well, for comparisons.
+static bool isa_supported(EmbSimIsa isa, EmbSimIsa detected) {
+    if (isa == EMB_SIM_ISA_SCALAR || isa == detected)
+        return true;
+#ifdef EMB_SIM_X86
+    return isa != EMB_SIM_ISA_NEON && isa <= detected;
+#else
+    return false;
+#endif
+}
+
+static EmbSimIsa isa_from_env(EmbSimIsa detected) {
+    const char *env = std::getenv("NVDS_EMB_SIM_ISA");
+    if (!env)
+        return detected;
+    const std::string name(env);
+    for (int isa = EMB_SIM_ISA_SCALAR; isa <= EMB_SIM_ISA_NEON; isa++) {
+        if (name == emb_sim_isa_name((EmbSimIsa) isa) && isa_supported((EmbSimIsa) isa, detected))
+            return (EmbSimIsa) isa;
+    }
+    std::cerr << "NVDS_EMB_SIM_ISA=" << name << " is not usable here, using "
+              << emb_sim_isa_name(detected) << "\n";
+    return detected;
+}
+
+static std::atomic<const EmbSimKernels *> &active_kernels() {
+    static std::atomic<const EmbSimKernels *> active(kernels_for(isa_from_env(detect_isa())));
+    return active;
+}
+
+static inline const EmbSimKernels *kernels() {
+    return active_kernels().load(std::memory_order_relaxed);
+}
+
+EmbSimIsa emb_sim_get_isa(void) {
+    return kernels()->isa;
+}
+
+const char *emb_sim_isa_name(EmbSimIsa isa) {
+    switch (isa) {
+        case EMB_SIM_ISA_SCALAR:
+            return "scalar";
+        case EMB_SIM_ISA_SSE42:
+            return "sse4.2";
+        case EMB_SIM_ISA_AVX2:
+            return "avx2";
+        case EMB_SIM_ISA_AVX512:
+            return "avx512";
+        case EMB_SIM_ISA_NEON:
+            return "neon";
+    }
+    return "unknown";
+}
+
+int emb_sim_set_isa(EmbSimIsa isa) {
+    if (!isa_supported(isa, detect_isa()))
+        return 0;
+    active_kernels().store(kernels_for(isa));
+    return 1;
+}
+
+float emb_sim_dot(const float *a, const float *b, unsigned dim) {
+    return kernels()->dot_f32(a, b, dim);
+}
+
+float emb_sim_l2sq(const float *a, const float *b, unsigned dim) {
+    return kernels()->l2sq_f32(a, b, dim);
+}
+
+float emb_sim_norm(const float *a, unsigned dim) {
+    return std::sqrt(kernels()->dot_f32(a, a, dim));
+}
+
+float emb_sim_cosine(const float *a, const float *b, unsigned dim) {
+    const EmbSimKernels *k = kernels();
+    float denom = std::sqrt(k->dot_f32(a, a, dim) * k->dot_f32(b, b, dim));
+    return denom > 0.f ? k->dot_f32(a, b, dim) / denom : 0.f;
+}
+
+/// Norm of a non fp32 row when the caller has no precomputed norms
+static float row_norm(const void *row, EmbSimDataType dtype, float scale, unsigned dim) {
+    float sum = 0.f;
+    for (unsigned i = 0; i < dim; i++) {
+        float v;
+        switch (dtype) {
+            case EMB_SIM_FP16:
+                v = emb_sim_f16_to_f32(((const uint16_t *) row)[i]);
+                break;
+            case EMB_SIM_INT8:
+                v = ((const int8_t *) row)[i] * scale;
+                break;
+            default:
+                v = ((const float *) row)[i];
+                break;
+        }
+        sum += v * v;
+    }
+    return std::sqrt(sum);
+}
+
+static size_t element_size(EmbSimDataType dtype) {
+    switch (dtype) {
+        case EMB_SIM_FP16:
+            return sizeof(uint16_t);
+        case EMB_SIM_INT8:
+            return sizeof(int8_t);
+        default:
+            return sizeof(float);
+    }
+}
+
+void emb_sim_score_batch(EmbSimMetric metric, const float *query, unsigned dim,
+                         const void *matrix, EmbSimDataType dtype, float scale,
+                         unsigned rows, size_t row_stride,
+                         const float *row_norms, float *scores) {
+    const EmbSimKernels *k = kernels();
+    if (row_stride == 0)
+        row_stride = element_size(dtype) * dim;
+    const float query_norm = metric == EMB_SIM_COSINE ? std::sqrt(k->dot_f32(query, query, dim)) : 0.f;
+
+    const uint8_t *row = static_cast<const uint8_t *>(matrix);
+    for (unsigned r = 0; r < rows; r++, row += row_stride) {
+        float score;
+        if (metric == EMB_SIM_L2) {
+            switch (dtype) {
+                case EMB_SIM_FP16:
+                    score = k->l2sq_f16(query, (const uint16_t *) row, dim);
+                    break;
+                case EMB_SIM_INT8:
+                    score = k->l2sq_i8(query, (const int8_t *) row, scale, dim);
+                    break;
+                default:
+                    score = k->l2sq_f32(query, (const float *) row, dim);
+                    break;
+            }
+            scores[r] = score;
+            continue;
+        }
+
+        switch (dtype) {
+            case EMB_SIM_FP16:
+                score = k->dot_f16(query, (const uint16_t *) row, dim);
+                break;
+            case EMB_SIM_INT8:
+                score = k->dot_i8(query, (const int8_t *) row, dim) * scale;
+                break;
+            default:
+                score = k->dot_f32(query, (const float *) row, dim);
+                break;
+        }
+        if (metric == EMB_SIM_COSINE) {
+            float norm = row_norms ? row_norms[r] : row_norm(row, dtype, scale, dim);
+            float denom = query_norm * norm;
+            score = denom > 0.f ? score / denom : 0.f;
+        }
+        scores[r] = score;
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __EMBEDDING_SIMILARITY_H__
+#define __EMBEDDING_SIMILARITY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Instruction sets the similarity kernels are implemented for.
+ * The best one supported by the CPU (and the OS, for the AVX state) is
+ * picked once through CPUID; it can be capped with the NVDS_EMB_SIM_ISA
+ * environment variable (scalar, sse4.2, avx2, avx512, neon).
+ */
+typedef enum {
+  EMB_SIM_ISA_SCALAR = 0,
+  EMB_SIM_ISA_SSE42 = 1,
+  EMB_SIM_ISA_AVX2 = 2,
+  EMB_SIM_ISA_AVX512 = 3,
+  EMB_SIM_ISA_NEON = 4,
+} EmbSimIsa;
+
+/** Element type of the rows of a reference matrix */
+typedef enum {
+  EMB_SIM_FP32 = 0,
+  EMB_SIM_FP16 = 1,
+  /** symmetric int8; the real value is int8 * scale */
+  EMB_SIM_INT8 = 2,
+} EmbSimDataType;
+
+typedef enum {
+  /** higher is more similar */
+  EMB_SIM_DOT = 0,
+  /** higher is more similar, in [-1, 1] */
+  EMB_SIM_COSINE = 1,
+  /** squared euclidean distance, lower is more similar */
+  EMB_SIM_L2 = 2,
+} EmbSimMetric;
+
+/** @return the instruction set currently used by the kernels */
+EmbSimIsa emb_sim_get_isa(void);
+
+/** @return printable name of @a isa */
+const char *emb_sim_isa_name(EmbSimIsa isa);
+
+/**
+ * Switch the kernels to @a isa, e.g. to compare implementations.
+ * @return 1 on success, 0 if @a isa is not supported on this machine
+ */
+int emb_sim_set_isa(EmbSimIsa isa);
+
+/** @{ One-to-one kernels over @a dim fp32 elements */
+float emb_sim_dot(const float *a, const float *b, unsigned dim);
+float emb_sim_l2sq(const float *a, const float *b, unsigned dim);
+float emb_sim_cosine(const float *a, const float *b, unsigned dim);
+float emb_sim_norm(const float *a, unsigned dim);
+/** @} */
+
+/**
+ * Score one fp32 query against @a rows reference vectors stored
+ * contiguously, one row every @a row_stride bytes.
+ * @param [in] metric Similarity or distance to compute
+ * @param [in] query fp32 query vector of @a dim elements
+ * @param [in] matrix First row of the reference matrix
+ * @param [in] dtype Element type of the reference matrix
+ * @param [in] scale Dequantization scale, used only for EMB_SIM_INT8
+ * @param [in] row_stride Bytes between two rows; 0 means tightly packed
+ * @param [in] row_norms Optional precomputed L2 norm of every row (already
+ *             dequantized), used only for EMB_SIM_COSINE
+ * @param [out] scores @a rows output scores
+ */
+void emb_sim_score_batch(EmbSimMetric metric, const float *query, unsigned dim,
+                         const void *matrix, EmbSimDataType dtype, float scale,
+                         unsigned rows, size_t row_stride,
+                         const float *row_norms, float *scores);
+
+/** @{ IEEE 754 half precision conversion helpers */
+uint16_t emb_sim_f32_to_f16(float value);
+float emb_sim_f16_to_f32(uint16_t value);
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< __EMBEDDING_SIMILARITY_H__ */
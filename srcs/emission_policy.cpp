@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "emission_policy.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// Checks between two sweeps for tracks the tracker never reported as ended
+#define EVICT_INTERVAL 1024
+
+void EmissionPolicy::init(int max_staleness, float motion_threshold, unsigned frame_budget) {
+    max_staleness_ = std::max(max_staleness, 1);
+    motion_threshold_ = motion_threshold;
+    frame_budget_ = frame_budget;
+    tracks_.clear();
+    budgets_.clear();
+}
+
+EmitReason EmissionPolicy::check(int stream_id, int frame_num, uint64_t object_id,
+                                 const float bbox[4], bool line_crossed) {
+    if (++checks_since_evict_ >= EVICT_INTERVAL) {
+        checks_since_evict_ = 0;
+        evict(stream_id, frame_num);
+    }
+
+    /// Without a tracker every object has the same id: no track to follow
+    if (object_id == kUntrackedObjectId)
+        return frame_num % max_staleness_ ? EMIT_NONE : EMIT_RATE;
+
+    const Key key{object_id, stream_id};
+    auto it = tracks_.find(key);
+    EmitReason reason = EMIT_NONE;
+
+    if (it == tracks_.end()) {
+        /// Back-date the first event by a hash of the track so that the
+        /// staleness deadlines of tracks born together are spread out
+        Track track;
+        track.emit_frame_num = frame_num - (int) (KeyHash()(key) % max_staleness_);
+        track.seen_frame_num = frame_num;
+        std::copy(bbox, bbox + 4, track.bbox);
+        tracks_.emplace(key, track);
+        return EMIT_NEW_TRACK;
+    }
+
+    Track &track = it->second;
+    track.seen_frame_num = frame_num;
+    if (line_crossed) {
+        reason = EMIT_LINE_CROSSING;
+    } else {
+        if (motion_threshold_ > 0.f) {
+            float dx = (bbox[0] + bbox[2] * 0.5f) - (track.bbox[0] + track.bbox[2] * 0.5f);
+            float dy = (bbox[1] + bbox[3] * 0.5f) - (track.bbox[1] + track.bbox[3] * 0.5f);
+            float size = std::max(std::max(track.bbox[2], track.bbox[3]), 1.f);
+            if (std::sqrt(dx * dx + dy * dy) >= motion_threshold_ * size)
+                reason = EMIT_MOTION;
+        }
+        if (reason == EMIT_NONE && frame_num - track.emit_frame_num >= max_staleness_)
+            reason = EMIT_STALE;
+        if (reason == EMIT_NONE)
+            return EMIT_NONE;
+
+        if (frame_budget_ > 0) {
+            if ((size_t) stream_id >= budgets_.size())
+                budgets_.resize(stream_id + 1);
+            StreamBudget &budget = budgets_[stream_id];
+            if (budget.frame_num != frame_num) {
+                budget.frame_num = frame_num;
+                budget.used = 0;
+            }
+            /// Over budget: stay due, try again on the next frame
+            if (budget.used >= frame_budget_)
+                return EMIT_NONE;
+            budget.used++;
+        }
+    }
+
+    track.emit_frame_num = frame_num;
+    std::copy(bbox, bbox + 4, track.bbox);
+    return reason;
+}
+
+bool EmissionPolicy::terminate(int stream_id, uint64_t object_id, float bbox[4]) {
+    auto it = tracks_.find(Key{object_id, stream_id});
+    if (it == tracks_.end())
+        return false;
+    std::copy(it->second.bbox, it->second.bbox + 4, bbox);
+    tracks_.erase(it);
+    return true;
+}
+
+void EmissionPolicy::evict(int stream_id, int frame_num) {
+    /// Frame numbers are per stream, only compare tracks of the same stream
+    const int evict_age = 4 * max_staleness_;
+    for (auto it = tracks_.begin(); it != tracks_.end();) {
+        if (it->first.stream_id == stream_id && frame_num - it->second.seen_frame_num > evict_age)
+            it = tracks_.erase(it);
+        else
+            ++it;
+    }
+}
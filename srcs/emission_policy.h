@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// Why an object event is emitted on this frame
+enum EmitReason {
+    EMIT_NONE = 0,
+    EMIT_NEW_TRACK,
+    EMIT_LINE_CROSSING,
+    EMIT_MOTION,
+    EMIT_STALE,
+    EMIT_RATE,
+};
+
+/// object_id of the objects the tracker did not handle (DeepStream's
+/// UNTRACKED_OBJECT_ID)
+static const uint64_t kUntrackedObjectId = 0xFFFFFFFFFFFFFFFFull;
+
+/// Per-track event emission policy.
+///
+/// A track is reported as soon as it appears or crosses a line. After that
+/// it is reported again when its box moved by a significant fraction of its
+/// size, or when its last event is max_staleness frames old. The first
+/// staleness deadline of a track is shifted by a hash of its id so that
+/// tracks born on the same frame do not stay in lockstep, and motion/stale
+/// events are capped per stream and frame; deferred tracks stay due and go
+/// out on the next frames. New tracks and line crossings bypass the budget.
+///
+/// Tracks need a tracker: untracked objects all share kUntrackedObjectId, so
+/// they fall back to one event each on every max_staleness-th frame.
+class EmissionPolicy {
+public:
+    /// @param [in] max_staleness Frames between two events of a static track
+    /// @param [in] motion_threshold Center displacement, relative to the box
+    ///             size, that counts as motion; 0 disables motion events
+    /// @param [in] frame_budget Motion/stale events per stream and frame;
+    ///             0 is unlimited
+    void init(int max_staleness, float motion_threshold, unsigned frame_budget);
+
+    /// Decide whether the object gets an event on this frame; the track state
+    /// is updated as if the event was sent when the result is not EMIT_NONE.
+    EmitReason check(int stream_id, int frame_num, uint64_t object_id,
+                     const float bbox[4], bool line_crossed);
+
+    /// Drop a terminated track.
+    /// @param [out] bbox Last box reported for it
+    /// @return true if the track had been reported
+    bool terminate(int stream_id, uint64_t object_id, float bbox[4]);
+
+private:
+    struct Key {
+        uint64_t object_id;
+        int stream_id;
+        bool operator==(const Key &other) const {
+            return object_id == other.object_id && stream_id == other.stream_id;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<uint64_t>()(key.object_id * 0x9E3779B97F4A7C15ull + key.stream_id);
+        }
+    };
+    struct Track {
+        int emit_frame_num;
+        int seen_frame_num;
+        float bbox[4];  ///< left, top, width, height of the last event
+    };
+    struct StreamBudget {
+        int frame_num = -1;
+        unsigned used = 0;
+    };
+
+    void evict(int stream_id, int frame_num);
+
+    int max_staleness_ = 30;
+    float motion_threshold_ = 0.f;
+    unsigned frame_budget_ = 0;
+    unsigned checks_since_evict_ = 0;
+    std::unordered_map<Key, Track, KeyHash> tracks_;
+    std::vector<StreamBudget> budgets_;
+};
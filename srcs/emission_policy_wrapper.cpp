@@ -0,0 +1,57 @@
+#include "emission_policy_wrapper.h"
+#include "emission_policy.h"
+
+// Wrapper struct to hold the actual C++ object
+struct EmissionPolicyWrapper {
+    EmissionPolicy* policy;
+};
+
+// Create and destroy
+EmissionPolicyWrapper* create_emission_policy(int max_staleness, float motion_threshold,
+                                              unsigned frame_budget) {
+    EmissionPolicyWrapper* wrapper = new EmissionPolicyWrapper();
+    wrapper->policy = new EmissionPolicy();
+    wrapper->policy->init(max_staleness, motion_threshold, frame_budget);
+    return wrapper;
+}
+
+void destroy_emission_policy(EmissionPolicyWrapper* wrapper) {
+    if (wrapper) {
+        delete wrapper->policy;
+        delete wrapper;
+    }
+}
+
+// Check
+int emission_policy_check(EmissionPolicyWrapper* wrapper, int stream_id, int frame_num,
+                          uint64_t object_id, const float* bbox, int line_crossed) {
+    if (!wrapper || !wrapper->policy)
+        return EMIT_NONE;
+    return wrapper->policy->check(stream_id, frame_num, object_id, bbox, line_crossed != 0);
+}
+
+// Terminate
+int emission_policy_terminate(EmissionPolicyWrapper* wrapper, int stream_id,
+                              uint64_t object_id, float* bbox) {
+    if (!wrapper || !wrapper->policy)
+        return 0;
+    return wrapper->policy->terminate(stream_id, object_id, bbox) ? 1 : 0;
+}
+
+// Reason name
+const char* emission_policy_reason_name(int reason) {
+    switch (reason) {
+        case EMIT_NEW_TRACK:
+            return "new";
+        case EMIT_LINE_CROSSING:
+            return "crossing";
+        case EMIT_MOTION:
+            return "motion";
+        case EMIT_STALE:
+            return "stale";
+        case EMIT_RATE:
+            return "rate";
+        default:
+            return "none";
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef EMISSION_POLICY_WRAPPER_H
+#define EMISSION_POLICY_WRAPPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct EmissionPolicyWrapper EmissionPolicyWrapper;
+
+// Create and destroy an EmissionPolicy object
+EmissionPolicyWrapper* create_emission_policy(int max_staleness, float motion_threshold,
+                                              unsigned frame_budget);
+void destroy_emission_policy(EmissionPolicyWrapper* policy);
+
+// Returns the EmitReason of the object on this frame (0 = no event).
+// bbox is left, top, width, height.
+int emission_policy_check(EmissionPolicyWrapper* policy, int stream_id, int frame_num,
+                          uint64_t object_id, const float* bbox, int line_crossed);
+
+// Drop a terminated track; returns 1 and its last reported bbox if it had
+// been reported
+int emission_policy_terminate(EmissionPolicyWrapper* policy, int stream_id,
+                              uint64_t object_id, float* bbox);
+
+// Printable name of an EmitReason
+const char* emission_policy_reason_name(int reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMISSION_POLICY_WRAPPER_H
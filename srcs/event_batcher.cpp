@@ -0,0 +1,248 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "event_batcher.h"
+#include "event_codec.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+static const char *event_type_name(int type) {
+    static const char *names[] = {"entry", "exit", "moving", "stopped", "empty", "parked", "reset"};
+    if (type >= 0 && type < (int)(sizeof(names) / sizeof(names[0])))
+        return names[type];
+    return "custom";
+}
+
+static void append_escaped(std::string &out, const char *str) {
+    out += '"';
+    for (const char *c = str ? str : ""; *c; ++c) {
+        switch (*c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)*c < 0x20) {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)*c);
+                out += esc;
+            } else {
+                out += *c;
+            }
+        }
+    }
+    out += '"';
+}
+
+/// Shortest representation that reads back to the same float
+static void append_number(std::string &out, float value) {
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr - buf);
+}
+
+static void append_field(std::string &out, const char *key, const char *value) {
+    if (!value)
+        return;
+    out += ",\"";
+    out += key;
+    out += "\":";
+    append_escaped(out, value);
+}
+
+static uint16_t str_len(const char *str) {
+    size_t len = str ? strlen(str) : 0;
+    return len > UINT16_MAX ? UINT16_MAX : (uint16_t) len;
+}
+
+EventBatcher::EventBatcher(uint64_t interval_ns, size_t max_objects, EventBatchFormat format)
+    : interval_ns_(interval_ns), max_objects_(max_objects), format_(format) {}
+
+void EventBatcher::append_object(std::string &out, const NvDsEventMsgMeta *meta) {
+    out += "{\"event\":\"";
+    out += event_type_name(meta->type);
+    out += "\",\"id\":";
+    out += std::to_string(meta->trackingId);
+    append_field(out, "label", meta->objectId);
+    out += ",\"classId\":";
+    out += std::to_string(meta->objClassId);
+    out += ",\"confidence\":";
+    append_number(out, meta->confidence);
+    out += ",\"bbox\":[";
+    append_number(out, meta->bbox.left);
+    out += ',';
+    append_number(out, meta->bbox.top);
+    out += ',';
+    append_number(out, meta->bbox.width);
+    out += ',';
+    append_number(out, meta->bbox.height);
+    out += ']';
+    append_field(out, "attributes", meta->otherAttrs);
+
+    if (meta->extMsg && meta->objType == NVDS_OBJECT_TYPE_PERSON) {
+        /// The app stores the crossing direction in gender, the event in cap
+        /// and the crop path in hair
+        const NvDsPersonObject *person = (const NvDsPersonObject *)meta->extMsg;
+        out += ",\"person\":{\"status\":";
+        append_escaped(out, person->cap);
+        append_field(out, "direction", person->gender);
+        append_field(out, "image", person->hair);
+        out += '}';
+    } else if (meta->extMsg && meta->objType == NVDS_OBJECT_TYPE_PRODUCT) {
+        const NvDsProductObject *product = (const NvDsProductObject *)meta->extMsg;
+        out += ",\"product\":{\"label\":";
+        append_escaped(out, product->brand);
+        append_field(out, "class", product->type);
+        out += '}';
+    }
+
+    if (meta->embedding.embedding_vector && meta->embedding.embedding_length > 0) {
+        out += ",\"embedding\":[";
+        for (unsigned i = 0; i < meta->embedding.embedding_length; i++) {
+            if (i)
+                out += ',';
+            append_number(out, meta->embedding.embedding_vector[i]);
+        }
+        out += ']';
+    }
+    out += '}';
+}
+
+void EventBatcher::append_record(std::string &out, const NvDsEventMsgMeta *meta) {
+    EventCodecRecord record = {};
+    record.event_type = meta->type;
+    record.object_type = meta->objType;
+    record.tracking_id = meta->trackingId;
+    record.timestamp_us = event_codec_parse_rfc3339(meta->ts);
+    record.frame_id = meta->frameId;
+    record.class_id = meta->objClassId;
+    record.confidence = meta->confidence;
+    record.bbox[0] = meta->bbox.left;
+    record.bbox[1] = meta->bbox.top;
+    record.bbox[2] = meta->bbox.width;
+    record.bbox[3] = meta->bbox.height;
+    record.embedding = meta->embedding.embedding_vector;
+    record.embedding_len = meta->embedding.embedding_vector ? meta->embedding.embedding_length : 0;
+    record.label = meta->objectId;
+    record.label_len = str_len(meta->objectId);
+    record.attrs = meta->otherAttrs;
+    record.attrs_len = str_len(meta->otherAttrs);
+    if (meta->extMsg && meta->objType == NVDS_OBJECT_TYPE_PERSON) {
+        const NvDsPersonObject *person = (const NvDsPersonObject *)meta->extMsg;
+        record.image = person->hair;
+        record.image_len = str_len(person->hair);
+        record.direction = person->gender;
+        record.direction_len = str_len(person->gender);
+    } else if (meta->extMsg && meta->objType == NVDS_OBJECT_TYPE_PRODUCT) {
+        /// Gallery match: the label is the matched class
+        const NvDsProductObject *product = (const NvDsProductObject *)meta->extMsg;
+        record.label = product->brand;
+        record.label_len = str_len(product->brand);
+    }
+
+    size_t offset = out.size();
+    out.resize(offset + event_codec_record_size(&record));
+    event_codec_write_record((uint8_t *) &out[offset], &record);
+}
+
+void EventBatcher::add(unsigned stream_id, const NvDsEventMsgMeta *meta, uint64_t frame_pts) {
+    Window &window = windows_[stream_id];
+    if (window.num_objects == 0) {
+        window.start_pts = frame_pts;
+        window.sensor_id = meta->sensorId;
+        window.sensor = meta->sensorStr ? meta->sensorStr : "";
+        window.first_ts = meta->ts ? meta->ts : "";
+    }
+    if (format_ == EVENT_BATCH_BINARY) {
+        append_record(window.frames, meta);
+    } else if (meta->frameId != window.frame_id) {
+        if (window.frame_id >= 0)
+            window.frames += "]},";
+        window.frame_id = meta->frameId;
+        window.last_ts = meta->ts ? meta->ts : "";
+        window.frames += "{\"frameId\":";
+        window.frames += std::to_string(meta->frameId);
+        window.frames += ",\"@timestamp\":";
+        append_escaped(window.frames, meta->ts);
+        window.frames += ",\"objects\":[";
+        append_object(window.frames, meta);
+    } else {
+        window.frames += ',';
+        append_object(window.frames, meta);
+    }
+    window.num_objects++;
+    objects_++;
+}
+
+bool EventBatcher::flush(unsigned stream_id, uint64_t frame_pts, bool force, std::string &payload) {
+    auto it = windows_.find(stream_id);
+    if (it == windows_.end() || it->second.num_objects == 0)
+        return false;
+    Window &window = it->second;
+    bool due = force || interval_ns_ == 0 ||
+               frame_pts - window.start_pts >= interval_ns_ ||
+               (max_objects_ && window.num_objects >= max_objects_);
+    if (!due)
+        return false;
+
+    if (format_ == EVENT_BATCH_BINARY)
+        finish_binary(window, payload);
+    else
+        finish_json(window, payload);
+
+    window.frames.clear();
+    window.frame_id = -1;
+    window.num_objects = 0;
+    messages_++;
+    return true;
+}
+
+void EventBatcher::finish_binary(const Window &window, std::string &payload) {
+    size_t header_size = event_codec_header_size(window.sensor.size());
+    payload.resize(header_size);
+    event_codec_write_header((uint8_t *) &payload[0], window.num_objects, window.sensor_id,
+                             window.sensor.data(), window.sensor.size());
+    payload += window.frames;
+}
+
+void EventBatcher::finish_json(const Window &window, std::string &payload) {
+    payload.clear();
+    payload.reserve(window.frames.size() + window.sensor.size() + 192);
+    payload += "{\"version\":\"1.0\",\"sensorId\":\"";
+    payload += std::to_string(window.sensor_id);
+    payload += '"';
+    if (!window.sensor.empty())
+        append_field(payload, "sensor", window.sensor.c_str());
+    payload += ",\"@timestamp\":";
+    append_escaped(payload, window.first_ts.c_str());
+    payload += ",\"end\":";
+    append_escaped(payload, window.last_ts.c_str());
+    payload += ",\"numObjects\":";
+    payload += std::to_string(window.num_objects);
+    payload += ",\"frames\":[";
+    payload += window.frames;
+    payload += "]}]}";
+}
@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "nvdsmeta_schema.h"
+
+/// Aggregates the events of a stream into one JSON message per frame or per
+/// time window, instead of one broker message per object.
+///
+/// Sensor and window timestamps are written once in the header and objects
+/// are grouped by frame:
+/// {
+///   "version": "1.0",
+///   "sensorId": "0", "sensor": "cam-0",
+///   "@timestamp": "<first frame>", "end": "<last frame>",
+///   "numObjects": 2,
+///   "frames": [
+///     { "frameId": 30, "@timestamp": "...", "objects": [
+///       { "event": "entry", "id": 12, "label": "person", "classId": 0,
+///         "confidence": 0.91, "bbox": [l, t, w, h],
+///         "attributes": "emit=new", "person": {...}, "embedding": [...] }
+///     ] }
+///   ]
+/// }
+///
+/// With EVENT_BATCH_BINARY the message is the little-endian layout of
+/// event_codec.h instead: the same fields, with raw embedding bytes.
+///
+/// Objects are serialized into a per-stream buffer as they are added; the
+/// buffers keep their capacity across windows, so steady state costs one
+/// copy per message and no allocation per object.
+enum EventBatchFormat {
+    EVENT_BATCH_JSON = 0,
+    EVENT_BATCH_BINARY = 1,
+};
+
+class EventBatcher {
+public:
+    /// @param [in] interval_ns Window length in stream time; 0 sends one
+    ///             message per frame
+    /// @param [in] max_objects Objects after which a window is sent early;
+    ///             0 for no limit
+    /// @param [in] format Message encoding
+    EventBatcher(uint64_t interval_ns, size_t max_objects,
+                 EventBatchFormat format = EVENT_BATCH_JSON);
+
+    /// Serialize an event into the open window of its stream
+    /// @param [in] frame_pts Buffer timestamp of the frame the event belongs to
+    void add(unsigned stream_id, const NvDsEventMsgMeta *meta, uint64_t frame_pts);
+
+    /// Close the window of a stream if it is due.
+    /// @param [in] frame_pts Buffer timestamp of the current frame
+    /// @param [in] force Close the window whatever its age
+    /// @param [out] payload Message, replaced when a window is closed
+    /// @return true if payload holds a message
+    bool flush(unsigned stream_id, uint64_t frame_pts, bool force, std::string &payload);
+
+    uint64_t num_messages() const { return messages_; }
+    uint64_t num_objects() const { return objects_; }
+
+private:
+    struct Window {
+        std::string frames;       ///< serialized frames without the brackets, or records
+        std::string sensor;
+        std::string first_ts;
+        std::string last_ts;
+        int sensor_id = 0;
+        int frame_id = -1;        ///< frame whose object list is open
+        uint64_t start_pts = 0;
+        size_t num_objects = 0;
+    };
+
+    void append_object(std::string &out, const NvDsEventMsgMeta *meta);
+    void append_record(std::string &out, const NvDsEventMsgMeta *meta);
+    void finish_json(const Window &window, std::string &payload);
+    void finish_binary(const Window &window, std::string &payload);
+
+    uint64_t interval_ns_;
+    size_t max_objects_;
+    EventBatchFormat format_;
+    uint64_t messages_ = 0;
+    uint64_t objects_ = 0;
+    std::unordered_map<unsigned, Window> windows_;
+};
@@ -0,0 +1,52 @@
+#include "event_batcher_wrapper.h"
+#include "event_batcher.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Wrapper struct to hold the actual C++ object
+struct EventBatcherWrapper {
+    EventBatcher* batcher;
+    std::string payload;
+};
+
+// Create and destroy
+EventBatcherWrapper* create_event_batcher(unsigned interval_ms, unsigned max_objects, int binary) {
+    EventBatcherWrapper* wrapper = new EventBatcherWrapper();
+    wrapper->batcher = new EventBatcher((uint64_t)interval_ms * 1000000ull, max_objects,
+                                        binary ? EVENT_BATCH_BINARY : EVENT_BATCH_JSON);
+    return wrapper;
+}
+
+void destroy_event_batcher(EventBatcherWrapper* wrapper) {
+    if (wrapper) {
+        std::cout << "Batched events: " << wrapper->batcher->num_objects() << " objects in "
+                  << wrapper->batcher->num_messages() << " messages\n";
+        delete wrapper->batcher;
+        delete wrapper;
+    }
+}
+
+// Add
+void event_batcher_add(EventBatcherWrapper* wrapper, unsigned stream_id,
+                       const NvDsEventMsgMeta* meta, uint64_t frame_pts) {
+    if (wrapper && wrapper->batcher && meta)
+        wrapper->batcher->add(stream_id, meta, frame_pts);
+}
+
+// Flush
+int event_batcher_flush(EventBatcherWrapper* wrapper, unsigned stream_id, uint64_t frame_pts,
+                        int force, char** payload, size_t* payload_size) {
+    if (!wrapper || !wrapper->batcher || !payload)
+        return 0;
+    if (!wrapper->batcher->flush(stream_id, frame_pts, force != 0, wrapper->payload))
+        return 0;
+    *payload = (char*)malloc(wrapper->payload.size() + 1);
+    if (!*payload)
+        return 0;
+    memcpy(*payload, wrapper->payload.c_str(), wrapper->payload.size() + 1);
+    if (payload_size)
+        *payload_size = wrapper->payload.size();
+    return 1;
+}
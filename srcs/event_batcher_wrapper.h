@@ -0,0 +1,35 @@
+#ifndef EVENT_BATCHER_WRAPPER_H
+#define EVENT_BATCHER_WRAPPER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "nvdsmeta_schema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct EventBatcherWrapper EventBatcherWrapper;
+
+// Create and destroy an EventBatcher object. interval_ms is the window of
+// every message (0 = one message per frame), max_objects the objects after
+// which a window is sent early (0 = no limit). binary selects the
+// event_codec.h layout instead of JSON.
+EventBatcherWrapper* create_event_batcher(unsigned interval_ms, unsigned max_objects, int binary);
+void destroy_event_batcher(EventBatcherWrapper* batcher);
+
+// Serialize an event into the open window of its stream; the meta can be
+// released right after
+void event_batcher_add(EventBatcherWrapper* batcher, unsigned stream_id,
+                       const NvDsEventMsgMeta* meta, uint64_t frame_pts);
+
+// Returns 1 and a malloc'ed message in payload when the window of the
+// stream is due (or force is set), 0 otherwise
+int event_batcher_flush(EventBatcherWrapper* batcher, unsigned stream_id, uint64_t frame_pts,
+                        int force, char** payload, size_t* payload_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_BATCHER_WRAPPER_H
@@ -0,0 +1,372 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "event_codec.h"
+
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "event_codec writes host order; add byte swapping for big-endian hosts"
+#endif
+
+#define ALIGN8(x) (((x) + 7) & ~(size_t) 7)
+
+/// On-wire layouts; fields are copied with memcpy, never accessed in place
+struct EventCodecHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t num_records;
+    int32_t sensor_id;
+    uint32_t sensor_len;
+    uint32_t reserved;
+};
+static_assert(sizeof(EventCodecHeader) == EVENT_CODEC_HEADER_SIZE, "EventCodecHeader layout changed");
+
+struct EventCodecRecordHeader {
+    uint32_t record_size;
+    uint16_t event_type;
+    uint16_t object_type;
+    uint64_t tracking_id;
+    int64_t timestamp_us;
+    int32_t frame_id;
+    int32_t class_id;
+    float confidence;
+    float bbox[4];
+    uint32_t embedding_len;
+    uint16_t label_len;
+    uint16_t image_len;
+    uint16_t direction_len;
+    uint16_t attrs_len;
+};
+static_assert(sizeof(EventCodecRecordHeader) == EVENT_CODEC_RECORD_HEADER_SIZE,
+              "EventCodecRecordHeader layout changed");
+
+size_t event_codec_header_size(uint32_t sensor_len) {
+    return ALIGN8(sizeof(EventCodecHeader) + sensor_len);
+}
+
+size_t event_codec_write_header(uint8_t *dst, uint32_t num_records,
+                                int32_t sensor_id, const char *sensor,
+                                uint32_t sensor_len) {
+    EventCodecHeader header;
+    memcpy(header.magic, EVENT_CODEC_MAGIC, sizeof(header.magic));
+    header.version = EVENT_CODEC_VERSION;
+    header.header_size = sizeof(EventCodecHeader);
+    header.num_records = num_records;
+    header.sensor_id = sensor_id;
+    header.sensor_len = sensor ? sensor_len : 0;
+    header.reserved = 0;
+    memcpy(dst, &header, sizeof(header));
+
+    size_t size = event_codec_header_size(header.sensor_len);
+    memset(dst + sizeof(header), 0, size - sizeof(header));
+    if (header.sensor_len)
+        memcpy(dst + sizeof(header), sensor, header.sensor_len);
+    return size;
+}
+
+size_t event_codec_record_size(const EventCodecRecord *record) {
+    return ALIGN8(sizeof(EventCodecRecordHeader) +
+                  (size_t) record->embedding_len * sizeof(float) +
+                  record->label_len + record->image_len +
+                  record->direction_len + record->attrs_len);
+}
+
+static uint8_t *write_bytes(uint8_t *dst, const void *src, size_t size) {
+    if (src && size)
+        memcpy(dst, src, size);
+    return dst + size;
+}
+
+size_t event_codec_write_record(uint8_t *dst, const EventCodecRecord *record) {
+    EventCodecRecordHeader header;
+    header.record_size = event_codec_record_size(record);
+    header.event_type = record->event_type;
+    header.object_type = record->object_type;
+    header.tracking_id = record->tracking_id;
+    header.timestamp_us = record->timestamp_us;
+    header.frame_id = record->frame_id;
+    header.class_id = record->class_id;
+    header.confidence = record->confidence;
+    memcpy(header.bbox, record->bbox, sizeof(header.bbox));
+    header.embedding_len = record->embedding ? record->embedding_len : 0;
+    header.label_len = record->label ? record->label_len : 0;
+    header.image_len = record->image ? record->image_len : 0;
+    header.direction_len = record->direction ? record->direction_len : 0;
+    header.attrs_len = record->attrs ? record->attrs_len : 0;
+
+    uint8_t *p = write_bytes(dst, &header, sizeof(header));
+    p = write_bytes(p, record->embedding, (size_t) header.embedding_len * sizeof(float));
+    p = write_bytes(p, record->label, header.label_len);
+    p = write_bytes(p, record->image, header.image_len);
+    p = write_bytes(p, record->direction, header.direction_len);
+    p = write_bytes(p, record->attrs, header.attrs_len);
+    memset(p, 0, dst + header.record_size - p);
+    return header.record_size;
+}
+
+size_t event_codec_decode_header(const uint8_t *data, size_t size,
+                                 EventCodecMessage *message) {
+    EventCodecHeader header;
+    if (!data || size < sizeof(header))
+        return 0;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, EVENT_CODEC_MAGIC, sizeof(header.magic)) ||
+        header.version != EVENT_CODEC_VERSION || header.header_size < sizeof(header))
+        return 0;
+    size_t offset = ALIGN8((size_t) header.header_size + header.sensor_len);
+    if (offset > size)
+        return 0;
+    if (message) {
+        message->version = header.version;
+        message->num_records = header.num_records;
+        message->sensor_id = header.sensor_id;
+        message->sensor = (const char *) data + header.header_size;
+        message->sensor_len = header.sensor_len;
+    }
+    return offset;
+}
+
+int event_codec_next_record(const uint8_t *data, size_t size, size_t *offset,
+                            EventCodecRecord *record) {
+    EventCodecRecordHeader header;
+    if (!data || !offset || *offset + sizeof(header) > size)
+        return 0;
+    memcpy(&header, data + *offset, sizeof(header));
+    size_t payload = (size_t) header.embedding_len * sizeof(float) + header.label_len +
+                     header.image_len + header.direction_len + header.attrs_len;
+    if (header.record_size < sizeof(header) + payload || header.record_size > size - *offset)
+        return 0;
+
+    const uint8_t *p = data + *offset + sizeof(header);
+    record->event_type = header.event_type;
+    record->object_type = header.object_type;
+    record->tracking_id = header.tracking_id;
+    record->timestamp_us = header.timestamp_us;
+    record->frame_id = header.frame_id;
+    record->class_id = header.class_id;
+    record->confidence = header.confidence;
+    memcpy(record->bbox, header.bbox, sizeof(record->bbox));
+    record->embedding_len = header.embedding_len;
+    record->embedding = header.embedding_len ? (const float *) p : nullptr;
+    p += (size_t) header.embedding_len * sizeof(float);
+    record->label_len = header.label_len;
+    record->label = (const char *) p;
+    p += header.label_len;
+    record->image_len = header.image_len;
+    record->image = (const char *) p;
+    p += header.image_len;
+    record->direction_len = header.direction_len;
+    record->direction = (const char *) p;
+    p += header.direction_len;
+    record->attrs_len = header.attrs_len;
+    record->attrs = (const char *) p;
+
+    *offset += header.record_size;
+    return 1;
+}
+
+struct EventCodecHeatmapHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    int32_t sensor_id;
+    uint16_t grid_width;
+    uint16_t grid_height;
+    uint16_t cell_size;
+    uint16_t reserved;
+    int64_t start_us;
+    int64_t end_us;
+    uint32_t num_frames;
+    uint32_t cells_len;
+    uint32_t occupancy_len;
+} __attribute__((packed));
+static_assert(sizeof(EventCodecHeatmapHeader) == EVENT_CODEC_HEATMAP_HEADER_SIZE,
+              "EventCodecHeatmapHeader layout changed");
+
+static uint8_t *write_varint(uint8_t *p, uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t) value;
+    return p;
+}
+
+static int read_varint(const uint8_t **p, const uint8_t *end, uint32_t *value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        uint8_t byte = *(*p)++;
+        result |= (uint32_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+size_t event_codec_heatmap_max_size(const EventCodecHeatmap *heatmap) {
+    /// At most 5 + 5 bytes per cell and 3 bytes per frame
+    return sizeof(EventCodecHeatmapHeader) +
+           (size_t) heatmap->grid_width * heatmap->grid_height * 10 +
+           (size_t) heatmap->num_frames * 3;
+}
+
+size_t event_codec_write_heatmap(uint8_t *dst, const EventCodecHeatmap *heatmap) {
+    EventCodecHeatmapHeader header;
+    memcpy(header.magic, EVENT_CODEC_HEATMAP_MAGIC, sizeof(header.magic));
+    header.version = EVENT_CODEC_VERSION;
+    header.header_size = sizeof(EventCodecHeatmapHeader);
+    header.sensor_id = heatmap->sensor_id;
+    header.grid_width = heatmap->grid_width;
+    header.grid_height = heatmap->grid_height;
+    header.cell_size = heatmap->cell_size;
+    header.reserved = 0;
+    header.start_us = heatmap->start_us;
+    header.end_us = heatmap->end_us;
+    header.num_frames = heatmap->num_frames;
+
+    uint8_t *cells = dst + sizeof(header);
+    uint8_t *p = cells;
+    const size_t num_cells = (size_t) heatmap->grid_width * heatmap->grid_height;
+    size_t skipped = 0;
+    for (size_t i = 0; i < num_cells; i++) {
+        if (!heatmap->cells[i]) {
+            skipped++;
+            continue;
+        }
+        p = write_varint(p, (uint32_t) skipped);
+        p = write_varint(p, heatmap->cells[i]);
+        skipped = 0;
+    }
+    header.cells_len = (uint32_t) (p - cells);
+
+    uint8_t *occupancy = p;
+    int32_t previous = 0;
+    for (uint32_t i = 0; i < heatmap->num_frames; i++) {
+        int32_t delta = (int32_t) heatmap->occupancy[i] - previous;
+        p = write_varint(p, ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31));
+        previous = heatmap->occupancy[i];
+    }
+    header.occupancy_len = (uint32_t) (p - occupancy);
+    memcpy(dst, &header, sizeof(header));
+    return p - dst;
+}
+
+int event_codec_decode_heatmap(const uint8_t *data, size_t size,
+                               EventCodecHeatmap *heatmap, uint32_t *cells,
+                               uint16_t *occupancy) {
+    EventCodecHeatmapHeader header;
+    if (!data || size < sizeof(header))
+        return 0;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, EVENT_CODEC_HEATMAP_MAGIC, sizeof(header.magic)) ||
+        header.version != EVENT_CODEC_VERSION || header.header_size < sizeof(header) ||
+        (size_t) header.header_size + header.cells_len + header.occupancy_len > size)
+        return 0;
+    heatmap->sensor_id = header.sensor_id;
+    heatmap->grid_width = header.grid_width;
+    heatmap->grid_height = header.grid_height;
+    heatmap->cell_size = header.cell_size;
+    heatmap->start_us = header.start_us;
+    heatmap->end_us = header.end_us;
+    heatmap->num_frames = header.num_frames;
+    heatmap->cells = cells;
+    heatmap->occupancy = occupancy;
+    if (!cells || !occupancy)
+        return 1;
+
+    const size_t num_cells = (size_t) header.grid_width * header.grid_height;
+    memset(cells, 0, num_cells * sizeof(uint32_t));
+    const uint8_t *p = data + header.header_size;
+    const uint8_t *end = p + header.cells_len;
+    size_t index = 0;
+    while (p < end) {
+        uint32_t skipped, count;
+        if (!read_varint(&p, end, &skipped) || !read_varint(&p, end, &count) ||
+            index + skipped >= num_cells)
+            return 0;
+        index += skipped;
+        cells[index++] = count;
+    }
+
+    end = p + header.occupancy_len;
+    int32_t previous = 0;
+    for (uint32_t i = 0; i < header.num_frames; i++) {
+        uint32_t zigzag;
+        if (!read_varint(&p, end, &zigzag))
+            return 0;
+        previous += (int32_t) (zigzag >> 1) ^ -(int32_t) (zigzag & 1);
+        occupancy[i] = (uint16_t) previous;
+    }
+    return 1;
+}
+
+static int parse_digits(const char *s, int n, int *value) {
+    int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (s[i] < '0' || s[i] > '9')
+            return 0;
+        v = v * 10 + (s[i] - '0');
+    }
+    *value = v;
+    return 1;
+}
+
+/// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+int64_t event_codec_parse_rfc3339(const char *ts) {
+    int year, month, day, hour, minute, second;
+    if (!ts || strlen(ts) < 20 ||
+        !parse_digits(ts, 4, &year) || ts[4] != '-' ||
+        !parse_digits(ts + 5, 2, &month) || ts[7] != '-' ||
+        !parse_digits(ts + 8, 2, &day) || ts[10] != 'T' ||
+        !parse_digits(ts + 11, 2, &hour) || ts[13] != ':' ||
+        !parse_digits(ts + 14, 2, &minute) || ts[16] != ':' ||
+        !parse_digits(ts + 17, 2, &second))
+        return 0;
+
+    int64_t usec = 0;
+    const char *p = ts + 19;
+    if (*p == '.') {
+        int64_t scale = 100000;
+        for (p++; *p >= '0' && *p <= '9'; p++) {
+            usec += (*p - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (*p != 'Z')
+        return 0;
+    int64_t seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    return seconds * 1000000 + usec;
+}
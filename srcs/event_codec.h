@@ -0,0 +1,202 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __EVENT_CODEC_H__
+#define __EVENT_CODEC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Binary event payload, an alternative to the JSON messages for consumers
+ * that want the raw embeddings. All integers and floats are little-endian;
+ * every record starts 8-byte aligned relative to the message.
+ *
+ *   message header            EVENT_CODEC_HEADER_SIZE bytes
+ *     char[4]   magic         "FSEV"
+ *     uint16    version       EVENT_CODEC_VERSION
+ *     uint16    header_size   bytes up to the sensor name
+ *     uint32    num_records
+ *     int32     sensor_id
+ *     uint32    sensor_len    bytes of sensor name, not NUL-terminated
+ *     uint32    reserved
+ *   sensor name, zero padded to 8 bytes
+ *   num_records records:
+ *     uint32    record_size   bytes up to the next record
+ *     uint16    event_type    NvDsEventType
+ *     uint16    object_type   NvDsObjectType
+ *     uint64    tracking_id
+ *     int64     timestamp_us  UTC microseconds since the epoch
+ *     int32     frame_id
+ *     int32     class_id
+ *     float32   confidence
+ *     float32   bbox[4]       left, top, width, height in source pixels
+ *     uint32    embedding_len elements
+ *     uint16    label_len, image_len, direction_len, attrs_len
+ *     float32   embedding[embedding_len]
+ *     label, image, direction and attrs bytes back to back, not
+ *     NUL-terminated, zero padded to 8 bytes
+ *
+ * This header and event_codec.cpp have no DeepStream dependency so
+ * consumers can build the decoder on its own (make event-codec).
+ */
+#define EVENT_CODEC_MAGIC "FSEV"
+#define EVENT_CODEC_VERSION 1
+#define EVENT_CODEC_HEADER_SIZE 24
+#define EVENT_CODEC_RECORD_HEADER_SIZE 64
+
+/**
+ * One event. When encoding, pointers are read and strings need not be
+ * NUL-terminated; when decoding, they point into the message buffer.
+ */
+typedef struct {
+  uint16_t event_type;
+  uint16_t object_type;
+  uint64_t tracking_id;
+  int64_t timestamp_us;
+  int32_t frame_id;
+  int32_t class_id;
+  float confidence;
+  float bbox[4];
+  const float *embedding;
+  uint32_t embedding_len;
+  const char *label;
+  uint16_t label_len;
+  const char *image;
+  uint16_t image_len;
+  const char *direction;
+  uint16_t direction_len;
+  const char *attrs;
+  uint16_t attrs_len;
+} EventCodecRecord;
+
+typedef struct {
+  uint16_t version;
+  uint32_t num_records;
+  int32_t sensor_id;
+  const char *sensor;
+  uint32_t sensor_len;
+} EventCodecMessage;
+
+/** @return bytes event_codec_write_header() writes for this sensor name */
+size_t event_codec_header_size(uint32_t sensor_len);
+
+/** Write the message header and sensor name at @a dst
+ * @return bytes written */
+size_t event_codec_write_header(uint8_t *dst, uint32_t num_records,
+                                int32_t sensor_id, const char *sensor,
+                                uint32_t sensor_len);
+
+/** @return bytes event_codec_write_record() writes for @a record */
+size_t event_codec_record_size(const EventCodecRecord *record);
+
+/** Write one record at @a dst, 8-byte aligned relative to the message
+ * @return bytes written */
+size_t event_codec_write_record(uint8_t *dst, const EventCodecRecord *record);
+
+/**
+ * Parse the message header.
+ * @return offset of the first record, 0 if @a data is not a valid message
+ */
+size_t event_codec_decode_header(const uint8_t *data, size_t size,
+                                 EventCodecMessage *message);
+
+/**
+ * Decode the record at @a *offset and advance it to the next one.
+ * The embedding points into @a data, so it is float aligned as long as
+ * @a data is.
+ * @return 1 on success, 0 at the end of the message or on a truncated record
+ */
+int event_codec_next_record(const uint8_t *data, size_t size, size_t *offset,
+                            EventCodecRecord *record);
+
+/**
+ * Heatmap message, sent per stream every --heatmap-interval seconds in
+ * place of the positions of every detection. Little-endian, no padding:
+ *
+ *   char[4]   magic         "FSHM"
+ *   uint16    version       EVENT_CODEC_VERSION
+ *   uint16    header_size   EVENT_CODEC_HEATMAP_HEADER_SIZE
+ *   int32     sensor_id
+ *   uint16    grid_width    cells
+ *   uint16    grid_height
+ *   uint16    cell_size     pixels of the streammux resolution
+ *   uint16    reserved
+ *   int64     start_us      first frame of the window, UTC microseconds
+ *   int64     end_us        last frame of the window
+ *   uint32    num_frames
+ *   uint32    cells_len     bytes of the cell counts
+ *   uint32    occupancy_len bytes of the occupancy series
+ *   cell counts, row major, as varint pairs for the non-zero cells only:
+ *     (cells skipped since the previous non-zero one, count)
+ *   occupancy series, objects on each of the num_frames frames, as
+ *     zigzag varint deltas from the previous frame
+ *
+ * varints are LEB128: 7 bits per byte, low bits first, high bit set on
+ * every byte but the last.
+ */
+#define EVENT_CODEC_HEATMAP_MAGIC "FSHM"
+#define EVENT_CODEC_HEATMAP_HEADER_SIZE 48
+
+typedef struct {
+  int32_t sensor_id;
+  uint16_t grid_width;
+  uint16_t grid_height;
+  uint16_t cell_size;
+  int64_t start_us;
+  int64_t end_us;
+  uint32_t num_frames;
+  const uint32_t *cells;      /**< grid_width * grid_height counts */
+  const uint16_t *occupancy;  /**< num_frames object counts */
+} EventCodecHeatmap;
+
+/** @return upper bound of the bytes event_codec_write_heatmap() writes */
+size_t event_codec_heatmap_max_size(const EventCodecHeatmap *heatmap);
+
+/** Write a heatmap message at @a dst
+ * @return bytes written */
+size_t event_codec_write_heatmap(uint8_t *dst, const EventCodecHeatmap *heatmap);
+
+/**
+ * Decode a heatmap message. With @a cells and @a occupancy NULL only the
+ * header is read, so the caller can size them (grid_width * grid_height
+ * and num_frames elements); the pointers of @a heatmap are set to them.
+ * @return 1 on success, 0 if @a data is not a valid heatmap message
+ */
+int event_codec_decode_heatmap(const uint8_t *data, size_t size,
+                               EventCodecHeatmap *heatmap, uint32_t *cells,
+                               uint16_t *occupancy);
+
+/** @return UTC microseconds of a "YYYY-MM-DDTHH:MM:SS[.fff]Z" timestamp,
+ * 0 if it cannot be parsed */
+int64_t event_codec_parse_rfc3339(const char *ts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< __EVENT_CODEC_H__ */
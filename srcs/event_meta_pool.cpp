@@ -0,0 +1,385 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "event_meta_pool.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include "nvdsmeta.h"
+
+#define CHUNK_BLOCKS 256
+#define MAX_CHUNKS 64
+#define HEAP_SLOT G_MAXUINT32
+
+/// The meta is the first member: a meta pointer is its block pointer
+struct EventMetaBlock {
+    NvDsEventMsgMeta meta;
+    union {
+        NvDsPersonObject person;
+        NvDsProductObject product;
+    } ext;
+    guint32 slot;
+    guint32 arena_used;
+    gchar ts[EVENT_META_TS_SIZE];
+    gchar object_id[MAX_LABEL_SIZE];
+    gchar arena[EVENT_META_ARENA_SIZE];
+};
+
+struct EventMetaChunk {
+    EventMetaBlock blocks[CHUNK_BLOCKS];
+    std::atomic<guint32> next[CHUNK_BLOCKS];
+};
+
+/// Chunks are only added, never released, so a slot always maps to the same
+/// block. The free list head packs an ABA tag with slot + 1 (0 = empty).
+static std::atomic<EventMetaChunk *> g_chunks[MAX_CHUNKS];
+static std::atomic<guint32> g_num_chunks{0};
+static std::atomic<guint64> g_free_head{0};
+static std::mutex g_grow_mutex;
+
+static std::atomic<guint64> g_pool_acquires{0};
+static std::atomic<guint64> g_heap_blocks{0};
+static std::atomic<guint64> g_heap_strings{0};
+static std::atomic<guint64> g_in_use{0};
+
+/// Header in front of every embedding buffer; keeps the floats 16-byte aligned
+struct EmbeddingHeader {
+    std::atomic<gint> refcount;
+    guint num_elements;
+    guint64 reserved;
+};
+static_assert(sizeof(EmbeddingHeader) == 16, "EmbeddingHeader must keep data aligned");
+
+static inline EmbeddingHeader *embedding_header(float *embedding) {
+    return (EmbeddingHeader *) embedding - 1;
+}
+
+static inline EventMetaBlock *block_of(const NvDsEventMsgMeta *meta) {
+    return (EventMetaBlock *) meta;
+}
+
+static inline bool in_block(const EventMetaBlock *block, const void *p) {
+    const char *c = (const char *) p;
+    return c >= (const char *) block && c < (const char *) (block + 1);
+}
+
+static void push_free(guint32 slot) {
+    EventMetaChunk *chunk = g_chunks[slot / CHUNK_BLOCKS].load(std::memory_order_relaxed);
+    guint64 head = g_free_head.load(std::memory_order_relaxed);
+    guint64 new_head;
+    do {
+        chunk->next[slot % CHUNK_BLOCKS].store((guint32) head, std::memory_order_relaxed);
+        new_head = (((head >> 32) + 1) << 32) | (slot + 1);
+    } while (!g_free_head.compare_exchange_weak(head, new_head, std::memory_order_release,
+                                                std::memory_order_relaxed));
+}
+
+static EventMetaBlock *pop_free() {
+    guint64 head = g_free_head.load(std::memory_order_acquire);
+    while ((guint32) head != 0) {
+        guint32 slot = (guint32) head - 1;
+        EventMetaChunk *chunk = g_chunks[slot / CHUNK_BLOCKS].load(std::memory_order_acquire);
+        guint32 next = chunk->next[slot % CHUNK_BLOCKS].load(std::memory_order_relaxed);
+        guint64 new_head = (((head >> 32) + 1) << 32) | next;
+        if (g_free_head.compare_exchange_weak(head, new_head, std::memory_order_acquire,
+                                              std::memory_order_acquire))
+            return &chunk->blocks[slot % CHUNK_BLOCKS];
+    }
+    return nullptr;
+}
+
+/// Add a chunk of blocks; false once MAX_CHUNKS are in use
+static bool grow() {
+    std::lock_guard<std::mutex> lock(g_grow_mutex);
+    if ((guint32) g_free_head.load(std::memory_order_acquire) != 0)
+        return true;  /// another thread grew the pool meanwhile
+    guint32 n = g_num_chunks.load(std::memory_order_relaxed);
+    if (n == MAX_CHUNKS)
+        return false;
+    EventMetaChunk *chunk = new EventMetaChunk();
+    for (guint32 i = 0; i < CHUNK_BLOCKS; i++)
+        chunk->blocks[i].slot = n * CHUNK_BLOCKS + i;
+    g_chunks[n].store(chunk, std::memory_order_release);
+    g_num_chunks.store(n + 1, std::memory_order_release);
+    for (guint32 i = CHUNK_BLOCKS; i-- > 0;)
+        push_free(n * CHUNK_BLOCKS + i);
+    return true;
+}
+
+static EventMetaBlock *alloc_block() {
+    EventMetaBlock *block = pop_free();
+    if (!block && grow())
+        block = pop_free();
+    if (block) {
+        g_pool_acquires.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        block = (EventMetaBlock *) g_malloc(sizeof(EventMetaBlock));
+        block->slot = HEAP_SLOT;
+        g_heap_blocks.fetch_add(1, std::memory_order_relaxed);
+    }
+    g_in_use.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+/// Pointer copied from src: rebase it into dst, or duplicate a heap string
+static void adopt_str(const EventMetaBlock *src, EventMetaBlock *dst, gchar **field) {
+    if (!*field)
+        return;
+    if (in_block(src, *field))
+        *field = (gchar *) dst + (*field - (const gchar *) src);
+    else
+        *field = g_strdup(*field);
+}
+
+static void free_str(const EventMetaBlock *block, gchar *str) {
+    if (str && !in_block(block, str))
+        g_free(str);
+}
+
+NvDsEventMsgMeta *event_meta_pool_acquire(void) {
+    EventMetaBlock *block = alloc_block();
+    /// Only the parts read before being written need clearing
+    memset(&block->meta, 0, sizeof(block->meta));
+    memset(&block->ext, 0, sizeof(block->ext));
+    block->arena_used = 0;
+    block->ts[0] = '\0';
+    block->object_id[0] = '\0';
+    block->meta.ts = block->ts;
+    block->meta.objectId = block->object_id;
+    return &block->meta;
+}
+
+NvDsEventMsgMeta *event_meta_pool_copy(const NvDsEventMsgMeta *src_meta) {
+    const EventMetaBlock *src = block_of(src_meta);
+    EventMetaBlock *dst = alloc_block();
+    const guint32 slot = dst->slot;
+    memcpy(dst, src, offsetof(EventMetaBlock, arena) + src->arena_used);
+    dst->slot = slot;
+
+    NvDsEventMsgMeta *meta = &dst->meta;
+    adopt_str(src, dst, &meta->ts);
+    adopt_str(src, dst, &meta->objectId);
+    adopt_str(src, dst, &meta->sensorStr);
+    adopt_str(src, dst, &meta->otherAttrs);
+    adopt_str(src, dst, &meta->videoPath);
+
+    if (meta->extMsg == &src->ext) {
+        meta->extMsg = &dst->ext;
+        if (meta->objType == NVDS_OBJECT_TYPE_PERSON) {
+            adopt_str(src, dst, &dst->ext.person.gender);
+            adopt_str(src, dst, &dst->ext.person.hair);
+            adopt_str(src, dst, &dst->ext.person.cap);
+            adopt_str(src, dst, &dst->ext.person.apparel);
+        } else if (meta->objType == NVDS_OBJECT_TYPE_PRODUCT) {
+            adopt_str(src, dst, &dst->ext.product.brand);
+            adopt_str(src, dst, &dst->ext.product.type);
+            adopt_str(src, dst, &dst->ext.product.shape);
+        }
+    }
+
+    if (src_meta->objSignature.size > 0) {
+        meta->objSignature.signature =
+            (gdouble *) g_memdup(src_meta->objSignature.signature, src_meta->objSignature.size);
+    }
+    if (src_meta->embedding.embedding_vector) {
+        /// Shared, not duplicated: one more reference
+        embedding_header(src_meta->embedding.embedding_vector)->refcount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (src_meta->has3DTracking && src_meta->singleView3DTracking.convexHull.points) {
+        meta->singleView3DTracking.convexHull.points = (gint *) g_memdup(
+            src_meta->singleView3DTracking.convexHull.points,
+            src_meta->singleView3DTracking.convexHull.numFilled * 2 * sizeof(gint));
+    }
+    return meta;
+}
+
+void event_meta_pool_release(NvDsEventMsgMeta *meta) {
+    if (!meta)
+        return;
+    EventMetaBlock *block = block_of(meta);
+    free_str(block, meta->ts);
+    free_str(block, meta->objectId);
+    free_str(block, meta->sensorStr);
+    free_str(block, meta->otherAttrs);
+    free_str(block, meta->videoPath);
+    if (meta->extMsg == &block->ext) {
+        if (meta->objType == NVDS_OBJECT_TYPE_PERSON) {
+            free_str(block, block->ext.person.gender);
+            free_str(block, block->ext.person.hair);
+            free_str(block, block->ext.person.cap);
+            free_str(block, block->ext.person.apparel);
+        } else if (meta->objType == NVDS_OBJECT_TYPE_PRODUCT) {
+            free_str(block, block->ext.product.brand);
+            free_str(block, block->ext.product.type);
+            free_str(block, block->ext.product.shape);
+        }
+    }
+    if (meta->objSignature.size > 0)
+        g_free(meta->objSignature.signature);
+    event_meta_pool_embedding_unref(meta->embedding.embedding_vector);
+    if (meta->has3DTracking)
+        g_free(meta->singleView3DTracking.convexHull.points);
+
+    g_in_use.fetch_sub(1, std::memory_order_relaxed);
+    if (block->slot == HEAP_SLOT)
+        g_free(block);
+    else
+        push_free(block->slot);
+}
+
+NvDsPersonObject *event_meta_pool_person(NvDsEventMsgMeta *meta) {
+    EventMetaBlock *block = block_of(meta);
+    memset(&block->ext.person, 0, sizeof(block->ext.person));
+    meta->objType = NVDS_OBJECT_TYPE_PERSON;
+    meta->extMsg = &block->ext.person;
+    meta->extMsgSize = sizeof(NvDsPersonObject);
+    return &block->ext.person;
+}
+
+NvDsProductObject *event_meta_pool_product(NvDsEventMsgMeta *meta) {
+    EventMetaBlock *block = block_of(meta);
+    memset(&block->ext.product, 0, sizeof(block->ext.product));
+    meta->objType = NVDS_OBJECT_TYPE_PRODUCT;
+    meta->extMsg = &block->ext.product;
+    meta->extMsgSize = sizeof(NvDsProductObject);
+    return &block->ext.product;
+}
+
+/// Point field at len bytes of storage: arena if it fits, else heap
+static gchar *reserve_str(EventMetaBlock *block, gsize len) {
+    if (block->arena_used + len <= EVENT_META_ARENA_SIZE) {
+        gchar *str = block->arena + block->arena_used;
+        block->arena_used += len;
+        return str;
+    }
+    g_heap_strings.fetch_add(1, std::memory_order_relaxed);
+    return (gchar *) g_malloc(len);
+}
+
+void event_meta_pool_set_str(NvDsEventMsgMeta *meta, gchar **field, const gchar *value) {
+    EventMetaBlock *block = block_of(meta);
+    gchar *old = *field;
+    if (value) {
+        gsize len = strlen(value) + 1;
+        *field = reserve_str(block, len);
+        memcpy(*field, value, len);
+    } else {
+        *field = nullptr;
+    }
+    /// Replaced arena strings are simply abandoned until the block recycles
+    free_str(block, old);
+}
+
+void event_meta_pool_printf(NvDsEventMsgMeta *meta, gchar **field, const gchar *format, ...) {
+    EventMetaBlock *block = block_of(meta);
+    gchar *old = *field;
+    va_list args;
+    va_start(args, format);
+    gsize room = EVENT_META_ARENA_SIZE - block->arena_used;
+    gint len = g_vsnprintf(block->arena + block->arena_used, room, format, args);
+    va_end(args);
+    if (len >= 0 && (gsize) len < room) {
+        *field = block->arena + block->arena_used;
+        block->arena_used += len + 1;
+    } else {
+        va_start(args, format);
+        *field = g_strdup_vprintf(format, args);
+        va_end(args);
+        g_heap_strings.fetch_add(1, std::memory_order_relaxed);
+    }
+    free_str(block, old);
+}
+
+void event_meta_pool_append_vprintf(NvDsEventMsgMeta *meta, gchar **field, const gchar *separator,
+                                    const gchar *format, va_list args) {
+    EventMetaBlock *block = block_of(meta);
+    gchar *old = *field;
+    const gchar *head = old ? old : "";
+    const gchar *sep = *head ? separator : "";
+    gsize head_len = strlen(head), sep_len = strlen(sep);
+    gsize room = EVENT_META_ARENA_SIZE - block->arena_used;
+    gchar *str = block->arena + block->arena_used;
+    gint len = -1;
+    if (head_len + sep_len < room) {
+        /// old is either before arena_used or on the heap: no overlap
+        memcpy(str, head, head_len);
+        memcpy(str + head_len, sep, sep_len);
+        va_list copy;
+        va_copy(copy, args);
+        len = g_vsnprintf(str + head_len + sep_len, room - head_len - sep_len, format, copy);
+        va_end(copy);
+    }
+    if (len >= 0 && head_len + sep_len + len < room) {
+        *field = str;
+        block->arena_used += head_len + sep_len + len + 1;
+    } else {
+        gchar *tail = g_strdup_vprintf(format, args);
+        *field = g_strdup_printf("%s%s%s", head, sep, tail);
+        g_free(tail);
+        g_heap_strings.fetch_add(1, std::memory_order_relaxed);
+    }
+    free_str(block, old);
+}
+
+float *event_meta_pool_embedding_new(guint num_elements) {
+    EmbeddingHeader *header =
+        (EmbeddingHeader *) g_malloc(sizeof(EmbeddingHeader) + num_elements * sizeof(float));
+    new (&header->refcount) std::atomic<gint>(1);
+    header->num_elements = num_elements;
+    return (float *) (header + 1);
+}
+
+void event_meta_pool_embedding_unref(float *embedding) {
+    if (!embedding)
+        return;
+    EmbeddingHeader *header = embedding_header(embedding);
+    if (header->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        g_free(header);
+}
+
+float *event_meta_pool_embedding_make_writable(NvDsEventMsgMeta *meta) {
+    float *embedding = meta->embedding.embedding_vector;
+    if (!embedding)
+        return nullptr;
+    EmbeddingHeader *header = embedding_header(embedding);
+    if (header->refcount.load(std::memory_order_acquire) == 1)
+        return embedding;
+    float *copy = event_meta_pool_embedding_new(header->num_elements);
+    memcpy(copy, embedding, header->num_elements * sizeof(float));
+    meta->embedding.embedding_vector = copy;
+    event_meta_pool_embedding_unref(embedding);
+    return copy;
+}
+
+void event_meta_pool_get_stats(EventMetaPoolStats *stats) {
+    stats->pool_acquires = g_pool_acquires.load(std::memory_order_relaxed);
+    stats->heap_blocks = g_heap_blocks.load(std::memory_order_relaxed);
+    stats->heap_strings = g_heap_strings.load(std::memory_order_relaxed);
+    stats->in_use = g_in_use.load(std::memory_order_relaxed);
+    stats->capacity = (guint64) g_num_chunks.load(std::memory_order_relaxed) * CHUNK_BLOCKS;
+}
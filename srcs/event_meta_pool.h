@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __EVENT_META_POOL_H__
+#define __EVENT_META_POOL_H__
+
+#include <glib.h>
+#include <stdarg.h>
+
+#include "nvdsmeta_schema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pooled NvDsEventMsgMeta.
+ *
+ * Every meta lives in a block that also holds its extension object
+ * (NvDsPersonObject / NvDsProductObject) and the storage of its strings:
+ * fixed buffers for ts and objectId, and a small arena for the other
+ * strings. Blocks are recycled through a lock-free free list, so generating,
+ * copying and releasing an event costs no allocation in the common case.
+ * Strings that do not fit in the arena fall back to the heap and are
+ * handled transparently by copy and release.
+ *
+ * The embedding is a reference-counted immutable buffer shared by a meta
+ * and all its copies, so copying an event is O(1) whatever the feature
+ * size. The object signature and convex hull stay heap buffers owned by
+ * the meta.
+ */
+
+/** Bytes of string arena per event */
+#define EVENT_META_ARENA_SIZE 512
+/** Inline ts buffer, MAX_TIME_STAMP_LEN + 1 */
+#define EVENT_META_TS_SIZE 65
+
+typedef struct {
+  guint64 pool_acquires;   /**< blocks taken from the free list */
+  guint64 heap_blocks;     /**< blocks allocated because the pool was full */
+  guint64 heap_strings;    /**< strings that did not fit in the arena */
+  guint64 in_use;          /**< blocks currently handed out */
+  guint64 capacity;        /**< blocks owned by the pool */
+} EventMetaPoolStats;
+
+/** @return a zeroed meta whose ts and objectId point to inline buffers of
+ * EVENT_META_TS_SIZE and MAX_LABEL_SIZE bytes */
+NvDsEventMsgMeta *event_meta_pool_acquire(void);
+
+/** NvDsMetaCopyFunc body: block memcpy, then inline pointers are rebased
+ * and heap buffers duplicated */
+NvDsEventMsgMeta *event_meta_pool_copy(const NvDsEventMsgMeta *src);
+
+/** NvDsMetaReleaseFunc body: frees heap buffers and recycles the block */
+void event_meta_pool_release(NvDsEventMsgMeta *meta);
+
+/** @{ Attach the inline extension object and set objType / extMsg */
+NvDsPersonObject *event_meta_pool_person(NvDsEventMsgMeta *meta);
+NvDsProductObject *event_meta_pool_product(NvDsEventMsgMeta *meta);
+/** @} */
+
+/** Store a copy of @a value in the meta's arena (or on the heap if it is
+ * full) and point @a field at it. @a field must belong to @a meta or to its
+ * extension object. */
+void event_meta_pool_set_str(NvDsEventMsgMeta *meta, gchar **field,
+                             const gchar *value);
+
+/** printf-style event_meta_pool_set_str() */
+void event_meta_pool_printf(NvDsEventMsgMeta *meta, gchar **field,
+                            const gchar *format, ...) G_GNUC_PRINTF(3, 4);
+
+/** Append @a separator and the formatted string to @a field, or set it if
+ * @a field is NULL or empty. The result is written straight into the arena
+ * (heap if it is full), so its length is not bounded. */
+void event_meta_pool_append_vprintf(NvDsEventMsgMeta *meta, gchar **field,
+                                    const gchar *separator,
+                                    const gchar *format, va_list args)
+    G_GNUC_PRINTF(4, 0);
+
+/**
+ * @return an embedding buffer of @a num_elements floats holding one
+ * reference, for NvDsEventMsgMeta::embedding.embedding_vector. It must not
+ * be modified once attached to a meta that may have been copied; use
+ * event_meta_pool_embedding_make_writable() instead.
+ */
+float *event_meta_pool_embedding_new(guint num_elements);
+
+/** Drop one reference; the buffer is freed with the last one */
+void event_meta_pool_embedding_unref(float *embedding);
+
+/** Copy-on-write: give @a meta its own embedding buffer if it is shared,
+ * and return it */
+float *event_meta_pool_embedding_make_writable(NvDsEventMsgMeta *meta);
+
+void event_meta_pool_get_stats(EventMetaPoolStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< __EVENT_META_POOL_H__ */
@@ -0,0 +1,493 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "event_outbox.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define OUTBOX_RECORD_MAGIC 0x3158424Fu   // "OBX1"
+#define OUTBOX_CURSOR_FILE "outbox.cursor"
+/// Spool bytes buffered before a write()
+#define OUTBOX_WRITE_BUFFER (64 << 10)
+
+struct SpoolRecord {
+    uint32_t magic;
+    uint32_t payload_size;
+    uint32_t topic_size;
+    uint32_t reserved;
+};
+static_assert(sizeof(SpoolRecord) == 16, "SpoolRecord layout changed");
+
+struct SpoolCursor {
+    uint64_t seq;
+    uint64_t offset;
+};
+
+static uint64_t monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool write_all(int fd, const void *data, size_t size) {
+    const char *ptr = (const char *) data;
+    while (size > 0) {
+        ssize_t n = write(fd, ptr, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        ptr += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *data, size_t size, uint64_t offset) {
+    char *ptr = (char *) data;
+    while (size > 0) {
+        ssize_t n = pread(fd, ptr, size, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        ptr += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+static void append_record(std::string &out, const std::string &topic, const std::string &payload) {
+    SpoolRecord record = {OUTBOX_RECORD_MAGIC, (uint32_t) payload.size(),
+                          (uint32_t) topic.size(), 0};
+    out.append((const char *) &record, sizeof(record));
+    out.append(topic);
+    out.append(payload);
+}
+
+EventOutbox::~EventOutbox() {
+    close();
+}
+
+std::string EventOutbox::segment_path(uint64_t seq) const {
+    char name[64];
+    snprintf(name, sizeof(name), "/outbox-%016llx.seg", (unsigned long long) seq);
+    return config_.spool_dir + name;
+}
+
+bool EventOutbox::init(const OutboxConfig &config, SendFunc send) {
+    config_ = config;
+    send_ = std::move(send);
+    config_.max_in_flight = std::max(config_.max_in_flight, 1u);
+    if (config_.spool_dir.empty() || !send_) {
+        std::cerr << "Outbox needs a spool directory and a sink\n";
+        return false;
+    }
+    if (mkdir(config_.spool_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Cannot create " << config_.spool_dir << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    DIR *dir = opendir(config_.spool_dir.c_str());
+    if (!dir) {
+        std::cerr << "Cannot open " << config_.spool_dir << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    std::vector<uint64_t> seqs;
+    while (struct dirent *entry = readdir(dir)) {
+        unsigned long long seq;
+        int end = 0;
+        if (sscanf(entry->d_name, "outbox-%llx.seg%n", &seq, &end) == 1 &&
+            entry->d_name[end] == '\0')
+            seqs.push_back(seq);
+    }
+    closedir(dir);
+    std::sort(seqs.begin(), seqs.end());
+
+    /// Where the previous run stopped reading
+    SpoolCursor cursor = {0, 0};
+    std::string cursor_path = config_.spool_dir + "/" OUTBOX_CURSOR_FILE;
+    int fd = open(cursor_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (!read_all(fd, &cursor, sizeof(cursor), 0))
+            cursor = {0, 0};
+        ::close(fd);
+        unlink(cursor_path.c_str());
+    }
+
+    for (uint64_t seq : seqs) {
+        Segment segment = {seq, 0, 0, seq == cursor.seq ? cursor.offset : 0};
+        if (scan_segment(segment)) {
+            segments_.push_back(segment);
+            spool_bytes_ += segment.bytes;
+        }
+    }
+    if (!segments_.empty()) {
+        next_seq_ = std::max(next_seq_, segments_.back().seq + 1);
+        read_offset_ = segments_.front().start;
+        uint64_t messages = 0;
+        for (const Segment &segment : segments_)
+            messages += segment.messages;
+        std::cout << "Outbox " << config_.spool_dir << ": replaying " << messages
+                  << " messages from " << segments_.size() << " segments\n";
+    }
+    closed_ = false;
+    return true;
+}
+
+/// Count the records of a segment left by a previous run, cutting a torn
+/// tail; false if nothing is left to read
+bool EventOutbox::scan_segment(Segment &segment) {
+    std::string path = segment_path(segment.seq);
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    uint64_t offset = segment.start;
+    SpoolRecord record;
+    while (offset + sizeof(record) <= (uint64_t) st.st_size &&
+           read_all(fd, &record, sizeof(record), offset) && record.magic == OUTBOX_RECORD_MAGIC) {
+        uint64_t end = offset + sizeof(record) + record.topic_size + record.payload_size;
+        if (end > (uint64_t) st.st_size)
+            break;
+        offset = end;
+        segment.messages++;
+    }
+    if (offset < (uint64_t) st.st_size) {
+        std::cerr << "Outbox: " << path << " is truncated at " << offset << " bytes\n";
+        if (ftruncate(fd, offset) != 0)
+            std::cerr << "Outbox: cannot truncate " << path << "\n";
+    }
+    ::close(fd);
+    segment.bytes = offset;
+    if (segment.messages == 0) {
+        unlink(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool EventOutbox::push(const std::string &topic, const void *data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_)
+        return false;
+    stats_.pushed++;
+    Message message{topic, std::string((const char *) data, size), 0};
+    /// Anything on disk is older: keep the order by appending there too
+    size_t bytes = topic.size() + size;
+    if (segments_.empty() && memory_used_ + bytes <= config_.memory_bytes) {
+        memory_used_ += bytes;
+        memory_.push_back(std::move(message));
+        return true;
+    }
+    return spill(std::move(message));
+}
+
+bool EventOutbox::spill(Message &&message) {
+    uint64_t size = sizeof(SpoolRecord) + message.topic.size() + message.payload.size();
+    while (spool_bytes_ + size > config_.max_spool_bytes) {
+        /// The segment being written cannot be dropped
+        if (config_.drop_policy == OUTBOX_DROP_NEWEST || segments_.size() < 2) {
+            stats_.dropped++;
+            return false;
+        }
+        drop_front_segment();
+    }
+    if (write_fd_ < 0 || segments_.back().bytes >= config_.segment_bytes) {
+        flush_writes();
+        if (write_fd_ >= 0) {
+            fdatasync(write_fd_);
+            ::close(write_fd_);
+            write_fd_ = -1;
+        }
+        Segment segment = {next_seq_++, 0, 0, 0};
+        std::string path = segment_path(segment.seq);
+        write_fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (write_fd_ < 0) {
+            std::cerr << "Outbox: cannot create " << path << ": " << strerror(errno) << "\n";
+            stats_.dropped++;
+            return false;
+        }
+        segments_.push_back(segment);
+    }
+    append_record(write_buffer_, message.topic, message.payload);
+    segments_.back().bytes += size;
+    segments_.back().messages++;
+    spool_bytes_ += size;
+    stats_.spilled++;
+    if (write_buffer_.size() >= OUTBOX_WRITE_BUFFER)
+        flush_writes();
+    return true;
+}
+
+bool EventOutbox::flush_writes() {
+    if (write_buffer_.empty() || write_fd_ < 0)
+        return true;
+    bool ok = write_all(write_fd_, write_buffer_.data(), write_buffer_.size());
+    if (!ok)
+        std::cerr << "Outbox: spool write failed: " << strerror(errno) << "\n";
+    write_buffer_.clear();
+    return ok;
+}
+
+void EventOutbox::close_segment_files() {
+    if (read_fd_ >= 0)
+        ::close(read_fd_);
+    read_fd_ = -1;
+    if (write_fd_ >= 0) {
+        fdatasync(write_fd_);
+        ::close(write_fd_);
+    }
+    write_fd_ = -1;
+}
+
+void EventOutbox::drop_front_segment() {
+    const Segment &front = segments_.front();
+    if (read_fd_ >= 0)
+        ::close(read_fd_);
+    read_fd_ = -1;
+    if (segments_.size() == 1 && write_fd_ >= 0) {
+        write_buffer_.clear();
+        ::close(write_fd_);
+        write_fd_ = -1;
+    }
+    unlink(segment_path(front.seq).c_str());
+    spool_bytes_ -= front.bytes;
+    stats_.dropped += front.messages;
+    segments_.pop_front();
+    read_offset_ = segments_.empty() ? 0 : segments_.front().start;
+}
+
+bool EventOutbox::read_spool(Message &message) {
+    while (!segments_.empty()) {
+        Segment &front = segments_.front();
+        bool writing = segments_.size() == 1 && write_fd_ >= 0;
+        if (writing)
+            flush_writes();
+        if (front.messages == 0) {
+            /// Fully read: the segment goes, the next one is read from its start
+            drop_front_segment();
+            continue;
+        }
+        if (read_fd_ < 0) {
+            read_fd_ = open(segment_path(front.seq).c_str(), O_RDONLY | O_CLOEXEC);
+            if (read_fd_ < 0) {
+                std::cerr << "Outbox: cannot read " << segment_path(front.seq) << "\n";
+                drop_front_segment();
+                continue;
+            }
+        }
+        SpoolRecord record;
+        if (!read_all(read_fd_, &record, sizeof(record), read_offset_) ||
+            record.magic != OUTBOX_RECORD_MAGIC) {
+            std::cerr << "Outbox: " << segment_path(front.seq) << " is corrupted at "
+                      << read_offset_ << "\n";
+            drop_front_segment();
+            continue;
+        }
+        message.id = 0;
+        message.topic.resize(record.topic_size);
+        message.payload.resize(record.payload_size);
+        uint64_t offset = read_offset_ + sizeof(record);
+        if (!read_all(read_fd_, &message.topic[0], record.topic_size, offset) ||
+            !read_all(read_fd_, &message.payload[0], record.payload_size,
+                      offset + record.topic_size)) {
+            drop_front_segment();
+            continue;
+        }
+        read_offset_ = offset + record.topic_size + record.payload_size;
+        front.messages--;
+        stats_.replayed++;
+        return true;
+    }
+    return false;
+}
+
+/// Failed messages first, then memory, then the spool
+bool EventOutbox::next_message(Message &message) {
+    if (!retry_.empty()) {
+        message = std::move(retry_.begin()->second);
+        retry_.erase(retry_.begin());
+        return true;
+    }
+    if (!memory_.empty()) {
+        message = std::move(memory_.front());
+        memory_.pop_front();
+        memory_used_ -= message.topic.size() + message.payload.size();
+        return true;
+    }
+    return read_spool(message);
+}
+
+void EventOutbox::send(Message &&message) {
+    if (!message.id)
+        message.id = next_id_++;
+    uint64_t id = message.id;
+    if (send_(id, message.topic, message.payload)) {
+        in_flight_.emplace(id, std::move(message));
+        return;
+    }
+    stats_.failed++;
+    retry_.emplace(id, std::move(message));
+    healthy_ = false;
+    last_failed_id_ = id;
+    next_attempt_ms_ = monotonic_ms() + config_.retry_ms;
+}
+
+void EventOutbox::complete(uint64_t id, bool ok) {
+    std::lock_guard<std::mutex> lock(completions_mutex_);
+    completions_.emplace_back(id, ok);
+}
+
+void EventOutbox::process_completions() {
+    {
+        std::lock_guard<std::mutex> lock(completions_mutex_);
+        completions_work_.swap(completions_);
+    }
+    for (const auto &completion : completions_work_) {
+        auto it = in_flight_.find(completion.first);
+        if (it == in_flight_.end())
+            continue;
+        if (completion.second) {
+            stats_.delivered++;
+            /// Only a message sent after the last failure proves the sink is back
+            if (completion.first > last_failed_id_)
+                healthy_ = true;
+        } else {
+            stats_.failed++;
+            retry_.emplace(it->first, std::move(it->second));
+            healthy_ = false;
+            last_failed_id_ = std::max(last_failed_id_, completion.first);
+            next_attempt_ms_ = monotonic_ms() + config_.retry_ms;
+        }
+        in_flight_.erase(it);
+    }
+    completions_work_.clear();
+}
+
+void EventOutbox::pump() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_)
+        return;
+    process_completions();
+    Message message;
+    if (!healthy_) {
+        /// One probe message per retry interval until one goes through
+        uint64_t now = monotonic_ms();
+        if (now >= next_attempt_ms_ && in_flight_.size() < config_.max_in_flight &&
+            next_message(message)) {
+            next_attempt_ms_ = now + config_.retry_ms;
+            send(std::move(message));
+        }
+    } else {
+        while (healthy_ && in_flight_.size() < config_.max_in_flight && next_message(message))
+            send(std::move(message));
+    }
+    flush_writes();
+}
+
+bool EventOutbox::idle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    process_completions();
+    return memory_.empty() && retry_.empty() && in_flight_.empty() && segments_.empty();
+}
+
+void EventOutbox::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_)
+        return;
+    closed_ = true;
+    process_completions();
+    flush_writes();
+
+    /// Not delivered yet and older than the spool: written to a segment
+    /// sorting before it
+    std::map<uint64_t, Message> pending = std::move(retry_);
+    for (auto &entry : in_flight_)
+        pending.emplace(entry.first, std::move(entry.second));
+    std::string buffer;
+    uint64_t count = pending.size() + memory_.size();
+    for (auto &entry : pending)
+        append_record(buffer, entry.second.topic, entry.second.payload);
+    for (Message &message : memory_)
+        append_record(buffer, message.topic, message.payload);
+    retry_.clear();
+    in_flight_.clear();
+    memory_.clear();
+    memory_used_ = 0;
+
+    SpoolCursor cursor = {0, 0};
+    if (!segments_.empty() && read_offset_ > 0)
+        cursor = {segments_.front().seq, read_offset_};
+    close_segment_files();
+
+    if (count > 0) {
+        uint64_t seq = segments_.empty() ? next_seq_++ : segments_.front().seq - 1;
+        std::string path = segment_path(seq);
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0 || !write_all(fd, buffer.data(), buffer.size())) {
+            std::cerr << "Outbox: cannot save " << count << " pending messages to " << path
+                      << "\n";
+            stats_.dropped += count;
+        } else {
+            fdatasync(fd);
+            stats_.spilled += count;
+        }
+        if (fd >= 0)
+            ::close(fd);
+    }
+    std::string cursor_path = config_.spool_dir + "/" OUTBOX_CURSOR_FILE;
+    if (cursor.offset > 0) {
+        int fd = open(cursor_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0 || !write_all(fd, &cursor, sizeof(cursor)))
+            std::cerr << "Outbox: cannot write " << cursor_path << "\n";
+        else
+            fdatasync(fd);
+        if (fd >= 0)
+            ::close(fd);
+    } else {
+        unlink(cursor_path.c_str());
+    }
+    segments_.clear();
+}
+
+EventOutbox::Stats EventOutbox::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.memory_bytes = memory_used_;
+    stats.spool_bytes = spool_bytes_;
+    stats.in_flight = in_flight_.size();
+    return stats;
+}
@@ -0,0 +1,171 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Store-and-forward queue in front of a message sink.
+///
+/// Messages are delivered in order, at least once. They wait in memory
+/// until memory_bytes is reached; after that, and for as long as anything
+/// is left on disk, they are appended to a spool of segment files in
+/// spool_dir instead, so a long sink outage costs disk, not memory:
+///   outbox-<seq>.seg   records { uint32 magic "OBX1", uint32 payload size,
+///                      uint32 topic size, uint32 0 }, topic, payload
+///   outbox.cursor      { uint64 seq, uint64 offset } of the first record
+///                      not delivered, written by close()
+///
+/// At most max_in_flight messages are handed to the sink at a time. When
+/// one fails the outbox stops sending, retries the oldest failed message
+/// every retry_ms and resumes once it goes through; failed messages are
+/// sent again before anything newer. Past max_spool_bytes, drop_policy
+/// discards either the oldest segment or the incoming message.
+///
+/// close() writes what is still in memory or in flight in front of the
+/// spool, and the next init() on the same directory replays it. Segments
+/// are not synced per message: a crash can lose the spool tail and replay
+/// messages of the first segment twice.
+enum OutboxDropPolicy {
+    OUTBOX_DROP_OLDEST = 0,
+    OUTBOX_DROP_NEWEST = 1,
+};
+
+struct OutboxConfig {
+    std::string spool_dir;
+    size_t memory_bytes = 8 << 20;
+    uint64_t segment_bytes = 16 << 20;
+    uint64_t max_spool_bytes = 1ull << 30;
+    OutboxDropPolicy drop_policy = OUTBOX_DROP_OLDEST;
+    unsigned max_in_flight = 256;
+    unsigned retry_ms = 1000;
+};
+
+class EventOutbox {
+public:
+    /// Hands a message to the sink; false if it was not accepted. An
+    /// accepted message is answered by complete(id, ...), from any thread.
+    using SendFunc =
+        std::function<bool(uint64_t id, const std::string &topic, const std::string &payload)>;
+
+    struct Stats {
+        uint64_t pushed = 0;
+        uint64_t delivered = 0;
+        uint64_t failed = 0;       ///< failed attempts, each retried
+        uint64_t spilled = 0;      ///< messages appended to the spool
+        uint64_t replayed = 0;     ///< messages read back from the spool
+        uint64_t dropped = 0;
+        uint64_t memory_bytes = 0;
+        uint64_t spool_bytes = 0;
+        uint64_t in_flight = 0;
+    };
+
+    EventOutbox() = default;
+    EventOutbox(const EventOutbox &) = delete;
+    EventOutbox &operator=(const EventOutbox &) = delete;
+    ~EventOutbox();
+
+    /// Open the spool directory, creating it if needed, and pick up the
+    /// segments a previous run left there
+    bool init(const OutboxConfig &config, SendFunc send);
+
+    /// Queue a message; false if the drop policy discarded it
+    bool push(const std::string &topic, const void *data, size_t size);
+
+    /// Outcome of a message handed to SendFunc
+    void complete(uint64_t id, bool ok);
+
+    /// Process the outcomes and send what the sink can take. Call it
+    /// periodically, e.g. from nvds_msgapi_do_work().
+    void pump();
+
+    /// Nothing queued, spooled or in flight
+    bool idle();
+
+    /// Persist everything not delivered yet for the next run
+    void close();
+
+    Stats stats();
+
+private:
+    struct Message {
+        std::string topic;
+        std::string payload;
+        uint64_t id = 0;      ///< assigned when first sent, kept on retries
+    };
+
+    struct Segment {
+        uint64_t seq;
+        uint64_t bytes;       ///< file size
+        uint64_t messages;    ///< records not read yet
+        uint64_t start;       ///< offset of the first record to read
+    };
+
+    std::string segment_path(uint64_t seq) const;
+    bool scan_segment(Segment &segment);
+    bool spill(Message &&message);
+    bool flush_writes();
+    void close_segment_files();
+    void drop_front_segment();
+    bool read_spool(Message &message);
+    bool next_message(Message &message);
+    void send(Message &&message);
+    void process_completions();
+
+    OutboxConfig config_;
+    SendFunc send_;
+    std::mutex mutex_;
+    bool closed_ = true;
+
+    std::deque<Message> memory_;
+    size_t memory_used_ = 0;
+
+    /// By id, which is also the delivery order
+    std::map<uint64_t, Message> in_flight_;
+    std::map<uint64_t, Message> retry_;
+    uint64_t next_id_ = 1;
+    bool healthy_ = true;
+    uint64_t last_failed_id_ = 0;
+    uint64_t next_attempt_ms_ = 0;
+
+    std::deque<Segment> segments_;
+    uint64_t spool_bytes_ = 0;
+    uint64_t next_seq_ = 1ull << 40;
+    int write_fd_ = -1;          ///< last segment, while it grows
+    std::string write_buffer_;
+    int read_fd_ = -1;           ///< first segment
+    uint64_t read_offset_ = 0;
+
+    std::mutex completions_mutex_;
+    std::vector<std::pair<uint64_t, bool>> completions_;
+    std::vector<std::pair<uint64_t, bool>> completions_work_;
+
+    Stats stats_;
+};
@@ -0,0 +1,254 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "event_worker_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <dlfcn.h>
+#include <iostream>
+#include "event_meta_pool.h"
+
+EventWorkerPool::~EventWorkerPool() {
+    stop();
+    for (auto &worker : workers_) {
+        delete worker->current;
+        for (Batch *batch : worker->queue)
+            delete batch;
+        for (Batch *batch : worker->free)
+            delete batch;
+    }
+    if (lib_)
+        dlclose(lib_);
+}
+
+bool EventWorkerPool::init(const EventWorkerPoolConfig &config) {
+    if (!config.fill || !config.proto_lib || !config.conn_str || !config.topic) {
+        std::cerr << "Event worker pool needs a fill callback, a protocol library, a "
+                     "connection string and a topic\n";
+        return false;
+    }
+    config_ = config;
+    config_.num_workers = std::max(config.num_workers, 1u);
+    if (!config_.max_pending_batches)
+        config_.max_pending_batches = 64;
+    topic_ = config.topic;
+
+    lib_ = dlopen(config.proto_lib, RTLD_NOW);
+    if (!lib_) {
+        std::cerr << "Cannot load " << config.proto_lib << ": " << dlerror() << "\n";
+        return false;
+    }
+    auto connect = (decltype(&nvds_msgapi_connect)) dlsym(lib_, "nvds_msgapi_connect");
+    send_async_ = (decltype(send_async_)) dlsym(lib_, "nvds_msgapi_send_async");
+    do_work_ = (decltype(do_work_)) dlsym(lib_, "nvds_msgapi_do_work");
+    disconnect_ = (decltype(disconnect_)) dlsym(lib_, "nvds_msgapi_disconnect");
+    if (!connect || !send_async_ || !do_work_ || !disconnect_) {
+        std::cerr << config.proto_lib << " is not an nvds_msgapi library\n";
+        return false;
+    }
+    handle_ = connect((char *) config.conn_str, nullptr, (char *) config.proto_config);
+    if (!handle_) {
+        std::cerr << "Cannot connect to " << config.conn_str << "\n";
+        return false;
+    }
+
+    EventBatchFormat format = config.binary ? EVENT_BATCH_BINARY : EVENT_BATCH_JSON;
+    for (unsigned i = 0; i < config_.num_workers; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->batcher = std::make_unique<EventBatcher>(
+            (uint64_t) config.batch_interval_ms * 1000000ULL, config.batch_max_objects, format);
+        workers_.push_back(std::move(worker));
+    }
+    for (auto &worker : workers_)
+        worker->thread = std::thread(&EventWorkerPool::run, this, std::ref(*worker));
+    return true;
+}
+
+uint32_t EventWorkerPool::add_string(Batch &batch, const char *str) {
+    if (!str)
+        return NO_STRING;
+    uint32_t offset = (uint32_t) batch.strings.size();
+    batch.strings.insert(batch.strings.end(), str, str + strlen(str) + 1);
+    return offset;
+}
+
+void EventWorkerPool::add(const EventSnapshot &snapshot, const float *embedding,
+                          unsigned num_elements, const char *label, const char *image_path,
+                          const char *direction, const char *sensor) {
+    if (workers_.empty())
+        return;
+    Worker &worker = *workers_[snapshot.stream_id % workers_.size()];
+    if (!worker.current) {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.free.empty()) {
+            worker.current = worker.free.back();
+            worker.free.pop_back();
+        } else {
+            worker.current = new Batch();
+        }
+    }
+    Batch &batch = *worker.current;
+
+    Entry entry;
+    entry.snapshot = snapshot;
+    entry.embedding_offset = (uint32_t) batch.embeddings.size();
+    entry.num_elements = embedding ? num_elements : 0;
+    if (entry.num_elements)
+        batch.embeddings.insert(batch.embeddings.end(), embedding, embedding + num_elements);
+    entry.label = add_string(batch, label);
+    entry.image_path = add_string(batch, image_path);
+    entry.direction = add_string(batch, direction);
+    entry.sensor = add_string(batch, sensor);
+    batch.entries.push_back(entry);
+    snapshots_++;
+}
+
+void EventWorkerPool::submit() {
+    for (auto &worker : workers_) {
+        Batch *batch = worker->current;
+        if (!batch || batch->entries.empty())
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            if (worker->queue.size() >= config_.max_pending_batches) {
+                /// The worker is behind; keep the streaming thread going
+                dropped_ += batch->entries.size();
+                batch->clear();
+                continue;
+            }
+            worker->queue.push_back(batch);
+        }
+        worker->current = nullptr;
+        worker->cv.notify_one();
+    }
+}
+
+void EventWorkerPool::stop() {
+    if (stopping_.exchange(true))
+        return;
+    submit();
+    for (auto &worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->cv.notify_one();
+    }
+    for (auto &worker : workers_)
+        if (worker->thread.joinable())
+            worker->thread.join();
+    if (handle_) {
+        do_work_(handle_);
+        disconnect_(handle_);
+        handle_ = nullptr;
+    }
+    if (!workers_.empty()) {
+        uint64_t objects = 0;
+        for (auto &worker : workers_)
+            objects += worker->batcher->num_objects();
+        std::cout << "Event worker pool: " << snapshots_ << " snapshots, " << dropped_
+                  << " dropped, " << objects << " events in " << messages_ << " messages, "
+                  << send_errors_ << " send errors\n";
+    }
+}
+
+void EventWorkerPool::run(Worker &worker) {
+    for (;;) {
+        Batch *batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&] { return !worker.queue.empty() || stopping_; });
+            if (worker.queue.empty())
+                break;
+            batch = worker.queue.front();
+            worker.queue.pop_front();
+        }
+        process(worker, *batch);
+        batch->clear();
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.free.push_back(batch);
+    }
+
+    /// Close the windows still open
+    std::string payload;
+    for (unsigned stream : worker.streams)
+        if (worker.batcher->flush(stream, 0, true, payload))
+            send(payload);
+}
+
+void EventWorkerPool::process(Worker &worker, Batch &batch) {
+    std::string payload;
+    for (const Entry &entry : batch.entries) {
+        EventSnapshotView view;
+        view.snapshot = &entry.snapshot;
+        view.embedding = entry.num_elements ? &batch.embeddings[entry.embedding_offset] : nullptr;
+        view.num_elements = entry.num_elements;
+        auto str = [&](uint32_t offset) {
+            return offset == NO_STRING ? nullptr : &batch.strings[offset];
+        };
+        view.label = str(entry.label);
+        view.image_path = str(entry.image_path);
+        view.direction = str(entry.direction);
+        view.sensor = str(entry.sensor);
+
+        NvDsEventMsgMeta *meta = event_meta_pool_acquire();
+        config_.fill(meta, &view, config_.fill_user_data);
+        worker.batcher->add(entry.snapshot.stream_id, meta, entry.snapshot.frame_pts);
+        event_meta_pool_release(meta);
+
+        unsigned stream = entry.snapshot.stream_id;
+        if (std::find(worker.streams.begin(), worker.streams.end(), stream) ==
+            worker.streams.end())
+            worker.streams.push_back(stream);
+    }
+
+    /// A batch holds one frame per stream, so the last entry of a stream
+    /// carries the time its window is checked against
+    for (unsigned stream : worker.streams) {
+        auto last = std::find_if(batch.entries.rbegin(), batch.entries.rend(),
+                                 [&](const Entry &e) { return e.snapshot.stream_id == stream; });
+        if (last == batch.entries.rend())
+            continue;
+        if (worker.batcher->flush(stream, last->snapshot.frame_pts, false, payload))
+            send(payload);
+    }
+}
+
+void EventWorkerPool::send_done(void *user_ptr, NvDsMsgApiErrorType flag) {
+    if (flag != NVDS_MSGAPI_OK)
+        static_cast<EventWorkerPool *>(user_ptr)->send_errors_++;
+}
+
+void EventWorkerPool::send(const std::string &payload) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    if (!handle_)
+        return;
+    NvDsMsgApiErrorType err = send_async_(handle_, (char *) topic_.c_str(),
+                                          (const uint8_t *) payload.data(), payload.size(),
+                                          send_done, this);
+    if (err != NVDS_MSGAPI_OK)
+        send_errors_++;
+    else
+        messages_++;
+    do_work_(handle_);
+}
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "event_batcher.h"
+#include "event_worker_pool_wrapper.h"
+#include "nvds_msgapi.h"
+
+/// Moves event generation off the streaming thread.
+///
+/// The probe only copies EventSnapshot PODs, plus their strings and host
+/// embeddings into slabs of the current batch; submit() hands the batch to
+/// the workers. A worker builds a pooled NvDsEventMsgMeta per snapshot
+/// through the fill callback (timestamp formatting, attributes, gallery
+/// matching), serializes it with its own EventBatcher and sends the
+/// messages through an nvds_msgapi library loaded with dlopen.
+///
+/// Streams are pinned to workers (stream_id % workers), so the events of a
+/// stream stay ordered and its batching window lives on one thread.
+/// Batch buffers are recycled, so the probe does not allocate in steady
+/// state, and never blocks: when a worker is max_pending_batches behind,
+/// its part of the batch is dropped and counted.
+class EventWorkerPool {
+public:
+    ~EventWorkerPool();
+
+    bool init(const EventWorkerPoolConfig &config);
+
+    void add(const EventSnapshot &snapshot, const float *embedding, unsigned num_elements,
+             const char *label, const char *image_path, const char *direction,
+             const char *sensor);
+    void submit();
+
+    /// Stop the workers after they emptied their queues, flush every
+    /// window and disconnect
+    void stop();
+
+    uint64_t num_snapshots() const { return snapshots_; }
+    uint64_t num_dropped() const { return dropped_; }
+    uint64_t num_messages() const { return messages_; }
+    uint64_t num_send_errors() const { return send_errors_; }
+
+private:
+    static constexpr uint32_t NO_STRING = UINT32_MAX;
+
+    struct Entry {
+        EventSnapshot snapshot;
+        uint32_t embedding_offset;
+        uint32_t num_elements;
+        uint32_t label;
+        uint32_t image_path;
+        uint32_t direction;
+        uint32_t sensor;
+    };
+
+    struct Batch {
+        std::vector<Entry> entries;
+        std::vector<float> embeddings;
+        std::vector<char> strings;
+        void clear() {
+            entries.clear();
+            embeddings.clear();
+            strings.clear();
+        }
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Batch *> queue;
+        Batch *current = nullptr;   ///< filled by the probe
+        std::vector<Batch *> free;  ///< recycled, under mutex
+        std::unique_ptr<EventBatcher> batcher;
+        std::vector<unsigned> streams;  ///< streams seen, for the final flush
+    };
+
+    uint32_t add_string(Batch &batch, const char *str);
+    void run(Worker &worker);
+    void process(Worker &worker, Batch &batch);
+    void send(const std::string &payload);
+    static void send_done(void *user_ptr, NvDsMsgApiErrorType flag);
+
+    EventWorkerPoolConfig config_ = {};
+    std::string topic_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stopping_{false};
+
+    void *lib_ = nullptr;
+    NvDsMsgApiHandle handle_ = nullptr;
+    decltype(&nvds_msgapi_send_async) send_async_ = nullptr;
+    decltype(&nvds_msgapi_do_work) do_work_ = nullptr;
+    decltype(&nvds_msgapi_disconnect) disconnect_ = nullptr;
+    /// Protocol libraries are not required to be thread safe
+    std::mutex send_mutex_;
+
+    std::atomic<uint64_t> snapshots_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> messages_{0};
+    std::atomic<uint64_t> send_errors_{0};
+};
@@ -0,0 +1,43 @@
+#include "event_worker_pool_wrapper.h"
+#include "event_worker_pool.h"
+
+// Wrapper struct to hold the actual C++ object
+struct EventWorkerPoolWrapper {
+    EventWorkerPool* pool;
+};
+
+// Create and destroy
+EventWorkerPoolWrapper* create_event_worker_pool(const EventWorkerPoolConfig* config) {
+    if (!config)
+        return nullptr;
+    EventWorkerPool* pool = new EventWorkerPool();
+    if (!pool->init(*config)) {
+        delete pool;
+        return nullptr;
+    }
+    EventWorkerPoolWrapper* wrapper = new EventWorkerPoolWrapper();
+    wrapper->pool = pool;
+    return wrapper;
+}
+
+void destroy_event_worker_pool(EventWorkerPoolWrapper* wrapper) {
+    if (wrapper) {
+        delete wrapper->pool;
+        delete wrapper;
+    }
+}
+
+// Add a snapshot to the current batch
+void event_worker_pool_add(EventWorkerPoolWrapper* wrapper, const EventSnapshot* snapshot,
+                           const float* embedding, unsigned num_elements, const char* label,
+                           const char* image_path, const char* direction, const char* sensor) {
+    if (!wrapper || !wrapper->pool || !snapshot)
+        return;
+    wrapper->pool->add(*snapshot, embedding, num_elements, label, image_path, direction, sensor);
+}
+
+// Hand the batch to the workers
+void event_worker_pool_submit(EventWorkerPoolWrapper* wrapper) {
+    if (wrapper && wrapper->pool)
+        wrapper->pool->submit();
+}
@@ -0,0 +1,85 @@
+#ifndef EVENT_WORKER_POOL_WRAPPER_H
+#define EVENT_WORKER_POOL_WRAPPER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "nvdsmeta_schema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Plain copy of what an event needs from the frame and object metas,
+// captured on the streaming thread. Strings and the embedding are copied
+// next to it by event_worker_pool_add().
+typedef struct {
+    uint64_t object_id;
+    uint64_t utc_ns;          // event time, already resolved to UTC
+    uint64_t frame_pts;       // stream time, for the batching window
+    int32_t frame_num;
+    int32_t class_id;
+    int32_t embedding_ref_frame;  // >= 0: embedding suppressed, same as this frame's
+    uint16_t stream_id;
+    uint8_t event_type;       // NvDsEventType
+    uint8_t emit_reason;
+    float confidence;
+    float bbox[4];            // left, top, width, height in source pixels
+    uint32_t occupancy;       // nvdsanalytics counts of the stream,
+    uint32_t lccum_entry;     // valid when has_line_counts is set
+    uint32_t lccum_exit;
+    uint32_t roi_mask;        // --line-cross-config ROIs the object is in
+    uint64_t dwell_enter_ns;  // NVDS_EVENT_EXIT dwell events: UTC of the
+    uint8_t dwell_end;        // entry in the ROI of roi_mask, DwellEnd
+    uint8_t has_line_counts;
+} EventSnapshot;
+
+// A snapshot with its copied data, as handed to the fill callback
+typedef struct {
+    const EventSnapshot* snapshot;
+    const float* embedding;   // NULL when none was captured
+    unsigned num_elements;
+    const char* label;
+    const char* image_path;   // NULL when absent
+    const char* direction;    // NULL when absent
+    const char* sensor;       // NULL when absent
+} EventSnapshotView;
+
+// Builds the event of a snapshot on a worker thread; must be thread safe
+typedef void (*EventFillFunc)(NvDsEventMsgMeta* meta, const EventSnapshotView* view,
+                              void* user_data);
+
+typedef struct {
+    unsigned num_workers;
+    unsigned max_pending_batches;   // per worker; beyond, batches are dropped
+    unsigned batch_interval_ms;     // EventBatcher window, 0 = per frame
+    unsigned batch_max_objects;
+    int binary;                     // event_codec.h layout instead of JSON
+    const char* proto_lib;          // nvds_msgapi library
+    const char* conn_str;
+    const char* proto_config;       // may be NULL
+    const char* topic;
+    EventFillFunc fill;
+    void* fill_user_data;
+} EventWorkerPoolConfig;
+
+typedef struct EventWorkerPoolWrapper EventWorkerPoolWrapper;
+
+// Create the workers and connect the sink; NULL on failure. Destroying the
+// pool sends what is queued and the open windows, then disconnects.
+EventWorkerPoolWrapper* create_event_worker_pool(const EventWorkerPoolConfig* config);
+void destroy_event_worker_pool(EventWorkerPoolWrapper* pool);
+
+// Copy a snapshot and its strings / host embedding into the current batch.
+// Any pointer but snapshot may be NULL.
+void event_worker_pool_add(EventWorkerPoolWrapper* pool, const EventSnapshot* snapshot,
+                           const float* embedding, unsigned num_elements, const char* label,
+                           const char* image_path, const char* direction, const char* sensor);
+
+// Hand the current batch over to the workers
+void event_worker_pool_submit(EventWorkerPoolWrapper* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_WORKER_POOL_WRAPPER_H
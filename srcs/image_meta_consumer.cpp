@@ -46,6 +46,27 @@ void ImageMetaConsumer::add_meta_csv(const std::string &meta) {
     cv_csv_.notify_one();
 }
 
+bool ImageMetaConsumer::set_compression(StreamCompressor::Codec codec, int level,
+                                        const std::string &dictionary_dir) {
+    if (!is_stopped_) {
+        std::cerr << __func__ << ": Compression must be set before init.\n";
+        return false;
+    }
+#ifndef ENABLE_COMPRESSION
+    if (codec != StreamCompressor::NONE) {
+        std::cerr << __func__ << ": " << StreamCompressor::codec_name(codec)
+                  << " needs a build with ENABLE_COMPRESSION=1\n";
+        return false;
+    }
+#endif
+    compression_ = codec;
+    compression_level_ = level;
+    compression_dictionary_dir_ = dictionary_dir;
+    if (!compression_dictionary_dir_.empty() && compression_dictionary_dir_.back() != '/')
+        compression_dictionary_dir_ += '/';
+    return true;
+}
+
 void ImageMetaConsumer::add_meta_json(const std::string &meta) {
     if (is_stopped_) {
         std::cerr << __func__ << ": Could not add meta when Consumer is stopped.\n";
@@ -148,7 +169,7 @@ bool ImageMetaConsumer::setup_folders() {
 }
 
 
-void ImageMetaConsumer::write_intro(std::ofstream &os, OutputType &ot) {
+void ImageMetaConsumer::write_intro(std::ostream &os, OutputType &ot) {
     switch (ot) {
         case OutputType::JSON:
             os << "{\n";
@@ -176,7 +197,7 @@ void ImageMetaConsumer::write_intro(std::ofstream &os, OutputType &ot) {
     }
 }
 
-void ImageMetaConsumer::write_mid_separator(std::ofstream &os, OutputType &ot) {
+void ImageMetaConsumer::write_mid_separator(std::ostream &os, OutputType &ot) {
     switch (ot) {
         case JSON:
             os << ",\n";
@@ -189,7 +210,7 @@ void ImageMetaConsumer::write_mid_separator(std::ofstream &os, OutputType &ot) {
     }
 }
 
-void ImageMetaConsumer::write_end(std::ofstream &os, OutputType &ot, unsigned total_nb) {
+void ImageMetaConsumer::write_end(std::ostream &os, OutputType &ot, unsigned total_nb) {
     switch (ot) {
         case JSON:
             os << "},\n";
@@ -205,17 +226,44 @@ void ImageMetaConsumer::write_end(std::ofstream &os, OutputType &ot, unsigned to
     }
 }
 
+std::string ImageMetaConsumer::meta_file_path(const std::string &extension) const {
+    return output_folder_path_ + "metadata." + extension + StreamCompressor::extension(compression_);
+}
+
 void ImageMetaConsumer::single_metadata_maker(const std::string &extension,
                                               ConcurrentQueue<std::string> &queue,
                                               std::mutex &mutex, std::condition_variable &cv,
                                               OutputType ot) {
-    std::string meta_path = output_folder_path_ + "metadata." + extension;
-    std::ofstream output(meta_path, std::ios::trunc);
-    if (!output.good()) {
+    std::string meta_path = meta_file_path(extension);
+    std::ofstream file(meta_path, std::ios::trunc | std::ios::binary);
+    if (!file.good()) {
         std::cerr << "Could not create " << meta_path << std::endl;
         is_stopped_ = true;
         return;
     }
+    /// Compressed files are formatted in memory, then appended to the
+    /// compressor after every drain of the queue
+    bool compressed = compression_ != StreamCompressor::NONE;
+    std::ostringstream text;
+    std::ostream &output = compressed ? static_cast<std::ostream &>(text) : file;
+    StreamCompressor compressor;
+    if (compressed) {
+        std::string dictionary;
+        if (compression_ == StreamCompressor::ZSTD && !compression_dictionary_dir_.empty())
+            dictionary = compression_dictionary_dir_ + "metadata." + extension + ".dict";
+        compressor.init(compression_, compression_level_, 0,
+                        [&file](const void *data, size_t size) {
+                            file.write((const char *) data, size);
+                            return file.good();
+                        },
+                        dictionary);
+    }
+    auto drain_text = [&]() {
+        if (compressed) {
+            compressor.write(text.str());
+            text.str("");
+        }
+    };
     write_intro(output, ot);
 
     bool first_time = true;
@@ -235,14 +283,23 @@ void ImageMetaConsumer::single_metadata_maker(const std::string &extension,
             output << meta;
             meta_nb++;
         }
+        drain_text();
     }
     write_end(output, ot, meta_nb);
+    if (compressed) {
+        drain_text();
+        compressor.finish();
+        const StreamCompressor::Stats &stats = compressor.stats();
+        std::cout << meta_path << ": " << stats.bytes_in << " -> " << stats.bytes_out
+                  << " bytes (ratio " << stats.ratio() << ", " << stats.cpu_seconds
+                  << " s CPU)\n";
+    }
 }
 
 bool ImageMetaConsumer::setup_files() {
-    std::string p1 = output_folder_path_ + "metadata.csv";
+    std::string p1 = meta_file_path("csv");
     std::ofstream output1(p1, std::ios::trunc);
-    std::string p2 = output_folder_path_ + "metadata.json";
+    std::string p2 = meta_file_path("json");
     std::ofstream output2(p2, std::ios::trunc);
     return output1.good() && output2.good();
 }
@@ -32,6 +32,7 @@
 #include "nvds_obj_encode.h"
 #include "concurrent_queue.h"
 #include "capture_time_rules.h"
+#include "stream_compressor.h"
 
 class ImageMetaConsumer {
 public:
@@ -76,6 +77,14 @@ public:
               bool save_full_frame_enabled, bool save_cropped_obj_enabled,
               unsigned seconds_to_skip_interval, unsigned source_nb);
 
+    /// Compress metadata.json and metadata.csv; call before init().
+    /// @param [in] codec Compression of the files, which get the codec extension
+    /// @param [in] level Codec level, 0 for its default
+    /// @param [in] dictionary_dir Directory of the zstd dictionaries
+    /// (metadata.<ext>.dict), trained on the first run if missing; empty for none
+    /// @return false if the codec is not available in this build
+    bool set_compression(StreamCompressor::Codec codec, int level, const std::string &dictionary_dir);
+
     /// Add metadata to the stored concurrent queue.
     /// @param [in] meta Metadata as CSV string
     void add_meta_csv(const std::string &meta);
@@ -172,17 +181,20 @@ private:
     /// Set up config files
     bool setup_files();
 
+    /// Path of metadata.<extension>, with the compression suffix
+    std::string meta_file_path(const std::string &extension) const;
+
     /// Creates folder for images and metadata output.
     bool setup_folders();
 
     /// Write at the beginning of a file depending of the output type.
-    void write_intro(std::ofstream &os, OutputType &ot);
+    void write_intro(std::ostream &os, OutputType &ot);
 
     /// Write at the middle of a file between metadata depending of the output type.
-    void write_mid_separator(std::ofstream &os, OutputType &ot);
+    void write_mid_separator(std::ostream &os, OutputType &ot);
 
     /// Write at the end of a file depending of the output type.
-    void write_end(std::ofstream &os, OutputType &ot, unsigned total_nb);
+    void write_end(std::ostream &os, OutputType &ot, unsigned total_nb);
 
     /// Creates a unique id for the current consumer.
     unsigned int get_unique_id();
@@ -226,4 +238,7 @@ private:
     NvDsObjEncCtxHandle obj_ctx_handle_;
     bool image_saving_library_is_init_;
     std::mutex mutex_image_save_init_;
+    StreamCompressor::Codec compression_ = StreamCompressor::NONE;
+    int compression_level_ = 0;
+    std::string compression_dictionary_dir_;
 };
\ No newline at end of file
@@ -54,6 +54,16 @@ void image_meta_consumer_init(ImageMetaConsumerWrapper* wrapper,
     }
 }
 
+// Compression
+int image_meta_consumer_set_compression(ImageMetaConsumerWrapper* wrapper, const char* codec,
+                                        int level, const char* dictionary_dir) {
+    StreamCompressor::Codec parsed;
+    if (!wrapper || !wrapper->consumer || !codec || !StreamCompressor::parse_codec(codec, parsed))
+        return 0;
+    return wrapper->consumer->set_compression(parsed, level,
+                                              dictionary_dir ? dictionary_dir : "") ? 1 : 0;
+}
+
 // Add metadata
 void image_meta_consumer_add_meta_csv(ImageMetaConsumerWrapper* wrapper, const char* meta) {
     if (wrapper && wrapper->consumer) {
@@ -28,6 +28,12 @@ void image_meta_consumer_init(ImageMetaConsumerWrapper* consumer,
                               unsigned seconds_to_skip_interval, 
                               unsigned source_nb);
 
+// Compress metadata.json and metadata.csv with codec "none", "lz4" or
+// "zstd"; call before image_meta_consumer_init(). dictionary_dir may be
+// NULL. Returns 0 if the codec is unknown or not built in.
+int image_meta_consumer_set_compression(ImageMetaConsumerWrapper* consumer, const char* codec,
+                                        int level, const char* dictionary_dir);
+
 // Add metadata
 void image_meta_consumer_add_meta_csv(ImageMetaConsumerWrapper* consumer, const char* meta);
 
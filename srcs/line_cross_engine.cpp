@@ -0,0 +1,526 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "line_cross_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <strings.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/// Lines and ROIs of a stream are reported as 32 bit masks
+#define LINE_CROSS_MAX_LINES 32
+#define LINE_CROSS_MAX_ROIS 32
+/// Frames of a stream between two sweeps for tracks that left
+#define EVICT_INTERVAL 256
+/// Frames after which an object that was not seen is forgotten
+#define EVICT_AGE 300
+
+/// @{ Four lanes of floats; comparisons return all-ones lanes
+#if defined(__SSE2__)
+typedef __m128 V4;
+static inline V4 v_load(const float *p) { return _mm_loadu_ps(p); }
+static inline V4 v_set(float x) { return _mm_set1_ps(x); }
+static inline V4 v_add(V4 a, V4 b) { return _mm_add_ps(a, b); }
+static inline V4 v_sub(V4 a, V4 b) { return _mm_sub_ps(a, b); }
+static inline V4 v_mul(V4 a, V4 b) { return _mm_mul_ps(a, b); }
+static inline V4 v_abs(V4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+static inline V4 v_lt(V4 a, V4 b) { return _mm_cmplt_ps(a, b); }
+static inline V4 v_le(V4 a, V4 b) { return _mm_cmple_ps(a, b); }
+static inline V4 v_and(V4 a, V4 b) { return _mm_and_ps(a, b); }
+static inline V4 v_xor(V4 a, V4 b) { return _mm_xor_ps(a, b); }
+static inline unsigned v_bits(V4 m) { return (unsigned) _mm_movemask_ps(m); }
+#elif defined(__ARM_NEON)
+typedef float32x4_t V4;
+static inline V4 v_load(const float *p) { return vld1q_f32(p); }
+static inline V4 v_set(float x) { return vdupq_n_f32(x); }
+static inline V4 v_add(V4 a, V4 b) { return vaddq_f32(a, b); }
+static inline V4 v_sub(V4 a, V4 b) { return vsubq_f32(a, b); }
+static inline V4 v_mul(V4 a, V4 b) { return vmulq_f32(a, b); }
+static inline V4 v_abs(V4 a) { return vabsq_f32(a); }
+static inline V4 v_lt(V4 a, V4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+static inline V4 v_le(V4 a, V4 b) { return vreinterpretq_f32_u32(vcleq_f32(a, b)); }
+static inline V4 v_and(V4 a, V4 b) {
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+static inline V4 v_xor(V4 a, V4 b) {
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+static inline unsigned v_bits(V4 m) {
+    uint32_t lanes[4];
+    vst1q_u32(lanes, vshrq_n_u32(vreinterpretq_u32_f32(m), 31));
+    return lanes[0] | (lanes[1] << 1) | (lanes[2] << 2) | (lanes[3] << 3);
+}
+#else
+struct V4 {
+    float v[4];
+};
+static inline float mask_lane(bool set) {
+    uint32_t bits = set ? 0xffffffffu : 0;
+    float lane;
+    memcpy(&lane, &bits, sizeof(lane));
+    return lane;
+}
+static inline uint32_t lane_bits(float lane) {
+    uint32_t bits;
+    memcpy(&bits, &lane, sizeof(bits));
+    return bits;
+}
+#define V4_MAP(expr) \
+    V4 r; \
+    for (int i = 0; i < 4; i++) \
+        r.v[i] = (expr); \
+    return r;
+static inline V4 v_load(const float *p) { V4_MAP(p[i]) }
+static inline V4 v_set(float x) { V4_MAP(x) }
+static inline V4 v_add(V4 a, V4 b) { V4_MAP(a.v[i] + b.v[i]) }
+static inline V4 v_sub(V4 a, V4 b) { V4_MAP(a.v[i] - b.v[i]) }
+static inline V4 v_mul(V4 a, V4 b) { V4_MAP(a.v[i] * b.v[i]) }
+static inline V4 v_abs(V4 a) { V4_MAP(std::fabs(a.v[i])) }
+static inline V4 v_lt(V4 a, V4 b) { V4_MAP(mask_lane(a.v[i] < b.v[i])) }
+static inline V4 v_le(V4 a, V4 b) { V4_MAP(mask_lane(a.v[i] <= b.v[i])) }
+static inline V4 v_and(V4 a, V4 b) { V4_MAP(mask_lane(lane_bits(a.v[i]) & lane_bits(b.v[i]))) }
+static inline V4 v_xor(V4 a, V4 b) { V4_MAP(mask_lane(lane_bits(a.v[i]) ^ lane_bits(b.v[i]))) }
+static inline unsigned v_bits(V4 m) {
+    unsigned bits = 0;
+    for (int i = 0; i < 4; i++)
+        bits |= (lane_bits(m.v[i]) >> 31) << i;
+    return bits;
+}
+#undef V4_MAP
+#endif
+/// @}
+
+static std::string trim(const std::string &str) {
+    size_t begin = str.find_first_not_of(" \t\r");
+    size_t end = str.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? std::string() : str.substr(begin, end - begin + 1);
+}
+
+static bool parse_values(const std::string &str, std::vector<float> &values) {
+    std::stringstream ss(str);
+    std::string item;
+    values.clear();
+    while (std::getline(ss, item, ';')) {
+        item = trim(item);
+        if (item.empty())
+            continue;
+        char *end = nullptr;
+        float value = strtof(item.c_str(), &end);
+        if (*end)
+            return false;
+        values.push_back(value);
+    }
+    return true;
+}
+
+/// "exit" anywhere in the label, like deepstream_nvdsanalytics_meta.cpp
+static bool is_exit_label(const std::string &label) {
+    for (size_t i = 0; i + 4 <= label.size(); i++)
+        if (strncasecmp(label.c_str() + i, "exit", 4) == 0)
+            return true;
+    return false;
+}
+
+/// Groups of an nvdsanalytics config: name -> ordered key/value pairs
+typedef std::vector<std::pair<std::string, std::string>> ConfigGroup;
+
+static bool read_config(const std::string &path,
+                        std::vector<std::pair<std::string, ConfigGroup>> &groups) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        if (line[0] == '[') {
+            size_t end = line.find(']');
+            groups.emplace_back(trim(line.substr(1, end - 1)), ConfigGroup());
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos || groups.empty())
+            continue;
+        groups.back().second.emplace_back(trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+    }
+    return true;
+}
+
+static const std::string *find_key(const ConfigGroup &group, const char *key) {
+    for (const auto &entry : group)
+        if (entry.first == key)
+            return &entry.second;
+    return nullptr;
+}
+
+static int get_int(const ConfigGroup &group, const char *key, int default_value) {
+    const std::string *value = find_key(group, key);
+    return value ? atoi(value->c_str()) : default_value;
+}
+
+/// Stream id of a "<prefix>N" group name, -1 if it does not match
+static int group_stream_id(const std::string &name, const char *prefix) {
+    size_t len = strlen(prefix);
+    if (name.compare(0, len, prefix) != 0 || name.size() == len)
+        return -1;
+    char *end = nullptr;
+    long stream_id = strtol(name.c_str() + len, &end, 10);
+    return *end || stream_id < 0 || stream_id > 65535 ? -1 : (int) stream_id;
+}
+
+bool LineCrossEngine::load(const std::string &config_path, int frame_width, int frame_height) {
+    std::vector<std::pair<std::string, ConfigGroup>> groups;
+    if (!read_config(config_path, groups)) {
+        std::cerr << "LineCrossEngine: could not read " << config_path << std::endl;
+        return false;
+    }
+    config_path_ = config_path;
+    streams_.clear();
+
+    int config_width = frame_width, config_height = frame_height;
+    for (const auto &group : groups) {
+        if (group.first == "property") {
+            config_width = get_int(group.second, "config-width", frame_width);
+            config_height = get_int(group.second, "config-height", frame_height);
+        }
+    }
+    const float scale_x = config_width > 0 ? (float) frame_width / config_width : 1.f;
+    const float scale_y = config_height > 0 ? (float) frame_height / config_height : 1.f;
+
+    std::vector<float> values;
+    for (const auto &group : groups) {
+        int line_stream_id = group_stream_id(group.first, "line-crossing-stream-");
+        int roi_stream_id = group_stream_id(group.first, "roi-filtering-stream-");
+        int stream_id = std::max(line_stream_id, roi_stream_id);
+        if (stream_id < 0 || !get_int(group.second, "enable", 0))
+            continue;
+        if ((size_t) stream_id >= streams_.size())
+            streams_.resize(stream_id + 1);
+        if (!streams_[stream_id])
+            streams_[stream_id].reset(new Stream());
+        Stream &stream = *streams_[stream_id];
+
+        int class_id = get_int(group.second, "class-id", -1);
+        bool extended = get_int(group.second, "extended", 0) != 0;
+        bool inverse = get_int(group.second, "inverse-roi", 0) != 0;
+        const std::string *mode = find_key(group.second, "mode");
+        float cos2 = 0.25f;  ///< balanced, 60 degrees
+        if (mode && *mode == "loose")
+            cos2 = -1.f;
+        else if (mode && *mode == "strict")
+            cos2 = 0.75f;  ///< 30 degrees
+
+        const char *prefix = line_stream_id >= 0 ? "line-crossing-" : "roi-";
+        const size_t prefix_len = strlen(prefix);
+        for (const auto &entry : group.second) {
+            if (entry.first.compare(0, prefix_len, prefix) != 0 || entry.first.size() == prefix_len)
+                continue;
+            const std::string label = entry.first.substr(prefix_len);
+            if (!parse_values(entry.second, values)) {
+                std::cerr << "LineCrossEngine: bad values for " << entry.first << " in ["
+                          << group.first << "]" << std::endl;
+                return false;
+            }
+            for (size_t i = 0; i < values.size(); i++)
+                values[i] *= (i % 2) ? scale_y : scale_x;
+            bool added = line_stream_id >= 0
+                             ? add_line(stream, label, values, class_id, extended, cos2)
+                             : add_roi(stream, label, values, class_id, inverse);
+            if (!added) {
+                std::cerr << "LineCrossEngine: invalid " << entry.first << " in ["
+                          << group.first << "]" << std::endl;
+                return false;
+            }
+        }
+    }
+    for (auto &stream : streams_) {
+        if (!stream)
+            continue;
+        stream->line_counts.reset(new std::atomic<uint64_t>[stream->lines.size()]());
+        stream->tracks.reserve(256);
+    }
+    return true;
+}
+
+bool LineCrossEngine::add_line(Stream &stream, const std::string &label,
+                               const std::vector<float> &values, int class_id, bool extended,
+                               float cos2) {
+    /// Groups of 8: the direction vector, then the line
+    if (values.empty() || values.size() % 8 || stream.lines.size() == LINE_CROSS_MAX_LINES)
+        return false;
+    stream.lines.push_back(Line{label, class_id, is_exit_label(label)});
+    for (size_t i = 0; i < values.size(); i += 8) {
+        float dx = values[i + 2] - values[i], dy = values[i + 3] - values[i + 1];
+        float ax = values[i + 4], ay = values[i + 5], bx = values[i + 6], by = values[i + 7];
+        float cross = (bx - ax) * dy - (by - ay) * dx;
+        if (cross == 0.f)
+            return false;
+        if (cross < 0.f) {
+            std::swap(ax, bx);
+            std::swap(ay, by);
+        }
+        stream.ax.push_back(ax);
+        stream.ay.push_back(ay);
+        stream.bx.push_back(bx);
+        stream.by.push_back(by);
+        stream.ex.push_back(bx - ax);
+        stream.ey.push_back(by - ay);
+        stream.dx.push_back(dx);
+        stream.dy.push_back(dy);
+        stream.cos2.push_back(cos2);
+        stream.extended.push_back(extended);
+        stream.segment_line.push_back(stream.lines.size() - 1);
+    }
+    return true;
+}
+
+bool LineCrossEngine::add_roi(Stream &stream, const std::string &label,
+                              const std::vector<float> &values, int class_id, bool inverse) {
+    if (values.size() < 6 || values.size() % 2 || stream.rois.size() == LINE_CROSS_MAX_ROIS)
+        return false;
+    const size_t num_points = values.size() / 2;
+    stream.rois.push_back(Roi{label, class_id, inverse, stream.edge_x0.size(), num_points});
+    for (size_t i = 0; i < num_points; i++) {
+        size_t j = (i + 1) % num_points;
+        float x0 = values[2 * i], y0 = values[2 * i + 1];
+        float x1 = values[2 * j], y1 = values[2 * j + 1];
+        stream.edge_x0.push_back(x0);
+        stream.edge_y0.push_back(y0);
+        stream.edge_y1.push_back(y1);
+        stream.edge_slope.push_back(y1 != y0 ? (x1 - x0) / (y1 - y0) : 0.f);
+    }
+    return true;
+}
+
+LineCrossEngine::Stream *LineCrossEngine::get_stream(int stream_id) const {
+    if (stream_id < 0 || (size_t) stream_id >= streams_.size())
+        return nullptr;
+    return streams_[stream_id].get();
+}
+
+void LineCrossEngine::process(int stream_id, int frame_num, const LineCrossObject *objects,
+                              size_t count, LineCrossResult *results) {
+    if (results)
+        memset(results, 0, count * sizeof(LineCrossResult));
+    Stream *stream = get_stream(stream_id);
+    if (!stream || count == 0)
+        return;
+    if (++stream->frames_since_evict >= EVICT_INTERVAL) {
+        stream->frames_since_evict = 0;
+        evict(*stream, frame_num);
+    }
+
+    /// Anchors of this frame and of the last one each object was seen on;
+    /// new objects start where they are, so they cannot cross anything
+    const size_t padded = (count + 3) & ~(size_t) 3;
+    stream->px.resize(padded);
+    stream->py.resize(padded);
+    stream->cx.resize(padded);
+    stream->cy.resize(padded);
+    stream->crossed.assign(count, 0);
+    stream->inside.assign(count, 0);
+    stream->frame_tracks.resize(count);
+    for (size_t i = 0; i < padded; i++) {
+        const float *bbox = objects[std::min(i, count - 1)].bbox;
+        float x = bbox[0] + bbox[2] * 0.5f, y = bbox[1] + bbox[3];
+        stream->cx[i] = x;
+        stream->cy[i] = y;
+        stream->px[i] = x;
+        stream->py[i] = y;
+        if (i >= count)
+            continue;
+        auto inserted = stream->tracks.emplace(objects[i].object_id, Track());
+        Track &track = inserted.first->second;
+        if (!inserted.second && track.seen_frame_num < frame_num) {
+            stream->px[i] = track.x;
+            stream->py[i] = track.y;
+        }
+        stream->frame_tracks[i] = &track;
+    }
+
+    for (size_t s = 0; s < stream->ax.size(); s++) {
+        const V4 ax = v_set(stream->ax[s]), ay = v_set(stream->ay[s]);
+        const V4 bx = v_set(stream->bx[s]), by = v_set(stream->by[s]);
+        const V4 ex = v_set(stream->ex[s]), ey = v_set(stream->ey[s]);
+        const V4 dx = v_set(stream->dx[s]), dy = v_set(stream->dy[s]);
+        const V4 cos2_dd = v_set(stream->cos2[s] * (stream->dx[s] * stream->dx[s] +
+                                                    stream->dy[s] * stream->dy[s]));
+        const V4 zero = v_set(0.f);
+        const bool extended = stream->extended[s];
+        const uint32_t line_bit = 1u << stream->segment_line[s];
+        for (size_t i = 0; i < padded; i += 4) {
+            V4 px = v_load(&stream->px[i]), py = v_load(&stream->py[i]);
+            V4 cx = v_load(&stream->cx[i]), cy = v_load(&stream->cy[i]);
+            /// Side of the line before and after the move: from d1 < 0 to d2 >= 0
+            V4 d1 = v_sub(v_mul(ex, v_sub(py, ay)), v_mul(ey, v_sub(px, ax)));
+            V4 d2 = v_sub(v_mul(ex, v_sub(cy, ay)), v_mul(ey, v_sub(cx, ax)));
+            V4 crossed = v_and(v_lt(d1, zero), v_le(zero, d2));
+            /// Within the mode's angle of the direction vector
+            V4 mx = v_sub(cx, px), my = v_sub(cy, py);
+            V4 dot = v_add(v_mul(mx, dx), v_mul(my, dy));
+            V4 mm = v_add(v_mul(mx, mx), v_mul(my, my));
+            crossed = v_and(crossed, v_le(v_mul(cos2_dd, mm), v_mul(dot, v_abs(dot))));
+            if (!extended) {
+                /// Segment ends on both sides of the move
+                V4 e1 = v_sub(v_mul(mx, v_sub(ay, py)), v_mul(my, v_sub(ax, px)));
+                V4 e2 = v_sub(v_mul(mx, v_sub(by, py)), v_mul(my, v_sub(bx, px)));
+                crossed = v_and(crossed, v_le(v_mul(e1, e2), zero));
+            }
+            for (unsigned bits = v_bits(crossed); bits; bits &= bits - 1) {
+                size_t k = i + __builtin_ctz(bits);
+                if (k < count)
+                    stream->crossed[k] |= line_bit;
+            }
+        }
+    }
+
+    for (size_t r = 0; r < stream->rois.size(); r++) {
+        const Roi &roi = stream->rois[r];
+        for (size_t i = 0; i < padded; i += 4) {
+            V4 cx = v_load(&stream->cx[i]), cy = v_load(&stream->cy[i]);
+            /// Crossing number: edges straddling the anchor's y on its right
+            V4 inside = v_set(0.f);
+            for (size_t e = roi.first_edge; e < roi.first_edge + roi.num_edges; e++) {
+                V4 y0 = v_set(stream->edge_y0[e]);
+                V4 straddle = v_xor(v_lt(cy, y0), v_lt(cy, v_set(stream->edge_y1[e])));
+                V4 x = v_add(v_set(stream->edge_x0[e]),
+                             v_mul(v_set(stream->edge_slope[e]), v_sub(cy, y0)));
+                inside = v_xor(inside, v_and(straddle, v_lt(cx, x)));
+            }
+            unsigned bits = v_bits(inside) ^ (roi.inverse ? 0xf : 0);
+            for (; bits; bits &= bits - 1) {
+                size_t k = i + __builtin_ctz(bits);
+                if (k < count)
+                    stream->inside[k] |= 1u << r;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const LineCrossObject &object = objects[i];
+        LineCrossResult result = {};
+        for (uint32_t bits = stream->crossed[i]; bits; bits &= bits - 1) {
+            unsigned l = __builtin_ctz(bits);
+            const Line &line = stream->lines[l];
+            if (line.class_id >= 0 && line.class_id != object.class_id)
+                continue;
+            uint64_t line_count = stream->line_counts[l].fetch_add(1, std::memory_order_relaxed) + 1;
+            (line.exit ? stream->exits : stream->entries).fetch_add(1, std::memory_order_relaxed);
+            (line.exit ? result.exits : result.entries)++;
+            if (!result.line) {
+                result.line = line.label.c_str();
+                result.line_count = (uint32_t) line_count;
+            }
+        }
+        for (uint32_t bits = stream->inside[i]; bits; bits &= bits - 1) {
+            unsigned r = __builtin_ctz(bits);
+            const Roi &roi = stream->rois[r];
+            if (roi.class_id >= 0 && roi.class_id != object.class_id)
+                continue;
+            result.roi_mask |= 1u << r;
+            if (!result.roi)
+                result.roi = roi.label.c_str();
+        }
+        Track &track = *stream->frame_tracks[i];
+        track.x = stream->cx[i];
+        track.y = stream->cy[i];
+        track.seen_frame_num = frame_num;
+        track.result = result;
+        if (results)
+            results[i] = result;
+    }
+}
+
+bool LineCrossEngine::object_result(int stream_id, uint64_t object_id, int frame_num,
+                                    LineCrossResult *result) const {
+    Stream *stream = get_stream(stream_id);
+    if (!stream)
+        return false;
+    auto it = stream->tracks.find(object_id);
+    if (it == stream->tracks.end() || it->second.seen_frame_num != frame_num)
+        return false;
+    *result = it->second.result;
+    return true;
+}
+
+void LineCrossEngine::stream_counts(int stream_id, uint32_t *entries, uint32_t *exits,
+                                    uint32_t *occupancy) const {
+    Stream *stream = get_stream(stream_id);
+    uint64_t in = stream ? stream->entries.load(std::memory_order_relaxed) : 0;
+    uint64_t out = stream ? stream->exits.load(std::memory_order_relaxed) : 0;
+    *entries = (uint32_t) in;
+    *exits = (uint32_t) out;
+    *occupancy = in > out ? (uint32_t) (in - out) : 0;
+}
+
+unsigned LineCrossEngine::num_rois(int stream_id) const {
+    Stream *stream = get_stream(stream_id);
+    return stream ? (unsigned) stream->rois.size() : 0;
+}
+
+const char *LineCrossEngine::roi_label(int stream_id, uint32_t roi_mask) const {
+    Stream *stream = get_stream(stream_id);
+    if (!stream || !roi_mask)
+        return nullptr;
+    size_t r = __builtin_ctz(roi_mask);
+    return r < stream->rois.size() ? stream->rois[r].label.c_str() : nullptr;
+}
+
+void LineCrossEngine::print_summary() const {
+    for (size_t stream_id = 0; stream_id < streams_.size(); stream_id++) {
+        const Stream *stream = streams_[stream_id].get();
+        if (!stream || stream->lines.empty())
+            continue;
+        std::ostringstream summary;
+        summary << "Line crossing stream " << stream_id << ":";
+        for (size_t l = 0; l < stream->lines.size(); l++)
+            summary << " " << stream->lines[l].label << "="
+                    << stream->line_counts[l].load(std::memory_order_relaxed);
+        uint32_t entries, exits, occupancy;
+        stream_counts((int) stream_id, &entries, &exits, &occupancy);
+        summary << " entries=" << entries << " exits=" << exits << " occupancy=" << occupancy;
+        std::cout << summary.str() << std::endl;
+    }
+}
+
+void LineCrossEngine::evict(Stream &stream, int frame_num) {
+    /// A stream that restarted (frame numbers going back) forgets everything
+    for (auto it = stream.tracks.begin(); it != stream.tracks.end();) {
+        int age = frame_num - it->second.seen_frame_num;
+        if (age > EVICT_AGE || age < 0)
+            it = stream.tracks.erase(it);
+        else
+            ++it;
+    }
+}
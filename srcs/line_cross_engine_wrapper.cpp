@@ -0,0 +1,74 @@
+#include "line_cross_engine_wrapper.h"
+#include "line_cross_engine.h"
+
+// Wrapper struct to hold the actual C++ object
+struct LineCrossEngineWrapper {
+    LineCrossEngine* engine;
+};
+
+// Create and destroy
+LineCrossEngineWrapper* create_line_cross_engine(const char* config_path, int frame_width,
+                                                 int frame_height) {
+    LineCrossEngine* engine = new LineCrossEngine();
+    if (!config_path || !engine->load(config_path, frame_width, frame_height)) {
+        delete engine;
+        return nullptr;
+    }
+    LineCrossEngineWrapper* wrapper = new LineCrossEngineWrapper();
+    wrapper->engine = engine;
+    return wrapper;
+}
+
+void destroy_line_cross_engine(LineCrossEngineWrapper* wrapper) {
+    if (wrapper) {
+        delete wrapper->engine;
+        delete wrapper;
+    }
+}
+
+// Process
+void line_cross_engine_process(LineCrossEngineWrapper* wrapper, int stream_id, int frame_num,
+                               const LineCrossObject* objects, unsigned num_objects,
+                               LineCrossResult* results) {
+    if (!wrapper || !wrapper->engine)
+        return;
+    wrapper->engine->process(stream_id, frame_num, objects, num_objects, results);
+}
+
+// Object result
+int line_cross_engine_object(LineCrossEngineWrapper* wrapper, int stream_id, uint64_t object_id,
+                             int frame_num, LineCrossResult* result) {
+    if (!wrapper || !wrapper->engine)
+        return 0;
+    return wrapper->engine->object_result(stream_id, object_id, frame_num, result) ? 1 : 0;
+}
+
+// Stream counts
+void line_cross_engine_stream_counts(LineCrossEngineWrapper* wrapper, int stream_id,
+                                     uint32_t* entries, uint32_t* exits, uint32_t* occupancy) {
+    *entries = *exits = *occupancy = 0;
+    if (!wrapper || !wrapper->engine)
+        return;
+    wrapper->engine->stream_counts(stream_id, entries, exits, occupancy);
+}
+
+// ROI count
+unsigned line_cross_engine_num_rois(LineCrossEngineWrapper* wrapper, int stream_id) {
+    if (!wrapper || !wrapper->engine)
+        return 0;
+    return wrapper->engine->num_rois(stream_id);
+}
+
+// ROI label
+const char* line_cross_engine_roi_label(LineCrossEngineWrapper* wrapper, int stream_id,
+                                        uint32_t roi_mask) {
+    if (!wrapper || !wrapper->engine)
+        return nullptr;
+    return wrapper->engine->roi_label(stream_id, roi_mask);
+}
+
+// Summary
+void line_cross_engine_print_summary(LineCrossEngineWrapper* wrapper) {
+    if (wrapper && wrapper->engine)
+        wrapper->engine->print_summary();
+}
@@ -0,0 +1,67 @@
+#ifndef LINE_CROSS_ENGINE_WRAPPER_H
+#define LINE_CROSS_ENGINE_WRAPPER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct LineCrossEngineWrapper LineCrossEngineWrapper;
+
+// A tracked object of a frame; bbox is left, top, width, height in the
+// frame resolution given at creation
+typedef struct {
+    uint64_t object_id;
+    int class_id;
+    float bbox[4];
+} LineCrossObject;
+
+// What an object did on a frame. line is the label of the first line it
+// crossed (NULL if none), roi the label of the first ROI it is in (NULL if
+// none); both stay valid as long as the engine.
+typedef struct {
+    const char* line;
+    const char* roi;
+    uint32_t entries;     // entry lines crossed on this frame
+    uint32_t exits;       // exit lines crossed on this frame
+    uint32_t line_count;  // cumulative crossings of line
+    uint32_t roi_mask;    // bit i: inside the i-th ROI of the stream
+} LineCrossResult;
+
+// Create an engine from the [line-crossing-stream-N] and
+// [roi-filtering-stream-N] groups of an nvdsanalytics config file, scaled
+// from its config-width/height to frame_width/height; NULL on error
+LineCrossEngineWrapper* create_line_cross_engine(const char* config_path, int frame_width,
+                                                 int frame_height);
+void destroy_line_cross_engine(LineCrossEngineWrapper* engine);
+
+// Evaluate every object of a frame against the lines and ROIs of its
+// stream; results may be NULL
+void line_cross_engine_process(LineCrossEngineWrapper* engine, int stream_id, int frame_num,
+                               const LineCrossObject* objects, unsigned num_objects,
+                               LineCrossResult* results);
+
+// Returns 1 and the result of the object if it was processed on frame_num
+int line_cross_engine_object(LineCrossEngineWrapper* engine, int stream_id, uint64_t object_id,
+                             int frame_num, LineCrossResult* result);
+
+// Cumulative entries, exits and occupancy of a stream
+void line_cross_engine_stream_counts(LineCrossEngineWrapper* engine, int stream_id,
+                                     uint32_t* entries, uint32_t* exits, uint32_t* occupancy);
+
+// Number of ROIs of a stream
+unsigned line_cross_engine_num_rois(LineCrossEngineWrapper* engine, int stream_id);
+
+// Label of the lowest ROI set in roi_mask, NULL if none; thread safe
+const char* line_cross_engine_roi_label(LineCrossEngineWrapper* engine, int stream_id,
+                                        uint32_t roi_mask);
+
+// One line per configured stream with the count of every line
+void line_cross_engine_print_summary(LineCrossEngineWrapper* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LINE_CROSS_ENGINE_WRAPPER_H
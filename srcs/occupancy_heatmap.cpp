@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "occupancy_heatmap.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "event_codec.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+bool OccupancyHeatmap::init(unsigned frame_width, unsigned frame_height, unsigned cell_size,
+                            unsigned interval_ms) {
+    if (!frame_width || !frame_height || !cell_size || !interval_ms) {
+        std::cerr << "OccupancyHeatmap: frame size, cell size and interval must be set"
+                  << std::endl;
+        return false;
+    }
+    grid_width_ = (frame_width + cell_size - 1) / cell_size;
+    grid_height_ = (frame_height + cell_size - 1) / cell_size;
+    if (grid_width_ > UINT16_MAX || grid_height_ > UINT16_MAX || cell_size > UINT16_MAX) {
+        std::cerr << "OccupancyHeatmap: grid of " << grid_width_ << "x" << grid_height_
+                  << " cells is too large" << std::endl;
+        return false;
+    }
+    cell_size_ = cell_size;
+    interval_ns_ = (uint64_t) interval_ms * 1000000;
+    streams_.clear();
+    return true;
+}
+
+void OccupancyHeatmap::bin(const float *boxes, size_t count, uint32_t *cells) {
+    /// Foot point in cells, clamped to the grid; NaNs land in cell 0
+    const float inv_cell = 1.f / cell_size_;
+    const float max_x = (float) (grid_width_ - 1), max_y = (float) (grid_height_ - 1);
+    indices_.resize(count);
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 vinv = _mm_set1_ps(inv_cell), vhalf = _mm_set1_ps(0.5f);
+    const __m128 vzero = _mm_setzero_ps(), vmax_x = _mm_set1_ps(max_x);
+    const __m128 vmax_y = _mm_set1_ps(max_y), vwidth = _mm_set1_ps((float) grid_width_);
+    for (; i + 4 <= count; i += 4) {
+        __m128 left = _mm_loadu_ps(boxes + 4 * i), top = _mm_loadu_ps(boxes + 4 * i + 4);
+        __m128 width = _mm_loadu_ps(boxes + 4 * i + 8), height = _mm_loadu_ps(boxes + 4 * i + 12);
+        _MM_TRANSPOSE4_PS(left, top, width, height);
+        __m128 x = _mm_mul_ps(_mm_add_ps(left, _mm_mul_ps(width, vhalf)), vinv);
+        __m128 y = _mm_mul_ps(_mm_add_ps(top, height), vinv);
+        x = _mm_min_ps(_mm_max_ps(x, vzero), vmax_x);
+        y = _mm_min_ps(_mm_max_ps(y, vzero), vmax_y);
+        __m128 row = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+        __m128i index = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(row, vwidth), x));
+        _mm_storeu_si128((__m128i *) &indices_[i], index);
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t vzero = vdupq_n_f32(0.f), vmax_x = vdupq_n_f32(max_x);
+    const float32x4_t vmax_y = vdupq_n_f32(max_y), vwidth = vdupq_n_f32((float) grid_width_);
+    for (; i + 4 <= count; i += 4) {
+        float32x4x4_t box = vld4q_f32(boxes + 4 * i);
+        float32x4_t x = vmulq_n_f32(vmlaq_n_f32(box.val[0], box.val[2], 0.5f), inv_cell);
+        float32x4_t y = vmulq_n_f32(vaddq_f32(box.val[1], box.val[3]), inv_cell);
+        x = vminq_f32(vmaxq_f32(x, vzero), vmax_x);
+        y = vminq_f32(vmaxq_f32(y, vzero), vmax_y);
+        float32x4_t row = vcvtq_f32_s32(vcvtq_s32_f32(y));
+        vst1q_s32(&indices_[i], vcvtq_s32_f32(vmlaq_f32(x, row, vwidth)));
+    }
+#endif
+    for (; i < count; i++) {
+        const float *box = boxes + 4 * i;
+        float x = (box[0] + box[2] * 0.5f) * inv_cell, y = (box[1] + box[3]) * inv_cell;
+        x = x > 0.f ? std::min(x, max_x) : 0.f;
+        y = y > 0.f ? std::min(y, max_y) : 0.f;
+        indices_[i] = (int32_t) ((float) (int32_t) y * grid_width_ + x);
+    }
+    for (size_t k = 0; k < count; k++)
+        cells[indices_[k]]++;
+}
+
+void OccupancyHeatmap::add_frame(unsigned stream_id, uint64_t pts_ns, const float *boxes,
+                                 size_t count) {
+    if (stream_id >= streams_.size())
+        streams_.resize(stream_id + 1);
+    Stream &stream = streams_[stream_id];
+    if (stream.cells.empty())
+        stream.cells.assign((size_t) grid_width_ * grid_height_, 0);
+    if (stream.occupancy.empty())
+        stream.start_ns = pts_ns;
+    stream.last_ns = pts_ns;
+    stream.occupancy.push_back((uint16_t) std::min<size_t>(count, UINT16_MAX));
+    if (count)
+        bin(boxes, count, stream.cells.data());
+}
+
+bool OccupancyHeatmap::flush(unsigned stream_id, int sensor_id, uint64_t pts_ns,
+                             uint64_t utc_ns, bool force, char **payload,
+                             size_t *payload_size) {
+    if (stream_id >= streams_.size())
+        return false;
+    Stream &stream = streams_[stream_id];
+    if (stream.occupancy.empty())
+        return false;
+    /// A stream restarting (pts going backwards) closes the window too
+    if (!force && pts_ns >= stream.start_ns && pts_ns - stream.start_ns < interval_ns_)
+        return false;
+
+    EventCodecHeatmap heatmap;
+    heatmap.sensor_id = sensor_id;
+    heatmap.grid_width = (uint16_t) grid_width_;
+    heatmap.grid_height = (uint16_t) grid_height_;
+    heatmap.cell_size = (uint16_t) cell_size_;
+    uint64_t span_ns = stream.last_ns >= stream.start_ns ? stream.last_ns - stream.start_ns : 0;
+    heatmap.end_us = (int64_t) (utc_ns / 1000);
+    heatmap.start_us = (int64_t) ((utc_ns - std::min(span_ns, utc_ns)) / 1000);
+    heatmap.num_frames = (uint32_t) stream.occupancy.size();
+    heatmap.cells = stream.cells.data();
+    heatmap.occupancy = stream.occupancy.data();
+    uint8_t *message = (uint8_t *) malloc(event_codec_heatmap_max_size(&heatmap));
+    if (!message)
+        return false;
+    *payload_size = event_codec_write_heatmap(message, &heatmap);
+    *payload = (char *) message;
+
+    std::fill(stream.cells.begin(), stream.cells.end(), 0);
+    stream.occupancy.clear();
+    return true;
+}
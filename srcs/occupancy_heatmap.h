@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Per-stream occupancy heatmap, exported periodically instead of the
+/// position of every detection.
+///
+/// Every frame, the foot point (bottom center) of each box is binned into
+/// a grid of cell_size pixel cells, and the number of boxes is appended to
+/// the stream's occupancy series. Windows are timed on the stream's pts;
+/// the message carries UTC times, derived from the UTC of the last frame
+/// given to flush(). When interval_ms of stream time have passed since
+/// the first frame of the window, flush() encodes the counts
+/// and the series as an event_codec.h heatmap message (sparse varints, a
+/// few hundred bytes for a typical scene) and starts a new window.
+///
+/// Cell indices are computed four boxes at a time with SSE2 or NEON; the
+/// increments themselves stay scalar, since boxes of a frame often share a
+/// cell. Buffers are kept between windows, so a frame does not allocate in
+/// steady state.
+class OccupancyHeatmap {
+public:
+    bool init(unsigned frame_width, unsigned frame_height, unsigned cell_size,
+              unsigned interval_ms);
+
+    void add_frame(unsigned stream_id, uint64_t pts_ns, const float *boxes, size_t count);
+
+    /// @param [in] utc_ns UTC time of the last frame added
+    /// @param [out] payload malloc'ed message, owned by the caller
+    bool flush(unsigned stream_id, int sensor_id, uint64_t pts_ns, uint64_t utc_ns, bool force,
+               char **payload, size_t *payload_size);
+
+private:
+    struct Stream {
+        std::vector<uint32_t> cells;
+        std::vector<uint16_t> occupancy;
+        uint64_t start_ns = 0;
+        uint64_t last_ns = 0;
+    };
+
+    void bin(const float *boxes, size_t count, uint32_t *cells);
+
+    unsigned grid_width_ = 0;
+    unsigned grid_height_ = 0;
+    unsigned cell_size_ = 0;
+    uint64_t interval_ns_ = 0;
+    std::vector<Stream> streams_;
+    std::vector<int32_t> indices_;
+};
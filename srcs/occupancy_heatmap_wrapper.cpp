@@ -0,0 +1,45 @@
+#include "occupancy_heatmap_wrapper.h"
+#include "occupancy_heatmap.h"
+
+// Wrapper struct to hold the actual C++ object
+struct OccupancyHeatmapWrapper {
+    OccupancyHeatmap* heatmap;
+};
+
+// Create and destroy
+OccupancyHeatmapWrapper* create_occupancy_heatmap(unsigned frame_width, unsigned frame_height,
+                                                  unsigned cell_size, unsigned interval_ms) {
+    OccupancyHeatmap* heatmap = new OccupancyHeatmap();
+    if (!heatmap->init(frame_width, frame_height, cell_size, interval_ms)) {
+        delete heatmap;
+        return nullptr;
+    }
+    OccupancyHeatmapWrapper* wrapper = new OccupancyHeatmapWrapper();
+    wrapper->heatmap = heatmap;
+    return wrapper;
+}
+
+void destroy_occupancy_heatmap(OccupancyHeatmapWrapper* wrapper) {
+    if (wrapper) {
+        delete wrapper->heatmap;
+        delete wrapper;
+    }
+}
+
+// Add
+void occupancy_heatmap_add_frame(OccupancyHeatmapWrapper* wrapper, unsigned stream_id,
+                                 uint64_t pts_ns, const float* boxes, unsigned num_boxes) {
+    if (!wrapper || !wrapper->heatmap)
+        return;
+    wrapper->heatmap->add_frame(stream_id, pts_ns, boxes, num_boxes);
+}
+
+// Flush
+int occupancy_heatmap_flush(OccupancyHeatmapWrapper* wrapper, unsigned stream_id, int sensor_id,
+                            uint64_t pts_ns, uint64_t utc_ns, int force, char** payload,
+                            size_t* payload_size) {
+    if (!wrapper || !wrapper->heatmap)
+        return 0;
+    return wrapper->heatmap->flush(stream_id, sensor_id, pts_ns, utc_ns, force != 0, payload,
+                                   payload_size) ? 1 : 0;
+}
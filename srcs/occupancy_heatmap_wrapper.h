@@ -0,0 +1,36 @@
+#ifndef OCCUPANCY_HEATMAP_WRAPPER_H
+#define OCCUPANCY_HEATMAP_WRAPPER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OccupancyHeatmapWrapper OccupancyHeatmapWrapper;
+
+// Create and destroy an OccupancyHeatmap object. The grid covers
+// frame_width x frame_height in cells of cell_size pixels; a stream's
+// window is exported every interval_ms of stream time.
+OccupancyHeatmapWrapper* create_occupancy_heatmap(unsigned frame_width, unsigned frame_height,
+                                                  unsigned cell_size, unsigned interval_ms);
+void destroy_occupancy_heatmap(OccupancyHeatmapWrapper* heatmap);
+
+// Bin the foot points of the boxes of a frame (left, top, width, height,
+// 4 floats per box); pts_ns is the stream time of the frame
+void occupancy_heatmap_add_frame(OccupancyHeatmapWrapper* heatmap, unsigned stream_id,
+                                 uint64_t pts_ns, const float* boxes, unsigned num_boxes);
+
+// Returns 1 and a malloc'ed event_codec.h heatmap message in payload when
+// the window of the stream is due at pts_ns (or force is set), 0
+// otherwise. utc_ns is the UTC time of the last frame added.
+int occupancy_heatmap_flush(OccupancyHeatmapWrapper* heatmap, unsigned stream_id, int sensor_id,
+                            uint64_t pts_ns, uint64_t utc_ns, int force, char** payload,
+                            size_t* payload_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OCCUPANCY_HEATMAP_WRAPPER_H
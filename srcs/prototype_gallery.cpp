@@ -0,0 +1,522 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "prototype_gallery.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <json-glib/json-glib.h>
+#include <libgen.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct GallerySnapshot {
+    unsigned dim = 0;
+    unsigned rows = 0;
+    EmbSimDataType dtype = EMB_SIM_FP32;
+    float scale = 1.f;
+    size_t row_stride = 0;
+    const void *matrix = nullptr;
+    const float *norms = nullptr;
+    const uint32_t *row_class = nullptr;
+    std::vector<const char *> labels;
+
+    /// Backing storage: heap buffers for JSON, a read-only mapping for binary
+    std::vector<float> owned_matrix;
+    std::vector<float> owned_norms;
+    std::vector<uint32_t> owned_row_class;
+    std::vector<std::string> owned_labels;
+    void *map_addr = nullptr;
+    size_t map_size = 0;
+
+    ~GallerySnapshot() {
+        if (map_addr)
+            munmap(map_addr, map_size);
+    }
+};
+
+static size_t dtype_size(EmbSimDataType dtype) {
+    switch (dtype) {
+        case EMB_SIM_FP16:
+            return sizeof(uint16_t);
+        case EMB_SIM_INT8:
+            return sizeof(int8_t);
+        default:
+            return sizeof(float);
+    }
+}
+
+static float row_element(const GallerySnapshot &g, unsigned r, unsigned i) {
+    const uint8_t *row = static_cast<const uint8_t *>(g.matrix) + r * g.row_stride;
+    switch (g.dtype) {
+        case EMB_SIM_FP16:
+            return emb_sim_f16_to_f32(((const uint16_t *) row)[i]);
+        case EMB_SIM_INT8:
+            return ((const int8_t *) row)[i] * g.scale;
+        default:
+            return ((const float *) row)[i];
+    }
+}
+
+static bool is_binary_gallery(const std::string &path) {
+    char magic[sizeof(GalleryFileHeader::magic)] = {0};
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    size_t n = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+    return n == sizeof(magic) && memcmp(magic, GALLERY_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+PrototypeGallery::~PrototypeGallery() {
+    stop_watch();
+}
+
+bool PrototypeGallery::load(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        std::cerr << "Could not open gallery " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    bool loaded = is_binary_gallery(path) ? load_binary(path) : load_json(path);
+    if (loaded) {
+        file_dev_ = st.st_dev;
+        file_ino_ = st.st_ino;
+        file_mtime_ = st.st_mtim.tv_sec;
+        file_mtime_ns_ = st.st_mtim.tv_nsec;
+    }
+    return loaded;
+}
+
+bool PrototypeGallery::load_json(const std::string &path) {
+    GError *error = nullptr;
+    JsonParser *parser = json_parser_new();
+    if (!json_parser_load_from_file(parser, path.c_str(), &error)) {
+        std::cerr << "Could not parse gallery " << path << ": " << error->message << "\n";
+        g_error_free(error);
+        g_object_unref(parser);
+        return false;
+    }
+
+    JsonNode *root = json_parser_get_root(parser);
+    JsonObject *root_obj = root && JSON_NODE_HOLDS_OBJECT(root) ? json_node_get_object(root) : nullptr;
+    if (!root_obj || !json_object_has_member(root_obj, "classes")) {
+        std::cerr << "Gallery " << path << " has no \"classes\" array\n";
+        g_object_unref(parser);
+        return false;
+    }
+
+    auto g = std::make_shared<GallerySnapshot>();
+    unsigned dim = 0;
+
+    JsonArray *classes = json_object_get_array_member(root_obj, "classes");
+    for (guint c = 0; c < json_array_get_length(classes); c++) {
+        JsonObject *cls = json_array_get_object_element(classes, c);
+        if (!cls || !json_object_has_member(cls, "label") || !json_object_has_member(cls, "embeddings")) {
+            std::cerr << "Gallery " << path << ": class " << c << " needs \"label\" and \"embeddings\"\n";
+            continue;
+        }
+        JsonArray *embeddings = json_object_get_array_member(cls, "embeddings");
+        const unsigned class_index = g->owned_labels.size();
+        bool class_used = false;
+
+        for (guint e = 0; e < json_array_get_length(embeddings); e++) {
+            JsonArray *values = json_array_get_array_element(embeddings, e);
+            const unsigned len = values ? json_array_get_length(values) : 0;
+            if (len == 0)
+                continue;
+            if (dim == 0)
+                dim = len;
+            if (len != dim) {
+                std::cerr << "Gallery " << path << ": prototype " << e << " of class "
+                          << json_object_get_string_member(cls, "label") << " has " << len
+                          << " elements, expected " << dim << "\n";
+                continue;
+            }
+            size_t offset = g->owned_matrix.size();
+            g->owned_matrix.resize(offset + dim);
+            for (unsigned i = 0; i < dim; i++)
+                g->owned_matrix[offset + i] = (float) json_array_get_double_element(values, i);
+            g->owned_row_class.push_back(class_index);
+            class_used = true;
+        }
+        if (class_used)
+            g->owned_labels.push_back(json_object_get_string_member(cls, "label"));
+    }
+    g_object_unref(parser);
+
+    if (g->owned_row_class.empty()) {
+        std::cerr << "Gallery " << path << " has no usable prototype\n";
+        return false;
+    }
+
+    /// Normalize once so that cosine scoring is a plain dot product per row
+    const size_t rows = g->owned_row_class.size();
+    for (size_t r = 0; r < rows; r++) {
+        float *row = &g->owned_matrix[r * dim];
+        float norm = emb_sim_norm(row, dim);
+        if (norm > 0.f) {
+            for (unsigned i = 0; i < dim; i++)
+                row[i] /= norm;
+        }
+    }
+    g->owned_norms.assign(rows, 1.f);
+
+    g->dim = dim;
+    g->rows = rows;
+    g->row_stride = dim * sizeof(float);
+    g->matrix = g->owned_matrix.data();
+    g->norms = g->owned_norms.data();
+    g->row_class = g->owned_row_class.data();
+    for (const std::string &label : g->owned_labels)
+        g->labels.push_back(label.c_str());
+
+    std::atomic_store(&snapshot_, std::shared_ptr<const GallerySnapshot>(g));
+    return true;
+}
+
+bool PrototypeGallery::load_binary(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Could not open gallery " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(GalleryFileHeader)) {
+        std::cerr << "Gallery " << path << " is truncated\n";
+        close(fd);
+        return false;
+    }
+    const size_t size = st.st_size;
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Could not map gallery " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    /// From here the snapshot owns the mapping, every error path unmaps it
+    auto g = std::make_shared<GallerySnapshot>();
+    g->map_addr = addr;
+    g->map_size = size;
+
+    const uint8_t *base = static_cast<const uint8_t *>(addr);
+    GalleryFileHeader h;
+    memcpy(&h, base, sizeof(h));
+    auto in_file = [size](uint64_t offset, uint64_t bytes) {
+        return offset <= size && bytes <= size - offset;
+    };
+
+    const char *problem = nullptr;
+    if (h.version != GALLERY_FILE_VERSION)
+        problem = "unsupported version";
+    else if (h.dim == 0 || h.rows == 0 || h.classes == 0)
+        problem = "empty gallery";
+    else if (h.dtype > EMB_SIM_INT8)
+        problem = "unknown element type";
+    else if (h.row_stride < h.dim * dtype_size((EmbSimDataType) h.dtype))
+        problem = "row stride smaller than a row";
+    else if (h.matrix_offset % GALLERY_MATRIX_ALIGN)
+        problem = "misaligned matrix";
+    else if (!in_file(h.matrix_offset, (uint64_t) h.rows * h.row_stride))
+        problem = "matrix out of bounds";
+    else if (h.row_class_offset % alignof(uint32_t) || !in_file(h.row_class_offset, (uint64_t) h.rows * sizeof(uint32_t)))
+        problem = "row class table out of bounds";
+    else if ((h.flags & GALLERY_FLAG_NORMS) &&
+             (h.norms_offset % alignof(float) || !in_file(h.norms_offset, (uint64_t) h.rows * sizeof(float))))
+        problem = "norms out of bounds";
+    else if (!in_file(h.labels_offset, h.labels_size))
+        problem = "label table out of bounds";
+    if (problem) {
+        std::cerr << "Gallery " << path << ": " << problem << "\n";
+        return false;
+    }
+
+    /// Label table: classes NUL-terminated strings
+    const char *label = (const char *) base + h.labels_offset;
+    const char *labels_end = label + h.labels_size;
+    for (uint32_t c = 0; c < h.classes; c++) {
+        const char *end = (const char *) memchr(label, '\0', labels_end - label);
+        if (!end) {
+            std::cerr << "Gallery " << path << ": label table has " << c << " labels, expected "
+                      << h.classes << "\n";
+            return false;
+        }
+        g->labels.push_back(label);
+        label = end + 1;
+    }
+
+    g->row_class = (const uint32_t *) (base + h.row_class_offset);
+    for (uint32_t r = 0; r < h.rows; r++) {
+        if (g->row_class[r] >= h.classes) {
+            std::cerr << "Gallery " << path << ": row " << r << " has class " << g->row_class[r]
+                      << " of " << h.classes << "\n";
+            return false;
+        }
+    }
+
+    g->dim = h.dim;
+    g->rows = h.rows;
+    g->dtype = (EmbSimDataType) h.dtype;
+    g->scale = h.scale;
+    g->row_stride = h.row_stride;
+    g->matrix = base + h.matrix_offset;
+    if (h.flags & GALLERY_FLAG_NORMS) {
+        g->norms = (const float *) (base + h.norms_offset);
+    } else {
+        /// Older writers may omit norms; compute them once instead of per query
+        g->owned_norms.resize(h.rows);
+        std::vector<float> row(h.dim);
+        for (uint32_t r = 0; r < h.rows; r++) {
+            for (uint32_t i = 0; i < h.dim; i++)
+                row[i] = row_element(*g, r, i);
+            g->owned_norms[r] = emb_sim_norm(row.data(), h.dim);
+        }
+        g->norms = g->owned_norms.data();
+    }
+
+    std::atomic_store(&snapshot_, std::shared_ptr<const GallerySnapshot>(g));
+    return true;
+}
+
+bool PrototypeGallery::save_binary(const std::string &path, EmbSimDataType dtype) const {
+    std::shared_ptr<const GallerySnapshot> g = std::atomic_load(&snapshot_);
+    if (!g) {
+        std::cerr << "No gallery loaded, nothing to save to " << path << "\n";
+        return false;
+    }
+
+    GalleryFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, GALLERY_FILE_MAGIC, sizeof(h.magic));
+    h.version = GALLERY_FILE_VERSION;
+    h.flags = GALLERY_FLAG_NORMS;
+    h.dim = g->dim;
+    h.rows = g->rows;
+    h.classes = g->labels.size();
+    h.dtype = dtype;
+    h.scale = 1.f;
+    h.row_stride = (g->dim * dtype_size(dtype) + GALLERY_MATRIX_ALIGN - 1) / GALLERY_MATRIX_ALIGN * GALLERY_MATRIX_ALIGN;
+    h.matrix_offset = (sizeof(h) + GALLERY_MATRIX_ALIGN - 1) / GALLERY_MATRIX_ALIGN * GALLERY_MATRIX_ALIGN;
+    h.row_class_offset = h.matrix_offset + (uint64_t) h.rows * h.row_stride;
+    h.norms_offset = h.row_class_offset + (uint64_t) h.rows * sizeof(uint32_t);
+    h.labels_offset = h.norms_offset + (uint64_t) h.rows * sizeof(float);
+    for (const char *label : g->labels)
+        h.labels_size += strlen(label) + 1;
+
+    if (dtype == EMB_SIM_INT8) {
+        /// Symmetric quantization with one scale for the whole matrix
+        float max_abs = 0.f;
+        for (unsigned r = 0; r < g->rows; r++)
+            for (unsigned i = 0; i < g->dim; i++)
+                max_abs = std::max(max_abs, std::fabs(row_element(*g, r, i)));
+        h.scale = max_abs > 0.f ? max_abs / 127.f : 1.f;
+    }
+
+    std::vector<uint8_t> file(h.labels_offset + h.labels_size, 0);
+    memcpy(file.data(), &h, sizeof(h));
+    std::vector<float> row(g->dim);
+    for (unsigned r = 0; r < g->rows; r++) {
+        for (unsigned i = 0; i < g->dim; i++)
+            row[i] = row_element(*g, r, i);
+        uint8_t *dst = &file[h.matrix_offset + (uint64_t) r * h.row_stride];
+        for (unsigned i = 0; i < g->dim; i++) {
+            switch (dtype) {
+                case EMB_SIM_FP16:
+                    ((uint16_t *) dst)[i] = emb_sim_f32_to_f16(row[i]);
+                    break;
+                case EMB_SIM_INT8:
+                    ((int8_t *) dst)[i] = (int8_t) std::lrint(std::max(-127.f, std::min(127.f, row[i] / h.scale)));
+                    break;
+                default:
+                    ((float *) dst)[i] = row[i];
+                    break;
+            }
+        }
+    }
+    /// Norms of the stored (possibly quantized) rows, matching what is scored
+    for (unsigned r = 0; r < g->rows; r++) {
+        const uint8_t *src = &file[h.matrix_offset + (uint64_t) r * h.row_stride];
+        for (unsigned i = 0; i < g->dim; i++) {
+            switch (dtype) {
+                case EMB_SIM_FP16:
+                    row[i] = emb_sim_f16_to_f32(((const uint16_t *) src)[i]);
+                    break;
+                case EMB_SIM_INT8:
+                    row[i] = ((const int8_t *) src)[i] * h.scale;
+                    break;
+                default:
+                    row[i] = ((const float *) src)[i];
+                    break;
+            }
+        }
+        float norm = emb_sim_norm(row.data(), g->dim);
+        memcpy(&file[h.norms_offset + r * sizeof(float)], &norm, sizeof(norm));
+    }
+    memcpy(&file[h.row_class_offset], g->row_class, (size_t) g->rows * sizeof(uint32_t));
+    uint8_t *labels = &file[h.labels_offset];
+    for (const char *label : g->labels) {
+        size_t len = strlen(label) + 1;
+        memcpy(labels, label, len);
+        labels += len;
+    }
+
+    std::string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Could not create " << tmp_path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    bool written = fwrite(file.data(), 1, file.size(), f) == file.size();
+    written = fclose(f) == 0 && written;
+    if (!written || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not write gallery " << path << ": " << strerror(errno) << "\n";
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool PrototypeGallery::watch(const std::string &path) {
+    if (watching_)
+        return true;
+    inotify_fd_ = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (inotify_fd_ < 0) {
+        perror("inotify_init");
+        return false;
+    }
+    /// Watch the directory for a file renamed onto path (rename(), mv,
+    /// symlink swap). The snapshot maps the file, so it must never be
+    /// rewritten in place, and files still being written or replaced are
+    /// not loaded: only a complete file moved into place is
+    std::vector<char> path_copy(path.begin(), path.end());
+    path_copy.push_back('\0');
+    if (inotify_add_watch(inotify_fd_, dirname(path_copy.data()), IN_MOVED_TO) < 0) {
+        perror("inotify_add_watch");
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+        return false;
+    }
+    watching_ = true;
+    watcher_ = std::thread(&PrototypeGallery::watch_loop, this, path);
+    return true;
+}
+
+void PrototypeGallery::stop_watch() {
+    if (!watching_)
+        return;
+    watching_ = false;
+    if (watcher_.joinable())
+        watcher_.join();
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+}
+
+void PrototypeGallery::watch_loop(std::string path) {
+    alignas(struct inotify_event) char buffer[4096];
+    const size_t slash = path.rfind('/');
+    const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    while (watching_) {
+        struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, 500) <= 0)
+            continue;
+        /// Drain the queue; a burst of renames onto path causes a single reload
+        bool replaced = false;
+        ssize_t length;
+        while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const struct inotify_event *event = (const struct inotify_event *) (buffer + offset);
+                if ((event->mask & IN_MOVED_TO) && event->len && name == event->name)
+                    replaced = true;
+                offset += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (!replaced)
+            continue;
+
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        if (st.st_dev == file_dev_ && st.st_ino == file_ino_ &&
+            st.st_mtim.tv_sec == file_mtime_ && st.st_mtim.tv_nsec == file_mtime_ns_)
+            continue;
+        /// A failed load keeps serving the previous gallery
+        if (load(path)) {
+            std::cout << "Gallery reloaded from " << path << ": " << num_classes() << " classes, "
+                      << num_prototypes() << " prototypes\n";
+        }
+    }
+}
+
+bool PrototypeGallery::classify(const float *embedding, unsigned dim, Match &match) const {
+    match = Match();
+    std::shared_ptr<const GallerySnapshot> g = std::atomic_load(&snapshot_);
+    if (!g || dim != g->dim)
+        return false;
+
+    static thread_local std::vector<float> scores;
+    scores.resize(g->rows);
+    emb_sim_score_batch(EMB_SIM_COSINE, embedding, g->dim, g->matrix, g->dtype, g->scale,
+                        g->rows, g->row_stride, g->norms, scores.data());
+
+    /// The best prototype also gives the best class (max over its prototypes)
+    size_t best = 0;
+    for (size_t r = 1; r < scores.size(); r++) {
+        if (scores[r] > scores[best])
+            best = r;
+    }
+    match.score = scores[best];
+    if (match.score < threshold_)
+        return false;
+    match.class_index = g->row_class[best];
+    match.label = g->labels[match.class_index];
+    match.gallery = std::move(g);
+    return true;
+}
+
+void PrototypeGallery::set_threshold(float threshold) {
+    threshold_ = threshold;
+}
+
+unsigned PrototypeGallery::dim() const {
+    std::shared_ptr<const GallerySnapshot> g = std::atomic_load(&snapshot_);
+    return g ? g->dim : 0;
+}
+
+size_t PrototypeGallery::num_prototypes() const {
+    std::shared_ptr<const GallerySnapshot> g = std::atomic_load(&snapshot_);
+    return g ? g->rows : 0;
+}
+
+size_t PrototypeGallery::num_classes() const {
+    std::shared_ptr<const GallerySnapshot> g = std::atomic_load(&snapshot_);
+    return g ? g->labels.size() : 0;
+}
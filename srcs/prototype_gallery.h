@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "embedding_similarity.h"
+
+/// Binary gallery file, all fields little-endian. Sections are referenced
+/// by absolute file offsets; the matrix is 64-byte aligned so it can be
+/// scored straight from the mapping.
+///
+///   header       GalleryFileHeader
+///   matrix       rows x row_stride bytes of dtype elements
+///   row_class    rows x uint32, class index of every row
+///   norms        rows x float32 L2 norms (optional, flag GALLERY_FLAG_NORMS)
+///   labels       classes NUL-terminated UTF-8 strings, back to back
+#define GALLERY_FILE_MAGIC "FSLGALRY"
+#define GALLERY_FILE_VERSION 1
+#define GALLERY_FLAG_NORMS 0x1
+#define GALLERY_MATRIX_ALIGN 64
+
+struct GalleryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t dim;
+    uint32_t rows;
+    uint32_t classes;
+    uint32_t dtype;        ///< EmbSimDataType
+    float scale;           ///< dequantization scale for EMB_SIM_INT8
+    uint32_t row_stride;   ///< bytes between two rows
+    uint64_t matrix_offset;
+    uint64_t row_class_offset;
+    uint64_t norms_offset;
+    uint64_t labels_offset;
+    uint64_t labels_size;
+};
+static_assert(sizeof(GalleryFileHeader) == 80, "GalleryFileHeader layout changed");
+
+/// Immutable support set, either parsed from JSON into owned buffers or
+/// mapped read-only from a binary gallery file.
+struct GallerySnapshot;
+
+/// Few-shot support set: every class is described by one or more reference
+/// embeddings (prototypes). An object embedding is scored with cosine
+/// similarity against every prototype and gets the label of the best one.
+///
+/// Two file formats are accepted, detected from the first bytes:
+/// - binary (see GalleryFileHeader), mapped with mmap and never copied
+/// - JSON, for small hand-written galleries:
+/// {
+///   "classes": [
+///     { "label": "soda_can", "embeddings": [[0.1, ...], [0.3, ...]] },
+///     { "label": "cereal_box", "embeddings": [[...]] }
+///   ]
+/// }
+///
+/// The active support set is swapped atomically on reload; classify() calls
+/// in flight keep scoring the previous one until they return.
+class PrototypeGallery {
+public:
+    struct Match {
+        int class_index = -1;
+        float score = 0.f;
+        /// Matched label, or "unknown"; valid as long as this Match lives
+        const char *label = "unknown";
+        std::shared_ptr<const GallerySnapshot> gallery;
+    };
+
+    ~PrototypeGallery();
+
+    /// Load the support set, replacing the current one.
+    /// @param [in] path Binary or JSON gallery file
+    /// @return true if at least one prototype was loaded
+    bool load(const std::string &path);
+
+    /// Write the current support set as a binary gallery. The file is
+    /// written next to path and renamed, so watchers never see it partially.
+    /// @param [in] dtype Element type of the written matrix
+    bool save_binary(const std::string &path, EmbSimDataType dtype = EMB_SIM_FP32) const;
+
+    /// Reload the gallery whenever a file is renamed onto path. Binary
+    /// galleries are mapped, so a new one must be written to a temporary
+    /// file and rename()d over path (as save_binary does), never rewritten
+    /// or truncated in place: readers of the current snapshot would fault.
+    bool watch(const std::string &path);
+    void stop_watch();
+
+    /// Score an embedding against every prototype.
+    /// @param [in] embedding Host embedding of dim() floats
+    /// @param [in] dim Number of elements in embedding
+    /// @param [out] match Best class and its cosine similarity
+    /// @return true if the best score reaches the threshold
+    bool classify(const float *embedding, unsigned dim, Match &match) const;
+
+    /// Minimum cosine similarity to accept a match.
+    void set_threshold(float threshold);
+
+    unsigned dim() const;
+    size_t num_prototypes() const;
+    size_t num_classes() const;
+
+private:
+    bool load_json(const std::string &path);
+    bool load_binary(const std::string &path);
+    void watch_loop(std::string path);
+
+    std::atomic<float> threshold_{0.f};
+    std::shared_ptr<const GallerySnapshot> snapshot_;
+
+    std::thread watcher_;
+    std::atomic<bool> watching_{false};
+    int inotify_fd_ = -1;
+    /// Identity of the file the current snapshot came from
+    dev_t file_dev_ = 0;
+    ino_t file_ino_ = 0;
+    time_t file_mtime_ = 0;
+    long file_mtime_ns_ = 0;
+};
@@ -0,0 +1,68 @@
+#include "prototype_gallery_wrapper.h"
+#include "prototype_gallery.h"
+
+#include <cstring>
+#include <iostream>
+
+// Wrapper struct to hold the actual C++ object
+struct PrototypeGalleryWrapper {
+    PrototypeGallery* gallery;
+};
+
+// Create and destroy
+PrototypeGalleryWrapper* create_prototype_gallery() {
+    PrototypeGalleryWrapper* wrapper = new PrototypeGalleryWrapper();
+    wrapper->gallery = new PrototypeGallery();
+    return wrapper;
+}
+
+void destroy_prototype_gallery(PrototypeGalleryWrapper* wrapper) {
+    if (wrapper) {
+        delete wrapper->gallery;
+        delete wrapper;
+    }
+}
+
+// Load
+int prototype_gallery_load(PrototypeGalleryWrapper* wrapper, const char* path, float threshold) {
+    if (!wrapper || !wrapper->gallery || !path)
+        return 0;
+    wrapper->gallery->set_threshold(threshold);
+    if (!wrapper->gallery->load(std::string(path)))
+        return 0;
+    std::cout << "Loaded gallery " << path << ": " << wrapper->gallery->num_classes()
+              << " classes, " << wrapper->gallery->num_prototypes() << " prototypes of dim "
+              << wrapper->gallery->dim() << "\n";
+    return 1;
+}
+
+// Classify
+int prototype_gallery_classify(PrototypeGalleryWrapper* wrapper,
+                               const float* embedding, unsigned dim,
+                               char* label, size_t label_size, float* score) {
+    if (!wrapper || !wrapper->gallery)
+        return -1;
+    PrototypeGallery::Match match;
+    wrapper->gallery->classify(embedding, dim, match);
+    if (label && label_size > 0) {
+        strncpy(label, match.label, label_size - 1);
+        label[label_size - 1] = '\0';
+    }
+    if (score)
+        *score = match.score;
+    return match.class_index;
+}
+
+// Save
+int prototype_gallery_save(PrototypeGalleryWrapper* wrapper, const char* path, int fp16) {
+    if (!wrapper || !wrapper->gallery || !path)
+        return 0;
+    return wrapper->gallery->save_binary(std::string(path), fp16 ? EMB_SIM_FP16 : EMB_SIM_FP32) ? 1 : 0;
+}
+
+// Hot reload
+int prototype_gallery_watch(PrototypeGalleryWrapper* wrapper, const char* path) {
+    if (!wrapper || !wrapper->gallery || !path)
+        return 0;
+    return wrapper->gallery->watch(std::string(path)) ? 1 : 0;
+}
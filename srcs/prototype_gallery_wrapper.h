@@ -0,0 +1,37 @@
+#ifndef PROTOTYPE_GALLERY_WRAPPER_H
+#define PROTOTYPE_GALLERY_WRAPPER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PrototypeGalleryWrapper PrototypeGalleryWrapper;
+
+// Create and destroy a PrototypeGallery object
+PrototypeGalleryWrapper* create_prototype_gallery();
+void destroy_prototype_gallery(PrototypeGalleryWrapper* gallery);
+
+// Load the support set; returns 1 on success
+int prototype_gallery_load(PrototypeGalleryWrapper* gallery, const char* path, float threshold);
+
+// Classify a host embedding. Returns the class index, or -1 when the best
+// score is below the threshold. The best label is copied to label (may be
+// "unknown") and the cosine similarity to score.
+int prototype_gallery_classify(PrototypeGalleryWrapper* gallery,
+                               const float* embedding, unsigned dim,
+                               char* label, size_t label_size, float* score);
+
+// Write the loaded gallery in the binary (mmap) format, fp32 or fp16 rows;
+// returns 1 on success
+int prototype_gallery_save(PrototypeGalleryWrapper* gallery, const char* path, int fp16);
+
+// Reload the gallery whenever the file at path is replaced; returns 1 on success
+int prototype_gallery_watch(PrototypeGalleryWrapper* gallery, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROTOTYPE_GALLERY_WRAPPER_H
@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rfc3339_timestamp.h"
+
+#include <glib.h>
+#include <string.h>
+
+/** Two-digit strings of 0..99, back to back */
+static const char digit_pairs[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334"
+    "3536373839404142434445464748495051525354555657585960616263646566676869"
+    "707172737475767778798081828384858687888990919293949596979899";
+
+#define RFC3339_PREFIX_LEN 19 /**< YYYY-MM-DDTHH:MM:SS */
+
+/**
+ * Per-thread "YYYY-MM-DDTHH:MM:SS" of the last second formatted: events
+ * of the same second only write their milliseconds
+ */
+typedef struct {
+  time_t second;
+  gboolean valid;
+  guint prefix_len;
+  char prefix[32];
+} Rfc3339Cache;
+
+static __thread Rfc3339Cache rfc3339_cache;
+
+static inline char *write_digit_pair(char *out, guint value) {
+  memcpy(out, &digit_pairs[value * 2], 2);
+  return out + 2;
+}
+
+void write_ts_rfc3339(char *buf, int buf_size, time_t second, int ms) {
+  Rfc3339Cache *cache = &rfc3339_cache;
+  if (!cache->valid || cache->second != second) {
+    struct tm tm_log;
+    gmtime_r(&second, &tm_log);
+    guint year = tm_log.tm_year + 1900;
+    if (year >= 1000 && year <= 9999) {
+      char *out = cache->prefix;
+      out = write_digit_pair(out, year / 100);
+      out = write_digit_pair(out, year % 100);
+      *out++ = '-';
+      out = write_digit_pair(out, tm_log.tm_mon + 1);
+      *out++ = '-';
+      out = write_digit_pair(out, tm_log.tm_mday);
+      *out++ = 'T';
+      out = write_digit_pair(out, tm_log.tm_hour);
+      *out++ = ':';
+      out = write_digit_pair(out, tm_log.tm_min);
+      *out++ = ':';
+      out = write_digit_pair(out, tm_log.tm_sec);
+      cache->prefix_len = RFC3339_PREFIX_LEN;
+    } else {
+      cache->prefix_len = strftime(cache->prefix, sizeof(cache->prefix),
+                                   "%Y-%m-%dT%H:%M:%S", &tm_log);
+    }
+    cache->second = second;
+    cache->valid = TRUE;
+  }
+
+  char ts[sizeof(cache->prefix) + 5];
+  memcpy(ts, cache->prefix, cache->prefix_len);
+  char *out = ts + cache->prefix_len;
+  *out++ = '.';
+  *out++ = '0' + ms / 100;
+  out = write_digit_pair(out, ms % 100);
+  *out++ = 'Z';
+  *out = '\0';
+  g_strlcpy(buf, ts, buf_size);
+}
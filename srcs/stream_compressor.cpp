@@ -0,0 +1,284 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "stream_compressor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef ENABLE_COMPRESSION
+#include <lz4frame.h>
+#define ZSTD_STATIC_LINKING_ONLY
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+#define SEEK_TABLE_SKIPPABLE_MAGIC 0x184D2A5E
+#define SEEK_TABLE_FOOTER_MAGIC 0x8F92EAB1
+/// Sample bytes kept before training a dictionary
+#define DICT_TRAIN_BYTES (1 << 20)
+#define DICT_CAPACITY (32 << 10)
+#define DEFAULT_FRAME_SIZE (1 << 20)
+
+#ifdef ENABLE_COMPRESSION
+static double thread_cpu_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        out.push_back((value >> (8 * i)) & 0xff);
+}
+
+StreamCompressor::~StreamCompressor() {
+    release();
+}
+
+bool StreamCompressor::parse_codec(const std::string &name, Codec &codec) {
+    if (name == "none" || name == "0")
+        codec = NONE;
+    else if (name == "lz4" || name == "1")
+        codec = LZ4;
+    else if (name == "zstd" || name == "2")
+        codec = ZSTD;
+    else
+        return false;
+    return true;
+}
+
+const char *StreamCompressor::codec_name(Codec codec) {
+    switch (codec) {
+        case LZ4:
+            return "lz4";
+        case ZSTD:
+            return "zstd";
+        default:
+            return "none";
+    }
+}
+
+const char *StreamCompressor::extension(Codec codec) {
+    switch (codec) {
+        case LZ4:
+            return ".lz4";
+        case ZSTD:
+            return ".zst";
+        default:
+            return "";
+    }
+}
+
+void StreamCompressor::release() {
+#ifdef ENABLE_COMPRESSION
+    ZSTD_freeCDict((ZSTD_CDict *) cdict_);
+    ZSTD_freeCCtx((ZSTD_CCtx *) cctx_);
+#endif
+    cdict_ = nullptr;
+    cctx_ = nullptr;
+}
+
+bool StreamCompressor::init(Codec codec, int level, size_t frame_size, Sink sink,
+                            const std::string &dictionary_path) {
+    release();
+    codec_ = codec;
+    level_ = level;
+    frame_size_ = frame_size ? frame_size : DEFAULT_FRAME_SIZE;
+    sink_ = std::move(sink);
+    pending_.clear();
+    seek_table_.clear();
+    sample_sizes_.clear();
+    stats_ = Stats();
+    dictionary_path_ = dictionary_path;
+    training_ = false;
+    if (codec_ == NONE)
+        return true;
+
+#ifdef ENABLE_COMPRESSION
+    if (codec_ == ZSTD) {
+        ZSTD_CCtx *cctx = ZSTD_createCCtx();
+        cctx_ = cctx;
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level_ ? level_ : ZSTD_CLEVEL_DEFAULT);
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+        if (!dictionary_path_.empty())
+            return load_or_train_dictionary(false);
+    }
+    return true;
+#else
+    std::cerr << "StreamCompressor: " << codec_name(codec_)
+              << " needs a build with ENABLE_COMPRESSION=1\n";
+    codec_ = NONE;
+    return false;
+#endif
+}
+
+bool StreamCompressor::load_or_train_dictionary(bool force) {
+#ifdef ENABLE_COMPRESSION
+    std::vector<uint8_t> dict;
+    std::ifstream in(dictionary_path_, std::ios::binary);
+    if (in.good()) {
+        dict.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } else if (!force) {
+        /// Collect samples first
+        training_ = true;
+        return true;
+    } else {
+        training_ = false;
+        dict.resize(DICT_CAPACITY);
+        size_t size = ZDICT_trainFromBuffer(dict.data(), dict.size(), pending_.data(),
+                                            sample_sizes_.data(), sample_sizes_.size());
+        sample_sizes_.clear();
+        if (ZDICT_isError(size)) {
+            std::cerr << "StreamCompressor: no dictionary trained from " << pending_.size()
+                      << " bytes: " << ZDICT_getErrorName(size) << "\n";
+            return true;
+        }
+        dict.resize(size);
+        std::ofstream out(dictionary_path_, std::ios::binary | std::ios::trunc);
+        out.write((const char *) dict.data(), dict.size());
+        if (!out.good())
+            std::cerr << "StreamCompressor: could not save dictionary " << dictionary_path_ << "\n";
+    }
+    ZSTD_CDict *cdict = ZSTD_createCDict(dict.data(), dict.size(),
+                                         level_ ? level_ : ZSTD_CLEVEL_DEFAULT);
+    if (!cdict) {
+        std::cerr << "StreamCompressor: invalid dictionary " << dictionary_path_ << "\n";
+        return false;
+    }
+    cdict_ = cdict;
+    ZSTD_CCtx_refCDict((ZSTD_CCtx *) cctx_, cdict);
+    return true;
+#else
+    (void) force;
+    return false;
+#endif
+}
+
+bool StreamCompressor::compress_frame(const uint8_t *data, size_t size) {
+#ifdef ENABLE_COMPRESSION
+    double start = thread_cpu_seconds();
+    size_t compressed = 0;
+    if (codec_ == ZSTD) {
+        output_.resize(ZSTD_compressBound(size));
+        compressed = ZSTD_compress2((ZSTD_CCtx *) cctx_, output_.data(), output_.size(), data, size);
+        if (ZSTD_isError(compressed)) {
+            std::cerr << "StreamCompressor: " << ZSTD_getErrorName(compressed) << "\n";
+            return false;
+        }
+    } else {
+        LZ4F_preferences_t prefs;
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        prefs.frameInfo.contentSize = size;
+        prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+        prefs.compressionLevel = level_;
+        output_.resize(LZ4F_compressFrameBound(size, &prefs));
+        compressed = LZ4F_compressFrame(output_.data(), output_.size(), data, size, &prefs);
+        if (LZ4F_isError(compressed)) {
+            std::cerr << "StreamCompressor: " << LZ4F_getErrorName(compressed) << "\n";
+            return false;
+        }
+    }
+    stats_.cpu_seconds += thread_cpu_seconds() - start;
+    if (!sink_(output_.data(), compressed))
+        return false;
+    seek_table_.emplace_back((uint32_t) compressed, (uint32_t) size);
+    stats_.bytes_out += compressed;
+    stats_.frames++;
+    return true;
+#else
+    (void) data;
+    (void) size;
+    return false;
+#endif
+}
+
+bool StreamCompressor::write(const void *data, size_t size) {
+    stats_.bytes_in += size;
+    if (codec_ == NONE) {
+        stats_.bytes_out += size;
+        return sink_(data, size);
+    }
+    const uint8_t *bytes = (const uint8_t *) data;
+    pending_.insert(pending_.end(), bytes, bytes + size);
+    if (training_) {
+        sample_sizes_.push_back(size);
+        if (pending_.size() < DICT_TRAIN_BYTES)
+            return true;
+        load_or_train_dictionary(true);
+    }
+    if (pending_.size() < frame_size_)
+        return true;
+
+    size_t offset = 0;
+    bool ok = true;
+    for (; ok && pending_.size() - offset >= frame_size_; offset += frame_size_)
+        ok = compress_frame(pending_.data() + offset, frame_size_);
+    pending_.erase(pending_.begin(), pending_.begin() + offset);
+    return ok;
+}
+
+bool StreamCompressor::flush() {
+    /// Frames are held back until the dictionary exists
+    if (codec_ == NONE || training_ || pending_.empty())
+        return true;
+    bool ok = compress_frame(pending_.data(), pending_.size());
+    pending_.clear();
+    return ok;
+}
+
+bool StreamCompressor::finish() {
+    if (codec_ == NONE)
+        return true;
+    if (training_ && !pending_.empty())
+        load_or_train_dictionary(true);
+    training_ = false;
+
+    bool ok = true;
+    size_t offset = 0;
+    for (; ok && offset < pending_.size(); offset += frame_size_)
+        ok = compress_frame(pending_.data() + offset, std::min(frame_size_, pending_.size() - offset));
+    pending_.clear();
+    if (!ok || seek_table_.empty())
+        return ok;
+
+    std::vector<uint8_t> table;
+    put_u32(table, SEEK_TABLE_SKIPPABLE_MAGIC);
+    put_u32(table, seek_table_.size() * 8 + 9);
+    for (const auto &entry : seek_table_) {
+        put_u32(table, entry.first);
+        put_u32(table, entry.second);
+    }
+    put_u32(table, seek_table_.size());
+    table.push_back(0);
+    put_u32(table, SEEK_TABLE_FOOTER_MAGIC);
+    seek_table_.clear();
+    stats_.bytes_out += table.size();
+    return sink_(table.data(), table.size());
+}
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// Compresses an append-only byte stream (event payloads, metadata files)
+/// into independent frames, so a reader can seek to a frame and decompress
+/// only that part.
+///
+/// Input is buffered until frame_size bytes, or flush(), then compressed in
+/// one shot into a standard zstd or LZ4 frame. finish() appends a seek table
+/// in a skippable frame, following the zstd seekable format:
+///   uint32 0x184D2A5E, uint32 table size,
+///   num_frames x { uint32 compressed size, uint32 decompressed size },
+///   uint32 num_frames, uint8 descriptor (0), uint32 0x8F92EAB1
+/// Both zstd and lz4 command line tools skip it, so the output still
+/// decompresses as a whole with them.
+///
+/// zstd can use a dictionary. If dictionary_path does not exist yet, the
+/// first writes (one sample each) are kept until enough data is seen, a
+/// dictionary is trained from them and saved there for the next runs.
+///
+/// The codecs are only compiled in with ENABLE_COMPRESSION=1 (libzstd and
+/// liblz4); otherwise init() rejects anything but NONE.
+class StreamCompressor {
+public:
+    enum Codec {
+        NONE = 0,
+        LZ4 = 1,
+        ZSTD = 2
+    };
+
+    struct Stats {
+        uint64_t bytes_in = 0;
+        uint64_t bytes_out = 0;
+        uint64_t frames = 0;
+        double cpu_seconds = 0;   ///< thread CPU time spent compressing
+        double ratio() const { return bytes_out ? (double) bytes_in / bytes_out : 0.; }
+    };
+
+    /// Receives the compressed bytes; returns false on error
+    using Sink = std::function<bool(const void *, size_t)>;
+
+    StreamCompressor() = default;
+    StreamCompressor(const StreamCompressor &) = delete;
+    StreamCompressor &operator=(const StreamCompressor &) = delete;
+    ~StreamCompressor();
+
+    /// @param [in] name "none", "lz4" or "zstd"
+    static bool parse_codec(const std::string &name, Codec &codec);
+    static const char *codec_name(Codec codec);
+    /// File name suffix of the codec, "" for NONE
+    static const char *extension(Codec codec);
+
+    /// @param [in] level Codec level; 0 for the codec default
+    /// @param [in] frame_size Uncompressed bytes per frame
+    /// @param [in] dictionary_path zstd dictionary, loaded or trained
+    bool init(Codec codec, int level, size_t frame_size, Sink sink,
+              const std::string &dictionary_path = "");
+
+    /// Append data; NONE passes it through immediately
+    bool write(const void *data, size_t size);
+    bool write(const std::string &data) { return write(data.data(), data.size()); }
+
+    /// Close the current frame
+    bool flush();
+
+    /// Close the current frame and write the seek table; the compressor can
+    /// be reused for a new output afterwards
+    bool finish();
+
+    Codec codec() const { return codec_; }
+    const Stats &stats() const { return stats_; }
+
+private:
+    bool compress_frame(const uint8_t *data, size_t size);
+    bool load_or_train_dictionary(bool force);
+    void release();
+
+    Codec codec_ = NONE;
+    int level_ = 0;
+    size_t frame_size_ = 0;
+    Sink sink_;
+    std::vector<uint8_t> pending_;
+    std::vector<uint8_t> output_;
+    std::vector<std::pair<uint32_t, uint32_t>> seek_table_;
+    Stats stats_;
+
+    std::string dictionary_path_;
+    bool training_ = false;
+    std::vector<size_t> sample_sizes_;
+    void *cctx_ = nullptr;
+    void *cdict_ = nullptr;
+};